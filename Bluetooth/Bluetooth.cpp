@@ -22,6 +22,7 @@
 #include "Bluetooth.h"
 
 #include <stdlib.h>
+#include <algorithm>
 
 // IMPLEMENTATION NOTE
 //
@@ -54,6 +55,7 @@ const string WPEFramework::Plugin::Bluetooth::METHOD_SET_NAME = "setName";
 const string WPEFramework::Plugin::Bluetooth::METHOD_SET_AUDIO_PLAYBACK_COMMAND = "sendAudioPlaybackCommand";
 const string WPEFramework::Plugin::Bluetooth::METHOD_SET_EVENT_RESPONSE = "respondToEvent";
 const string WPEFramework::Plugin::Bluetooth::METHOD_GET_DEVICE_INFO = "getDeviceInfo";
+const string WPEFramework::Plugin::Bluetooth::METHOD_GET_DEVICES_INFO = "getDevicesInfo";
 const string WPEFramework::Plugin::Bluetooth::METHOD_GET_AUDIO_INFO = "getAudioInfo";
 const string WPEFramework::Plugin::Bluetooth::METHOD_GET_API_VERSION_NUMBER = "getApiVersionNumber";
 const string WPEFramework::Plugin::Bluetooth::METHOD_GET_DEVICE_VOLUME_MUTE_INFO = "getDeviceVolumeMuteInfo";
@@ -119,6 +121,10 @@ namespace WPEFramework
         Bluetooth* Bluetooth::_instance = nullptr;
         static Core::TimerType<DiscoveryTimer> _discoveryTimer(64 * 1024, "DiscoveryTimer");
 
+        // Device properties include the signal level, so they are only reused for a short while
+        static const uint64_t DEVICE_INFO_MAX_AGE = 5000 * Core::Time::TicksPerMillisecond;
+        static const size_t DEVICE_INFO_MAX_ENTRIES = 64;
+
         BTRMGR_Result_t bluetoothSrv_EventCallback (BTRMGR_EventMessage_t eventMsg)
         {
             if (!Bluetooth::_instance) {
@@ -157,6 +163,7 @@ namespace WPEFramework
             registerMethod(METHOD_SET_AUDIO_PLAYBACK_COMMAND, &Bluetooth::sendAudioPlaybackCommandWrapper, this);
             registerMethod(METHOD_SET_EVENT_RESPONSE, &Bluetooth::setEventResponseWrapper, this);
             registerMethod(METHOD_GET_DEVICE_INFO, &Bluetooth::getDeviceInfoWrapper, this);
+            registerMethod(METHOD_GET_DEVICES_INFO, &Bluetooth::getDevicesInfoWrapper, this);
             registerMethod(METHOD_GET_AUDIO_INFO, &Bluetooth::getMediaTrackInfoWrapper, this);
             registerMethod(METHOD_GET_DEVICE_VOLUME_MUTE_INFO, &Bluetooth::getDeviceVolumeMuteInfoWrapper, this);
             registerMethod(METHOD_SET_DEVICE_VOLUME_MUTE_INFO, &Bluetooth::setDeviceVolumeMuteInfoWrapper, this);
@@ -186,6 +193,8 @@ namespace WPEFramework
             {
                 LOGWARN("Failed to UnRegister BTRMgr...!");
             }
+
+            invalidateDeviceInventory();
         }
 
         string Bluetooth::Information() const
@@ -349,9 +358,145 @@ namespace WPEFramework
             stopDeviceDiscovery();
         }
 
+        // DEVICE INVENTORY
+        //
+        // The discovered and paired device lists are kept as they were last returned by BTRMgr and
+        // are served from memory until an event from BTRMgr indicates that a list may have changed. Discovery
+        // updates carry everything a discovered device entry holds, so they are applied in place; the other
+        // events only invalidate the affected lists, which are then fetched again on the next query.
+        // Every invalidation or in-place update bumps the list generation, so a fetch that raced with an event
+        // does not overwrite the newer state.
+        // The connected device list is not kept: its activeState (the power status of the device) changes
+        // without any event from BTRMgr, so it is fetched on every query.
+
+        bool Bluetooth::getCachedDevices(const DeviceList& list, JsonArray& devices, uint32_t& generation)
+        {
+            std::lock_guard<std::mutex> lock(m_inventoryMutex);
+            generation = list.generation;
+            if (list.valid)
+            {
+                devices = list.devices;
+            }
+            return list.valid;
+        }
+
+        void Bluetooth::storeDevices(DeviceList& list, uint32_t generation, const JsonArray& devices)
+        {
+            std::lock_guard<std::mutex> lock(m_inventoryMutex);
+            if (list.generation == generation)
+            {
+                list.devices = devices;
+                list.valid = true;
+            }
+        }
+
+        // Must be called with m_inventoryMutex held
+        void Bluetooth::invalidateDevices(DeviceList& list)
+        {
+            list.valid = false;
+            list.generation++;
+            list.devices.Clear();
+        }
+
+        void Bluetooth::invalidateDeviceInventory()
+        {
+            std::lock_guard<std::mutex> lock(m_inventoryMutex);
+            invalidateDevices(m_discoveredDevices);
+            invalidateDevices(m_pairedDevices);
+            m_deviceInfo.clear();
+        }
+
+        // Must be called with m_inventoryMutex held
+        void Bluetooth::updateDiscoveredDevice(const BTRMGR_DiscoveredDevices_t& device)
+        {
+            if (!m_discoveredDevices.valid)
+            {
+                return;
+            }
+
+            const string deviceID = std::to_string(device.m_deviceHandle);
+            JsonArray devices;
+            bool found = false;
+
+            for (int i = 0; i < m_discoveredDevices.devices.Length(); i++)
+            {
+                JsonObject entry = m_discoveredDevices.devices[i].Object();
+                if (entry["deviceID"].String() != deviceID)
+                {
+                    devices.Add(entry);
+                }
+                else
+                {
+                    found = true;
+                    if (device.m_isDiscovered)
+                    {
+                        entry["name"] = string(device.m_name);
+                        entry["deviceType"] = string(BTRMGR_GetDeviceTypeAsString(device.m_deviceType));
+                        entry["connected"] = device.m_isConnected?true:false;
+                        entry["paired"] = device.m_isPairedDevice?true:false;
+                        devices.Add(entry);
+                    }
+                }
+            }
+
+            if (!found && device.m_isDiscovered)
+            {
+                JsonObject entry;
+                entry["deviceID"] = deviceID;
+                entry["name"] = string(device.m_name);
+                entry["deviceType"] = string(BTRMGR_GetDeviceTypeAsString(device.m_deviceType));
+                entry["connected"] = device.m_isConnected?true:false;
+                entry["paired"] = device.m_isPairedDevice?true:false;
+                devices.Add(entry);
+            }
+
+            m_discoveredDevices.devices = devices;
+            m_discoveredDevices.generation++;
+        }
+
+        void Bluetooth::updateDeviceInventory(const BTRMGR_EventMessage_t& eventMsg)
+        {
+            std::lock_guard<std::mutex> lock(m_inventoryMutex);
+            switch (eventMsg.m_eventType) {
+                case BTRMGR_EVENT_DEVICE_DISCOVERY_UPDATE:
+                    updateDiscoveredDevice(eventMsg.m_discoveredDevice);
+                    break;
+
+                case BTRMGR_EVENT_DEVICE_DISCOVERY_STARTED:
+                case BTRMGR_EVENT_DEVICE_DISCOVERY_COMPLETE:
+                    invalidateDevices(m_discoveredDevices);
+                    break;
+
+                case BTRMGR_EVENT_DEVICE_PAIRING_COMPLETE:
+                    invalidateDevices(m_discoveredDevices);
+                    invalidateDevices(m_pairedDevices);
+                    m_deviceInfo.erase(eventMsg.m_discoveredDevice.m_deviceHandle);
+                    break;
+
+                case BTRMGR_EVENT_DEVICE_UNPAIRING_COMPLETE:
+                case BTRMGR_EVENT_DEVICE_CONNECTION_COMPLETE:
+                case BTRMGR_EVENT_DEVICE_DISCONNECT_COMPLETE:
+                case BTRMGR_EVENT_DEVICE_FOUND:
+                case BTRMGR_EVENT_DEVICE_OUT_OF_RANGE:
+                    invalidateDevices(m_discoveredDevices);
+                    invalidateDevices(m_pairedDevices);
+                    m_deviceInfo.erase(eventMsg.m_pairedDevice.m_deviceHandle);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
         JsonArray Bluetooth::getDiscoveredDevices()
         {
             JsonArray deviceArray;
+            uint32_t generation;
+            if (getCachedDevices(m_discoveredDevices, deviceArray, generation))
+            {
+                return deviceArray;
+            }
+
             BTRMGR_DiscoveredDevicesList_t discoveredDevices;
 
             memset (&discoveredDevices, 0, sizeof(discoveredDevices));
@@ -374,6 +519,7 @@ namespace WPEFramework
                     deviceDetails["paired"] = discoveredDevices.m_deviceProperty[i].m_isPairedDevice?true:false;
                     deviceArray.Add(deviceDetails);
                 }
+                storeDevices(m_discoveredDevices, generation, deviceArray);
             }
             return deviceArray;
         }
@@ -381,6 +527,12 @@ namespace WPEFramework
         JsonArray Bluetooth::getPairedDevices()
         {
             JsonArray deviceArray;
+            uint32_t generation;
+            if (getCachedDevices(m_pairedDevices, deviceArray, generation))
+            {
+                return deviceArray;
+            }
+
             BTRMGR_PairedDevicesList_t pairedDevices;
 
             memset (&pairedDevices, 0, sizeof(pairedDevices));
@@ -402,6 +554,7 @@ namespace WPEFramework
                     deviceDetails["connected"] = pairedDevices.m_deviceProperty[i].m_isConnected?true:false;
                     deviceArray.Add(deviceDetails);
                 }
+                storeDevices(m_pairedDevices, generation, deviceArray);
             }
             return deviceArray;
         }
@@ -541,6 +694,10 @@ namespace WPEFramework
             {
                 LOGERR("Failed to do setBluetoothEnabled");
             }
+            else
+            {
+                invalidateDeviceInventory();
+            }
 
             return BTRMGR_RESULT_SUCCESS == rc;
         }
@@ -764,6 +921,16 @@ namespace WPEFramework
         {
             JsonObject deviceDetails;
             string profileInfo;
+            const uint64_t now = Core::Time::Now().Ticks();
+
+            {
+                std::lock_guard<std::mutex> lock(m_inventoryMutex);
+                auto cached = m_deviceInfo.find(deviceID);
+                if ((cached != m_deviceInfo.end()) && ((now - cached->second.fetched) < DEVICE_INFO_MAX_AGE))
+                {
+                    return cached->second.info;
+                }
+            }
 
             BTRMGR_Result_t rc = BTRMGR_RESULT_SUCCESS;
             BTRMgrDeviceHandle deviceHandle = (BTRMgrDeviceHandle) deviceID;
@@ -792,10 +959,40 @@ namespace WPEFramework
                     }
                 }
                 deviceDetails["supportedProfile"] = profileInfo;
+
+                std::lock_guard<std::mutex> lock(m_inventoryMutex);
+                if (m_deviceInfo.size() >= DEVICE_INFO_MAX_ENTRIES)
+                {
+                    for (auto it = m_deviceInfo.begin(); it != m_deviceInfo.end(); )
+                    {
+                        if ((now - it->second.fetched) >= DEVICE_INFO_MAX_AGE)
+                            it = m_deviceInfo.erase(it);
+                        else
+                            ++it;
+                    }
+                }
+                if (m_deviceInfo.size() < DEVICE_INFO_MAX_ENTRIES)
+                {
+                    m_deviceInfo[deviceID] = { deviceDetails, now };
+                }
             }
             return deviceDetails;
         }
 
+        JsonArray Bluetooth::getDevicesInfo(const std::vector<long long int>& deviceIDs)
+        {
+            JsonArray devicesInfo;
+            for (long long int deviceID : deviceIDs)
+            {
+                JsonObject deviceDetails = getDeviceInfo(deviceID);
+                if (deviceDetails.HasLabel("deviceID"))
+                {
+                    devicesInfo.Add(deviceDetails);
+                }
+            }
+            return devicesInfo;
+        }
+
         JsonObject Bluetooth::getMediaTrackInfo(long long int deviceID)
         {
             JsonObject               mediaTrackInfo;
@@ -830,6 +1027,7 @@ namespace WPEFramework
             string profileInfo;
             string eventId;
             LOGINFO ("Event notification: event of type %d received", eventMsg.m_eventType);
+            updateDeviceInventory(eventMsg);
             switch (eventMsg.m_eventType) {
                 case BTRMGR_EVENT_DEVICE_DISCOVERY_COMPLETE:
                     LOGINFO ("Received %s Event from BTRMgr", C_STR(STATUS_DISCOVERY_COMPLETED));
@@ -1663,6 +1861,46 @@ namespace WPEFramework
             returnResponse(successFlag);
         }
 
+        uint32_t Bluetooth::getDevicesInfoWrapper(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            std::vector<long long int> deviceIDs;
+
+            if (parameters.HasLabel("deviceIDs"))
+            {
+                JsonArray deviceIDsArray = parameters["deviceIDs"].Array();
+                for (int i = 0; i < deviceIDsArray.Length(); i++)
+                {
+                    const string deviceIDStr = deviceIDsArray[i].String();
+                    if (deviceIDStr.empty() || (deviceIDStr.find_first_not_of("0123456789") != string::npos))
+                    {
+                        LOGERR("Invalid deviceID '%s'", deviceIDStr.c_str());
+                        returnResponse(false);
+                    }
+                    deviceIDs.push_back(stoll(deviceIDStr));
+                }
+            }
+            else
+            {
+                // No list given: every device the settings UI can currently show
+                JsonArray devices[] = { getDiscoveredDevices(), getPairedDevices() };
+                for (JsonArray& deviceArray : devices)
+                {
+                    for (int i = 0; i < deviceArray.Length(); i++)
+                    {
+                        long long int deviceID = stoll(deviceArray[i].Object()["deviceID"].String());
+                        if (std::find(deviceIDs.begin(), deviceIDs.end(), deviceID) == deviceIDs.end())
+                        {
+                            deviceIDs.push_back(deviceID);
+                        }
+                    }
+                }
+            }
+
+            response["devicesInfo"] = getDevicesInfo(deviceIDs);
+            returnResponse(true);
+        }
+
         uint32_t Bluetooth::getMediaTrackInfoWrapper(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
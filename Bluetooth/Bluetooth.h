@@ -20,6 +20,9 @@
 #pragma once
 
 #include <thread>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include "Module.h"
 #include "utils.h"
@@ -95,6 +98,7 @@ namespace WPEFramework {
             uint32_t sendAudioPlaybackCommandWrapper(const JsonObject& parameters, JsonObject& response);
             uint32_t setEventResponseWrapper(const JsonObject& parameters, JsonObject& response);
             uint32_t getDeviceInfoWrapper(const JsonObject& parameters, JsonObject& response);
+            uint32_t getDevicesInfoWrapper(const JsonObject& parameters, JsonObject& response);
             uint32_t getMediaTrackInfoWrapper(const JsonObject& parameters, JsonObject& response);
             uint32_t getDeviceVolumeMuteInfoWrapper(const JsonObject& parameters, JsonObject& response);
             uint32_t setDeviceVolumeMuteInfoWrapper(const JsonObject& parameters, JsonObject& response);
@@ -121,11 +125,30 @@ namespace WPEFramework {
             bool setAudioControlCommand(long long int  deviceID, const string &audioCtrlCmd);
             bool setEventResponse(long long int  deviceID, const string &eventType, const string &respValue);
             JsonObject getDeviceInfo(long long int deviceID);
+            JsonArray getDevicesInfo(const std::vector<long long int>& deviceIDs);
             JsonObject getMediaTrackInfo(long long int deviceID);
             bool setDeviceVolumeMuteProperties(long long int  deviceID, const string &deviceProfile, unsigned char ui8volume, unsigned char mute);
             JsonObject getDeviceVolumeMuteProperties(long long int  deviceID, const string &deviceProfile);
             BTRMGR_DeviceOperationType_t btmgrDeviceOperationTypeFromString(const string &deviceProfile);
 
+            // Device inventory, see the note above getDiscoveredDevices()
+            struct DeviceList {
+                DeviceList() : valid(false), generation(0) {}
+                bool valid;
+                uint32_t generation;
+                JsonArray devices;
+            };
+            struct CachedDeviceInfo {
+                JsonObject info;
+                uint64_t fetched;
+            };
+            bool getCachedDevices(const DeviceList& list, JsonArray& devices, uint32_t& generation);
+            void storeDevices(DeviceList& list, uint32_t generation, const JsonArray& devices);
+            void invalidateDevices(DeviceList& list);
+            void invalidateDeviceInventory();
+            void updateDiscoveredDevice(const BTRMGR_DiscoveredDevices_t& device);
+            void updateDeviceInventory(const BTRMGR_EventMessage_t& eventMsg);
+
 
         public:
             static const short API_VERSION_NUMBER_MAJOR;
@@ -150,6 +173,7 @@ namespace WPEFramework {
             static const string METHOD_SET_AUDIO_PLAYBACK_COMMAND;
             static const string METHOD_SET_EVENT_RESPONSE;
             static const string METHOD_GET_DEVICE_INFO;
+            static const string METHOD_GET_DEVICES_INFO;
             static const string METHOD_GET_AUDIO_INFO;
             static const string METHOD_GET_API_VERSION_NUMBER;
             static const string METHOD_GET_DEVICE_VOLUME_MUTE_INFO;
@@ -223,6 +247,11 @@ namespace WPEFramework {
             bool m_discoveryRunning;
             DiscoveryTimer m_discoveryTimer;
             friend class DiscoveryTimer;
+
+            std::mutex m_inventoryMutex;
+            DeviceList m_discoveredDevices;
+            DeviceList m_pairedDevices;
+            std::map<long long int, CachedDeviceInfo> m_deviceInfo;
         };
 	} // Plugin
 } // WPEFramework
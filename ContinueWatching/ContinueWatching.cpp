@@ -33,6 +33,10 @@
   * This service will be enabled/disabled using an TR181 parameter.
   */
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <unistd.h>
 
 #include "ContinueWatching.h"
 
@@ -68,6 +72,7 @@ namespace WPEFramework {
 
 		ContinueWatching::ContinueWatching()
 		: AbstractPlugin()
+		, m_store(CW_LOCAL_FILE)
 		, m_apiVersionNumber((uint32_t)-1)
 		{
 			ContinueWatching::_instance = this;
@@ -84,6 +89,7 @@ namespace WPEFramework {
 
 		void ContinueWatching::Deinitialize(PluginHost::IShell* /* service */)
 		{
+			m_store.flush();
 			ContinueWatching::_instance = nullptr;
 		}
 
@@ -195,7 +201,7 @@ namespace WPEFramework {
 			{
 				ContinueWatchingImplFactory continueWatchingImplFactory;
 				ContinueWatchingImpl *continueWatchingImpl = NULL;
-				continueWatchingImpl = continueWatchingImplFactory.createContinueWatchingImpl(strApplicationName);
+				continueWatchingImpl = continueWatchingImplFactory.createContinueWatchingImpl(strApplicationName, m_store);
 				if (!continueWatchingImpl)
 				{
 					LOGERR("Application name not matched. Return empty string \n");
@@ -231,7 +237,7 @@ namespace WPEFramework {
 
 				ContinueWatchingImplFactory continueWatchingImplFactory;
 				ContinueWatchingImpl *continueWatchingImpl = NULL;
-				continueWatchingImpl = continueWatchingImplFactory.createContinueWatchingImpl(strApplicationName);
+				continueWatchingImpl = continueWatchingImplFactory.createContinueWatchingImpl(strApplicationName, m_store);
 				if (!continueWatchingImpl)
 					return false;
 
@@ -259,7 +265,7 @@ namespace WPEFramework {
 			{
 				ContinueWatchingImplFactory continueWatchingImplFactory;
 				ContinueWatchingImpl *continueWatchingImpl = NULL;
-				continueWatchingImpl = continueWatchingImplFactory.createContinueWatchingImpl(strApplicationName);
+				continueWatchingImpl = continueWatchingImplFactory.createContinueWatchingImpl(strApplicationName, m_store);
 				if (!continueWatchingImpl)
 					return false;
 
@@ -278,7 +284,8 @@ namespace WPEFramework {
 		 *
 		 * @return None.
 		 */
-		ContinueWatchingImpl::ContinueWatchingImpl()
+		ContinueWatchingImpl::ContinueWatchingImpl(ContinueWatchingStore& store)
+		: mStore(store)
 		{
 		}
 
@@ -475,231 +482,313 @@ namespace WPEFramework {
 		}
 
 		/**
-		 * @brief This function is used to write the protectedData into file.
+		 * @brief This function is used to delete the token from the store.
 		 *
-		 * @param[in] protectedData Variable of string.
+		 * @return True if a token was deleted.
+		 */
+		bool ContinueWatchingImpl::deleteToken()
+		{
+			if(!tr181FeatureEnabled()) {
+				LOGWARN("Feature DISABLED...\n");
+				return false;
+			}
+
+			return mStore.remove(mStrApplicationName);
+		}
+
+		/**
+		 * @brief Class ContinueWatchingStore Constructor, reads the tokens from the given file.
 		 *
-		 * @return True if it able to write data into file.
+		 * @param[in] path Location of the token file.
+		 *
+		 * @return None.
 		 */
-		bool ContinueWatchingImpl::writeToJson(std::string protectedData)
+		ContinueWatchingStore::ContinueWatchingStore(const std::string& path)
+		: m_path(path)
+		, m_dirty(false)
+		, m_written(true)
+		, m_stopping(false)
 		{
-			char *jsonDoc = NULL;
-			char *jsonOut = NULL;
-			cJSON *root = NULL;
-			bool createNewJsonDoc = true;
+			load();
+		}
 
-			FILE *file = fopen(CW_LOCAL_FILE, "r");
-			if (file) {
-				fseek(file, 0, SEEK_END);
-				long numbytes = ftell(file);
-				jsonDoc = (char*)malloc(sizeof(char)*(numbytes + 1));
-				if(jsonDoc == NULL) {
-					fclose(file);
-					return false;
-				}
+		/**
+		 * @brief Class ContinueWatchingStore Destructor, writes pending changes.
+		 *
+		 * @return None.
+		 */
+		ContinueWatchingStore::~ContinueWatchingStore()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_stopping = true;
+			}
+			m_changed.notify_all();
 
-				fseek(file, 0, SEEK_SET);
-				fread(jsonDoc, numbytes, 1, file);
-				fclose(file);
-				file = NULL;
-				jsonDoc[numbytes] = 0;
-
-				root = cJSON_Parse(jsonDoc);
-				cJSON *tokens = cJSON_GetObjectItem(root, "tokens");
-				if (tokens) {
-					int i;
-					bool tokenUpdated = false;
-					int tokensCount = cJSON_GetArraySize(tokens);
-					createNewJsonDoc = false;
-					for (i = 0; i < tokensCount; i++) {
-						cJSON *token = cJSON_GetArrayItem(tokens, i);
-						cJSON *item = cJSON_GetObjectItem(token, "applicationName");
-						if (item) {
-							//updating token data
-							if (strcmp(item->valuestring, mStrApplicationName.c_str()) == 0) {
-								tokenUpdated = true;
-								cJSON_ReplaceItemInObject(token, "encryptedData", cJSON_CreateString(protectedData.c_str()));
-				 				break;
-							}
-						}
-					}
+			if (m_thread.joinable())
+				m_thread.join();
 
-					//Adding new entry to list
-					if(!tokenUpdated) {
-						cJSON *jsonItem = cJSON_CreateObject();
+			flush();
+		}
 
-						cJSON_AddItemToObject(jsonItem, "applicationName", cJSON_CreateString(mStrApplicationName.c_str()));
-						cJSON_AddItemToObject(jsonItem, "encryptedData", cJSON_CreateString(protectedData.c_str()));
-						cJSON_AddItemToArray(tokens, jsonItem);
-					}
-				}
-				free(jsonDoc);
-				jsonDoc = NULL;
-			}
+		/**
+		 * @brief This function is used to look up the token of an application.
+		 *
+		 * @param[in] applicationName Name of the application.
+		 * @param[out] encryptedData The token as stored in the file.
+		 * @param[out] clearToken The token itself, empty if it was not decoded yet.
+		 *
+		 * @return True if the application has a token.
+		 */
+		bool ContinueWatchingStore::find(const std::string& applicationName, std::string& encryptedData, std::string& clearToken)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
 
-			if (createNewJsonDoc) {
-				cJSON *tokenArray;
-				cJSON *jsonItem;
+			std::map<std::string, Token>::const_iterator it = m_tokens.find(applicationName);
+			if (it == m_tokens.end())
+				return false;
 
-				cJSON_Delete(root);
-				root  = cJSON_CreateObject();
-				tokenArray=  cJSON_CreateArray();
-				cJSON_AddItemToObject(root, "tokens", tokenArray);
-				jsonItem = cJSON_CreateObject();
-				cJSON_AddItemToObject(jsonItem, "applicationName", cJSON_CreateString(mStrApplicationName.c_str()));
-				cJSON_AddItemToObject(jsonItem, "encryptedData", cJSON_CreateString(protectedData.c_str()));
-				cJSON_AddItemToArray(tokenArray, jsonItem);
+			encryptedData = it->second.encryptedData;
+			clearToken = it->second.clearToken;
+			return true;
+		}
+
+		/**
+		 * @brief This function is used to store a new token for an application.
+		 *
+		 * @param[in] applicationName Name of the application.
+		 * @param[in] encryptedData The token as it is to be stored in the file.
+		 * @param[in] clearToken The token itself.
+		 *
+		 * @return True if the token was written to the file, otherwise the previous token is kept.
+		 */
+		bool ContinueWatchingStore::set(const std::string& applicationName, const std::string& encryptedData, const std::string& clearToken)
+		{
+			Token previous;
+			bool existed;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+
+				std::map<std::string, Token>::iterator it = m_tokens.find(applicationName);
+				existed = (it != m_tokens.end());
+				if (existed)
+					previous = it->second;
+
+				Token& token = m_tokens[applicationName];
+				token.encryptedData = encryptedData;
+				token.clearToken = clearToken;
+				m_dirty = true;
 			}
 
-			jsonOut = cJSON_Print(root);
-			cJSON_Delete(root);
+			if (flush())
+				return true;
 
-			file = fopen(CW_LOCAL_FILE, "w");
-			if (!file) {
-				free(jsonOut);
-				jsonOut = NULL;
-				return false;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+
+				if (existed)
+					m_tokens[applicationName] = previous;
+				else
+					m_tokens.erase(applicationName);
 			}
+			// Other changes that were in the failed write are tried again later
+			scheduleWrite();
+			return false;
+		}
+
+		/**
+		 * @brief This function is used to remember the decoded token of an application.
+		 *
+		 * @param[in] applicationName Name of the application.
+		 * @param[in] clearToken The token itself.
+		 *
+		 * @return None.
+		 */
+		void ContinueWatchingStore::setDecoded(const std::string& applicationName, const std::string& clearToken)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
 
-			fprintf(file, "%s", jsonOut);
+			std::map<std::string, Token>::iterator it = m_tokens.find(applicationName);
+			if (it != m_tokens.end())
+				it->second.clearToken = clearToken;
+		}
 
-			fclose (file);
-			file = NULL;
-			free(jsonOut);
-			jsonOut = NULL;
+		/**
+		 * @brief This function is used to delete the token of an application.
+		 *
+		 * @param[in] applicationName Name of the application.
+		 *
+		 * @return True if the application had a token.
+		 */
+		bool ContinueWatchingStore::remove(const std::string& applicationName)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
 
+				if (m_tokens.erase(applicationName) == 0)
+					return false;
+			}
+			scheduleWrite();
 			return true;
 		}
 
 		/**
-		 * @brief This function is used to read the protectedData from file.
+		 * @brief This function is used to write pending changes to the file right away.
 		 *
-		 * @return protectedData.
+		 * @return True if the changes made so far are in the file.
 		 */
-		std::string ContinueWatchingImpl::readFromJson()
+		bool ContinueWatchingStore::flush()
 		{
-			char *jsonDoc = NULL;
-			std::string retVal = "";
-			FILE *file = fopen(CW_LOCAL_FILE, "r");
+			// Held until the file is replaced, so an older state never overwrites a newer one
+			std::lock_guard<std::mutex> writeLock(m_writeLock);
+			std::string document;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
 
-			if (!file)
-				return retVal;
+				// Nothing changed since the last write, which may have been done by the writer thread
+				if (!m_dirty)
+					return m_written;
 
-			fseek(file, 0, SEEK_END);
-			long numbytes = ftell(file);
-			jsonDoc = (char*)malloc(sizeof(char)*(numbytes + 1));
-			if(jsonDoc == NULL) {
-				fclose(file);
-				return retVal;
+				document = serialize();
+				m_dirty = false;
 			}
 
-			fseek(file, 0, SEEK_SET);
-			fread(jsonDoc, 1, numbytes, file);
-			fclose(file);
-			jsonDoc[numbytes] = '\0';
+			m_written = write(document);
+			if (!m_written)
+				LOGERR("Failed to write %s\n", m_path.c_str());
+			return m_written;
+		}
+
+		/**
+		 * @brief This function is used to read the tokens from the file.
+		 *
+		 * @return None.
+		 */
+		void ContinueWatchingStore::load()
+		{
+			std::ifstream file(m_path.c_str());
+			if (!file)
+				return;
+
+			std::stringstream buffer;
+			buffer << file.rdbuf();
+
+			cJSON *root = cJSON_Parse(buffer.str().c_str());
+			if (root == NULL) {
+				LOGERR("Failed to parse %s\n", m_path.c_str());
+				return;
+			}
 
-			cJSON *root = cJSON_Parse(jsonDoc);
 			cJSON *tokens = cJSON_GetObjectItem(root, "tokens");
 			int tokensCount = cJSON_GetArraySize(tokens);
-			int i;
-
-			for (i = 0; i < tokensCount; i++) {
+			for (int i = 0; i < tokensCount; i++) {
 				cJSON *token = cJSON_GetArrayItem(tokens, i);
-				cJSON *item = cJSON_GetObjectItem(token, "applicationName");
-				if (item) {
-					if (strcmp(item->valuestring, mStrApplicationName.c_str()) == 0) {
-						cJSON *encrypteDataItem = cJSON_GetObjectItem(token, "encryptedData");
-						if (encrypteDataItem){
-							retVal = encrypteDataItem->valuestring;
-						}
-						break;
-					}
+				cJSON *name = cJSON_GetObjectItem(token, "applicationName");
+				cJSON *encryptedData = cJSON_GetObjectItem(token, "encryptedData");
+				if (name && name->valuestring && encryptedData && encryptedData->valuestring) {
+					m_tokens[name->valuestring].encryptedData = encryptedData->valuestring;
 				}
 			}
 			cJSON_Delete(root);
-			root = NULL;
-			free(jsonDoc);
-			root = NULL;
 
-			return retVal;
+			LOGINFO("Loaded %zu token(s) from %s\n", m_tokens.size(), m_path.c_str());
 		}
 
 		/**
-		 * @brief This function is used to delete the token from file.
+		 * @brief This function is used to have the changes written by the background thread.
 		 *
-		 * @return True.
+		 * @return None.
 		 */
-		bool ContinueWatchingImpl::deleteToken()
+		void ContinueWatchingStore::scheduleWrite()
 		{
-			char *jsonDoc = NULL;
-			char *jsonOut = NULL;
-			cJSON *root = NULL;
-			bool retVal = false;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_dirty = true;
 
-			if(!tr181FeatureEnabled()) {
-				LOGWARN("Feature DISABLED...\n");
-				return false;
+				if (!m_thread.joinable())
+					m_thread = std::thread(&ContinueWatchingStore::writer, this);
 			}
+			m_changed.notify_all();
+		}
 
-			FILE *file = fopen(CW_LOCAL_FILE, "r");
-			if (!file)
-				return retVal;
+		/**
+		 * @brief Background thread writing the file, a while after the first of a series of changes.
+		 *
+		 * @return None.
+		 */
+		void ContinueWatchingStore::writer()
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
 
-			fseek(file, 0, SEEK_END);
-			long numbytes = ftell(file);
-			jsonDoc = (char*)malloc(sizeof(char)*(numbytes + 1));
-			if(jsonDoc==NULL) {
-				fclose(file);
-				return false;
-			}
-			fseek(file, 0, SEEK_SET);
-			fread(jsonDoc, numbytes, 1, file);
-			fclose(file);
-			file = NULL;
-			jsonDoc[numbytes] = 0;
+			while (!m_stopping) {
+				m_changed.wait(lock, [this]() { return (m_dirty || m_stopping); });
+				if (m_stopping)
+					break;
 
-			root = cJSON_Parse(jsonDoc);
-			cJSON *tokens = cJSON_GetObjectItem(root, "tokens");
-			if (tokens) {
-				int i;
-				int tokensCount = cJSON_GetArraySize(tokens);
-				for (i = 0; i < tokensCount; i++) {
-					cJSON *token = cJSON_GetArrayItem(tokens, i);
-					cJSON *item = cJSON_GetObjectItem(token, "applicationName");
-					if (item) {
-						if (strcmp(item->valuestring, mStrApplicationName.c_str()) == 0) {
-							retVal = true;
-							cJSON_DeleteItemFromArray(tokens, i);
-							break;
-						}
-					}
-				}
+				m_changed.wait_for(lock, std::chrono::milliseconds(CW_WRITE_DELAY_MS), [this]() { return m_stopping; });
+
+				lock.unlock();
+				flush();
+				lock.lock();
 			}
-			free(jsonDoc);
-			jsonDoc = NULL;
+		}
 
-			if (!retVal) {
-				cJSON_Delete(root);
-				return retVal;
+		/**
+		 * @brief This function is used to create the file contents, with m_lock held.
+		 *
+		 * @return The JSON document.
+		 */
+		std::string ContinueWatchingStore::serialize()
+		{
+			cJSON *root = cJSON_CreateObject();
+			cJSON *tokenArray = cJSON_CreateArray();
+			cJSON_AddItemToObject(root, "tokens", tokenArray);
+
+			for (std::map<std::string, Token>::const_iterator it = m_tokens.begin(); it != m_tokens.end(); ++it) {
+				cJSON *jsonItem = cJSON_CreateObject();
+				cJSON_AddItemToObject(jsonItem, "applicationName", cJSON_CreateString(it->first.c_str()));
+				cJSON_AddItemToObject(jsonItem, "encryptedData", cJSON_CreateString(it->second.encryptedData.c_str()));
+				cJSON_AddItemToArray(tokenArray, jsonItem);
 			}
 
-			jsonOut = cJSON_Print(root);
+			char *jsonOut = cJSON_Print(root);
 			cJSON_Delete(root);
 
-			file = fopen(CW_LOCAL_FILE, "w");
-			if (!file) {
+			std::string document;
+			if (jsonOut) {
+				document = jsonOut;
 				free(jsonOut);
-				jsonOut = NULL;
-				retVal = false;
-				return retVal;
 			}
+			return document;
+		}
 
-			fprintf(file, "%s", jsonOut);
-			fclose (file);
-			file = NULL;
-			free(jsonOut);
-			jsonOut = NULL;
-			return true;
+		/**
+		 * @brief This function is used to replace the file, through a temporary file so it is never left half written.
+		 *
+		 * @param[in] document The JSON document.
+		 *
+		 * @return True if the file was replaced.
+		 */
+		bool ContinueWatchingStore::write(const std::string& document)
+		{
+			std::string tempPath = m_path + ".tmp";
+
+			FILE *file = fopen(tempPath.c_str(), "w");
+			if (!file)
+				return false;
+
+			bool result = (fwrite(document.data(), 1, document.size(), file) == document.size());
+			result = (fflush(file) == 0) && result;
+			result = (fsync(fileno(file)) == 0) && result;
+			result = (fclose(file) == 0) && result;
+
+			if (result && (rename(tempPath.c_str(), m_path.c_str()) != 0))
+				result = false;
+
+			if (!result)
+				unlink(tempPath.c_str());
+
+			return result;
 		}
 
 		/**
@@ -787,7 +876,8 @@ namespace WPEFramework {
 		 *
 		 * @return None.
 		*/
-		NetflixContinueWatchingImpl::NetflixContinueWatchingImpl()
+		NetflixContinueWatchingImpl::NetflixContinueWatchingImpl(ContinueWatchingStore& store)
+		: ContinueWatchingImpl(store)
 		{
 			mStrApplicationName = NETFLIX_CONTINUEWATCHING_APP_NAME;
 			#if !defined(DISABLE_SECAPI)
@@ -812,10 +902,19 @@ namespace WPEFramework {
 
 		std::string NetflixContinueWatchingImpl::getApplicationToken()
 		{
-			string encencryptData = readFromJson();
-                      if (encencryptData.empty()) {
-                          return encencryptData;
-                      }
+			string encencryptData;
+			string clearToken;
+			if (!mStore.find(mStrApplicationName, encencryptData, clearToken) || encencryptData.empty()) {
+				return "";
+			}
+			if (!clearToken.empty()) {
+				//decoded before, only the feature check of decryptData() applies
+				if (!tr181FeatureEnabled()) {
+					LOGWARN("%s Feature DISABLED\n", __FUNCTION__);
+					return "";
+				}
+				return clearToken;
+			}
 			int paddingLength = 0;
 			string decodedencryptedtokenbase64;
 
@@ -881,6 +980,7 @@ namespace WPEFramework {
 			dectokenbase64 = listdecydec.str();
 			free(workspace);
 			free(decworkspace);
+			mStore.setDecoded(mStrApplicationName, dectokenbase64);
 			return dectokenbase64;
 		}
 
@@ -949,7 +1049,7 @@ namespace WPEFramework {
 				listwritetofile << jsonworkspace[i];
 			}
 			jsontokenbase64 = listwritetofile.str();
-			result = writeToJson(jsontokenbase64);
+			result = mStore.set(mStrApplicationName, jsontokenbase64, token);
 			free(workspace);
 			free(jsonworkspace);
 			return result;
@@ -969,15 +1069,16 @@ namespace WPEFramework {
 		 * @brief This function is used to create ContinueWatchingImpl object based on strApplicationName.
 		 *
 		 * @param[in] strApplicationName Variable of application name string.
+		 * @param[in] store Token store shared by all applications.
 		 *
 		 * @return ContinueWatchingImpl*.
 		 */
-		ContinueWatchingImpl* ContinueWatchingImplFactory::createContinueWatchingImpl(std::string strApplicationName)
+		ContinueWatchingImpl* ContinueWatchingImplFactory::createContinueWatchingImpl(std::string strApplicationName, ContinueWatchingStore& store)
 		{
 			ContinueWatchingImpl* continueWatchingImpl = NULL;
 
 			if (strApplicationName == NETFLIX_CONTINUEWATCHING_APP_NAME) {
-				continueWatchingImpl = new NetflixContinueWatchingImpl;
+				continueWatchingImpl = new NetflixContinueWatchingImpl(store);
 			}
 			return continueWatchingImpl;
 		}
@@ -40,6 +40,9 @@
 
 #include <string.h>
 #include <mutex>
+#include <map>
+#include <thread>
+#include <condition_variable>
 #include "Module.h"
 #include "utils.h"
 #if !defined(DISABLE_SECAPI)
@@ -50,12 +53,60 @@
 #include "AbstractPlugin.h"
 
 #define CW_LOCAL_FILE  "/opt/continuewatching.json"
+#define CW_WRITE_DELAY_MS  500
 #define NETFLIX_CONTINUEWATCHING_APP_NAME  "netflix"
 
 namespace WPEFramework {
 
 	namespace Plugin {
 
+		/**
+		* @brief In-memory copy of the tokens in CW_LOCAL_FILE.
+		*
+		* The file is read once, lookups are by application name. A new token is written to the
+		* file before set() returns, so a token that could not be stored is reported. Deletions are
+		* written back by a background thread after CW_WRITE_DELAY_MS. Either way the new contents
+		* go to a temporary file that then replaces the original. Next to the stored (encrypted) data it keeps the clear token once known, so
+		* only setting a token has to go through encryption, hashing and base64.
+		**/
+		class ContinueWatchingStore
+		{
+		public:
+			ContinueWatchingStore(const std::string& path);
+			~ContinueWatchingStore();
+			bool find(const std::string& applicationName, std::string& encryptedData, std::string& clearToken);
+			bool set(const std::string& applicationName, const std::string& encryptedData, const std::string& clearToken);
+			void setDecoded(const std::string& applicationName, const std::string& clearToken);
+			bool remove(const std::string& applicationName);
+			bool flush();
+
+		private:
+			ContinueWatchingStore(const ContinueWatchingStore&) = delete;
+			ContinueWatchingStore& operator=(const ContinueWatchingStore&) = delete;
+
+			struct Token
+			{
+				std::string encryptedData;
+				std::string clearToken;
+			};
+
+			void load();
+			void scheduleWrite();
+			void writer();
+			std::string serialize();
+			bool write(const std::string& document);
+
+			std::string m_path;
+			std::mutex m_lock;
+			std::mutex m_writeLock;
+			std::condition_variable m_changed;
+			std::map<std::string, Token> m_tokens;
+			bool m_dirty;
+			bool m_written;
+			bool m_stopping;
+			std::thread m_thread;
+		};
+
 		/**
 		* @brief WPEFramework class declaration for ContinueWatching
 		**/
@@ -85,6 +136,7 @@ namespace WPEFramework {
 			bool deleteAppToken(std::string strApplicationName);
 	       private:
 			std::mutex m_mutex;
+			ContinueWatchingStore m_store;
         	public:
 			ContinueWatching();
 			virtual ~ContinueWatching();
@@ -104,7 +156,7 @@ namespace WPEFramework {
 		class ContinueWatchingImpl
 		{
 		public:
-   			ContinueWatchingImpl();
+   			ContinueWatchingImpl(ContinueWatchingStore& store);
 			virtual ~ContinueWatchingImpl();
 			virtual std::string getApplicationToken() = 0;
 			virtual bool setApplicationToken(std::string token) = 0;
@@ -112,8 +164,6 @@ namespace WPEFramework {
 			bool encryptData(uint8_t* clearData, int clearDataLength, uint8_t* protectedData, int protectedDataLength, int &bytesWritten);
 			bool decryptData(uint8_t* protectedData, int protectedDataLength, uint8_t* clearData, int clearDataLength, int &bytesWritten);
 			std::string sha256(const std::string str);
-			bool writeToJson(std::string protectedData);
-			std::string readFromJson();
 			bool deleteToken();
 
 		protected:
@@ -121,6 +171,7 @@ namespace WPEFramework {
 	    		bool tr181FeatureEnabled();
 
 	    		std::string mStrApplicationName;
+			ContinueWatchingStore& mStore;
 			#if !defined(DISABLE_SECAPI)
     			SEC_OBJECTID mSecObjectId;
 			#endif
@@ -132,7 +183,7 @@ namespace WPEFramework {
 		class NetflixContinueWatchingImpl : public ContinueWatchingImpl
 		{
 		public:
-			NetflixContinueWatchingImpl();
+			NetflixContinueWatchingImpl(ContinueWatchingStore& store);
 			virtual ~NetflixContinueWatchingImpl();
 			std::string getApplicationToken();
 			bool setApplicationToken(std::string token);
@@ -144,7 +195,7 @@ namespace WPEFramework {
 		public:
 			ContinueWatchingImplFactory();
 			virtual ~ContinueWatchingImplFactory();
-			ContinueWatchingImpl* createContinueWatchingImpl(std::string strApplicationName);
+			ContinueWatchingImpl* createContinueWatchingImpl(std::string strApplicationName, ContinueWatchingStore& store);
 		};
 	} // namespace Plugin
 } // namespace WPEFramework
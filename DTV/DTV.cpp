@@ -179,6 +179,10 @@ namespace WPEFramework
 
          config.FromString(_service->ConfigLine());
 
+         _epgLock.Lock();
+         _epgCacheTTL = std::chrono::seconds(config.EpgCacheTTL.Value());
+         _epgLock.Unlock();
+
          _service->Register(&_notification);
 
          _dtv = service->Root<Core::IUnknown>(_connectionId, 2000, _T("DTV"));
@@ -251,6 +255,8 @@ namespace WPEFramework
          _service = nullptr;
          UnregisterAll();
 
+         EpgClear();
+
          SYSLOG(Logging::Shutdown, (string(_T("DTV de-initialised"))));
       }
 
@@ -555,6 +561,12 @@ namespace WPEFramework
             case STB_EVENT_SEARCH_SUCCESS:
             case UI_EVENT_UPDATE:
             {
+               if (event != UI_EVENT_UPDATE)
+               {
+                  // The service database may have changed as a result of the search
+                  DTV::instance()->EpgInvalidateServices();
+               }
+
                //STB_SPDebugWrite("DTV::DvbEventHandler: event=0x%08x\n", event);
                DTV::instance()->NotifySearchStatus();
                break;
@@ -562,18 +574,21 @@ namespace WPEFramework
 
             case APP_EVENT_SERVICE_UPDATED:
             {
+               DTV::instance()->EpgInvalidateServices();
                DTV::instance()->NotifyService(EventtypeType::SERVICEUPDATED, _T("serviceupdated"), *(void **)event_data);
                break;
             }
 
             case APP_EVENT_SERVICE_ADDED:
             {
+               DTV::instance()->EpgInvalidateServices();
                DTV::instance()->NotifyService(EventtypeType::SERVICEADDED, _T("serviceadded"), *(void **)event_data);
                break;
             }
 
             case APP_EVENT_SERVICE_DELETED:
             {
+               DTV::instance()->EpgRemoveService(*(void **)event_data);
                DTV::instance()->NotifyService(EventtypeType::SERVICEDELETED, _T("servicedeleted"), *(void **)event_data);
                break;
             }
@@ -603,11 +618,22 @@ namespace WPEFramework
                /* Service, and hence event info, can only be provided if the service is available */
                if (event_data != NULL)
                {
+                  DTV::instance()->EpgInvalidateSchedule(*(void **)event_data);
                   DTV::instance()->NotifyEventChanged(*(void **)event_data);
                }
                break;
             }
 
+            case APP_EVENT_SERVICE_EIT_SCHED_UPDATE:
+            {
+               /* Only the cached schedule for the updated service needs to be refreshed */
+               if (event_data != NULL)
+               {
+                  DTV::instance()->EpgInvalidateSchedule(*(void **)event_data);
+               }
+               break;
+            }
+
             default:
             {
                //STB_SPDebugWrite("DTV::DvbEventHandler: Unhandled event=0x%08x\n", event);
@@ -22,6 +22,11 @@
 #include "Module.h"
 #include <interfaces/json/JsonData_DTV.h>
 
+#include <chrono>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
 extern "C"
 {
    // DVB include files
@@ -91,9 +96,11 @@ namespace WPEFramework
                Config() : Core::JSON::Container(),
                   SubtitleProcessing(false),
                   TeletextProcessing(false),
+                  EpgCacheTTL(300)
                {
                    Add(_T("subtitleprocessing"), &SubtitleProcessing);
                    Add(_T("teletextprocessing"), &TeletextProcessing);
+                   Add(_T("epgcachettl"), &EpgCacheTTL);
                }
 
                ~Config()
@@ -103,6 +110,7 @@ namespace WPEFramework
             public:
                Core::JSON::Boolean SubtitleProcessing;
                Core::JSON::Boolean TeletextProcessing;
+               Core::JSON::DecUInt32 EpgCacheTTL;  // s, 0 keeps cached EPG data until it is invalidated
          };
 
          public:
@@ -134,8 +142,116 @@ namespace WPEFramework
                   Core::JSON::ArrayType<ServiceInfo> ServiceList;
             };
 
+            class ScheduleGridParams: public Core::JSON::Container
+            {
+               private:
+                  ScheduleGridParams(const ScheduleGridParams&) = delete;
+                  ScheduleGridParams& operator=(const ScheduleGridParams&) = delete;
+
+               public:
+                  ScheduleGridParams() : Core::JSON::Container(), Starttime(0), Endtime(0xffffffff), Offset(0), Count(0)
+                  {
+                     Add(_T("services"), &Services);
+                     Add(_T("starttime"), &Starttime);
+                     Add(_T("endtime"), &Endtime);
+                     Add(_T("offset"), &Offset);
+                     Add(_T("count"), &Count);
+                  }
+
+                  ~ScheduleGridParams()
+                  {
+                  }
+
+               public:
+                  Core::JSON::ArrayType<Core::JSON::String> Services;
+                  Core::JSON::DecUInt32 Starttime;
+                  Core::JSON::DecUInt32 Endtime;
+                  Core::JSON::DecUInt32 Offset;
+                  Core::JSON::DecUInt32 Count;
+            };
+
+            class ServiceSchedule: public Core::JSON::Container
+            {
+               public:
+                  ServiceSchedule() : Core::JSON::Container(), Total(0)
+                  {
+                     Init();
+                  }
+
+                  ServiceSchedule(const ServiceSchedule& other) : Core::JSON::Container(), Dvburi(other.Dvburi),
+                     Total(other.Total), Events(other.Events)
+                  {
+                     Init();
+                  }
+
+                  ServiceSchedule& operator=(const ServiceSchedule& rhs)
+                  {
+                     Dvburi = rhs.Dvburi;
+                     Total = rhs.Total;
+                     Events = rhs.Events;
+                     return (*this);
+                  }
+
+                  ~ServiceSchedule()
+                  {
+                  }
+
+               private:
+                  void Init()
+                  {
+                     Add(_T("dvburi"), &Dvburi);
+                     Add(_T("total"), &Total);
+                     Add(_T("events"), &Events);
+                  }
+
+               public:
+                  Core::JSON::String Dvburi;
+                  Core::JSON::DecUInt32 Total;
+                  Core::JSON::ArrayType<EiteventInfo> Events;
+            };
+
+         private:
+            // EPG data held in the plugin so that schedule and service list queries don't have to go
+            // back to the DVB database (and re-extract every string) on each request
+            struct EpgEvent
+            {
+               uint32_t Starttime;
+               uint32_t Duration;
+               uint16_t Eventid;
+               uint8_t Parentalrating;
+               bool Hassubtitles;
+               bool Hasaudiodescription;
+               bool Hasextendedinfo;
+               string Name;
+               string Shortdescription;
+               std::vector<uint8_t> Contentdata;
+            };
+
+            struct EpgSchedule
+            {
+               EpgSchedule() : Valid(false) {}
+
+               bool Valid;
+               std::chrono::steady_clock::time_point Expiry;
+               std::vector<EpgEvent> Events;    // sorted by start time
+            };
+
+            // The running status and scrambled state in Info change with the SDT, without the service
+            // being reported as updated, so they are read from the DVB database when served
+            struct CachedService
+            {
+               CachedService(E_STB_DP_SIGNAL_TYPE signal) : Signal(signal), OnetId(0), TransId(0), ServId(0) {}
+
+               E_STB_DP_SIGNAL_TYPE Signal;
+               U16BIT OnetId;
+               U16BIT TransId;
+               U16BIT ServId;
+               ServiceInfo Info;
+            };
+
          public:
-            DTV() : _skipURL(0), _service(nullptr), _connectionId(0), _dtv(nullptr), _notification(this)
+            DTV() : _skipURL(0), _service(nullptr), _connectionId(0), _dtv(nullptr), _notification(this),
+               _epgLock(), _epgCacheTTL(0), _schedules(), _services(), _servicesValid(false), _servicesExpiry()
             {
                DTV::instance(this);
                RegisterAll();
@@ -202,6 +318,7 @@ namespace WPEFramework
             uint32_t GetTransportInfo(const string& index, TransportInfo& response) const;
             uint32_t GetExtendedEventInfo(const string& index, ExtendedeventinfoData& response) const;
             uint32_t GetSignalInfo(const string& index, SignalInfoData& response) const;
+            uint32_t GetScheduleGrid(const ScheduleGridParams& params, Core::JSON::ArrayType<ServiceSchedule>& response) const;
 
             uint32_t AddLnb(const LnbsettingsInfo& lnb_settings, Core::JSON::Boolean& response);
             uint32_t AddSatellite(const SatellitesettingsInfo& sat_settings, Core::JSON::Boolean& response);
@@ -234,6 +351,13 @@ namespace WPEFramework
             PluginHost::IShell *_service;
             Core::Sink<Notification> _notification;
 
+            mutable Core::CriticalSection _epgLock;
+            std::chrono::seconds _epgCacheTTL;
+            mutable std::unordered_map<uint64_t, EpgSchedule> _schedules;
+            mutable std::list<CachedService> _services;
+            mutable bool _servicesValid;
+            mutable std::chrono::steady_clock::time_point _servicesExpiry;
+
          private:
             static void DvbEventHandler(U32BIT event, void *event_data, U32BIT data_size);
 
@@ -284,6 +408,21 @@ namespace WPEFramework
             void ExtractDvbtTuningParams(DvbttuningparamsInfo& tuning_params, void *transport) const;
             void ExtractDvbEventInfo(EiteventInfo& event, void *dvb_event) const;
             void SetJsonString(U8BIT *src_string, Core::JSON::String& out_string, bool free_src = false) const;
+            string GetDvbString(U8BIT *src_string, bool free_src = false) const;
+
+            // EPG cache, see DTVEpgCache.cpp
+            static uint64_t EpgServiceKey(void *service);
+            void EpgInvalidateSchedule(void *service);
+            void EpgRemoveService(void *service);
+            void EpgInvalidateServices();
+            void EpgClear();
+            bool EpgExpired(const std::chrono::steady_clock::time_point& expiry) const;
+            const EpgSchedule& EpgGetSchedule(void *service) const;
+            const std::list<CachedService>& EpgGetServices() const;
+            uint32_t EpgGetEvents(void *service, uint32_t start_utc, uint32_t end_utc, uint32_t offset,
+               uint32_t count, Core::JSON::ArrayType<EiteventInfo>& events) const;
+            void ExtractDvbEventInfo(EpgEvent& event, void *dvb_event) const;
+            void ConvertEpgEvent(EiteventInfo& event, const EpgEvent& epg_event) const;
       };
    }
 }
@@ -0,0 +1,271 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Module.h"
+#include "DTV.h"
+
+#include <algorithm>
+
+extern "C"
+{
+   // DVB include files
+   #include <stbuni.h>
+   #include <stbdpc.h>
+
+   #include <app.h>
+   #include <ap_dbacc.h>
+};
+
+namespace WPEFramework
+{
+   namespace Plugin
+   {
+      using namespace JsonData::DTV;
+
+      // The EPG cache holds a time sorted copy of the EIT schedule for each service that has been
+      // queried, and a copy of the digital service list. Entries are invalidated per service from
+      // the DVB event handler and are only rebuilt from the DVB database when next requested.
+      // As events the DVB stack does not report can still change the database, entries are also
+      // rebuilt once they are older than the configured TTL.
+
+      uint64_t DTV::EpgServiceKey(void *service)
+      {
+         U16BIT onet_id, trans_id, serv_id;
+
+         ADB_GetServiceIds(service, &onet_id, &trans_id, &serv_id);
+
+         return ((static_cast<uint64_t>(onet_id) << 32) | (static_cast<uint64_t>(trans_id) << 16) | serv_id);
+      }
+
+      void DTV::EpgInvalidateSchedule(void *service)
+      {
+         if (service != NULL)
+         {
+            uint64_t key = EpgServiceKey(service);
+
+            _epgLock.Lock();
+
+            std::unordered_map<uint64_t, EpgSchedule>::iterator entry = _schedules.find(key);
+            if (entry != _schedules.end())
+            {
+               // Keep the event storage so it can be reused when the schedule is rebuilt
+               entry->second.Valid = false;
+            }
+
+            _epgLock.Unlock();
+         }
+      }
+
+      void DTV::EpgRemoveService(void *service)
+      {
+         _epgLock.Lock();
+
+         if (service != NULL)
+         {
+            _schedules.erase(EpgServiceKey(service));
+         }
+
+         _servicesValid = false;
+
+         _epgLock.Unlock();
+      }
+
+      void DTV::EpgInvalidateServices()
+      {
+         _epgLock.Lock();
+         _servicesValid = false;
+         _epgLock.Unlock();
+      }
+
+      void DTV::EpgClear()
+      {
+         _epgLock.Lock();
+         _schedules.clear();
+         _services.clear();
+         _servicesValid = false;
+         _epgLock.Unlock();
+      }
+
+      // Must be called with _epgLock held
+      bool DTV::EpgExpired(const std::chrono::steady_clock::time_point& expiry) const
+      {
+         return ((_epgCacheTTL.count() != 0) && (std::chrono::steady_clock::now() >= expiry));
+      }
+
+      // Must be called with _epgLock held
+      const DTV::EpgSchedule& DTV::EpgGetSchedule(void *service) const
+      {
+         EpgSchedule& schedule = _schedules[EpgServiceKey(service)];
+
+         if (!schedule.Valid || EpgExpired(schedule.Expiry))
+         {
+            void **event_list = NULL;
+            U16BIT num_events = 0;
+
+            schedule.Events.clear();
+
+            ADB_GetEventSchedule(FALSE, service, &event_list, &num_events);
+            if (event_list != NULL)
+            {
+               schedule.Events.resize(num_events);
+
+               for (U16BIT i = 0; i < num_events; i++)
+               {
+                  ExtractDvbEventInfo(schedule.Events[i], event_list[i]);
+               }
+
+               ADB_ReleaseEventList(event_list, num_events);
+
+               // The DVB stack provides events in increasing date/time order, but the lookups below
+               // depend on it so make sure
+               std::stable_sort(schedule.Events.begin(), schedule.Events.end(),
+                  [](const EpgEvent& a, const EpgEvent& b) { return (a.Starttime < b.Starttime); });
+            }
+
+            schedule.Valid = true;
+            schedule.Expiry = std::chrono::steady_clock::now() + _epgCacheTTL;
+         }
+
+         return (schedule);
+      }
+
+      // Must be called with _epgLock held
+      const std::list<DTV::CachedService>& DTV::EpgGetServices() const
+      {
+         if (!_servicesValid || EpgExpired(_servicesExpiry))
+         {
+            void **slist = NULL;
+            U16BIT num_services = 0;
+
+            _services.clear();
+
+            ADB_GetServiceList(ADB_SERVICE_LIST_DIGITAL, &slist, &num_services);
+            if (slist != NULL)
+            {
+               BOOLEAN is_sig2;
+
+               for (U16BIT index = 0; index < num_services; index++)
+               {
+                  _services.emplace_back(ADB_GetServiceSignalType(slist[index], &is_sig2));
+
+                  CachedService& service = _services.back();
+
+                  ADB_GetServiceIds(slist[index], &service.OnetId, &service.TransId, &service.ServId);
+                  ExtractDvbServiceInfo(service.Info, slist[index]);
+               }
+
+               ADB_ReleaseServiceList(slist, num_services);
+            }
+
+            _servicesValid = true;
+            _servicesExpiry = std::chrono::steady_clock::now() + _epgCacheTTL;
+         }
+
+         return (_services);
+      }
+
+      // Adds the cached events for the service that start within the given window to 'events',
+      // skipping the first 'offset' of them and adding at most 'count' (0 means no limit).
+      // Returns the total number of events in the window.
+      uint32_t DTV::EpgGetEvents(void *service, uint32_t start_utc, uint32_t end_utc, uint32_t offset,
+         uint32_t count, Core::JSON::ArrayType<EiteventInfo>& events) const
+      {
+         uint32_t total = 0;
+
+         _epgLock.Lock();
+
+         const std::vector<EpgEvent>& schedule = EpgGetSchedule(service).Events;
+
+         std::vector<EpgEvent>::const_iterator first = std::lower_bound(schedule.begin(), schedule.end(), start_utc,
+            [](const EpgEvent& event, uint32_t time) { return (event.Starttime < time); });
+         std::vector<EpgEvent>::const_iterator last = std::upper_bound(first, schedule.end(), end_utc,
+            [](uint32_t time, const EpgEvent& event) { return (time < event.Starttime); });
+
+         total = static_cast<uint32_t>(std::distance(first, last));
+
+         if (offset < total)
+         {
+            first += offset;
+
+            if ((count != 0) && (count < (total - offset)))
+            {
+               last = first + count;
+            }
+
+            for (; first != last; ++first)
+            {
+               EiteventInfo event;
+
+               ConvertEpgEvent(event, *first);
+               events.Add(event);
+            }
+         }
+
+         _epgLock.Unlock();
+
+         return (total);
+      }
+
+      void DTV::ExtractDvbEventInfo(EpgEvent& event, void *dvb_event) const
+      {
+         event.Name = GetDvbString(ADB_GetEventName(dvb_event), true);
+         event.Shortdescription = GetDvbString(ADB_GetEventDescription(dvb_event), true);
+
+         event.Starttime = STB_GCConvertToTimestamp(ADB_GetEventStartDateTime(dvb_event));
+
+         U32DHMS dhms = ADB_GetEventDuration(dvb_event);
+         event.Duration = ((DHMS_DAYS(dhms) * 24 + DHMS_HOUR(dhms)) * 60 + DHMS_MINS(dhms)) * 60 + DHMS_SECS(dhms);
+
+         event.Eventid = ADB_GetEventId(dvb_event);
+         event.Hassubtitles = (ADB_GetEventSubtitlesAvailFlag(dvb_event) ? true : false);
+         event.Hasaudiodescription = (ADB_GetEventAudioDescriptionFlag(dvb_event) ? true : false);
+         event.Parentalrating = ADB_GetEventParentalAge(dvb_event);
+         event.Hasextendedinfo = (ADB_GetEventHasExtendedDescription(dvb_event) ? true : false);
+
+         U8BIT content_len;
+         U8BIT *content_data = ADB_GetEventContentData(dvb_event, &content_len);
+         if ((content_len != 0) && (content_data != NULL))
+         {
+            event.Contentdata.assign(content_data, content_data + content_len);
+         }
+         else
+         {
+            event.Contentdata.clear();
+         }
+      }
+
+      void DTV::ConvertEpgEvent(EiteventInfo& event, const EpgEvent& epg_event) const
+      {
+         event.Name = epg_event.Name;
+         event.Shortdescription = epg_event.Shortdescription;
+         event.Starttime = epg_event.Starttime;
+         event.Duration = epg_event.Duration;
+         event.Eventid = epg_event.Eventid;
+         event.Hassubtitles = epg_event.Hassubtitles;
+         event.Hasaudiodescription = epg_event.Hasaudiodescription;
+         event.Parentalrating = epg_event.Parentalrating;
+         event.Hasextendedinfo = epg_event.Hasextendedinfo;
+
+         for (uint8_t content : epg_event.Contentdata)
+         {
+            event.Contentdata.Add(content);
+         }
+      }
+   }
+}
@@ -72,6 +72,7 @@ namespace WPEFramework
          JSONRPC::Register<Core::JSON::DecSInt32, void>(_T("stopPlaying"), &DTV::StopPlaying, this);
 
          // Version 2 methods
+         JSONRPC::Register<ScheduleGridParams, Core::JSON::ArrayType<ServiceSchedule>>(_T("getScheduleGrid"), &DTV::GetScheduleGrid, this);
       }
 
       void DTV::UnregisterAll()
@@ -100,6 +101,7 @@ namespace WPEFramework
          JSONRPC::Unregister(_T("finishServiceSearch"));
          JSONRPC::Unregister(_T("startPlaying"));
          JSONRPC::Unregister(_T("stopPlaying"));
+         JSONRPC::Unregister(_T("getScheduleGrid"));
       }
 
       // API implementation
@@ -277,10 +279,8 @@ namespace WPEFramework
       uint32_t DTV::GetServiceList(const string& index, Core::JSON::ArrayType<ServiceInfo>& response) const
       {
          U16BIT onet_id, trans_id;
-         void *transport;
+         bool by_transport = false;
          E_STB_DP_SIGNAL_TYPE signal = SIGNAL_NONE;
-         U16BIT num_services = 0;
-         void **slist = NULL;
 
          SYSLOG(Logging::Notification, (_T("DTV::GetServiceList: %s"), index.c_str()));
 
@@ -288,11 +288,7 @@ namespace WPEFramework
          int num_args = std::sscanf(index.c_str(), "%hu.%hu", &onet_id, &trans_id);
          if (num_args == 2)
          {
-            transport = ADB_GetTransportFromIds(ADB_INVALID_DVB_ID, onet_id, trans_id);
-            if (transport != NULL)
-            {
-               ADB_GetTransportServiceList(transport, &slist, &num_services);
-            }
+            by_transport = true;
          }
          else
          {
@@ -312,28 +308,42 @@ namespace WPEFramework
                   signal = SIGNAL_NONE;
                   break;
             }
-
-            ADB_GetServiceList(ADB_SERVICE_LIST_DIGITAL, &slist, &num_services);
          }
 
-         if ((slist != NULL) && (num_services != 0))
-         {
-            BOOLEAN is_sig2;
+         // Services are served from the cached list, which is only rebuilt when the DVB stack
+         // reports a service being added, updated or deleted. The running status and scrambled
+         // state are taken from the database, a service that has just gone is left out.
+         auto add = [this, &response](const CachedService& service) {
+            void *serv_ptr = ADB_FindServiceByIds(service.OnetId, service.TransId, service.ServId);
+            if (serv_ptr != NULL)
+            {
+               ServiceInfo info(service.Info);
+
+               info.Scrambled = (ADB_GetServiceScrambledFlag(serv_ptr) ? true : false);
+               info.Runningstatus = GetJsonRunningStatus(ADB_GetServiceRunningStatus(serv_ptr));
+               response.Add(info);
+            }
+         };
+
+         _epgLock.Lock();
 
-            for (U16BIT index = 0; index < num_services; index++)
+         for (const CachedService& service : EpgGetServices())
+         {
+            if (by_transport)
             {
-               if ((signal == SIGNAL_NONE) || (ADB_GetServiceSignalType(slist[index], &is_sig2) == signal))
+               if ((service.OnetId == onet_id) && (service.TransId == trans_id))
                {
-                  ServiceInfo service;
-
-                  ExtractDvbServiceInfo(service, slist[index]);
-                  response.Add(service);
+                  add(service);
                }
             }
-
-            ADB_ReleaseServiceList(slist, num_services);
+            else if ((signal == SIGNAL_NONE) || (service.Signal == signal))
+            {
+               add(service);
+            }
          }
 
+         _epgLock.Unlock();
+
          return (Core::ERROR_NONE);
       }
 
@@ -418,35 +428,7 @@ namespace WPEFramework
                void *service = ADB_FindServiceByIds(onet_id, trans_id, serv_id);
                if (service != NULL)
                {
-                  void **event_list;
-                  U16BIT num_events;
-
-                  ADB_GetEventSchedule(FALSE, service, &event_list, &num_events);
-                  if (event_list != NULL)
-                  {
-                     U32BIT start_time;
-
-                     for (U16BIT i = 0; i < num_events; i++)
-                     {
-                        start_time = STB_GCConvertToTimestamp(ADB_GetEventStartDateTime(event_list[i]));
-                        if ((start_time >= start_utc) && (start_time <= end_utc))
-                        {
-                           EiteventInfo event;
-
-                           ExtractDvbEventInfo(event, event_list[i]);
-                           response.Add(event);
-                        }
-                        else if (start_time > end_utc)
-                        {
-                           /* Events are provided in increasing date/time order so all events after
-                            * this will be outside of the requested window and don't need to be checked */
-                           break;
-                        }
-                     }
-
-                     ADB_ReleaseEventList(event_list, num_events);
-                  }
-
+                  EpgGetEvents(service, start_utc, end_utc, 0, 0, response);
                   result = Core::ERROR_NONE;
                }
             }
@@ -684,6 +666,64 @@ namespace WPEFramework
          return(result);
       }
 
+      /************************
+       * Version 2 methods
+       ************************/
+
+      // Method: getScheduleGrid - get the schedule EIT events for a number of services in one call, e.g. to
+      //                           build a grid guide. Events are returned for each service in the order
+      //                           the services are given, and only events starting within the optional
+      //                           start and end times are included. 'offset' and 'count' allow each
+      //                           service's events to be paged; a count of 0 returns all remaining events
+      //                           and 'total' gives the number of events in the time window.
+      // Return codes:
+      //  - ERROR_NONE: Success
+      //  - ERROR_BAD_REQUEST: no services given or a service URI is invalid
+      uint32_t DTV::GetScheduleGrid(const ScheduleGridParams& params, Core::JSON::ArrayType<ServiceSchedule>& response) const
+      {
+         uint32_t result = Core::ERROR_BAD_REQUEST;
+
+         SYSLOG(Logging::Notification, (_T("DTV::GetScheduleGrid: %u services"), params.Services.Length()));
+
+         if (params.Services.Length() != 0)
+         {
+            result = Core::ERROR_NONE;
+
+            Core::JSON::ArrayType<Core::JSON::String>::ConstIterator index(params.Services.Elements());
+
+            while ((result == Core::ERROR_NONE) && index.Next())
+            {
+               U16BIT onet_id, trans_id, serv_id;
+               const string& service_uri = index.Current().Value();
+
+               if (std::sscanf(service_uri.c_str(), "%hu.%hu.%hu", &onet_id, &trans_id, &serv_id) == 3)
+               {
+                  ServiceSchedule& schedule = response.Add();
+
+                  schedule.Dvburi = service_uri;
+
+                  void *service = ADB_FindServiceByIds(onet_id, trans_id, serv_id);
+                  if (service != NULL)
+                  {
+                     schedule.Total = EpgGetEvents(service, params.Starttime.Value(), params.Endtime.Value(),
+                        params.Offset.Value(), params.Count.Value(), schedule.Events);
+                  }
+               }
+               else
+               {
+                  result = Core::ERROR_BAD_REQUEST;
+               }
+            }
+
+            if (result != Core::ERROR_NONE)
+            {
+               response.Clear();
+            }
+         }
+
+         return (result);
+      }
+
       uint32_t DTV::AddLnb(const LnbsettingsInfo& lnb_settings, Core::JSON::Boolean& response)
       {
          uint32_t result = Core::ERROR_BAD_REQUEST;
@@ -2078,6 +2118,13 @@ namespace WPEFramework
 
       void DTV::SetJsonString(U8BIT *src_string, Core::JSON::String& out_string, bool free_src) const
       {
+         out_string = GetDvbString(src_string, free_src);
+      }
+
+      string DTV::GetDvbString(U8BIT *src_string, bool free_src) const
+      {
+         string out_string;
+
          if (src_string != NULL)
          {
             // Strip any DVB control chars from the string and output it minus the unicode indicator byte, if present
@@ -2106,11 +2153,8 @@ namespace WPEFramework
                STB_ReleaseUnicodeString(src_string);
             }
          }
-         else
-         {
-            out_string = string();
-         }
+
+         return (out_string);
       }
    }
 }
-
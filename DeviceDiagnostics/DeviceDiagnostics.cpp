@@ -22,10 +22,14 @@
 #include <curl/curl.h>
 #include <time.h>
 
+#include <algorithm>
+#include <iterator>
+
 #include "utils.h"
 
 #define DEVICE_DIAGNOSTICS_METHOD_NAME_GET_CONFIGURATION  "getConfiguration"
 #define DEVICE_DIAGNOSTICS_METHOD_GET_AV_DECODER_STATUS "getAVDecoderStatus"
+#define DEVICE_DIAGNOSTICS_METHOD_GET_AV_DECODER_STATUS_HISTORY "getAVDecoderStatusHistory"
 
 #define DEVICE_DIAGNOSTICS_EVT_ON_AV_DECODER_STATUS_CHANGED "onAVDecoderStatusChanged"
 
@@ -45,11 +49,34 @@ namespace WPEFramework
             NULL
         };
 
-        static size_t writeCurlResponse(void *ptr, size_t size, size_t nmemb, std::string stream)
+        static const char *decoderStatusName(int status)
+        {
+            return ((status >= 0) && (status <= 2)) ? decoderStatusStr[status] : "UNKNOWN";
+        }
+
+#ifdef ENABLE_ERM
+        static uint64_t wallClockMs()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+#endif
+
+        // Parameters that do not change while the box is running
+        static const char *defaultCacheable[] = {
+            "Device.DeviceInfo.Manufacturer",
+            "Device.DeviceInfo.ModelName",
+            "Device.DeviceInfo.ProductClass",
+            "Device.DeviceInfo.SerialNumber",
+            "Device.DeviceInfo.HardwareVersion",
+            "Device.DeviceInfo.SoftwareVersion",
+            NULL
+        };
+
+        static size_t writeCurlResponse(void *ptr, size_t size, size_t nmemb, void *userdata)
         {
           size_t realsize = size * nmemb;
-          std::string temp(static_cast<const char*>(ptr), realsize);
-          stream.append(temp);
+          static_cast<std::string*>(userdata)->append(static_cast<const char*>(ptr), realsize);
           return realsize;
         }
 
@@ -60,6 +87,7 @@ namespace WPEFramework
 
             registerMethod(DEVICE_DIAGNOSTICS_METHOD_NAME_GET_CONFIGURATION, &DeviceDiagnostics::getConfigurationWrapper, this);
             registerMethod(DEVICE_DIAGNOSTICS_METHOD_GET_AV_DECODER_STATUS, &DeviceDiagnostics::getAVDecoderStatus, this);
+            registerMethod(DEVICE_DIAGNOSTICS_METHOD_GET_AV_DECODER_STATUS_HISTORY, &DeviceDiagnostics::getAVDecoderStatusHistory, this);
         }
 
         DeviceDiagnostics::~DeviceDiagnostics()
@@ -68,8 +96,28 @@ namespace WPEFramework
 
         /* virtual */ const string DeviceDiagnostics::Initialize(PluginHost::IShell* service)
         {
+            Config config;
+            config.FromString(service->ConfigLine());
+
+            m_unixSocket = config.UnixSocket.Value();
+            m_cacheTTL = std::chrono::seconds(config.CacheTTL.Value());
+            m_cacheable.clear();
+            if (config.Cacheable.IsSet())
+            {
+                Core::JSON::ArrayType<Core::JSON::String>::Iterator index(config.Cacheable.Elements());
+                while (index.Next() == true)
+                    m_cacheable.push_back(index.Current().Value());
+            }
+            else
+            {
+                for (int i = 0; defaultCacheable[i] != NULL; i++)
+                    m_cacheable.push_back(defaultCacheable[i]);
+            }
+
 #ifdef ENABLE_ERM
-            int ret;
+            m_AVPollFast = std::chrono::milliseconds(std::max<uint32_t>(config.AVPollFast.Value(), 10));
+            m_AVPollSlow = std::chrono::milliseconds(std::max<uint32_t>(config.AVPollSlow.Value(), config.AVPollFast.Value()));
+            m_AVSettleTime = std::chrono::milliseconds(config.AVSettleTime.Value());
 
             if ((m_EssRMgr = EssRMgrCreate()) == NULL)
             {
@@ -77,7 +125,14 @@ namespace WPEFramework
                 return "EssRMgrCreate() failed";
             }
 
+            m_AVStatus = EssRMgrRes_idle;
+            m_AVStatusSince = std::chrono::steady_clock::now();
+            m_AVStatusStart = wallClockMs();
+            m_AVStatusHistory.clear();
+            std::fill(std::begin(m_AVStatusTotal), std::end(m_AVStatusTotal), 0);
+
             m_pollThreadRun = 1;
+            m_pollNow = false;
             m_AVPollThread = std::thread(AVPollThread, this);
 #else
             LOGWARN("ENABLE_ERM is not defined, decoder status will "
@@ -90,12 +145,24 @@ namespace WPEFramework
         void DeviceDiagnostics::Deinitialize(PluginHost::IShell* /* service */)
         {
 #ifdef ENABLE_ERM
-            m_AVDecoderStatusLock.lock();
-            m_pollThreadRun = 0;
-            m_AVDecoderStatusLock.unlock();
+            {
+                std::lock_guard<std::mutex> lock(m_AVDecoderStatusLock);
+                m_pollThreadRun = 0;
+            }
+            m_AVPollCondition.notify_one();
             m_AVPollThread.join();
             EssRMgrDestroy(m_EssRMgr);
 #endif
+            {
+                std::lock_guard<std::mutex> lock(m_curlLock);
+                for (CURL* handle : m_idleHandles)
+                    curl_easy_cleanup(handle);
+                m_idleHandles.clear();
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_cacheLock);
+                m_cache.clear();
+            }
             DeviceDiagnostics::_instance = nullptr;
         }
 
@@ -104,31 +171,19 @@ namespace WPEFramework
             LOGINFOMETHOD();
 
             JsonArray names = parameters["names"].Array();
-
-            JsonObject requestParams;
-            JsonArray namePairs;
+            std::vector<string> nameList;
 
             JsonArray::Iterator index(names.Elements());
 
             while (index.Next() == true)
             {
                 if (Core::JSON::Variant::type::STRING == index.Current().Content())
-                {
-                    //JSON::String s = index.Current().String();
-                    JsonObject o;
-                    o["name"] = index.Current().String();
-                    namePairs.Add(o);
-                }
+                    nameList.push_back(index.Current().String());
                 else
                     LOGWARN("Unexpected variant type");
             }
 
-            requestParams["paramList"] = namePairs;
-
-            string json;
-            requestParams.ToString(json);
-
-            if (0 == getConfiguration(json, response))
+            if (0 == getConfiguration(nameList, response))
                 returnResponse(true);
 
             returnResponse(false);
@@ -147,44 +202,73 @@ namespace WPEFramework
             return status;
         }
 
-        /* periodically polls ERM library for changes in most
-         * active decoder and send thunder event when decoder
-         * status changes. Needs to be done via poll and separate
-         * thread because ERM doesn't support events. */
+        /* polls ERM library for changes in most active decoder
+         * and sends thunder event when decoder status changes.
+         * Needs to be done via poll and separate thread because
+         * ERM doesn't support events, not even for observers.
+         * Polling is fast while the status is changing, starting
+         * or stopping playback goes through several states, and
+         * slows down once it has settled. */
 #ifdef ENABLE_ERM
         void *DeviceDiagnostics::AVPollThread(void *arg)
         {
-            struct timespec poll_wait = { .tv_sec = 30, .tv_nsec = 0  };
-            int lastStatus = EssRMgrRes_idle;
-            int status;
-            DeviceDiagnostics* t = DeviceDiagnostics::_instance;
+            DeviceDiagnostics* t = static_cast<DeviceDiagnostics*>(arg);
 
             LOGINFO("AVPollThread started");
-            for (;;)
+            std::unique_lock<std::mutex> lock(t->m_AVDecoderStatusLock);
+            while (t->m_pollThreadRun != 0)
             {
-                nanosleep(&poll_wait, NULL);
-                std::unique_lock<std::mutex> lock(t->m_AVDecoderStatusLock);
-                if (t->m_pollThreadRun == 0)
-                    break;
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                int status = t->getMostActiveDecoderStatus();
+                bool changed = (status != t->m_AVStatus);
+                if (changed)
+                    t->recordDecoderStatus(status, now);
 
-                status = t->getMostActiveDecoderStatus();
-                lock.unlock();
+                // A paused pipeline is usually about to start or stop
+                bool settling = (status == EssRMgrRes_paused) || ((now - t->m_AVStatusSince) < t->m_AVSettleTime);
 
-                if (status == lastStatus)
-                    continue;
+                if (changed)
+                {
+                    lock.unlock();
+                    t->onDecoderStatusChange(status);
+                    lock.lock();
+                }
 
-                lastStatus = status;
-                t->onDecoderStatusChange(status);
+                t->m_AVPollCondition.wait_for(lock, settling ? t->m_AVPollFast : t->m_AVPollSlow,
+                    [t] { return (t->m_pollThreadRun == 0) || t->m_pollNow; });
+                t->m_pollNow = false;
             }
+            LOGINFO("AVPollThread stopped");
 
             return NULL;
         }
+
+        /* called with m_AVDecoderStatusLock held */
+        void DeviceDiagnostics::recordDecoderStatus(int status, std::chrono::steady_clock::time_point now)
+        {
+            uint64_t duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_AVStatusSince).count();
+
+            LOGINFO("AV decoder status %s -> %s after %llu ms", decoderStatusName(m_AVStatus), decoderStatusName(status),
+                    static_cast<unsigned long long>(duration));
+
+            AVStatusPeriod period = { m_AVStatus, m_AVStatusStart, duration };
+            m_AVStatusHistory.push_back(period);
+            if (m_AVStatusHistory.size() > AVStatusHistorySize)
+                m_AVStatusHistory.pop_front();
+
+            if ((m_AVStatus >= 0) && (m_AVStatus <= 2))
+                m_AVStatusTotal[m_AVStatus] += duration;
+
+            m_AVStatus = status;
+            m_AVStatusSince = now;
+            m_AVStatusStart = wallClockMs();
+        }
 #endif
 
         void DeviceDiagnostics::onDecoderStatusChange(int status)
         {
             JsonObject params;
-            params["avDecoderStatusChange"] = decoderStatusStr[status];
+            params["avDecoderStatusChange"] = decoderStatusName(status);
             sendNotify(DEVICE_DIAGNOSTICS_EVT_ON_AV_DECODER_STATUS_CHANGED, params);
         }
 
@@ -192,66 +276,256 @@ namespace WPEFramework
         {
             LOGINFOMETHOD();
 #ifdef ENABLE_ERM
-            m_AVDecoderStatusLock.lock();
+            std::unique_lock<std::mutex> lock(m_AVDecoderStatusLock);
             int status = getMostActiveDecoderStatus();
-            m_AVDecoderStatusLock.unlock();
-            response["avDecoderStatus"] = decoderStatusStr[status];
+            if (status != m_AVStatus)
+            {
+                // Let the monitor pick the change up right away
+                m_pollNow = true;
+                m_AVPollCondition.notify_one();
+            }
+            lock.unlock();
+            response["avDecoderStatus"] = decoderStatusName(status);
 #else
             response["avDecoderStatus"] = decoderStatusStr[0];
 #endif
             returnResponse(true);
         }
 
-        int DeviceDiagnostics::getConfiguration(const std::string& postData, JsonObject& out)
+        uint32_t DeviceDiagnostics::getAVDecoderStatusHistory(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+#ifdef ENABLE_ERM
+            std::lock_guard<std::mutex> lock(m_AVDecoderStatusLock);
+
+            uint64_t current = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - m_AVStatusSince).count();
+
+            response["avDecoderStatus"] = decoderStatusName(m_AVStatus);
+            response["since"] = m_AVStatusStart;
+            response["duration"] = current;
+
+            JsonArray history;
+            for (auto it = m_AVStatusHistory.begin(); it != m_AVStatusHistory.end(); ++it)
+            {
+                JsonObject period;
+                period["avDecoderStatus"] = decoderStatusName(it->status);
+                period["start"] = it->start;
+                period["duration"] = it->duration;
+                history.Add(period);
+            }
+            response["history"] = history;
+
+            JsonObject totals;
+            for (int status = 0; status <= 2; status++)
+                totals[decoderStatusStr[status]] = m_AVStatusTotal[status] + ((status == m_AVStatus) ? current : 0);
+            response["totals"] = totals;
+
+            returnResponse(true);
+#else
+            LOGWARN("ENABLE_ERM is not defined, decoder status is not monitored");
+            returnResponse(false);
+#endif
+        }
+
+        bool DeviceDiagnostics::isCacheable(const string& name) const
+        {
+            if (m_cacheTTL.count() == 0 || name.empty())
+                return false;
+
+            for (const auto& prefix : m_cacheable)
+            {
+                if (name.compare(0, prefix.size(), prefix) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        /* Answers what it can from the cache and asks the TR-181 agent for the rest, all
+         * remaining names in a single request over a kept-alive connection. A partial path
+         * (ending in '.') expands to any number of parameters, those are never answered from
+         * the cache. */
+        int DeviceDiagnostics::getConfiguration(const std::vector<string>& names, JsonObject& out)
         {
             LOGINFO("%s",__FUNCTION__);
 
-            JsonObject DeviceDiagnosticsResult;
-            int result = -1;
+            // The parameters for each name, in the order the names were asked for
+            std::vector<std::vector<JsonObject>> params(names.size());
+            std::vector<size_t> misses;
 
-            long http_code = 0;
-            std::string response;
-            CURL *curl_handle = NULL;
-            CURLcode res = CURLE_OK;
-            curl_handle = curl_easy_init();
+            {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                std::lock_guard<std::mutex> lock(m_cacheLock);
+                for (size_t i = 0; i < names.size(); i++)
+                {
+                    bool partial = !names[i].empty() && names[i].back() == '.';
+                    auto it = (!partial && isCacheable(names[i])) ? m_cache.find(names[i]) : m_cache.end();
+                    if (it != m_cache.end() && it->second.expiry > now)
+                    {
+                        params[i].emplace_back();
+                        params[i].back().FromString(it->second.parameter);
+                    }
+                    else
+                        misses.push_back(i);
+                }
+            }
 
-            LOGINFO("data: %s", postData.c_str());
+            if (!misses.empty() || names.empty())
+            {
+                JsonObject requestParams;
+                JsonArray namePairs;
+                for (size_t i : misses)
+                {
+                    JsonObject o;
+                    o["name"] = names[i];
+                    namePairs.Add(o);
+                }
+                requestParams["paramList"] = namePairs;
+
+                string postData;
+                requestParams.ToString(postData);
+
+                string response;
+                if (!postToAgent(postData, response))
+                    return -1;
+
+                JsonObject jsonHash;
+                jsonHash.FromString(response);
+
+                if (!jsonHash.HasLabel("paramList"))
+                {
+                    LOGWARN("key paramList not present");
+                    return -1;
+                }
+
+                JsonArray fetched = jsonHash["paramList"].Array();
+
+                if (misses.size() == names.size())
+                {
+                    // Nothing came from the cache, pass the agent's answer on as is
+                    out["paramList"] = jsonHash["paramList"];
+                }
+
+                // The agent may reorder or leave out names, so each of its parameters goes with the
+                // name it is, or else the partial path it is under. Any other is kept at the end.
+                std::vector<JsonObject> unmatched;
+                std::chrono::steady_clock::time_point expiry = std::chrono::steady_clock::now() + m_cacheTTL;
+                std::lock_guard<std::mutex> lock(m_cacheLock);
+                for (int f = 0; f < fetched.Length(); f++)
+                {
+                    JsonObject param = fetched[f].Object();
+                    string name = param["name"].String();
+                    if (isCacheable(name))
+                    {
+                        string parameter;
+                        param.ToString(parameter);
+                        m_cache[name] = CachedParameter{ parameter, expiry };
+                    }
+
+                    size_t match = names.size();
+                    for (size_t i : misses)
+                    {
+                        if (names[i] == name)
+                        {
+                            match = i;
+                            break;
+                        }
+                        if (match == names.size() && !names[i].empty() && names[i].back() == '.'
+                            && name.compare(0, names[i].size(), names[i]) == 0)
+                            match = i;
+                    }
+
+                    if (match != names.size())
+                        params[match].push_back(param);
+                    else
+                        unmatched.push_back(param);
+                }
+
+                if (misses.size() == names.size())
+                    return 0;
 
-            if (curl_handle) {
+                params.push_back(unmatched);
+            }
+
+            JsonArray paramList;
+            for (const auto& forName : params)
+                for (const auto& param : forName)
+                    paramList.Add(param);
+            out["paramList"] = paramList;
+            return 0;
+        }
 
+        CURL* DeviceDiagnostics::acquireHandle()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_curlLock);
+                if (!m_idleHandles.empty())
+                {
+                    CURL* handle = m_idleHandles.back();
+                    m_idleHandles.pop_back();
+                    return handle;
+                }
+            }
+
+            CURL *curl_handle = curl_easy_init();
+            if (curl_handle)
+            {
                 curl_easy_setopt(curl_handle, CURLOPT_URL, "http://127.0.0.1:10999");
-                curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, postData.c_str());
-                curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDSIZE, postData.size());
+                if (!m_unixSocket.empty())
+                    curl_easy_setopt(curl_handle, CURLOPT_UNIX_SOCKET_PATH, m_unixSocket.c_str());
                 curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1); //when redirected, follow the redirections
                 curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, writeCurlResponse);
-                curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &response);
                 curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, curlTimeoutInSeconds);
+                curl_easy_setopt(curl_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+                curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1L);
+            }
+            return curl_handle;
+        }
 
-                res = curl_easy_perform(curl_handle);
-                curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_code);
-
-                LOGWARN("Perfomed curl call : %d http response code: %ld", res, http_code);
-                curl_easy_cleanup(curl_handle);
+        void DeviceDiagnostics::releaseHandle(CURL* handle, bool reusable)
+        {
+            if (reusable)
+            {
+                std::lock_guard<std::mutex> lock(m_curlLock);
+                if (m_idleHandles.size() < MaxIdleHandles)
+                {
+                    m_idleHandles.push_back(handle);
+                    return;
+                }
             }
-            else {
+            curl_easy_cleanup(handle);
+        }
+
+        /* The handle keeps its connection to the agent open between requests,
+         * so only the first request (per concurrent caller) pays for connecting. */
+        bool DeviceDiagnostics::postToAgent(const string& postData, string& response)
+        {
+            LOGINFO("data: %s", postData.c_str());
+
+            CURL *curl_handle = acquireHandle();
+            if (!curl_handle)
+            {
                 LOGWARN("Could not perform curl ");
+                return false;
             }
 
-            if (res == CURLE_OK && (http_code == 0 || http_code == 200))
-             {
-                 LOGWARN("curl Response: %s", response.c_str());
+            long http_code = 0;
+            curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, postData.c_str());
+            curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDSIZE, postData.size());
+            curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &response);
 
-                 JsonObject jsonHash;
-                 jsonHash.FromString(response);
+            CURLcode res = curl_easy_perform(curl_handle);
+            curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_code);
 
-                 if (jsonHash.HasLabel("paramList"))
-                 {
-                    LOGWARN("key paramList present");
-                    out["paramList"] = jsonHash["paramList"];
-                    result = 0;
-                 }
-             }
-            return result;
+            LOGINFO("Perfomed curl call : %d http response code: %ld", res, http_code);
+            releaseHandle(curl_handle, res == CURLE_OK);
+
+            if (res == CURLE_OK && (http_code == 0 || http_code == 200))
+            {
+                LOGINFO("curl Response: %s", response.c_str());
+                return true;
+            }
+            return false;
         }
 
 
@@ -21,6 +21,12 @@
 
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <curl/curl.h>
 #ifdef ENABLE_ERM
 #include <essos-resmgr.h>
 #endif
@@ -48,6 +54,56 @@ namespace WPEFramework {
 		// will receive a JSONRPC message as a notification, in case this method is called.
         class DeviceDiagnostics : public AbstractPlugin {
         private:
+            class Config : public Core::JSON::Container {
+            private:
+                Config(const Config&) = delete;
+                Config& operator=(const Config&) = delete;
+
+            public:
+                Config()
+                    : AVPollFast(250)
+                    , AVPollSlow(2000)
+                    , AVSettleTime(10000)
+                    , UnixSocket()
+                    , CacheTTL(60)
+                    , Cacheable()
+                {
+                    Add(_T("avpollfast"), &AVPollFast);
+                    Add(_T("avpollslow"), &AVPollSlow);
+                    Add(_T("avsettletime"), &AVSettleTime);
+                    Add(_T("unixsocket"), &UnixSocket);
+                    Add(_T("cachettl"), &CacheTTL);
+                    Add(_T("cacheable"), &Cacheable);
+                }
+                ~Config()
+                {
+                }
+
+            public:
+                Core::JSON::DecUInt32 AVPollFast;   // ms, while the decoder status is changing
+                Core::JSON::DecUInt32 AVPollSlow;   // ms, once it has settled
+                Core::JSON::DecUInt32 AVSettleTime; // ms after a change before polling slows down
+                Core::JSON::String UnixSocket;      // Reach the TR-181 agent through this socket instead of TCP
+                Core::JSON::DecUInt32 CacheTTL;     // s, 0 disables the parameter cache
+                Core::JSON::ArrayType<Core::JSON::String> Cacheable; // Name prefixes of parameters that may be cached
+            };
+
+            struct CachedParameter {
+                string parameter;   // The agent's object for the name, as JSON
+                std::chrono::steady_clock::time_point expiry;
+            };
+
+            // Idle connections to the TR-181 agent kept open for the next request
+            static const size_t MaxIdleHandles = 4;
+
+            // A past decoder status and how long it lasted
+            struct AVStatusPeriod {
+                int status;
+                uint64_t start;     // ms since the epoch
+                uint64_t duration;  // ms
+            };
+
+            static const size_t AVStatusHistorySize = 32;
 
             // We do not allow this plugin to be copied !!
             DeviceDiagnostics(const DeviceDiagnostics&) = delete;
@@ -57,20 +113,48 @@ namespace WPEFramework {
             uint32_t getConfigurationWrapper(const JsonObject& parameters, JsonObject& response);
             //End methods
 
-            int getConfiguration(const std::string& postData, JsonObject& response);
+            int getConfiguration(const std::vector<string>& names, JsonObject& response);
+            bool postToAgent(const string& postData, string& response);
+            CURL* acquireHandle();
+            void releaseHandle(CURL* handle, bool reusable);
+            bool isCacheable(const string& name) const;
             uint32_t getAVDecoderStatus(const JsonObject& parameters, JsonObject& response);
+            uint32_t getAVDecoderStatusHistory(const JsonObject& parameters, JsonObject& response);
             int getMostActiveDecoderStatus();
             void onDecoderStatusChange(int status);
 #ifdef ENABLE_ERM
             static void *AVPollThread(void *arg);
+            void recordDecoderStatus(int status, std::chrono::steady_clock::time_point now);
 #endif
 
         private:
+            std::mutex m_curlLock;
+            std::vector<CURL*> m_idleHandles;
+            string m_unixSocket;
+
+            std::mutex m_cacheLock;
+            std::unordered_map<string, CachedParameter> m_cache;
+            std::chrono::seconds m_cacheTTL;
+            std::vector<string> m_cacheable;
+
 #ifdef ENABLE_ERM
             std::thread m_AVPollThread;
             std::mutex m_AVDecoderStatusLock;
+            std::condition_variable m_AVPollCondition;
             EssRMgr* m_EssRMgr;
             int m_pollThreadRun;
+            bool m_pollNow;
+
+            std::chrono::milliseconds m_AVPollFast;
+            std::chrono::milliseconds m_AVPollSlow;
+            std::chrono::milliseconds m_AVSettleTime;
+
+            // Decoder status as last seen by the monitor, since when, and what came before
+            int m_AVStatus;
+            std::chrono::steady_clock::time_point m_AVStatusSince;
+            uint64_t m_AVStatusStart;
+            std::deque<AVStatusPeriod> m_AVStatusHistory;
+            uint64_t m_AVStatusTotal[3];
 #endif
 
         public:
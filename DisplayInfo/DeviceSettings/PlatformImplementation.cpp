@@ -42,6 +42,9 @@
 #define EDID_MAX_HORIZONTAL_SIZE 21
 #define EDID_MAX_VERTICAL_SIZE   22
 
+#include <atomic>
+#include <memory>
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -63,6 +66,7 @@ public:
             IARM_Result_t res;
             IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_RES_PRECHANGE,ResolutionChange) );
             IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_RES_POSTCHANGE, ResolutionChange) );
+            IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_HDMI_HOTPLUG, HdmiHotplug) );
 
             //TODO: this is probably per process so we either need to be running in our own process or be carefull no other plugin is calling it
             device::Manager::Initialize();
@@ -82,6 +86,7 @@ public:
         IARM_Result_t res;
         IARM_CHECK( IARM_Bus_UnRegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_RES_PRECHANGE) );
         IARM_CHECK( IARM_Bus_UnRegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_RES_POSTCHANGE) );
+        IARM_CHECK( IARM_Bus_UnRegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_HDMI_HOTPLUG) );
         DisplayInfoImplementation::_instance = nullptr;
     }
 
@@ -148,10 +153,29 @@ public:
 
         if(DisplayInfoImplementation::_instance)
         {
+           // A mode change can come with a different EDID, e.g. when a switch or AVR was in between
+           if (eventtype == IConnectionProperties::INotification::Source::POST_RESOLUTION_CHANGE)
+           {
+               DisplayInfoImplementation::_instance->InvalidateDisplay();
+           }
            DisplayInfoImplementation::_instance->ResolutionChangeImpl(eventtype);
         }
     }
 
+    static void HdmiHotplug(const char *owner, IARM_EventId_t eventId, void *data, size_t len)
+    {
+        if ((strcmp(owner, IARM_BUS_DSMGR_NAME) == 0) && (eventId == IARM_BUS_DSMGR_EVENT_HDMI_HOTPLUG))
+        {
+            IARM_Bus_DSMgr_EventData_t *eventData = (IARM_Bus_DSMgr_EventData_t *)data;
+            TRACE_GLOBAL(Trace::Information, (_T("HDMI hotplug event data: %d"), eventData->data.hdmi_hpd.event));
+
+            if(DisplayInfoImplementation::_instance)
+            {
+               DisplayInfoImplementation::_instance->InvalidateDisplay();
+            }
+        }
+    }
+
     void ResolutionChangeImpl(IConnectionProperties::INotification::Source eventtype)
     {
         _adminLock.Lock();
@@ -211,32 +235,23 @@ public:
     }
     uint32_t VerticalFreq(uint32_t& value) const override
     {
-        vector<uint8_t> edidVec;
-        uint32_t ret = GetEdidBytes(edidVec);
-        if (ret == Core::ERROR_NONE)
+        uint32_t ret = Core::ERROR_NONE;
+        std::shared_ptr<const DisplaySnapshot> display(Display());
+        if (display->Connected == false)
         {
-            uint32_t edidLen = edidVec.size();
-            unsigned char* edidbytes = new unsigned char [edidLen];
-            std::copy(edidVec.begin(), edidVec.end(), edidbytes);
-            if (edid_parser::EDID_Verify(edidbytes, edidLen) == edid_parser::EDID_STATUS_OK)
-            {
-                edid_parser::edid_data_t data_ptr;
-                edid_parser::EDID_Parse(edidbytes, edidLen, &data_ptr);
-                value = data_ptr.res.refresh;
-                TRACE(Trace::Information, (_T("Vertical frequency = %d"), value));
-            }
-            else
-            {
-                TRACE(Trace::Information, (_T("EDID Verification failed")));
-                ret = Core::ERROR_GENERAL;
-            }
-            delete edidbytes;
+            TRACE(Trace::Information, (_T("HDMI not connected")));
+            ret = Core::ERROR_GENERAL;
         }
-        else
+        else if (display->EdidValid == false)
         {
-            TRACE(Trace::Information, (_T("HDMI not connected")));
+            TRACE(Trace::Information, (_T("EDID Verification failed")));
             ret = Core::ERROR_GENERAL;
         }
+        else
+        {
+            value = display->VerticalFreq;
+            TRACE(Trace::Information, (_T("Vertical frequency = %d"), value));
+        }
         return ret;
    }
 
@@ -306,88 +321,67 @@ public:
     uint32_t WidthInCentimeters(uint8_t& width /* @out */) const override
     {
         int ret = Core::ERROR_NONE;
-        vector<uint8_t> edidVec;
-        ret = GetEdidBytes(edidVec);
-        if (Core::ERROR_NONE == ret)
+        std::shared_ptr<const DisplaySnapshot> display(Display());
+        if (display->Connected == false)
         {
-            std::string strVideoPort = device::Host::getInstance().getDefaultVideoPortName();
-            if(edidVec.size() > EDID_MAX_VERTICAL_SIZE)
-            {
-                width = edidVec[EDID_MAX_HORIZONTAL_SIZE];
-                TRACE(Trace::Information, (_T("Width in cm = %d"), width));
-            }
-            else
-            {
-                TRACE(Trace::Information, (_T("Failed to get Display Size!")));
-                ret = Core::ERROR_GENERAL;
-            }
+            TRACE(Trace::Error, (_T("HDMI not connected!")));
+            ret = Core::ERROR_GENERAL;
+        }
+        else if(display->Edid.size() > EDID_MAX_VERTICAL_SIZE)
+        {
+            width = display->Edid[EDID_MAX_HORIZONTAL_SIZE];
+            TRACE(Trace::Information, (_T("Width in cm = %d"), width));
+        }
+        else
+        {
+            TRACE(Trace::Information, (_T("Failed to get Display Size!")));
+            ret = Core::ERROR_GENERAL;
         }
         return ret;
     }
 
     uint32_t HeightInCentimeters(uint8_t& height /* @out */) const override
     {
-        try
+        std::shared_ptr<const DisplaySnapshot> display(Display());
+        if (display->Connected == true)
         {
-            std::string strVideoPort = device::Host::getInstance().getDefaultVideoPortName();
-            ::device::VideoOutputPort vPort = ::device::Host::getInstance().getVideoOutputPort(strVideoPort.c_str());
-            if (vPort.isDisplayConnected())
+            if(display->Edid.size() > EDID_MAX_VERTICAL_SIZE)
             {
-                std::vector<uint8_t> edidVec;
-
-                vPort.getDisplay().getEDIDBytes(edidVec);
-
-                if(edidVec.size() > EDID_MAX_VERTICAL_SIZE)
-                {
-                    height = edidVec[EDID_MAX_VERTICAL_SIZE];
-                    TRACE(Trace::Information, (_T("Height in cm = %d"), height));
-                }
-                else
-                {
-                    TRACE(Trace::Information, (_T("Failed to get Display Size!")));
-                }
+                height = display->Edid[EDID_MAX_VERTICAL_SIZE];
+                TRACE(Trace::Information, (_T("Height in cm = %d"), height));
+            }
+            else
+            {
+                TRACE(Trace::Information, (_T("Failed to get Display Size!")));
             }
-        }
-        catch (const device::Exception& err)
-        {
-            TRACE(Trace::Error, (_T("Exception during DeviceSetting library call. code = %d message = %s"), err.getCode(), err.what()));
         }
         return (Core::ERROR_NONE);
     }
 
     uint32_t EDID (uint16_t& length /* @inout */, uint8_t data[] /* @out @length:length */) const override
     {
-        vector<uint8_t> edidVec({'u','n','k','n','o','w','n' });
+        vector<uint8_t> unknown({'u','n','k','n','o','w','n' });
         int ret = Core::ERROR_NONE;
-        try
+        std::shared_ptr<const DisplaySnapshot> display(Display());
+        //edid must be "unknown" unless we successfully read it from a connected display
+        const vector<uint8_t>* edidVec = &unknown;
+        if (display->Connected == true)
         {
-            vector<uint8_t> edidVec2;
-            std::string strVideoPort = device::Host::getInstance().getDefaultVideoPortName();
-            device::VideoOutputPort vPort = device::Host::getInstance().getVideoOutputPort(strVideoPort.c_str());
-            if (vPort.isDisplayConnected())
-            {
-                vPort.getDisplay().getEDIDBytes(edidVec2);
-                edidVec = edidVec2;//edidVec must be "unknown" unless we successfully get to this line
-            }
-            else
-            {
-                TRACE(Trace::Information, (_T("failure: HDMI not connected!")));
-                ret = Core::ERROR_GENERAL;
-            }
+            edidVec = &display->Edid;
         }
-        catch (const device::Exception& err)
+        else
         {
-            LOG_DEVICE_EXCEPTION0();
+            TRACE(Trace::Information, (_T("failure: HDMI not connected!")));
             ret = Core::ERROR_GENERAL;
         }
         //convert to base64
-        uint16_t size = min(edidVec.size(), (size_t)numeric_limits<uint16_t>::max());
-        if(edidVec.size() > (size_t)numeric_limits<uint16_t>::max())
+        uint16_t size = min(edidVec->size(), (size_t)numeric_limits<uint16_t>::max());
+        if(edidVec->size() > (size_t)numeric_limits<uint16_t>::max())
             LOGERR("Size too large to use ToString base64 wpe api");
         int i = 0;
         for (i; i < length && i < size; i++)
         {
-            data[i] = edidVec[i];
+            data[i] = (*edidVec)[i];
         }
         length = i;
         return ret;
@@ -576,41 +570,32 @@ public:
     uint32_t Colorimetry(IColorimetryIterator*& colorimetry /* @out */) const override
     {
         std::list<Exchange::IDisplayProperties::ColorimetryType> colorimetryCaps;
-        vector<uint8_t> edidVec;
-        uint32_t ret = GetEdidBytes(edidVec);
-        if (ret == Core::ERROR_NONE)
-        {
-            uint32_t edidLen = edidVec.size();
-            unsigned char* edidbytes = new unsigned char [edidLen];
-            std::copy(edidVec.begin(), edidVec.end(), edidbytes);
-            if (edid_parser::EDID_Verify(edidbytes, edidLen) == edid_parser::EDID_STATUS_OK)
-            {
-                edid_parser::edid_data_t data_ptr;
-                edid_parser::EDID_Parse(edidbytes, edidLen, &data_ptr);
-                uint32_t colorimetry_info = data_ptr.colorimetry_info;
-                TRACE(Trace::Information, (_T("colorimetry = %d"),colorimetry_info));
-                if (!colorimetry_info) colorimetryCaps.push_back(COLORIMETRY_UNKNOWN);
-                if (colorimetry_info & edid_parser::COLORIMETRY_INFO_XVYCC601) colorimetryCaps.push_back(COLORIMETRY_XVYCC601);
-                if (colorimetry_info & edid_parser::COLORIMETRY_INFO_XVYCC709) colorimetryCaps.push_back(COLORIMETRY_XVYCC709);
-                if (colorimetry_info & edid_parser::COLORIMETRY_INFO_SYCC601) colorimetryCaps.push_back(COLORIMETRY_SYCC601);
-                if (colorimetry_info & edid_parser::COLORIMETRY_INFO_ADOBEYCC601) colorimetryCaps.push_back(COLORIMETRY_OPYCC601);
-                if (colorimetry_info & edid_parser::COLORIMETRY_INFO_ADOBERGB) colorimetryCaps.push_back(COLORIMETRY_OPRGB);
-                if (colorimetry_info & edid_parser::COLORIMETRY_INFO_BT2020CL || colorimetry_info & edid_parser::COLORIMETRY_INFO_BT2020NCL) colorimetryCaps.push_back(COLORIMETRY_BT2020YCCBCBRC);
-                if (colorimetry_info & edid_parser::COLORIMETRY_INFO_BT2020RGB) colorimetryCaps.push_back(COLORIMETRY_BT2020RGB_YCBCR);
-                if (colorimetry_info & edid_parser::COLORIMETRY_INFO_DCI_P3) colorimetryCaps.push_back(COLORIMETRY_OTHER);
-            }
-            else
-            {
-                TRACE(Trace::Error, (_T("EDID Verification failed")));
-                ret = Core::ERROR_GENERAL;
-            }
-            delete edidbytes;
-        }
-        else
+        uint32_t ret = Core::ERROR_NONE;
+        std::shared_ptr<const DisplaySnapshot> display(Display());
+        if (display->Connected == false)
         {
             TRACE(Trace::Error, (_T("HDMI not connected!")));
             ret = Core::ERROR_GENERAL;
         }
+        else if (display->EdidValid == false)
+        {
+            TRACE(Trace::Error, (_T("EDID Verification failed")));
+            ret = Core::ERROR_GENERAL;
+        }
+        else
+        {
+            uint32_t colorimetry_info = display->Colorimetry;
+            TRACE(Trace::Information, (_T("colorimetry = %d"),colorimetry_info));
+            if (!colorimetry_info) colorimetryCaps.push_back(COLORIMETRY_UNKNOWN);
+            if (colorimetry_info & edid_parser::COLORIMETRY_INFO_XVYCC601) colorimetryCaps.push_back(COLORIMETRY_XVYCC601);
+            if (colorimetry_info & edid_parser::COLORIMETRY_INFO_XVYCC709) colorimetryCaps.push_back(COLORIMETRY_XVYCC709);
+            if (colorimetry_info & edid_parser::COLORIMETRY_INFO_SYCC601) colorimetryCaps.push_back(COLORIMETRY_SYCC601);
+            if (colorimetry_info & edid_parser::COLORIMETRY_INFO_ADOBEYCC601) colorimetryCaps.push_back(COLORIMETRY_OPYCC601);
+            if (colorimetry_info & edid_parser::COLORIMETRY_INFO_ADOBERGB) colorimetryCaps.push_back(COLORIMETRY_OPRGB);
+            if (colorimetry_info & edid_parser::COLORIMETRY_INFO_BT2020CL || colorimetry_info & edid_parser::COLORIMETRY_INFO_BT2020NCL) colorimetryCaps.push_back(COLORIMETRY_BT2020YCCBCBRC);
+            if (colorimetry_info & edid_parser::COLORIMETRY_INFO_BT2020RGB) colorimetryCaps.push_back(COLORIMETRY_BT2020RGB_YCBCR);
+            if (colorimetry_info & edid_parser::COLORIMETRY_INFO_DCI_P3) colorimetryCaps.push_back(COLORIMETRY_OTHER);
+        }
         colorimetry = Core::Service<ColorimetryIteratorImplementation>::Create<Exchange::IDisplayProperties::IColorimetryIterator>(colorimetryCaps);
         return (colorimetry != nullptr && ret == Core::ERROR_NONE ? Core::ERROR_NONE : Core::ERROR_GENERAL);
     }
@@ -659,20 +644,12 @@ public:
         std::list<Exchange::IHDRProperties::HDRType> hdrCapabilities;
 
         int capabilities = static_cast<int>(dsHDRSTANDARD_NONE);
-        try
-        {
-            std::string strVideoPort = device::Host::getInstance().getDefaultVideoPortName();
-            device::VideoOutputPort vPort = device::Host::getInstance().getVideoOutputPort(strVideoPort.c_str());
-            if (vPort.isDisplayConnected()) {
-                vPort.getTVHDRCapabilities(&capabilities);
-            }
-            else {
-                TRACE(Trace::Error, (_T("getTVHDRCapabilities failure: HDMI not connected!")));
-            }
+        std::shared_ptr<const DisplaySnapshot> display(Display());
+        if (display->Connected == true) {
+            capabilities = display->TVHDRCapabilities;
         }
-        catch(const device::Exception& err)
-        {
-            TRACE(Trace::Error, (_T("Exception during DeviceSetting library call. code = %d message = %s"), err.getCode(), err.what()));
+        else {
+            TRACE(Trace::Error, (_T("getTVHDRCapabilities failure: HDMI not connected!")));
         }
         if(!capabilities) hdrCapabilities.push_back(HDR_OFF);
         if(capabilities & dsHDRSTANDARD_HDR10) hdrCapabilities.push_back(HDR_10);
@@ -750,36 +727,116 @@ public:
         INTERFACE_ENTRY(Exchange::IDisplayProperties)
     END_INTERFACE_MAP
 
+private:
+    // What is known about the connected display, read once after every hotplug and never
+    // changed afterwards, so getters can use it without taking a lock.
+    struct DisplaySnapshot {
+        DisplaySnapshot()
+            : Connected(false)
+            , EdidValid(false)
+            , VerticalFreq(0)
+            , Colorimetry(0)
+            , TVHDRCapabilities(static_cast<int>(dsHDRSTANDARD_NONE))
+        {
+        }
+
+        bool Connected;
+        vector<uint8_t> Edid;
+        bool EdidValid;
+        uint32_t VerticalFreq;
+        uint32_t Colorimetry;
+        int TVHDRCapabilities;
+    };
+
 private:
     std::list<IConnectionProperties::INotification*> _observers;
     mutable Core::CriticalSection _adminLock;
 
+    // Only accessed with std::atomic_load/std::atomic_store, empty until read after a hotplug
+    mutable std::shared_ptr<const DisplaySnapshot> _display;
+    mutable Core::CriticalSection _displayLock;
+    mutable Core::CriticalSection _readLock;
+    std::atomic<uint32_t> _displayGeneration { 0 };
+
 private:
-    uint32_t GetEdidBytes(vector<uint8_t> &edid) const
+    std::shared_ptr<const DisplaySnapshot> Display() const
     {
-        uint32_t ret = Core::ERROR_NONE;
+        std::shared_ptr<const DisplaySnapshot> display(std::atomic_load(&_display));
+
+        if (display == nullptr) {
+            // Let concurrent callers wait for one read instead of all asking DS manager
+            _readLock.Lock();
+
+            display = std::atomic_load(&_display);
+            if (display == nullptr) {
+                uint32_t generation = _displayGeneration.load();
+                bool complete = false;
+
+                display = ReadDisplay(complete);
+
+                // Do not keep a failed read, nor one that may predate a hotplug that came in meanwhile.
+                // Right after a hotplug the EDID may not be readable yet, a connected display
+                // without a valid EDID is read again next time.
+                bool settled = ((display->Connected == false) || ((display->EdidValid == true) && (display->Edid.empty() == false)));
+
+                _displayLock.Lock();
+                if ((complete == true) && (settled == true) && (generation == _displayGeneration.load())) {
+                    std::atomic_store(&_display, display);
+                }
+                _displayLock.Unlock();
+            }
+
+            _readLock.Unlock();
+        }
+
+        return display;
+    }
+
+    void InvalidateDisplay()
+    {
+        _displayLock.Lock();
+        _displayGeneration++;
+        std::atomic_store(&_display, std::shared_ptr<const DisplaySnapshot>());
+        _displayLock.Unlock();
+    }
+
+    std::shared_ptr<const DisplaySnapshot> ReadDisplay(bool& complete) const
+    {
+        std::shared_ptr<DisplaySnapshot> display(std::make_shared<DisplaySnapshot>());
         try
         {
             std::string strVideoPort = device::Host::getInstance().getDefaultVideoPortName();
             device::VideoOutputPort vPort = device::Host::getInstance().getVideoOutputPort(strVideoPort.c_str());
             if (vPort.isDisplayConnected())
             {
-                vPort.getDisplay().getEDIDBytes(edid);
-            }
-            else
-            {
-                TRACE(Trace::Error, (_T("HDMI not connected!")));
-                ret = Core::ERROR_GENERAL;
+                display->Connected = true;
+                vPort.getDisplay().getEDIDBytes(display->Edid);
+                vPort.getTVHDRCapabilities(&display->TVHDRCapabilities);
+
+                uint32_t edidLen = display->Edid.size();
+                unsigned char* edidbytes = new unsigned char [edidLen];
+                std::copy(display->Edid.begin(), display->Edid.end(), edidbytes);
+                if (edid_parser::EDID_Verify(edidbytes, edidLen) == edid_parser::EDID_STATUS_OK)
+                {
+                    edid_parser::edid_data_t data_ptr;
+                    edid_parser::EDID_Parse(edidbytes, edidLen, &data_ptr);
+                    display->EdidValid = true;
+                    display->VerticalFreq = data_ptr.res.refresh;
+                    display->Colorimetry = data_ptr.colorimetry_info;
+                }
+                delete[] edidbytes;
             }
-
+            TRACE(Trace::Information, (_T("Display read: connected = %d, EDID = %d bytes, valid = %d"), display->Connected, static_cast<int>(display->Edid.size()), display->EdidValid));
+            complete = true;
         }
         catch (const device::Exception& err)
         {
             TRACE(Trace::Error, (_T("caught an exception: %d, %s"),err.getCode(), err.what()));
-            ret = Core::ERROR_GENERAL;
+            display = std::make_shared<DisplaySnapshot>();
+            complete = false;
         }
 
-        return ret;
+        return display;
     }
 
 
@@ -0,0 +1,119 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace PlaybackPosition {
+
+    // Layout of the shared memory object a stream keeps its playback position in when the
+    // "positionSharedMemory" setting is enabled with initConfig, so clients can poll it
+    // instead of subscribing to playbackProgressUpdate. The object is created with
+    // shm_open(Name(id)) and updated on every progress report from the player, whatever
+    // the progress event settings are.
+    //
+    // The writer makes Sequence odd while it updates the fields, a reader copies the
+    // fields and retries if Sequence was odd or changed in the meantime, see Read().
+
+    static const uint8_t Magic[8] = { 'F', 'M', 'P', 'P', 'O', 'S', '0', '1' };
+
+    struct Position {
+        uint8_t Magic[8];
+        std::atomic<uint32_t> Sequence;
+        int32_t PlaybackSpeed;
+        int64_t DurationMiliseconds;
+        int64_t PositionMiliseconds;
+        int64_t StartMiliseconds;
+        int64_t EndMiliseconds;
+        uint64_t UpdateTime; // CLOCK_MONOTONIC in microseconds
+    };
+
+    struct Snapshot {
+        int32_t PlaybackSpeed;
+        int64_t DurationMiliseconds;
+        int64_t PositionMiliseconds;
+        int64_t StartMiliseconds;
+        int64_t EndMiliseconds;
+        uint64_t UpdateTime;
+    };
+
+    // Shared memory object name for the stream created with this id
+    inline std::string Name(const std::string& id)
+    {
+        std::string name("/FireboltMediaPlayer.");
+        for (char c : id) {
+            name += ((c == '/') ? '_' : c);
+        }
+        return name;
+    }
+
+    inline void Write(Position& position, const Snapshot& snapshot)
+    {
+        uint32_t sequence = position.Sequence.load(std::memory_order_relaxed);
+        position.Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        position.PlaybackSpeed = snapshot.PlaybackSpeed;
+        position.DurationMiliseconds = snapshot.DurationMiliseconds;
+        position.PositionMiliseconds = snapshot.PositionMiliseconds;
+        position.StartMiliseconds = snapshot.StartMiliseconds;
+        position.EndMiliseconds = snapshot.EndMiliseconds;
+        position.UpdateTime = snapshot.UpdateTime;
+
+        position.Sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Returns false if the object is not a position or is being written for too long
+    inline bool Read(const Position& position, Snapshot& snapshot)
+    {
+        if (::memcmp(position.Magic, Magic, sizeof(Magic)) != 0) {
+            return false;
+        }
+
+        for (int attempt = 0; attempt < 100; attempt++) {
+            uint32_t before = position.Sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0) {
+                continue;
+            }
+
+            snapshot.PlaybackSpeed = position.PlaybackSpeed;
+            snapshot.DurationMiliseconds = position.DurationMiliseconds;
+            snapshot.PositionMiliseconds = position.PositionMiliseconds;
+            snapshot.StartMiliseconds = position.StartMiliseconds;
+            snapshot.EndMiliseconds = position.EndMiliseconds;
+            snapshot.UpdateTime = position.UpdateTime;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (position.Sequence.load(std::memory_order_relaxed) == before) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace PlaybackPosition
+} // namespace Plugin
+} // namespace WPEFramework
@@ -21,6 +21,8 @@
 #include "AampMediaStream.h"
 #include "utils.h"
 
+#include <glib.h>
+
 namespace WPEFramework {
 
     namespace Plugin {
@@ -37,7 +39,8 @@ namespace WPEFramework {
 
         void AampEventListener::Event(const AAMPEvent& event)
         {
-            LOGINFO("Event: handling event: %d", event.type);
+            if (event.type != AAMP_EVENT_PROGRESS)
+                LOGINFO("Event: handling event: %d", event.type);
             switch(event.type)
             {
             case AAMP_EVENT_TUNED:
@@ -80,16 +83,16 @@ namespace WPEFramework {
 
         void AampEventListener::HandlePlaybackProgressUpdateEvent(const AAMPEvent& event)
         {
-            JsonObject parameters;
-            parameters[_T("durationMiliseconds")] = static_cast<int>(event.data.progress.durationMiliseconds);
-            parameters[_T("positionMiliseconds")] = static_cast<int>(event.data.progress.positionMiliseconds);
-            parameters[_T("playbackSpeed")] = static_cast<int>(event.data.progress.playbackSpeed);
-            parameters[_T("startMiliseconds")] = static_cast<int>(event.data.progress.startMiliseconds);
-            parameters[_T("endMiliseconds")] = static_cast<int>(event.data.progress.endMiliseconds);
-
-            string s;
-            parameters.ToString(s);
-            _parent.SendEvent(_T("playbackProgressUpdate"), s);
+            // The stream decides when (and whether) this becomes an event
+            PlaybackPosition::Snapshot progress;
+            progress.PlaybackSpeed = static_cast<int32_t>(event.data.progress.playbackSpeed);
+            progress.DurationMiliseconds = static_cast<int64_t>(event.data.progress.durationMiliseconds);
+            progress.PositionMiliseconds = static_cast<int64_t>(event.data.progress.positionMiliseconds);
+            progress.StartMiliseconds = static_cast<int64_t>(event.data.progress.startMiliseconds);
+            progress.EndMiliseconds = static_cast<int64_t>(event.data.progress.endMiliseconds);
+            progress.UpdateTime = g_get_monotonic_time();
+
+            _parent.ReportProgress(progress);
         }
 
         void AampEventListener::HandleBufferingChangedEvent(const AAMPEvent& event)
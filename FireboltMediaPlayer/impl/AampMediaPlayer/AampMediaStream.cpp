@@ -21,6 +21,15 @@
 
 #include "utils.h"
 
+#include <new>
+
+#include <errno.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 // Use macros to avoid unnecessary repetition of code. 
 #define ADD_SETTER_INT(name, fn)                                                                                       \
     m_setters[#name] = [] (PlayerInstanceAAMP* aamp, string const& label, Variant const& value) {                      \
@@ -482,17 +491,52 @@ namespace {
     };
 }
 
+namespace {
+
+    bool sameProgress(WPEFramework::Plugin::PlaybackPosition::Snapshot const& a,
+                      WPEFramework::Plugin::PlaybackPosition::Snapshot const& b)
+    {
+        return (a.PlaybackSpeed == b.PlaybackSpeed) && (a.DurationMiliseconds == b.DurationMiliseconds) &&
+               (a.PositionMiliseconds == b.PositionMiliseconds) && (a.StartMiliseconds == b.StartMiliseconds) &&
+               (a.EndMiliseconds == b.EndMiliseconds);
+    }
+
+    void progressToJson(WPEFramework::Plugin::PlaybackPosition::Snapshot const& progress, JsonObject& parameters)
+    {
+        parameters[_T("durationMiliseconds")] = static_cast<int>(progress.DurationMiliseconds);
+        parameters[_T("positionMiliseconds")] = static_cast<int>(progress.PositionMiliseconds);
+        parameters[_T("playbackSpeed")] = static_cast<int>(progress.PlaybackSpeed);
+        parameters[_T("startMiliseconds")] = static_cast<int>(progress.StartMiliseconds);
+        parameters[_T("endMiliseconds")] = static_cast<int>(progress.EndMiliseconds);
+    }
+}
+
 namespace WPEFramework {
     namespace Plugin {
 
 
-        AampMediaStream::AampMediaStream()
+        AampMediaStream::AampMediaStream(const string& id)
         : _adminLock()
         , _notificationRelease() //Lock
         , _notification(nullptr)
         , _aampPlayer(nullptr)
         , _aampEventListener(nullptr)
         , _aampGstPlayerMainLoop(nullptr)
+        , _id(id)
+        , _progressLock()
+        , _progressMinInterval(0)
+        , _progressOnlyOnChange(false)
+        , _progressBatch(1)
+        , _progressReportInterval(1000 /* ms */)
+        , _progressPending()
+        , _progressLast()
+        , _progressHaveLast(false)
+        , _progressLastSent(0)
+        , _progressFirstPending(0)
+        , _progressTimerDue(0)
+        , _progressTimer(0)
+        , _progressDestroyed(false)
+        , _position(nullptr)
         {
             gst_init(0, nullptr);
             _aampPlayer = new PlayerInstanceAAMP();
@@ -507,7 +551,7 @@ namespace WPEFramework {
                 return;
             }
             _aampPlayer->RegisterEvents(_aampEventListener);
-            _aampPlayer->SetReportInterval(1000 /* ms */);
+            _aampPlayer->SetReportInterval(_progressReportInterval);
 
             _aampGstPlayerMainLoop = g_main_loop_new(nullptr, false);
 
@@ -517,6 +561,17 @@ namespace WPEFramework {
 
         AampMediaStream::~AampMediaStream()
         {
+            // A timer callback already running on the main loop thread waits for the lock and then
+            // finds the stream destroyed, the thread is only joined further down.
+            _progressLock.Lock();
+            _progressDestroyed = true;
+            if (_progressTimer != 0) {
+                g_source_remove(_progressTimer);
+                _progressTimer = 0;
+            }
+            _progressPending.clear();
+            _progressLock.Unlock();
+
             _adminLock.Lock();
             if(!_aampPlayer)
             {
@@ -550,6 +605,8 @@ namespace WPEFramework {
             delete _aampPlayer;
             _aampPlayer = nullptr;
             _adminLock.Unlock();
+
+            ClosePositionMemory();
         }
 
         uint32_t AampMediaStream::Load(const string& url, bool autoPlay)
@@ -607,11 +664,26 @@ namespace WPEFramework {
             bool enableVideoRectangleValue = false;
             bool enableVideoRectangleSet = false;
 
+            // Progress settings left out keep their current value
+            _progressLock.Lock();
+            int progressMinIntervalValue = _progressMinInterval;
+            bool progressOnlyOnChangeValue = _progressOnlyOnChange;
+            int progressBatchValue = _progressBatch;
+            int progressReportIntervalValue = _progressReportInterval / 1000;
+            bool positionSharedMemoryValue = (_position != nullptr);
+            _progressLock.Unlock();
+
             // Iterate through the configuration settings
             string const idLabel("id");
             string const langCodePreferenceLabel("langCodePreference");
             string const descriptiveTrackNameLabel("descriptiveTrackName");
             string const enableVideoRectangleLabel("enableVideoRectangle");
+            // How progress reports from AAMP are turned into events, these are not AAMP settings
+            string const progressMinIntervalLabel("progressMinInterval");
+            string const progressOnlyOnChangeLabel("progressOnlyOnChange");
+            string const progressBatchLabel("progressBatch");
+            string const positionSharedMemoryLabel("positionSharedMemory");
+            string const progressReportingIntervalLabel("progressReportingInterval");
             JsonObject const config(configurationJson);
             JsonObject::Iterator it = config.Variants();
             while (it.Next())
@@ -629,8 +701,20 @@ namespace WPEFramework {
                     (void)Settings::extractSetting(descriptiveTrackNameLabel, it.Current(), descriptiveTrackNameValue);
                 else if (label == enableVideoRectangleLabel)
                     enableVideoRectangleSet = Settings::extractSetting(descriptiveTrackNameLabel, it.Current(), enableVideoRectangleValue);
-                else
+                else if (label == progressMinIntervalLabel)
+                    (void)Settings::extractSetting(progressMinIntervalLabel, it.Current(), progressMinIntervalValue);
+                else if (label == progressOnlyOnChangeLabel)
+                    (void)Settings::extractSetting(progressOnlyOnChangeLabel, it.Current(), progressOnlyOnChangeValue);
+                else if (label == progressBatchLabel)
+                    (void)Settings::extractSetting(progressBatchLabel, it.Current(), progressBatchValue);
+                else if (label == positionSharedMemoryLabel)
+                    (void)Settings::extractSetting(positionSharedMemoryLabel, it.Current(), positionSharedMemoryValue);
+                else {
+                    // Also needed to tell when a partial batch is overdue
+                    if (label == progressReportingIntervalLabel)
+                        (void)Settings::extractSetting(progressReportingIntervalLabel, it.Current(), progressReportIntervalValue);
                     ConfigurationSettings::getInstance().apply(_aampPlayer, label, it.Current());
+                }
             }
 
             if (langCodePreferenceValue != -1) {
@@ -644,6 +728,22 @@ namespace WPEFramework {
                 _aampPlayer->EnableVideoRectangle(enableVideoRectangleValue);
             }
 
+            LOGINFO("Progress events: min interval %d ms, only on change %s, batch %d, shared memory %s",
+                progressMinIntervalValue, progressOnlyOnChangeValue ? "true" : "false", progressBatchValue,
+                positionSharedMemoryValue ? "true" : "false");
+            _progressLock.Lock();
+            _progressMinInterval = (progressMinIntervalValue > 0) ? progressMinIntervalValue : 0;
+            _progressOnlyOnChange = progressOnlyOnChangeValue;
+            _progressBatch = (progressBatchValue > 1) ? progressBatchValue : 1;
+            if (progressReportIntervalValue > 0)
+                _progressReportInterval = progressReportIntervalValue * 1000;
+            _progressLock.Unlock();
+
+            if (positionSharedMemoryValue)
+                OpenPositionMemory();
+            else
+                ClosePositionMemory();
+
             _adminLock.Unlock();
             return Core::ERROR_NONE;
         }
@@ -696,12 +796,19 @@ namespace WPEFramework {
         }
 
         void AampMediaStream::SendEvent(const string& eventName, const string& parameters)
+        {
+            // Progress held back by the progress settings goes out first, so events stay in order
+            FlushProgress();
+            DispatchEvent(eventName, parameters);
+        }
+
+        void AampMediaStream::DispatchEvent(const string& eventName, const string& parameters)
         {
             LOGINFO("eventName=%s, parameters=%s", eventName.c_str(), parameters.c_str());
             _adminLock.Lock();
             if(!_notification)
             {
-                LOGERR("SendEvent: notification callback is null");
+                LOGERR("DispatchEvent: notification callback is null");
                 _adminLock.Unlock();
                 return;
             }
@@ -715,6 +822,204 @@ namespace WPEFramework {
             _notificationRelease.Unlock();
         }
 
+        /**
+         * @brief Handle a progress report from AAMP.
+         *
+         * The shared memory position (if enabled) is updated every time. Events follow the settings
+         * given with InitConfig: reports equal to the previous one can be dropped, reports can be
+         * collected into a single event, and events are not sent more often than the minimum interval,
+         * with the latest report(s) going out when it has passed. A batch that does not fill up, e.g.
+         * because reports equal to the previous one were dropped or playback stopped, goes out once
+         * the reports missing from it are overdue.
+         *
+         * @param progress The reported playback position.
+         */
+        void AampMediaStream::ReportProgress(const PlaybackPosition::Snapshot& progress)
+        {
+            std::vector<PlaybackPosition::Snapshot> samples;
+            bool batched = false;
+
+            _progressLock.Lock();
+            if (_progressDestroyed) {
+                _progressLock.Unlock();
+                return;
+            }
+
+            if (_position != nullptr) {
+                PlaybackPosition::Write(*_position, progress);
+            }
+
+            if (_progressOnlyOnChange && _progressHaveLast && sameProgress(_progressLast, progress)) {
+                _progressLock.Unlock();
+                return;
+            }
+            _progressLast = progress;
+            _progressHaveLast = true;
+
+            int64_t const now = g_get_monotonic_time();
+            if (_progressPending.empty())
+                _progressFirstPending = now;
+
+            if (_progressBatch > 1) {
+                _progressPending.push_back(progress);
+            } else {
+                // Only the latest position is of interest
+                _progressPending.assign(1, progress);
+            }
+
+            int64_t due = _progressLastSent + static_cast<int64_t>(_progressMinInterval) * 1000;
+            if (_progressPending.size() < _progressBatch) {
+                int64_t const batchDue = _progressFirstPending + static_cast<int64_t>(_progressBatch) * _progressReportInterval * 1000;
+                if (batchDue > due)
+                    due = batchDue;
+            }
+
+            if (due <= now) {
+                if (_progressTimer != 0) {
+                    g_source_remove(_progressTimer);
+                    _progressTimer = 0;
+                }
+                samples.swap(_progressPending);
+                batched = (_progressBatch > 1);
+                _progressLastSent = now;
+            } else if ((_progressTimer == 0) || (_progressTimerDue != due)) {
+                if (_progressTimer != 0)
+                    g_source_remove(_progressTimer);
+                _progressTimer = g_timeout_add(static_cast<guint>((due - now + 999) / 1000), &AampMediaStream::OnProgressTimer, this);
+                _progressTimerDue = due;
+            }
+            _progressLock.Unlock();
+
+            if (!samples.empty())
+                SendProgress(samples, batched);
+        }
+
+        /**
+         * @brief Send what the progress settings held back right away.
+         */
+        void AampMediaStream::FlushProgress()
+        {
+            std::vector<PlaybackPosition::Snapshot> samples;
+            bool batched = false;
+
+            _progressLock.Lock();
+            if (_progressTimer != 0) {
+                g_source_remove(_progressTimer);
+                _progressTimer = 0;
+            }
+            if (!_progressDestroyed && !_progressPending.empty()) {
+                samples.swap(_progressPending);
+                batched = (_progressBatch > 1);
+                _progressLastSent = g_get_monotonic_time();
+            }
+            _progressLock.Unlock();
+
+            if (!samples.empty())
+                SendProgress(samples, batched);
+        }
+
+        /**
+         * @brief Progress timer, sends what was held back by the minimum interval or a partial batch.
+         *
+         * Runs on the main loop thread, which the destructor joins only after marking the stream
+         * destroyed, so the stream is still there while the lock is taken.
+         */
+        gboolean AampMediaStream::OnProgressTimer(gpointer data)
+        {
+            AampMediaStream* self = static_cast<AampMediaStream*>(data);
+            std::vector<PlaybackPosition::Snapshot> samples;
+            bool batched = false;
+
+            self->_progressLock.Lock();
+            if (self->_progressDestroyed) {
+                self->_progressLock.Unlock();
+                return G_SOURCE_REMOVE;
+            }
+            self->_progressTimer = 0;
+            if (!self->_progressPending.empty()) {
+                samples.swap(self->_progressPending);
+                batched = (self->_progressBatch > 1);
+                self->_progressLastSent = g_get_monotonic_time();
+            }
+            self->_progressLock.Unlock();
+
+            if (!samples.empty())
+                self->SendProgress(samples, batched);
+
+            return G_SOURCE_REMOVE;
+        }
+
+        /**
+         * @brief Send progress as playbackProgressUpdate, or as playbackProgressBatch with all reports
+         * in an "updates" array when batching is enabled.
+         */
+        void AampMediaStream::SendProgress(const std::vector<PlaybackPosition::Snapshot>& samples, bool batched)
+        {
+            JsonObject parameters;
+            string s;
+
+            if (batched) {
+                JsonArray updates;
+                for (auto const& sample : samples) {
+                    JsonObject update;
+                    progressToJson(sample, update);
+                    updates.Add(update);
+                }
+                parameters[_T("updates")] = updates;
+                parameters.ToString(s);
+                DispatchEvent(_T("playbackProgressBatch"), s);
+            } else {
+                progressToJson(samples.back(), parameters);
+                parameters.ToString(s);
+                DispatchEvent(_T("playbackProgressUpdate"), s);
+            }
+        }
+
+        /**
+         * @brief Create the shared memory object with the playback position, see PlaybackPosition.h.
+         */
+        void AampMediaStream::OpenPositionMemory()
+        {
+            _progressLock.Lock();
+            if (_position == nullptr) {
+                string const name = PlaybackPosition::Name(_id);
+                int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+                void* memory = MAP_FAILED;
+                if (fd >= 0) {
+                    if (ftruncate(fd, sizeof(PlaybackPosition::Position)) == 0)
+                        memory = mmap(nullptr, sizeof(PlaybackPosition::Position), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                    close(fd);
+                }
+
+                if (memory == MAP_FAILED) {
+                    LOGERR("Failed to create shared memory %s: %s", name.c_str(), strerror(errno));
+                    if (fd >= 0)
+                        shm_unlink(name.c_str());
+                } else {
+                    LOGINFO("Playback position of stream %s is in shared memory %s", _id.c_str(), name.c_str());
+                    _position = new (memory) PlaybackPosition::Position();
+                    if (_progressHaveLast)
+                        PlaybackPosition::Write(*_position, _progressLast);
+                    // Readers only trust the contents once the magic is there
+                    std::atomic_thread_fence(std::memory_order_release);
+                    memcpy(_position->Magic, PlaybackPosition::Magic, sizeof(PlaybackPosition::Magic));
+                }
+            }
+            _progressLock.Unlock();
+        }
+
+        void AampMediaStream::ClosePositionMemory()
+        {
+            _progressLock.Lock();
+            if (_position != nullptr) {
+                memset(_position->Magic, 0, sizeof(_position->Magic));
+                munmap(_position, sizeof(PlaybackPosition::Position));
+                _position = nullptr;
+                shm_unlink(PlaybackPosition::Name(_id).c_str());
+            }
+            _progressLock.Unlock();
+        }
+
         // Thread overrides
         uint32_t AampMediaStream::Worker()
         {
@@ -21,17 +21,20 @@
 
 #include "Module.h"
 #include "AampEventListener.h"
+#include "PlaybackPosition.h"
 
 #include <interfaces/IMediaPlayer.h>
 #include <gst/gst.h>
 #include <main_aamp.h>
 
+#include <vector>
+
 namespace WPEFramework {
     namespace Plugin {
 
         class AampMediaStream : public Exchange::IMediaPlayer::IMediaStream, Core::Thread {
         public:
-            AampMediaStream();
+            AampMediaStream(const string& id);
             ~AampMediaStream() override;
 
             AampMediaStream(const AampMediaStream&) = delete;
@@ -52,6 +55,7 @@ namespace WPEFramework {
             END_INTERFACE_MAP
 
             void SendEvent(const string& eventName, const string& parameters);
+            void ReportProgress(const PlaybackPosition::Snapshot& progress);
 
         private:
             typedef struct _GMainLoop GMainLoop;
@@ -59,11 +63,35 @@ namespace WPEFramework {
             // Thread Interface
             uint32_t Worker() override;
 
+            void DispatchEvent(const string& eventName, const string& parameters);
+            void FlushProgress();
+            void SendProgress(const std::vector<PlaybackPosition::Snapshot>& samples, bool batched);
+            void OpenPositionMemory();
+            void ClosePositionMemory();
+            static gboolean OnProgressTimer(gpointer data);
+
             mutable Core::CriticalSection _adminLock, _notificationRelease;
             Exchange::IMediaPlayer::IMediaStream::INotification *_notification;
             PlayerInstanceAAMP *_aampPlayer;
             AampEventListener *_aampEventListener;
             GMainLoop *_aampGstPlayerMainLoop;
+            string _id;
+
+            // Progress reporting, see InitConfig()
+            mutable Core::CriticalSection _progressLock;
+            uint32_t _progressMinInterval; // ms between progress events, 0 for every report
+            bool _progressOnlyOnChange;
+            uint32_t _progressBatch; // Reports per event, 1 is no batching
+            uint32_t _progressReportInterval; // ms between reports from AAMP
+            std::vector<PlaybackPosition::Snapshot> _progressPending;
+            PlaybackPosition::Snapshot _progressLast;
+            bool _progressHaveLast;
+            int64_t _progressLastSent; // g_get_monotonic_time()
+            int64_t _progressFirstPending; // g_get_monotonic_time() of the oldest pending report
+            int64_t _progressTimerDue; // g_get_monotonic_time() the timer is set for
+            guint _progressTimer;
+            bool _progressDestroyed; // The timer callback must not touch the stream anymore
+            PlaybackPosition::Position* _position; // Shared memory, if enabled
         };
 
     }
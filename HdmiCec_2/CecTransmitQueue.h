@@ -0,0 +1,329 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Sends CEC frames from a thread of its own, so no caller waits for a device that does not ack.
+        // Frames go out one at a time, highest priority first and in order of submission within a
+        // priority. A frame that is the same as one still waiting (same destination and same bytes) is
+        // not queued again, its callback is added to the waiting one. A frame that is not acked is
+        // retried as set for its destination, meanwhile other frames go out. Frames that have to reach
+        // the bus in order are submitted together, each one is only queued once the one before it was
+        // acked or gave up.
+        //
+        // The queue does not depend on ccec, frames are the bytes after the header and the Transmitter
+        // puts them on the bus, see HdmiCec_2Transmitter.
+        class CecTransmitQueue
+        {
+        public:
+            enum Priority {
+                PRIORITY_USER = 0,          // Asked for with an API call
+                PRIORITY_RESPONSE,          // Answers to requests of other devices
+                PRIORITY_HOUSEKEEPING       // Announcements and device discovery
+            };
+
+            enum Result {
+                RESULT_ACKED = 0,
+                RESULT_NACKED,
+                RESULT_FAILED,
+                RESULT_CANCELLED            // Still waiting when the queue was stopped
+            };
+
+            typedef std::function<void(Result result)> Callback;
+
+            class Transmitter
+            {
+            public:
+                virtual ~Transmitter() {}
+                // Gives up after timeout mS, the queue waits for nothing else meanwhile
+                virtual Result transmit(uint8_t destination, const std::vector<uint8_t>& frame, uint32_t timeout) = 0;
+            };
+
+            struct Message
+            {
+                uint8_t destination;
+                std::vector<uint8_t> frame;
+                Callback callback;
+            };
+
+            static constexpr uint8_t broadcast = 0x0F;
+            static constexpr uint32_t defaultTimeout = 1000;
+
+            CecTransmitQueue()
+                : m_transmitter(nullptr)
+                , m_exit(false)
+                , m_sequence(0)
+            {
+            }
+
+            ~CecTransmitQueue()
+            {
+                stop();
+            }
+
+            CecTransmitQueue(const CecTransmitQueue&) = delete;
+            CecTransmitQueue& operator=(const CecTransmitQueue&) = delete;
+
+            void start(Transmitter& transmitter)
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+
+                if (m_worker.joinable() == false)
+                {
+                    m_transmitter = &transmitter;
+                    m_exit = false;
+                    m_worker = std::thread(&CecTransmitQueue::run, this);
+                }
+            }
+
+            // Frames that were not sent yet complete with RESULT_CANCELLED
+            void stop()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    m_exit = true;
+                    m_signal.notify_one();
+                }
+
+                if (m_worker.joinable() == true)
+                    m_worker.join();
+
+                std::list<Entry> cancelled;
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    cancelled.swap(m_pending);
+                    m_transmitter = nullptr;
+                }
+
+                for (Entry& entry : cancelled)
+                {
+                    complete(entry, RESULT_CANCELLED);
+                    for (Entry& follower : entry.followers)
+                        complete(follower, RESULT_CANCELLED);
+                }
+            }
+
+            // A frame that is not acked is sent again up to retries times, delay mS apart. Broadcasts
+            // are only retried if the transmitter failed to send them. A single attempt takes up to
+            // timeout mS.
+            void setRetryPolicy(uint8_t destination, uint8_t retries, uint32_t delay, uint32_t timeout = defaultTimeout)
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_policies[destination] = Policy { retries, delay, timeout };
+            }
+
+            // Returns false if the queue is not started, the callback is not called then
+            bool submit(uint8_t destination, const std::vector<uint8_t>& frame, Priority priority, const Callback& callback = Callback())
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+
+                if ((m_transmitter == nullptr) || (m_exit == true))
+                    return false;
+
+                for (Entry& entry : m_pending)
+                {
+                    if ((entry.destination == destination) && (entry.frame == frame))
+                    {
+                        if (priority < entry.priority)
+                            entry.priority = priority;
+                        if (callback)
+                            entry.callbacks.push_back(callback);
+                        return true;
+                    }
+                }
+
+                Entry entry;
+                entry.destination = destination;
+                entry.frame = frame;
+                entry.priority = priority;
+                entry.sequence = m_sequence++;
+                entry.attempts = 0;
+                entry.notBefore = std::chrono::steady_clock::now();
+                if (callback)
+                    entry.callbacks.push_back(callback);
+                m_pending.push_back(entry);
+
+                m_signal.notify_one();
+                return true;
+            }
+
+            // The messages go out in the given order, a message is sent once the one before it completed,
+            // whatever its result. Other frames may go out in between.
+            bool submit(const std::vector<Message>& messages, Priority priority)
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+
+                if ((m_transmitter == nullptr) || (m_exit == true) || (messages.empty() == true))
+                    return false;
+
+                std::list<Entry> chain;
+                for (const Message& message : messages)
+                {
+                    Entry entry;
+                    entry.destination = message.destination;
+                    entry.frame = message.frame;
+                    entry.priority = priority;
+                    entry.sequence = m_sequence;
+                    entry.attempts = 0;
+                    entry.notBefore = std::chrono::steady_clock::now();
+                    if (message.callback)
+                        entry.callbacks.push_back(message.callback);
+                    chain.push_back(std::move(entry));
+                }
+                m_sequence++;
+
+                Entry head(std::move(chain.front()));
+                chain.pop_front();
+                head.followers.swap(chain);
+                m_pending.push_back(std::move(head));
+
+                m_signal.notify_one();
+                return true;
+            }
+
+            size_t pending() const
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                return m_pending.size();
+            }
+
+        private:
+            struct Policy
+            {
+                uint8_t retries;
+                uint32_t delay;
+                uint32_t timeout;
+            };
+
+            struct Entry
+            {
+                uint8_t destination;
+                std::vector<uint8_t> frame;
+                Priority priority;
+                uint32_t sequence;
+                uint8_t attempts;
+                std::chrono::steady_clock::time_point notBefore;
+                std::vector<Callback> callbacks;
+                std::list<Entry> followers;     // Queued in order once this one completed
+            };
+
+            void run()
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+
+                while (m_exit == false)
+                {
+                    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                    std::chrono::steady_clock::time_point wakeup = now + std::chrono::hours(1);
+                    std::list<Entry>::iterator next = m_pending.end();
+
+                    for (std::list<Entry>::iterator index = m_pending.begin(); index != m_pending.end(); index++)
+                    {
+                        if (index->notBefore > now)
+                        {
+                            if (index->notBefore < wakeup)
+                                wakeup = index->notBefore;
+                        }
+                        else if ((next == m_pending.end()) || (index->priority < next->priority)
+                            || ((index->priority == next->priority) && (index->sequence < next->sequence)))
+                        {
+                            next = index;
+                        }
+                    }
+
+                    if (next == m_pending.end())
+                    {
+                        m_signal.wait_until(lock, wakeup);
+                        continue;
+                    }
+
+                    // Out of the list while it is on the bus, so an identical frame submitted now is sent again
+                    Entry entry(std::move(*next));
+                    m_pending.erase(next);
+                    entry.attempts++;
+
+                    Policy policy { 0, 0, defaultTimeout };
+                    std::map<uint8_t, Policy>::const_iterator found = m_policies.find(entry.destination);
+                    if (found != m_policies.end())
+                        policy = found->second;
+
+                    Transmitter* transmitter = m_transmitter;
+                    lock.unlock();
+                    Result result = transmitter->transmit(entry.destination, entry.frame, policy.timeout);
+                    lock.lock();
+
+                    bool retry = ((result == RESULT_FAILED) || ((result == RESULT_NACKED) && (entry.destination != broadcast)));
+                    if ((retry == true) && (entry.attempts <= policy.retries) && (m_exit == false))
+                    {
+                        entry.notBefore = std::chrono::steady_clock::now() + std::chrono::milliseconds(policy.delay);
+                        m_pending.push_back(std::move(entry));
+                        continue;
+                    }
+
+                    if (entry.followers.empty() == false)
+                    {
+                        // Takes the place of the completed one, ahead of frames submitted after it
+                        Entry follower(std::move(entry.followers.front()));
+                        entry.followers.pop_front();
+                        follower.followers.swap(entry.followers);
+                        follower.sequence = entry.sequence;
+                        follower.notBefore = std::chrono::steady_clock::now();
+                        m_pending.push_back(std::move(follower));
+                    }
+
+                    lock.unlock();
+                    complete(entry, result);
+                    lock.lock();
+                }
+            }
+
+            static void complete(Entry& entry, Result result)
+            {
+                for (Callback& callback : entry.callbacks)
+                    callback(result);
+            }
+
+        private:
+            mutable std::mutex m_lock;
+            std::condition_variable m_signal;
+            std::thread m_worker;
+            Transmitter* m_transmitter;
+            bool m_exit;
+            uint32_t m_sequence;
+            std::list<Entry> m_pending;
+            std::map<uint8_t, Policy> m_policies; // By destination, no retries if not set
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
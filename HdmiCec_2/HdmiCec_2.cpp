@@ -109,7 +109,37 @@ namespace WPEFramework
                 MessageDecoder(processor).decode(in);
        }
 
+//=========================================== HdmiCec_2Transmitter =========================================
+        CecTransmitQueue::Result HdmiCec_2Transmitter::transmit(uint8_t destination, const std::vector<uint8_t>& frame, uint32_t timeout)
+        {
+                CecTransmitQueue::Result result = CecTransmitQueue::RESULT_ACKED;
+                try
+                {
+                    conn.sendTo(LogicalAddress(destination), CECFrame(frame.data(), frame.size()), timeout);
+                }
+                catch(CECNoAckException &e)
+                {
+                    LOGINFO("Frame %02X to %d not acked: %s\n", (frame.empty() ? 0 : frame[0]), destination, e.what());
+                    result = CecTransmitQueue::RESULT_NACKED;
+                }
+                catch(...)
+                {
+                    LOGWARN("Exception while sending frame %02X to %d\n", (frame.empty() ? 0 : frame[0]), destination);
+                    result = CecTransmitQueue::RESULT_FAILED;
+                }
+                return result;
+       }
+
 //=========================================== HdmiCec_2Processor =========================================
+       void HdmiCec_2Processor::sendReply(const LogicalAddress &to, const CECFrame &frame)
+       {
+             const uint8_t *buf = NULL;
+             size_t len = 0;
+
+             frame.getBuffer(&buf, &len);
+             queue.submit(to.toInt(), std::vector<uint8_t>(buf, buf + len), CecTransmitQueue::PRIORITY_RESPONSE);
+       }
+
        void HdmiCec_2Processor::process (const ActiveSource &msg, const Header &header)
        {
              printHeader(header);
@@ -145,14 +175,7 @@ namespace WPEFramework
              if(isDeviceActiveSource)
              {
                   LOGINFO("sending  ActiveSource\n");
-                  try
-                  { 
-                      conn.sendTo(LogicalAddress::BROADCAST, MessageEncoder().encode(ActiveSource(physical_addr)));
-                  } 
-                  catch(...)
-                  {
-                     LOGWARN("Exception while sending ActiveSource");
-                  }
+                  sendReply(LogicalAddress::BROADCAST, MessageEncoder().encode(ActiveSource(physical_addr)));
              }
        }
        void HdmiCec_2Processor::process (const Standby &msg, const Header &header)
@@ -166,14 +189,7 @@ namespace WPEFramework
        {
              printHeader(header);
              LOGINFO("Command: GetCECVersion sending CECVersion response \n");
-             try
-             { 
-                 conn.sendTo(header.from, MessageEncoder().encode(CECVersion(Version::V_1_4)));
-             } 
-             catch(...)
-             {
-                 LOGWARN("Exception while sending CECVersion ");
-             }
+             sendReply(header.from, MessageEncoder().encode(CECVersion(Version::V_1_4)));
        }
        void HdmiCec_2Processor::process (const CECVersion &msg, const Header &header)
        {
@@ -192,44 +208,23 @@ namespace WPEFramework
              if (!(header.from == LogicalAddress(LogicalAddress::UNREGISTERED)))
              {
                  LOGINFO("Command: GiveOSDName sending SetOSDName : %s\n",osdName.toString().c_str());
-                 try
-                 { 
-                     conn.sendTo(header.from, MessageEncoder().encode(SetOSDName(osdName)));
-                 }
-                 catch(...)
-                 {
-                     LOGWARN("Exception while sending SetOSDName");
-                 }
+                 sendReply(header.from, MessageEncoder().encode(SetOSDName(osdName)));
              }
        }
        void HdmiCec_2Processor::process (const GivePhysicalAddress &msg, const Header &header)
        {
              LOGINFO("Command: GivePhysicalAddress\n");
-             try
-             { 
-                 LOGINFO(" sending ReportPhysicalAddress response physical_addr :%s logicalAddress :%x \n",physical_addr.toString().c_str(), logicalAddress.toInt());
-                 conn.sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(ReportPhysicalAddress(physical_addr,logicalAddress.toInt()))); 
-             } 
-             catch(...)
-             {
-                LOGWARN("Exception while sending ReportPhysicalAddress ");
-             }
+             LOGINFO(" sending ReportPhysicalAddress response physical_addr :%s logicalAddress :%x \n",physical_addr.toString().c_str(), logicalAddress.toInt());
+             sendReply(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(ReportPhysicalAddress(physical_addr,logicalAddress.toInt())));
        }
        void HdmiCec_2Processor::process (const GiveDeviceVendorID &msg, const Header &header)
        {
              printHeader(header);
-             try
-             {
-                 LOGINFO("Command: GiveDeviceVendorID sending VendorID response :%s\n",(isLGTvConnected)?lgVendorId.toString().c_str():appVendorId.toString().c_str());
-                 if(isLGTvConnected)
-                     conn.sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(lgVendorId)));
-                 else 
-                     conn.sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(appVendorId)));
-             }
-             catch(...)
-             {
-                 LOGWARN("Exception while sending DeviceVendorID");
-             }
+             LOGINFO("Command: GiveDeviceVendorID sending VendorID response :%s\n",(isLGTvConnected)?lgVendorId.toString().c_str():appVendorId.toString().c_str());
+             if(isLGTvConnected)
+                 sendReply(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(lgVendorId)));
+             else
+                 sendReply(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(appVendorId)));
 
        }
        void HdmiCec_2Processor::process (const SetOSDString &msg, const Header &header)
@@ -309,14 +304,7 @@ namespace WPEFramework
        {
              printHeader(header);
              LOGINFO("Command: GiveDevicePowerStatus sending powerState :%d \n",powerState);
-             try
-             { 
-                 conn.sendTo(header.from, MessageEncoder().encode(ReportPowerStatus(PowerStatus(powerState))));
-             } 
-             catch(...)
-             {
-                 LOGWARN("Exception while sending ReportPowerStatus");
-             }
+             sendReply(header.from, MessageEncoder().encode(ReportPowerStatus(PowerStatus(powerState))));
        }
        void HdmiCec_2Processor::process (const ReportPowerStatus &msg, const Header &header)
        {
@@ -337,15 +325,7 @@ namespace WPEFramework
              if (!(header.from == LogicalAddress(LogicalAddress::BROADCAST)))
              {
 		 LOGINFO("Command: Abort, sending FeatureAbort");
-		 try
-		 { 
-		     conn.sendTo(header.from, MessageEncoder().encode(FeatureAbort(OpCode(msg.opCode()),AbortReason(ABORT_REASON_ID))));
-		 } 
-		 catch(...)
-		 {
-		     LOGWARN("Exception while sending FeatureAbort command");
-		 }
-
+		 sendReply(header.from, MessageEncoder().encode(FeatureAbort(OpCode(msg.opCode()),AbortReason(ABORT_REASON_ID))));
              }
              LOGINFO("Command: Abort\n");
        }
@@ -388,6 +368,7 @@ namespace WPEFramework
            string msg;
            HdmiCec_2::_instance = this;
            smConnection = NULL;
+           msgTransmitter = NULL;
            IsCecMgrActivated = false;
            if (Utils::IARM::init()) {
 
@@ -514,15 +495,7 @@ namespace WPEFramework
             if(true == cecEnableStatus)
             {
                 if (smConnection){
-                   try
-                   {
-                       smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(Standby()), 5000);
-		       ret = true;
-                   }
-                   catch(...)
-                   {
-                       LOGWARN("Exception while sending CEC StandBy Message");
-                   }
+                   ret = sendFrame(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(Standby()), CecTransmitQueue::PRIORITY_USER);
                 }
                 else {
                     LOGWARN("smConnection is NULL");
@@ -703,22 +676,15 @@ namespace WPEFramework
                  }
                  if(smConnection)
                  {
-                     try
-                     {
-                         LOGINFO(" sending ReportPhysicalAddress response physical_addr :%s logicalAddress :%x \n",physical_addr.toString().c_str(), logicalAddress.toInt());
-                         smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(ReportPhysicalAddress(physical_addr,logicalAddress.toInt()))); 
-
-                         LOGINFO("Command: GiveDeviceVendorID sending VendorID response :%s\n", \
-                             (isLGTvConnected)?lgVendorId.toString().c_str():appVendorId.toString().c_str());
-                         if(isLGTvConnected)
-                             smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(lgVendorId)), 5000);
-                         else 
-                             smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(appVendorId)),5000);
-                     } 
-                     catch(...)
-                     {
-                         LOGWARN("Exception while sending Messages onHdmiHotPlug\n");
-                     }
+                     LOGINFO(" sending ReportPhysicalAddress response physical_addr :%s logicalAddress :%x \n",physical_addr.toString().c_str(), logicalAddress.toInt());
+                     sendFrame(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(ReportPhysicalAddress(physical_addr,logicalAddress.toInt())), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
+
+                     LOGINFO("Command: GiveDeviceVendorID sending VendorID response :%s\n", \
+                         (isLGTvConnected)?lgVendorId.toString().c_str():appVendorId.toString().c_str());
+                     if(isLGTvConnected)
+                         sendFrame(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(lgVendorId)), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
+                     else
+                         sendFrame(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(appVendorId)), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
                  }
             }
             return;
@@ -1025,7 +991,14 @@ namespace WPEFramework
 
             smConnection = new Connection(logicalAddress.toInt(),false,"ServiceManager::Connection::");
             smConnection->open();
-            msgProcessor = new HdmiCec_2Processor(*smConnection);
+            msgTransmitter = new HdmiCec_2Transmitter(*smConnection);
+            // The TV is the one that has to see Standby and the One Touch Play frames. Other
+            // destinations may not be there at all, they are not retried and hold the bus shorter
+            m_txQueue.setRetryPolicy(LogicalAddress::TV, 2, 200, 1000);
+            for (int address = LogicalAddress::TV + 1; address < LogicalAddress::BROADCAST; address++)
+                m_txQueue.setRetryPolicy(address, 0, 0, 500);
+            m_txQueue.start(*msgTransmitter);
+            msgProcessor = new HdmiCec_2Processor(m_txQueue);
             msgFrameListener = new HdmiCec_2FrameListener(*msgProcessor);
             smConnection->addFrameListener(msgFrameListener);
 
@@ -1034,16 +1007,16 @@ namespace WPEFramework
             if(smConnection)
             {
                 LOGINFO("Command: sending GiveDevicePowerStatus \r\n");
-                smConnection->sendTo(LogicalAddress::TV, MessageEncoder().encode(GiveDevicePowerStatus()), 5000);
+                sendFrame(LogicalAddress::TV, MessageEncoder().encode(GiveDevicePowerStatus()), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
                 LOGINFO("Command: sending request active Source isDeviceActiveSource is set to false\r\n");
-                smConnection->sendTo(LogicalAddress::BROADCAST, MessageEncoder().encode(RequestActiveSource()), 5000);
+                sendFrame(LogicalAddress::BROADCAST, MessageEncoder().encode(RequestActiveSource()), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
                 isDeviceActiveSource = false;
                 LOGINFO("Command: GiveDeviceVendorID sending VendorID response :%s\n", \
                                                  (isLGTvConnected)?lgVendorId.toString().c_str():appVendorId.toString().c_str());
                 if(isLGTvConnected)
-                    smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(lgVendorId)), 5000);
-                else 
-                    smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(appVendorId)),5000);
+                    sendFrame(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(lgVendorId)), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
+                else
+                    sendFrame(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(appVendorId)), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
 
                 LOGWARN("Start Update thread %p", smConnection );
                 m_updateThreadExit = false;
@@ -1118,6 +1091,10 @@ namespace WPEFramework
                 //Clear cec device cache.
                 removeAllCecDevices();
 
+                m_txQueue.stop();
+                delete msgTransmitter;
+                msgTransmitter = NULL;
+
                 smConnection->close();
                 delete smConnection;
                 smConnection = NULL;
@@ -1219,23 +1196,25 @@ namespace WPEFramework
             if((true == cecEnableStatus) && (cecOTPSettingEnabled == true))
             {
                 if (smConnection)  {
-                    try
-                    {
-                        LOGINFO("Command: sending ImageViewOn TV \r\n");
-                        smConnection->sendTo(LogicalAddress::TV, MessageEncoder().encode(ImageViewOn()), 5000);
-                        usleep(10000);
-                        LOGINFO("Command: sending ActiveSource  physical_addr :%s \r\n",physical_addr.toString().c_str());
-                        smConnection->sendTo(LogicalAddress::BROADCAST, MessageEncoder().encode(ActiveSource(physical_addr)), 5000);
-                        usleep(10000);
-                        isDeviceActiveSource = true;
-                        LOGINFO("Command: sending GiveDevicePowerStatus \r\n");
-                        smConnection->sendTo(LogicalAddress::TV, MessageEncoder().encode(GiveDevicePowerStatus()), 5000);
-                        ret = true;
-                    }
-                    catch(...)
-                    {
-                        LOGWARN("Exception while processing performOTPAction");
-                    }
+                    // ActiveSource only goes out once the TV acked ImageViewOn or it was retried enough
+                    LOGINFO("Command: sending ImageViewOn TV, ActiveSource physical_addr :%s \r\n",physical_addr.toString().c_str());
+                    CecTransmitQueue::Message imageViewOn = { LogicalAddress::TV, frameBytes(MessageEncoder().encode(ImageViewOn())),
+                        [](CecTransmitQueue::Result result) {
+                            if (result != CecTransmitQueue::RESULT_ACKED)
+                                LOGWARN("ImageViewOn not acked: %d", result);
+                        } };
+                    CecTransmitQueue::Message activeSource = { LogicalAddress::BROADCAST, frameBytes(MessageEncoder().encode(ActiveSource(physical_addr))),
+                        [](CecTransmitQueue::Result result) {
+                            if (result == CecTransmitQueue::RESULT_ACKED)
+                                isDeviceActiveSource = true;
+                            else
+                                LOGWARN("ActiveSource not sent: %d", result);
+                        } };
+                    ret = m_txQueue.submit(std::vector<CecTransmitQueue::Message>({ imageViewOn, activeSource }), CecTransmitQueue::PRIORITY_USER);
+                    if (!ret)
+                        LOGWARN("CEC transmit queue not running, frames dropped");
+                    LOGINFO("Command: sending GiveDevicePowerStatus \r\n");
+                    ret = sendFrame(LogicalAddress::TV, MessageEncoder().encode(GiveDevicePowerStatus()), CecTransmitQueue::PRIORITY_USER) && ret;
                 }
                 else {
                     LOGWARN("smConnection is NULL");
@@ -1382,27 +1361,21 @@ namespace WPEFramework
 		}
 	}
 
-	void HdmiCec_2::sendUnencryptMsg(unsigned char* msg, int size)
+	std::vector<uint8_t> HdmiCec_2::frameBytes(const CECFrame &frame)
 	{
-		LOGINFO("sendMessage ");
+		const uint8_t *buf = NULL;
+		size_t len = 0;
 
-		if(true == cecEnableStatus)
-		{
-			std::vector <unsigned char> buf;
-			buf.resize(size);
-
-			int itr = 0;
-			for (itr= 0; itr<size; itr++)
-				buf [itr] = msg [itr];
+		frame.getBuffer(&buf, &len);
+		return std::vector<uint8_t>(buf, buf + len);
+	}
 
-			CECFrame frame = CECFrame((const uint8_t *)buf.data(), size);
-			//      SVCLOG_WARN("Frame to be sent from servicemanager in %s \n",__FUNCTION__);
-			//      frame.hexDump();
-			smConnection->sendAsync(frame);
-		}
-		else
-			LOGWARN("cecEnableStatus=false");
-		return;
+	bool HdmiCec_2::sendFrame(const LogicalAddress &to, const CECFrame &frame, CecTransmitQueue::Priority priority, const CecTransmitQueue::Callback &callback)
+	{
+		bool queued = m_txQueue.submit(to.toInt(), frameBytes(frame), priority, callback);
+		if (!queued)
+			LOGWARN("CEC transmit queue not running, frame dropped");
+		return queued;
 	}
 
 	void HdmiCec_2::requestVendorID(const int newDevlogicalAddress)
@@ -1410,16 +1383,10 @@ namespace WPEFramework
 		//Get OSD name and vendor ID only from connected devices. Since devices are identified using polling
 		//Once OSD name and Vendor ID is updated. We have to poll again in next iteration also. Just to check
 		//a new device is reconnected with same logical address
-		unsigned char msg [2];
-		unsigned int logicalAddr = logicalAddress.toInt();
-		unsigned char sender = (unsigned char)(logicalAddr & 0x0f);
-		unsigned char receiver = (unsigned char) (newDevlogicalAddress & 0x0f);
-
-		msg [0] = (sender<<4)|receiver;
-		//Request vendor id
-		msg [1] = 0x8c;
-		LOGINFO("Sending msg request vendor id %x %x", msg [0], msg [1]);
-		_instance->sendUnencryptMsg (msg, sizeof(msg));
+		//Request vendor id, the update thread asks again until it gets an answer. The queue
+		//drops the request if the previous one did not go out yet
+		LOGINFO("Sending msg request vendor id to %x", newDevlogicalAddress);
+		_instance->m_txQueue.submit(newDevlogicalAddress & 0x0f, std::vector<uint8_t>({ 0x8c }), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
 
 	}
 
@@ -1428,16 +1395,9 @@ namespace WPEFramework
 		//Get OSD name and vendor ID only from connected devices. Since devices are identified using polling
 		//Once OSD name and Vendor ID is updated. We have to poll again in next iteration also. Just to check
 		//a new device is reconnected with same logical address
-		unsigned char msg [2];
-		unsigned int logicalAddr = logicalAddress.toInt();
-		unsigned char sender = (unsigned char)(logicalAddr & 0x0f);
-		unsigned char receiver = (unsigned char) (newDevlogicalAddress & 0x0f);
-
-		msg [0] = (sender<<4)|receiver;
 		//Request OSD  name
-		msg [1] = 0x46;
-		LOGINFO("Sending msg request osd name %x %x", msg [0], msg [1]);
-		_instance->sendUnencryptMsg (msg, sizeof(msg));
+		LOGINFO("Sending msg request osd name to %x", newDevlogicalAddress);
+		_instance->m_txQueue.submit(newDevlogicalAddress & 0x0f, std::vector<uint8_t>({ 0x46 }), CecTransmitQueue::PRIORITY_HOUSEKEEPING);
 
 	}
 
@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include "ccec/FrameListener.hpp"
 #include "ccec/Connection.hpp"
+#include "ccec/CECFrame.hpp"
 
 #include "libIBus.h"
 #include "ccec/Assert.hpp"
@@ -34,6 +35,7 @@
 #include "Module.h"
 #include "utils.h"
 #include "AbstractPlugin.h"
+#include "CecTransmitQueue.h"
 
 namespace WPEFramework {
 
@@ -48,10 +50,20 @@ namespace WPEFramework {
             MessageProcessor &processor;
         };
         
+        // Puts frames of the CecTransmitQueue on the bus with the Connection
+        class HdmiCec_2Transmitter : public CecTransmitQueue::Transmitter
+        {
+        public:
+            HdmiCec_2Transmitter(Connection &conn) : conn(conn) {}
+            CecTransmitQueue::Result transmit(uint8_t destination, const std::vector<uint8_t>& frame, uint32_t timeout) override;
+        private:
+            Connection &conn;
+        };
+
         class HdmiCec_2Processor : public MessageProcessor
         {
         public:
-            HdmiCec_2Processor(Connection &conn) : conn(conn) {}
+            HdmiCec_2Processor(CecTransmitQueue &queue) : queue(queue) {}
                 void process (const ActiveSource &msg, const Header &header);
 	        void process (const InActiveSource &msg, const Header &header);
 	        void process (const ImageViewOn &msg, const Header &header);
@@ -78,7 +90,8 @@ namespace WPEFramework {
 	        void process (const Abort &msg, const Header &header);
 	        void process (const Polling &msg, const Header &header);
         private:
-            Connection conn;
+            CecTransmitQueue &queue;
+            void sendReply(const LogicalAddress &to, const CECFrame &frame);
             void printHeader(const Header &header)
             {
                 printf("Header : From : %s \n", header.from.toString().c_str());
@@ -171,8 +184,10 @@ namespace WPEFramework {
 
             void addDevice(const int logicalAddress);
             void removeDevice(const int logicalAddress);
-            void sendUnencryptMsg(unsigned char* msg, int size);
             void sendDeviceUpdateInfo(const int logicalAddress);
+            static std::vector<uint8_t> frameBytes(const CECFrame &frame);
+            bool sendFrame(const LogicalAddress &to, const CECFrame &frame, CecTransmitQueue::Priority priority,
+                const CecTransmitQueue::Callback &callback = CecTransmitQueue::Callback());
 
         private:
             // We do not allow this plugin to be copied !!
@@ -205,6 +220,8 @@ namespace WPEFramework {
             bool m_updateThreadExit;
             std::thread m_UpdateThread;
 
+            HdmiCec_2Transmitter *msgTransmitter;
+            CecTransmitQueue m_txQueue;
             HdmiCec_2Processor *msgProcessor;
             HdmiCec_2FrameListener *msgFrameListener;
             const void InitializeIARM();
@@ -19,6 +19,8 @@
  
 #include "LocationService.h"
 
+#include <algorithm>
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -264,7 +266,7 @@ namespace Plugin {
         Data _data;
     };
 
-    static Core::ProxyPoolType<Web::Response> g_Factory(1);
+    static Core::ProxyPoolType<Web::Response> g_Factory(4);
 
     static Core::NodeId FindLocalIPV6()
     {
@@ -310,16 +312,106 @@ namespace Plugin {
         return (index < (sizeof(g_domainFactory) / sizeof(DomainConstructor)) ? &(g_domainFactory[index]) : nullptr);
     }
 
-#ifdef __WINDOWS__
-#pragma warning(disable : 4355)
-#endif
+    class LocationService::Attempt : public Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, Core::ProxyPoolType<Web::Response>&> {
+    private:
+        typedef Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, Core::ProxyPoolType<Web::Response>&> BaseClass;
+
+    public:
+        Attempt() = delete;
+        Attempt(const Attempt&) = delete;
+        Attempt& operator=(const Attempt&) = delete;
+
+        Attempt(LocationService& parent, const Endpoint& endpoint, const Core::NodeId& remote)
+            : BaseClass(1, g_Factory, false, remote.AnyInterface(), remote, 256, 1024)
+            , _parent(parent)
+            , _type(remote.Type())
+            , _failed(false)
+            , _infoCarrier(endpoint.Factory())
+            , _request(Core::ProxyType<Web::Request>::Create())
+        {
+            _request->Host = endpoint.Host;
+            _request->Verb = Web::Request::HTTP_GET;
+            _request->Path = endpoint.Path;
+            if (endpoint.Query.empty() == false) {
+                _request->Query = endpoint.Query;
+            }
+        }
+        ~Attempt() override
+        {
+            Close(Core::infinite);
+        }
+
+    public:
+        Core::NodeId::enumType Type() const
+        {
+            return (_type);
+        }
+        // Both only used with the lock of the parent taken
+        bool HasFailed() const
+        {
+            return (_failed);
+        }
+        void Failed()
+        {
+            _failed = true;
+        }
+
+    private:
+        // Notification of a Partial Request received, time to attach a body..
+        void LinkBody(Core::ProxyType<Web::Response>& element) override
+        {
+            if (element->ErrorCode == Web::STATUS_OK) {
+                element->Body<Web::IBody>(Core::proxy_cast<Web::IBody>(Core::ProxyType<Web::TextBody>::Create()));
+            }
+        }
+        void Received(Core::ProxyType<Web::Response>& element) override
+        {
+            Core::ProxyType<Web::TextBody> textInfo = element->Body<Web::TextBody>();
+
+            if (textInfo.IsValid() == false) {
+                TRACE(Trace::Information, (_T("Got a response but had an empty body!")));
+                _parent.Failed(*this);
+            } else {
+                _infoCarrier->FromString(*textInfo);
+                _parent.Completed(*this, *_infoCarrier);
+            }
+        }
+        void Send(const Core::ProxyType<Web::Request>& element VARIABLE_IS_NOT_USED) override
+        {
+            // Not much to do, just so we know we are done...
+            ASSERT(element == _request);
+        }
+
+        // Signal a state change, Opened, Closed or Accepted
+        void StateChange() override
+        {
+            if (Link().IsOpen() == true) {
+
+                // Send out a trigger to send the request
+                Submit(_request);
+                TRACE(Trace::Information, (_T("Connection open, Location request submitted on %s."), (_type == Core::NodeId::TYPE_IPV6 ? _T("IPv6") : _T("IPv4"))));
+            } else {
+                // Refused, reset or closed before (or after) an answer, nothing more to expect
+                _parent.Failed(*this);
+            }
+        }
+
+    private:
+        LocationService& _parent;
+        const Core::NodeId::enumType _type;
+        bool _failed;
+        Core::ProxyType<IGeography> _infoCarrier;
+        Core::ProxyType<Web::Request> _request;
+    };
+
     LocationService::LocationService(Core::IDispatchType<void>* callback)
-        : BaseClass(1, g_Factory, false, Core::NodeId(), Core::NodeId(), 256, 1024)
-        , _adminLock()
+        : _adminLock()
         , _state(IDLE)
-        , _remoteId()
-        , _sourceNode()
+        , _endpoints()
+        , _attempts()
+        , _deadline(0)
         , _tryInterval(0)
+        , _retries(0)
         , _callback(callback)
         , _publicIPAddress()
         , _timeZone()
@@ -327,23 +419,15 @@ namespace Plugin {
         , _region()
         , _city()
         , _activity(*this)
-        , _infoCarrier()
-        , _request(Core::ProxyType<Web::Request>::Create())
     {
     }
-#ifdef __WINDOWS__
-#pragma warning(default : 4355)
-#endif
 
     LocationService::~LocationService() /* override */
     {
-
         Stop();
-
-        Close(Core::infinite);
     }
 
-    uint32_t LocationService::Probe(const string& remote, const uint32_t retries, const uint32_t retryTimeSpan)
+    uint32_t LocationService::Probe(const std::list<string>& remotes, const uint32_t retries, const uint32_t retryTimeSpan)
     {
         uint32_t result = Core::ERROR_INPROGRESS;
 
@@ -351,53 +435,59 @@ namespace Plugin {
 
         if ((_state == IDLE) || (_state == FAILED) || (_state == LOADED)) {
 
-            ASSERT(_infoCarrier.IsValid() == false);
-
             result = Core::ERROR_GENERAL;
 
-            // Determine the request
-            Core::URL info(remote.c_str());
-
-            if (info.IsValid() == true) {
-
-                result = Core::ERROR_INCORRECT_URL;
+            _endpoints.clear();
 
-                DomainConstructor* constructor = FindDomain(info);
+            for (const string& remote : remotes) {
 
-                if (constructor != nullptr) {
+                // Determine the request
+                Core::URL info(remote.c_str());
 
-                    const string hostName(info.Host().Value());
-
-                    _state = ACTIVE;
+                if (info.IsValid() == false) {
+                    TRACE(Trace::Error, (_T("URL is not valid. %s"), remote.c_str()));
+                } else {
+                    DomainConstructor* constructor = FindDomain(info);
 
-                    // it runs till zero, so subtract by definition 1 :-)
-                    _retries = (retries - 1);
-                    _tryInterval = retryTimeSpan * 1000; // Move from seconds to mS.
-                    _request->Host = hostName;
-                    _request->Verb = Web::Request::HTTP_GET;
-                    _request->Path = _T("/");
-                    if (info.Path().IsSet() == true) {
-                        _request->Path += info.Path().Value();
+                    if (constructor == nullptr) {
+                        result = Core::ERROR_INCORRECT_URL;
+                    } else {
+                        Endpoint endpoint;
+
+                        endpoint.Host = info.Host().Value();
+                        endpoint.Path = _T("/");
+                        if (info.Path().IsSet() == true) {
+                            endpoint.Path += info.Path().Value();
+                        }
+                        if (info.Query().IsSet() == true) {
+                            endpoint.Query = info.Query().Value();
+                        }
+                        endpoint.RemoteId = endpoint.Host;
+
+                        if (info.Port().IsSet() == true) {
+                            endpoint.RemoteId += ':' + Core::NumberType<uint16_t>(info.Port().Value()).Text();
+                        }
+                        else {
+                            endpoint.RemoteId += ':' + Core::NumberType<uint16_t>(Core::URL::Port(info.Type())).Text();
+                        }
+                        endpoint.Factory = constructor->factory;
+
+                        _endpoints.push_back(endpoint);
                     }
-                    _remoteId = hostName;
+                }
+            }
 
-                    if (info.Port().IsSet() == true) {
-                        _remoteId += ':' + Core::NumberType<uint16_t>(info.Port().Value()).Text();
-                    }
-                    else {
-                        _remoteId += ':' + Core::NumberType<uint16_t>(Core::URL::Port(info.Type())).Text();
-                    }
+            if (_endpoints.empty() == false) {
 
-                    if (info.Query().IsSet() == true) {
-                        _request->Query = info.Query().Value();
-                    }
+                _state = ACTIVE;
 
-                    _infoCarrier = constructor->factory();
+                // it runs till zero, so subtract by definition 1 :-)
+                _retries = (retries - 1);
+                _tryInterval = retryTimeSpan * 1000; // Move from seconds to mS.
 
-                    _activity.Submit();
+                _activity.Submit();
 
-                    result = Core::ERROR_NONE;
-                }
+                result = Core::ERROR_NONE;
             }
         }
 
@@ -408,56 +498,87 @@ namespace Plugin {
 
     void LocationService::Stop()
     {
-        _adminLock.Lock();
+        std::list<Attempt*> finished;
 
         _activity.Revoke();
 
-        if ((_state != IDLE) && (_state != FAILED) && (_state != LOADED)) {
-
-            if (IsClosed() == false) {
-                Close(0);
-            }
+        _adminLock.Lock();
 
+        if ((_state != IDLE) && (_state != FAILED) && (_state != LOADED)) {
             _state = FAILED;
         }
 
-        if(_infoCarrier.IsValid() == true) {
-            _infoCarrier.Release();
-        }
+        finished.swap(_attempts);
 
         _adminLock.Unlock();
+
+        for (Attempt* attempt : finished) {
+            delete attempt;
+        }
     }
 
-    // Methods to extract and insert data into the socket buffers
-    void LocationService::LinkBody(Core::ProxyType<Web::Response>& element) /* override */
+    void LocationService::Preset(const string& publicIPAddress, const string& timeZone, const string& country, const string& region, const string& city)
     {
-        if (element->ErrorCode == Web::STATUS_OK) {
+        _adminLock.Lock();
 
-            ASSERT(_infoCarrier.IsValid() == true);
+        _publicIPAddress = publicIPAddress;
+        _timeZone = timeZone;
+        _country = country;
+        _region = region;
+        _city = city;
 
-            element->Body<Web::IBody>(Core::proxy_cast<Web::IBody>(Core::ProxyType<Web::TextBody>::Create()));
-        }
+        _adminLock.Unlock();
     }
 
-    void LocationService::Received(Core::ProxyType<Web::Response>& element) /* override */
+    // Opens a connection to every endpoint that resolves for the given address family. Returns
+    // the number of attempts that are on their way. Called with the lock taken.
+    uint32_t LocationService::Launch(const Core::NodeId::enumType type)
     {
-        Core::ProxyType<Web::TextBody> textInfo = element->Body<Web::TextBody>();
+        uint32_t launched = 0;
+        const TCHAR* family = (type == Core::NodeId::TYPE_IPV6 ? _T("IPv6") : _T("IPv4"));
 
-        if (textInfo.IsValid() == false) {
-            TRACE(Trace::Information, (_T("Got a response but had an empty body!")));
+        for (const Endpoint& endpoint : _endpoints) {
+
+            Core::NodeId remote(endpoint.RemoteId.c_str(), type);
+
+            if (remote.IsValid() == false) {
+                TRACE(Trace::Warning, (_T("DNS resolving of [%s] on %s failed. Attempts left: %d"), endpoint.RemoteId.c_str(), family, _retries));
+            } else {
+                Attempt* attempt = new Attempt(*this, endpoint, remote);
+
+                TRACE(Trace::Information, (_T("Probing [%s:%d] on [%s]"), remote.HostAddress().c_str(), remote.PortNumber(), family));
+
+                uint32_t status = attempt->Open(0);
+
+                if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+                    launched++;
+                } else {
+                    TRACE(Trace::Warning, (_T("Failed on network %s for [%s]. Attempts left: %d"), family, endpoint.RemoteId.c_str(), _retries));
+
+                    // Cleaned up on the next dispatch
+                    attempt->Failed();
+                }
+
+                _attempts.push_back(attempt);
+            }
         }
-        else {
 
-            _infoCarrier->FromString(*textInfo);
+        return (launched);
+    }
+
+    void LocationService::Completed(Attempt& attempt, const IGeography& info)
+    {
+        _adminLock.Lock();
 
-            _adminLock.Lock();
+        // Only the first answer of a race counts
+        if ((_state == IPV6_INPROGRESS) || (_state == IPV4_INPROGRESS)) {
 
-            _timeZone = _infoCarrier->TimeZone();
-            _country = _infoCarrier->Country();
-            _region = _infoCarrier->Region();
-            _city = _infoCarrier->City();
+            _timeZone = info.TimeZone();
+            _country = info.Country();
+            _region = info.Region();
+            _city = info.City();
 
-            if (_state == IPV6_INPROGRESS) {
+            if (attempt.Type() == Core::NodeId::TYPE_IPV6) {
 
                 // For now the source IPV6 is not returned but as IPV6 is not NAT'ed our IF Address should be
                 // the outside IP address as well.
@@ -467,7 +588,7 @@ namespace Plugin {
 
                 _publicIPAddress = localId.HostAddress();
             } else {
-                _publicIPAddress = _infoCarrier->IP();
+                _publicIPAddress = info.IP();
             }
             _state = LOADED;
 
@@ -486,102 +607,93 @@ namespace Plugin {
                 TRACE(Trace::Information, (_T("Network connectivity established. Type: %s, on %s"), (node.Type() == Core::NodeId::TYPE_IPV6 ? _T("IPv6") : _T("IPv4")), node.HostAddress().c_str()));
                 _callback->Dispatch();
             }
-
-            ASSERT(_infoCarrier.IsValid() == true);
-
-            _infoCarrier.Release();
-
-            _adminLock.Unlock();
         }
 
+        _adminLock.Unlock();
+
         // Finish the cycle..
         _activity.Submit();
     }
 
-    void LocationService::Send(const Core::ProxyType<Web::Request>& element VARIABLE_IS_NOT_USED) /* override */
+    void LocationService::Failed(Attempt& attempt)
     {
-        // Not much to do, just so we know we are done...
-        ASSERT(element == _request);
-    }
+        bool reschedule = false;
 
-    // Signal a state change, Opened, Closed or Accepted
-    void LocationService::StateChange() /* override */
-    {
-        if (Link().IsOpen() == true) {
+        _adminLock.Lock();
+
+        // Attempts that are already taken out of the race are being closed, ignore those.
+        if ((std::find(_attempts.begin(), _attempts.end(), &attempt) != _attempts.end()) && (attempt.HasFailed() == false)) {
+            attempt.Failed();
+            reschedule = true;
+        }
 
-            // Send out a trigger to send the request
-            Submit(_request);
-            TRACE(Trace::Information, (_T("Connection open, Location requets submitted.")));
-        } else if (Link().HasError() == true) {
-            Close(0);
+        _adminLock.Unlock();
 
+        if (reschedule == true) {
             _activity.Submit();
         }
     }
 
-    // The network might be down, keep on trying until we have connectivity.
-    // We start using IPV6, preferred network...
+    // The network might be down, keep on trying until we have connectivity. Every round all
+    // endpoints are tried at once, IPv6 (preferred network) first, IPv4 joins the race when
+    // IPv6 had its head start or failed.
     void LocationService::Dispatch()
     {
         uint32_t result = Core::infinite;
+        std::list<Attempt*> finished;
 
-        if ((Close(100) != Core::ERROR_NONE) || (IsClosed() == false)) {
-
-            result = 500; // ms...Check again..
-        } else {
-
-            _adminLock.Lock();
-
-            if (_state == IPV4_INPROGRESS) {
-                _state = (_retries-- == 0 ? FAILED : ACTIVE);
-            }
-
-            if ((_state != LOADED) && (_state != FAILED)) {
-
-                Core::NodeId remote(_remoteId.c_str(), ((_state == ACTIVE) && (Core::NodeId::IsIPV6Enabled()) ? Core::NodeId::TYPE_IPV6 : Core::NodeId::TYPE_IPV4));
-
-                if (remote.IsValid() == false) {
+        _adminLock.Lock();
 
-                    TRACE(Trace::Warning, (_T("DNS resolving failed. Sleep for %d mS for attempt %d"), _tryInterval, _retries));
+        const state previous = _state;
+        const uint64_t now = Core::Time::Now().Ticks();
 
-                    // Name resolving does not even work. Retry this after a few seconds, if we still can..
-                    if (_retries-- == 0)
-                        _state = FAILED;
-                    else
-                        result = _tryInterval;
-                } else {
-                    Link().LocalNode(remote.AnyInterface());
-                    Link().RemoteNode(remote);
+        if ((_state == IPV4_INPROGRESS) && (now >= _deadline)) {
+            TRACE(Trace::Warning, (_T("No location received within %d mS. Attempts left: %d"), _tryInterval, _retries));
 
-                    TRACE(Trace::Information, (_T("Probing [%s:%d] on [%s]"), remote.HostAddress().c_str(), remote.PortNumber(), remote.Type() == Core::NodeId::TYPE_IPV6 ? _T("IPV6") : _T("IPv4")));
-                    _state = (remote.Type() == Core::NodeId::TYPE_IPV6 ? IPV6_INPROGRESS : IPV4_INPROGRESS);
+            _state = (_retries-- == 0 ? FAILED : ACTIVE);
+        }
 
-                    uint32_t status = Open(0);
+        // Take out what can not win anymore, a race that is over takes all its attempts along
+        std::list<Attempt*>::iterator index(_attempts.begin());
+        while (index != _attempts.end()) {
+            if ((_state == ACTIVE) || (_state == LOADED) || (_state == FAILED) || ((*index)->HasFailed() == true)) {
+                finished.push_back(*index);
+                index = _attempts.erase(index);
+            } else {
+                index++;
+            }
+        }
 
-                    if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+        if (_state == ACTIVE) {
+            _deadline = now + (static_cast<uint64_t>(_tryInterval) * Core::Time::TicksPerMillisecond);
 
-                        TRACE(Trace::Information, (_T("Sending out a network package on %s. Attempt: %d"), (remote.Type() == Core::NodeId::TYPE_IPV6 ? _T("IPv6") : _T("IPv4")), _retries));
+            if ((Core::NodeId::IsIPV6Enabled() == true) && (Launch(Core::NodeId::TYPE_IPV6) != 0)) {
+                _state = IPV6_INPROGRESS;
+                result = ConnectionAttemptDelay;
+            } else {
+                Launch(Core::NodeId::TYPE_IPV4);
+                _state = IPV4_INPROGRESS;
+            }
+        } else if (_state == IPV6_INPROGRESS) {
+            Launch(Core::NodeId::TYPE_IPV4);
+            _state = IPV4_INPROGRESS;
+        }
 
-                        // We need to get a response in the given time..
-                        result = _tryInterval;
-                    } else {
-                        TRACE(Trace::Warning, (_T("Failed on network %s. Reschedule for the next attempt: %d"), (remote.Type() == Core::NodeId::TYPE_IPV6 ? _T("IPv6") : _T("IPv4")), _retries));
+        if (_state == IPV4_INPROGRESS) {
+            // Wait for an answer till the end of the round, even if all attempts failed already
+            result = (now >= _deadline ? 0 : static_cast<uint32_t>((_deadline - now) / Core::Time::TicksPerMillisecond));
+        }
 
-                        // Seems we could not open this connection, move on to the next attempt.
-                        Close(0);
-                        result = 100;
-                    }
-                }
-            }
+        const bool failed = ((_state == FAILED) && (previous != FAILED));
 
-            if (_state == FAILED) {
-                _infoCarrier.Release();
-            }
+        _adminLock.Unlock();
 
-            _adminLock.Unlock();
+        // Closing waits for the socket to be released, do not hold the lock for it
+        for (Attempt* attempt : finished) {
+            delete attempt;
         }
 
-        if (_state == FAILED) {
+        if (failed == true) {
             Core::NodeId::ClearIPV6Enabled();
 
             TRACE(Trace::Error, (_T("LocationSync: Network connectivity could *NOT* be established. Falling back to IPv4. %d"), __LINE__));
@@ -30,8 +30,7 @@ namespace Plugin {
 
     class EXTERNAL LocationService
         : public PluginHost::ISubSystem::ILocation,
-          public PluginHost::ISubSystem::IInternet,
-          public Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, Core::ProxyPoolType<Web::Response>&> {
+          public PluginHost::ISubSystem::IInternet {
 
     private:
         enum state {
@@ -43,6 +42,20 @@ namespace Plugin {
             FAILED
         };
 
+        // Give IPv6 this head start (mS) before IPv4 joins the race, as proposed by RFC 8305
+        static constexpr uint32_t ConnectionAttemptDelay = 250;
+
+        struct Endpoint {
+            string RemoteId;
+            string Host;
+            string Path;
+            string Query;
+            Core::ProxyType<IGeography> (*Factory)();
+        };
+
+        // A single request to one endpoint over one address family
+        class Attempt;
+
         using Job = Core::ThreadPool::JobType<LocationService>;
 
     private:
@@ -50,8 +63,6 @@ namespace Plugin {
         LocationService(const LocationService&) = delete;
         LocationService& operator=(const LocationService&) = delete;
 
-        typedef Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, Core::ProxyPoolType<Web::Response>&> BaseClass;
-
     public:
         LocationService(Core::IDispatchType<void>* update);
         ~LocationService() override;
@@ -65,9 +76,24 @@ namespace Plugin {
         // Retry TimeSpan is in Seconds.
 
         static uint32_t IsSupported(const string& remoteNode);
-        uint32_t Probe(const string& remoteNode, const uint32_t retries, const uint32_t retryTimeSpan);
+
+        // All remote nodes are raced, over IPv6 and IPv4, the first answer wins. Every retry
+        // is a new race, run after the previous one did not produce an answer in time.
+        uint32_t Probe(const std::list<string>& remoteNodes, const uint32_t retries, const uint32_t retryTimeSpan);
         void Stop();
 
+        // Serve a previously probed location until a probe replaces it
+        void Preset(const string& publicIPAddress, const string& timeZone, const string& country, const string& region, const string& city);
+
+        // The last probe got an answer, a preset location alone does not count
+        bool Loaded() const
+        {
+            _adminLock.Lock();
+            bool loaded = (_state == LOADED);
+            _adminLock.Unlock();
+            return (loaded);
+        }
+
         /*
         * ------------------------------------------------------------------------------------------------------------
         * ISubSystem::INetwork methods
@@ -104,22 +130,19 @@ namespace Plugin {
         }
 
     private:
-        // Notification of a Partial Request received, time to attach a body..
-        void LinkBody(Core::ProxyType<Web::Response>& element) override;
-        void Received(Core::ProxyType<Web::Response>& element) override;
-        void Send(const Core::ProxyType<Web::Request>& element) override;
-
-        // Signal a state change, Opened, Closed or Accepted
-        void StateChange() override;
+        uint32_t Launch(const Core::NodeId::enumType type);
+        void Completed(Attempt& attempt, const IGeography& info);
+        void Failed(Attempt& attempt);
 
         friend Core::ThreadPool::JobType<LocationService&>;
         void Dispatch();
 
     private:
-        Core::CriticalSection _adminLock;
+        mutable Core::CriticalSection _adminLock;
         state _state;
-        string _remoteId;
-        Core::NodeId _sourceNode;
+        std::vector<Endpoint> _endpoints;
+        std::list<Attempt*> _attempts;
+        uint64_t _deadline;
         uint32_t _tryInterval;
         uint32_t _retries;
         Core::IDispatch* _callback;
@@ -129,8 +152,6 @@ namespace Plugin {
         string _region;
         string _city;
         Core::WorkerPool::JobType<LocationService&> _activity;
-        Core::ProxyType<IGeography> _infoCarrier;
-        Core::ProxyType<Web::Request> _request;
     };
 }
 } // namespace WPEFramework:Plugin
@@ -19,6 +19,10 @@
  
 #include "LocationSync.h"
 
+#include <stdio.h>
+
+#include <algorithm>
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -32,7 +36,8 @@ namespace Plugin {
 #endif
     LocationSync::LocationSync()
         : _skipURL(0)
-        , _source()
+        , _sources()
+        , _storage()
         , _sink(this)
         , _service(nullptr)
     {
@@ -54,12 +59,32 @@ namespace Plugin {
         config.FromString(service->ConfigLine());
         string version = service->Version();
 
+        _sources.clear();
+
         if (LocationService::IsSupported(config.Source.Value()) == Core::ERROR_NONE) {
+            _sources.push_back(config.Source.Value());
+        }
+
+        Core::JSON::ArrayType<Core::JSON::String>::Iterator index(config.Sources.Elements());
+        while (index.Next() == true) {
+            if ((LocationService::IsSupported(index.Current().Value()) == Core::ERROR_NONE)
+                && (std::find(_sources.begin(), _sources.end(), index.Current().Value()) == _sources.end())) {
+                _sources.push_back(index.Current().Value());
+            }
+        }
+
+        if (_sources.empty() == false) {
             _skipURL = static_cast<uint16_t>(service->WebPrefix().length());
-            _source = config.Source.Value();
             _service = service;
 
-            _sink.Initialize(config.Source.Value(), config.Interval.Value(), config.Retries.Value());
+            if (config.Persist.Value() == true) {
+                _storage = service->PersistentPath() + _T("location.json");
+
+                // Serve the last known location right away, the probe refreshes it in the background
+                RestoreLocation();
+            }
+
+            _sink.Initialize(_sources, config.Interval.Value(), config.Retries.Value());
         } else {
             result = _T("URL for retrieving location is incorrect !!!");
         }
@@ -108,8 +133,11 @@ namespace Plugin {
             const PluginHost::ISubSystem::IInternet* internet(subSystem->Get<PluginHost::ISubSystem::IInternet>());
             const PluginHost::ISubSystem::ILocation* location(subSystem->Get<PluginHost::ISubSystem::ILocation>());
 
-            if ((internet != nullptr) && (location != nullptr)) {
-                response->PublicIp = internet->PublicIPAddress();
+            // A restored location is available before the internet connectivity is confirmed
+            if (location != nullptr) {
+                if (internet != nullptr) {
+                    response->PublicIp = internet->PublicIPAddress();
+                }
                 response->TimeZone = location->TimeZone();
                 response->Region = location->Region();
                 response->Country = location->Country();
@@ -124,8 +152,8 @@ namespace Plugin {
         } else if (request.Verb == Web::Request::HTTP_POST) {
             index.Next();
             if (index.Next()) {
-                if ((index.Current() == "Sync") && (_source.empty() == false)) {
-                    uint32_t error = _sink.Probe(_source, 1, 1);
+                if ((index.Current() == "Sync") && (_sources.empty() == false)) {
+                    uint32_t error = _sink.Probe(_sources, 1, 1);
 
                     if (error != Core::ERROR_NONE) {
                         result->ErrorCode = Web::STATUS_INTERNAL_SERVER_ERROR;
@@ -149,13 +177,81 @@ namespace Plugin {
 
         if (subSystem != nullptr) {
 
-            subSystem->Set(PluginHost::ISubSystem::INTERNET, _sink.Network());
+            // Also called when the probe gave up, that confirms neither connectivity nor a
+            // (restored) location worth keeping
+            const bool loaded = _sink.Loaded();
+
+            if (loaded == true) {
+                subSystem->Set(PluginHost::ISubSystem::INTERNET, _sink.Network());
+            }
             subSystem->Set(PluginHost::ISubSystem::LOCATION, _sink.Location());
             subSystem->Release();
 
-            if ((_sink.Location() != nullptr) && (_sink.Location()->TimeZone().empty() == false)) {
+            if ((loaded == true) && (_sink.Location() != nullptr) && (_sink.Location()->TimeZone().empty() == false)) {
                 Core::SystemInfo::SetEnvironment(_T("TZ"), _sink.Location()->TimeZone());
                 event_locationchange();
+
+                StoreLocation();
+            }
+        }
+    }
+
+    void LocationSync::RestoreLocation()
+    {
+        Core::File file(_storage);
+
+        if (file.Open(true) == true) {
+            Data location;
+            Core::OptionalType<Core::JSON::Error> error;
+
+            location.IElement::FromFile(file, error);
+
+            if (error.IsSet() == true) {
+                TRACE(Trace::Error, (_T("Stored location %s could not be parsed"), _storage.c_str()));
+            } else if (location.TimeZone.Value().empty() == false) {
+                PluginHost::ISubSystem* subSystem = _service->SubSystems();
+
+                ASSERT(subSystem != nullptr);
+
+                if (subSystem != nullptr) {
+                    _sink.Preset(location);
+
+                    // Only the location, internet connectivity is up to the probe to confirm
+                    subSystem->Set(PluginHost::ISubSystem::LOCATION, _sink.Location());
+                    subSystem->Release();
+
+                    TRACE(Trace::Information, (_T("Restored location, timezone %s"), location.TimeZone.Value().c_str()));
+
+                    Core::SystemInfo::SetEnvironment(_T("TZ"), location.TimeZone.Value());
+                    event_locationchange();
+                }
+            }
+        }
+    }
+
+    void LocationSync::StoreLocation()
+    {
+        if (_storage.empty() == false) {
+            Data location;
+            location.PublicIp = _sink.Network()->PublicIPAddress();
+            location.TimeZone = _sink.Location()->TimeZone();
+            location.Region = _sink.Location()->Region();
+            location.Country = _sink.Location()->Country();
+            location.City = _sink.Location()->City();
+
+            Core::Directory(_service->PersistentPath().c_str()).CreatePath();
+
+            // Write aside and move in place, so a power cut never leaves half a location behind
+            const string temporary(_storage + _T(".tmp"));
+            Core::File file(temporary);
+
+            if (file.Create() == true) {
+                location.IElement::ToFile(file);
+                file.Close();
+
+                if (::rename(temporary.c_str(), _storage.c_str()) != 0) {
+                    TRACE(Trace::Error, (_T("Could not store the location in %s"), _storage.c_str()));
+                }
             }
         }
     }
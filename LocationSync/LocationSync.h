@@ -45,8 +45,8 @@ namespace Plugin {
                 Add(_T("ip"), &PublicIp);
                 Add(_T("timezone"), &TimeZone);
                 Add(_T("region"), &Region);
-                Add(_T("country"), &Region);
-                Add(_T("city"), &Region);
+                Add(_T("country"), &Country);
+                Add(_T("city"), &City);
             }
 
             ~Data() override
@@ -74,7 +74,7 @@ namespace Plugin {
 #endif
             explicit Notification(LocationSync* parent)
                 : _parent(*parent)
-                , _source()
+                , _sources()
                 , _interval()
                 , _retries()
                 , _locator(Core::Service<LocationService>::Create<LocationService>(this))
@@ -90,9 +90,9 @@ namespace Plugin {
             }
 
         public:
-            inline void Initialize(const string& source, const uint16_t interval, const uint8_t retries)
+            inline void Initialize(const std::list<string>& sources, const uint16_t interval, const uint8_t retries)
             {
-                _source = source;
+                _sources = sources;
                 _interval = interval;
                 _retries = retries;
 
@@ -101,14 +101,20 @@ namespace Plugin {
             inline void Deinitialize()
             {
             }
-            uint32_t Probe(const string& remoteNode, const uint32_t retries, const uint32_t retryTimeSpan)
+            uint32_t Probe(const std::list<string>& remoteNodes, const uint32_t retries, const uint32_t retryTimeSpan)
             {
-                _source = remoteNode;
+                _sources = remoteNodes;
                 _interval = retryTimeSpan;
                 _retries = retries;
 
                 return (Probe());
             }
+            inline void Preset(const Data& location)
+            {
+                ASSERT(_locator != nullptr);
+
+                _locator->Preset(location.PublicIp.Value(), location.TimeZone.Value(), location.Country.Value(), location.Region.Value(), location.City.Value());
+            }
 
             inline PluginHost::ISubSystem::ILocation* Location()
             {
@@ -118,6 +124,10 @@ namespace Plugin {
             {
                 return (_locator);
             }
+            inline bool Loaded() const
+            {
+                return ((_locator != nullptr) && (_locator->Loaded() == true));
+            }
 
         private:
             inline uint32_t Probe()
@@ -125,7 +135,7 @@ namespace Plugin {
 
                 ASSERT(_locator != nullptr);
 
-                return (_locator != nullptr ? _locator->Probe(_source, _retries, _interval) : static_cast<uint32_t>(Core::ERROR_UNAVAILABLE));
+                return (_locator != nullptr ? _locator->Probe(_sources, _retries, _interval) : static_cast<uint32_t>(Core::ERROR_UNAVAILABLE));
             }
 
             void Dispatch() override
@@ -135,7 +145,7 @@ namespace Plugin {
 
         private:
             LocationSync& _parent;
-            string _source;
+            std::list<string> _sources;
             uint16_t _interval;
             uint8_t _retries;
             LocationService* _locator;
@@ -151,10 +161,14 @@ namespace Plugin {
                 : Interval(30)
                 , Retries(8)
                 , Source()
+                , Sources()
+                , Persist(true)
             {
                 Add(_T("interval"), &Interval);
                 Add(_T("retries"), &Retries);
                 Add(_T("source"), &Source);
+                Add(_T("sources"), &Sources);
+                Add(_T("persist"), &Persist);
             }
             ~Config()
             {
@@ -164,6 +178,8 @@ namespace Plugin {
             Core::JSON::DecUInt16 Interval;
             Core::JSON::DecUInt8 Retries;
             Core::JSON::String Source;
+            Core::JSON::ArrayType<Core::JSON::String> Sources; // Raced together with source
+            Core::JSON::Boolean Persist;
         };
 
     private:
@@ -201,10 +217,13 @@ namespace Plugin {
         void event_locationchange();
 
         void SyncedLocation();
+        void RestoreLocation();
+        void StoreLocation();
 
     private:
         uint16_t _skipURL;
-        string _source;
+        std::list<string> _sources;
+        string _storage;
         Core::Sink<Notification> _sink;
         PluginHost::IShell* _service;
     };
@@ -56,8 +56,8 @@ namespace Plugin {
     {
         uint32_t result = Core::ERROR_NONE;
 
-        if (_source.empty() == false) {
-            result = _sink.Probe(_source, 1, 1);
+        if (_sources.empty() == false) {
+            result = _sink.Probe(_sources, 1, 1);
         } else {
             result = Core::ERROR_GENERAL;
         }
@@ -78,8 +78,11 @@ namespace Plugin {
         const PluginHost::ISubSystem::IInternet* internet(subSystem->Get<PluginHost::ISubSystem::IInternet>());
         const PluginHost::ISubSystem::ILocation* location(subSystem->Get<PluginHost::ISubSystem::ILocation>());
 
-        if ((internet != nullptr) && (location != nullptr)) {
-            response.Publicip = internet->PublicIPAddress();
+        // A restored location is available before the internet connectivity is confirmed
+        if (location != nullptr) {
+            if (internet != nullptr) {
+                response.Publicip = internet->PublicIPAddress();
+            }
 
             response.Timezone = location->TimeZone();
             response.Region = location->Region();
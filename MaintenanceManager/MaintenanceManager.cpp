@@ -37,6 +37,13 @@
 #include <bits/stdc++.h>
 #include <algorithm>
 
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
 #include "MaintenanceManager.h"
 #include "utils.h"
 
@@ -70,6 +77,14 @@ using namespace std;
 #define TR181_AUTOREBOOT_ENABLE "Device.DeviceInfo.X_RDKCENTRAL-COM_RFC.Feature.AutoReboot.Enable"
 #define TR181_STOP_MAINTENANCE  "Device.DeviceInfo.X_RDKCENTRAL-COM_RFC.Feature.StopMaintenance.Enable"
 
+/* ioprio_set(2) has no glibc wrapper */
+#define IOPRIO_CLASS_SHIFT      13
+#define IOPRIO_CLASS_BE         2
+#define IOPRIO_CLASS_IDLE       3
+#define IOPRIO_WHO_PROCESS      1
+#define IOPRIO_WHO_PGRP         2
+#define IOPRIO_PRIO_VALUE(CLASS, DATA) (((CLASS) << IOPRIO_CLASS_SHIFT) | (DATA))
+
 string notifyStatusToString(Maint_notify_status_t &status)
 {
     string ret_status="";
@@ -177,8 +192,6 @@ namespace WPEFramework {
             "/lib/rdk/Start_uploadSTBLogs.sh"
         };
 
-        vector<string> tasks;
-
         string script_names[]={
             "DCMscript_maintaince.sh",
             "RFCbase.sh",
@@ -191,6 +204,13 @@ namespace WPEFramework {
          */
         MaintenanceManager::MaintenanceManager()
             :AbstractPlugin()
+            ,m_nice(10)
+            ,m_ioPriority(IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 7))
+            ,m_activeNice(19)
+            ,m_activeIoPriority(IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0))
+            ,m_activityWindow(300)
+            ,m_maxDeferral(1800)
+            ,m_lastUserActivity(0)
         {
             MaintenanceManager::_instance = this;
 
@@ -206,6 +226,7 @@ namespace WPEFramework {
             registerMethod("startMaintenance", &MaintenanceManager::startMaintenance,this);
             registerMethod("stopMaintenance", &MaintenanceManager::stopMaintenance,this);
             registerMethod("getMaintenanceMode", &MaintenanceManager::getMaintenanceMode,this);
+            registerMethod("getMaintenanceTaskStatistics", &MaintenanceManager::getMaintenanceTaskStatistics,this);
 
 
             MaintenanceManager::m_task_map["/lib/rdk/StartDCM_maintaince.sh"]=false;
@@ -217,15 +238,8 @@ namespace WPEFramework {
          }
 
         void MaintenanceManager::task_execution_thread(){
-            uint8_t i=0;
-            string cmd="";
             bool internetConnectStatus=false;
 
-            /* cleanup if not empty */
-            if(!tasks.empty()){
-                tasks.erase (tasks.begin(),tasks.end());
-            }
-
             /* Controlled by CFLAGS */
 #if defined(SUPPRESS_MAINTENANCE)
             bool activationStatus=false;
@@ -247,6 +261,19 @@ namespace WPEFramework {
             LOGINFO("Reboot_Pending :%s",g_is_reboot_pending.c_str());
 
             MaintenanceManager::_instance->onMaintenanceStatusChange(MAINTENANCE_STARTED);
+
+            /* RFC waits for DCM (set upfront for solicited maintenance), firmware update for RFC and
+             * log upload for the firmware update, so the uploaded logs cover it (its completion is
+             * set upfront when the update is skipped). This DCM -> RFC -> swupdate -> logupload order
+             * is strict on purpose, so the scripts run one at a time. A task counts as done when its
+             * script reports COMPLETE or ERROR over IARM, not when the process exits: the scripts may
+             * leave work running in the background */
+            std::vector<MaintenanceTaskPtr> schedule;
+            MaintenanceTaskPtr rfcTask = std::make_shared<MaintenanceTask>(task_names_foreground[0], RFC_COMPLETE, (1 << DCM_COMPLETE));
+            MaintenanceTaskPtr swupdateTask = std::make_shared<MaintenanceTask>(task_names_foreground[1], DIFD_COMPLETE, (1 << RFC_COMPLETE));
+            MaintenanceTaskPtr logUploadTask = std::make_shared<MaintenanceTask>(task_names_foreground[2], LOGUPLOAD_COMPLETE, (1 << RFC_COMPLETE) | (1 << DIFD_COMPLETE));
+
+            std::unique_lock<std::mutex> lck(m_callMutex);
 #if defined(SUPPRESS_MAINTENANCE)
             /* decide which all tasks are needed based on the activation status */
             if (activationStatus){
@@ -256,63 +283,95 @@ namespace WPEFramework {
                     SET_STATUS(g_task_status,DIFD_COMPLETE);
 
                     /* Add tasks */
-                    tasks.push_back("/lib/rdk/RFCbase.sh");
-                    tasks.push_back("/lib/rdk/Start_uploadSTBLogs.sh");
+                    schedule.push_back(rfcTask);
+                    schedule.push_back(logUploadTask);
                 }else{
-                    tasks.push_back("/lib/rdk/RFCbase.sh");
-                    tasks.push_back("/lib/rdk/swupdate_utility.sh >> /opt/logs/swupdate.log");
-                    tasks.push_back("/lib/rdk/Start_uploadSTBLogs.sh");
+                    schedule.push_back(rfcTask);
+                    schedule.push_back(swupdateTask);
+                    schedule.push_back(logUploadTask);
                 }
             }
 #else
-            tasks.push_back("/lib/rdk/RFCbase.sh");
-            tasks.push_back("/lib/rdk/swupdate_utility.sh >> /opt/logs/swupdate.log");
-            tasks.push_back("/lib/rdk/Start_uploadSTBLogs.sh");
+            schedule.push_back(rfcTask);
+            schedule.push_back(swupdateTask);
+            schedule.push_back(logUploadTask);
 #endif
-            std::unique_lock<std::mutex> lck(m_callMutex);
+            {
+                std::lock_guard<std::mutex> guard(m_taskMutex);
+                m_tasks = schedule;
+            }
 
-            // Unsolicited part comes here
-            if (UNSOLICITED_MAINTENANCE == g_maintenance_type && internetConnectStatus){
-                LOGINFO("---------------UNSOLICITED_MAINTENANCE--------------");
-                for( i = 0; i < tasks.size(); i++) {
-                    LOGINFO("waiting to unlock.. [%d/%d]",i,tasks.size());
-                    task_thread.wait(lck);
-                    cmd = tasks[i];
-                    cmd += " &";
-                    cmd += "\0";
-                    m_task_map[tasks[i]] = true;
-
-                    if ( !m_abort_flag ){
-                        LOGINFO("Starting Script (USM) :  %s \n", cmd.c_str());
-                        system(cmd.c_str());
-                    }
+            if (internetConnectStatus && !schedule.empty()){
+                /* Unsolicited maintenance may be held back while the user is active,
+                 * solicited maintenance only runs throttled */
+                const bool deferrable = (UNSOLICITED_MAINTENANCE == g_maintenance_type);
+                bool userActive = isUserActive();
+
+                if (deferrable) {
+                    LOGINFO("---------------UNSOLICITED_MAINTENANCE--------------");
+                } else {
+                    LOGINFO("=============SOLICITED_MAINTENANCE===============");
                 }
-            }
-            /* Here in Solicited, we start with RFC so no
-             * need to wait for any DCM events */
-            else if( SOLICITED_MAINTENANCE == g_maintenance_type && internetConnectStatus){
-                LOGINFO("=============SOLICITED_MAINTENANCE===============");
-                cmd = tasks[0];
-                cmd += " &";
-                cmd += "\0";
-                m_task_map[tasks[0]] = true;
-                LOGINFO("Starting Script (SM) :  %s \n", cmd.c_str());
-                system(cmd.c_str());
-                cmd="";
-                for( i = 1; i < tasks.size(); i++){
-                    LOGINFO("Waiting to unlock.. [%d/%d]",i,tasks.size());
-                    task_thread.wait(lck);
-                    cmd = tasks[i];
-                    cmd += " &";
-                    cmd += "\0";
-                    m_task_map[tasks[i]]=true;
-                    if ( !m_abort_flag ){
-                        LOGINFO("Starting Script (SM) :  %s \n",cmd.c_str());
-                        system(cmd.c_str());
+
+                while (!m_abort_flag) {
+                    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                    bool pending = false;
+
+                    if (isUserActive() != userActive) {
+                        userActive = !userActive;
+                        LOGINFO("User %s, %s running tasks", userActive ? "active" : "idle", userActive ? "throttling" : "restoring");
+                        for (auto& task : schedule) {
+                            setTaskPriority(task, userActive);
+                        }
+                    }
+
+                    for (auto& task : schedule) {
+                        std::unique_lock<std::mutex> taskLock(task->lock);
+
+                        if (task->completed) {
+                            continue;
+                        }
+                        if (g_task_status & (1 << task->completeBit)) {
+                            /* reported complete, or never needed to run */
+                            task->completed = true;
+                            continue;
+                        }
+
+                        pending = true;
+                        if (task->started || ((g_task_status & task->dependsOn) != task->dependsOn)) {
+                            continue;
+                        }
+
+                        if (!task->queued) {
+                            task->queued = true;
+                            task->queuedAt = now;
+                        }
+                        if (deferrable && userActive &&
+                            (std::chrono::duration_cast<std::chrono::seconds>(now - task->queuedAt).count() < m_maxDeferral)) {
+                            if (!task->deferred) {
+                                task->deferred = true;
+                                LOGINFO("Deferring %s while the user is active", task->command.c_str());
+                            }
+                            continue;
+                        }
+                        taskLock.unlock();
+
+                        m_task_map[task->command] = true;
+                        if (!launchTask(task, userActive)) {
+                            m_task_map[task->command] = false;
+                        }
+                    }
+
+                    if (!pending) {
+                        break;
                     }
+
+                    /* woken up by the completion events, the timeout catches user activity changes */
+                    task_thread.wait_for(lck, std::chrono::seconds(1));
                 }
             }
             m_abort_flag=false;
+            lck.unlock();
             LOGINFO("Worker Thread Completed");
             if ( false == internetConnectStatus ) {
                 MaintenanceManager::_instance->onMaintenanceStatusChange(MAINTENANCE_ERROR);
@@ -320,6 +379,189 @@ namespace WPEFramework {
             }
         }
 
+        /* Starts the task script as a child process in its own process group,
+         * with the configured CPU and IO priority and in the configured cgroup.
+         * posix_spawn() does not copy the address space of the whole framework like
+         * fork() does, but it can not set these, so the shell waits on a pipe until
+         * they are set from here, before the script and anything it starts run */
+        bool MaintenanceManager::launchTask(const MaintenanceTaskPtr& task, bool throttled)
+        {
+            const string script = "read -r _ <&3; exec 3<&-; " + task->command;
+            const char* command = task->command.c_str();
+            const int niceValue = throttled ? m_activeNice : m_nice;
+            const int ioPrio = throttled ? m_activeIoPriority : m_ioPriority;
+            char* const argv[] = { const_cast<char*>("sh"), const_cast<char*>("-c"), const_cast<char*>(script.c_str()), nullptr };
+            int gate[2];
+
+            if (pipe2(gate, O_CLOEXEC) < 0) {
+                LOGERR("Failed to start %s: %s", command, strerror(errno));
+                return false;
+            }
+
+            posix_spawn_file_actions_t actions;
+            posix_spawnattr_t attributes;
+            sigset_t signals;
+
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_adddup2(&actions, gate[0], 3);
+            posix_spawnattr_init(&attributes);
+            posix_spawnattr_setpgroup(&attributes, 0);
+            sigemptyset(&signals);
+            posix_spawnattr_setsigmask(&attributes, &signals);
+            posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK);
+
+            pid_t pid = -1;
+            const int result = posix_spawn(&pid, "/bin/sh", &actions, &attributes, argv, environ);
+
+            posix_spawnattr_destroy(&attributes);
+            posix_spawn_file_actions_destroy(&actions);
+            close(gate[0]);
+
+            if (0 != result) {
+                close(gate[1]);
+                LOGERR("Failed to start %s: %s", command, strerror(result));
+                return false;
+            }
+
+            if (!m_cgroupProcs.empty()) {
+                std::ofstream procs(m_cgroupProcs);
+                procs << pid << std::endl;
+                if (!procs) {
+                    LOGWARN("Failed to move %s to %s", command, m_cgroupProcs.c_str());
+                }
+            }
+            if (setpriority(PRIO_PROCESS, pid, niceValue) < 0) {
+                LOGWARN("Failed to set nice %d for %s: %s", niceValue, command, strerror(errno));
+            }
+            if ((ioPrio >= 0) && (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, pid, ioPrio) < 0)) {
+                LOGWARN("Failed to set io priority for %s: %s", command, strerror(errno));
+            }
+
+            /* lets the shell go on */
+            close(gate[1]);
+
+            {
+                std::lock_guard<std::mutex> lock(task->lock);
+                task->pid = pid;
+                task->started = true;
+                task->throttled = throttled;
+                task->startedAt = std::chrono::steady_clock::now();
+            }
+            LOGINFO("Starting Script (%s) : %s, pid %d%s", (SOLICITED_MAINTENANCE == g_maintenance_type) ? "SM" : "USM",
+                command, pid, throttled ? ", throttled" : "");
+
+            /* completion is still signalled by the script's IARM event, this only
+             * collects the exit status and resource usage of the process */
+            std::thread reaper([task, pid]() {
+                int status = 0;
+                struct rusage usage;
+                pid_t result;
+
+                memset(&usage, 0, sizeof(usage));
+                do {
+                    result = wait4(pid, &status, 0, &usage);
+                } while ((result < 0) && (EINTR == errno));
+
+                std::lock_guard<std::mutex> lock(task->lock);
+                task->exited = true;
+                task->finishedAt = std::chrono::steady_clock::now();
+                if (result == pid) {
+                    task->exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : (128 + WTERMSIG(status));
+                    task->usage = usage;
+                }
+
+                LOGINFO("%s exited with %d after %lld ms, cpu user %ld ms system %ld ms, max rss %ld kB, blocks in %ld out %ld",
+                    task->command.c_str(), task->exitCode,
+                    static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(task->finishedAt - task->startedAt).count()),
+                    static_cast<long>(usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000),
+                    static_cast<long>(usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000),
+                    usage.ru_maxrss, usage.ru_inblock, usage.ru_oublock);
+            });
+
+            joinReapers(false);
+            {
+                std::lock_guard<std::mutex> guard(m_taskMutex);
+                m_reapers.emplace_back(task, std::move(reaper));
+            }
+
+            return true;
+        }
+
+        /* Joins the reapers of processes that exited, or all of them, which waits for the scripts still running */
+        void MaintenanceManager::joinReapers(bool all)
+        {
+            std::vector<std::pair<MaintenanceTaskPtr, std::thread>> finished;
+            {
+                std::lock_guard<std::mutex> guard(m_taskMutex);
+                for (auto index = m_reapers.begin(); index != m_reapers.end(); ) {
+                    bool exited = all;
+                    if (!exited) {
+                        std::lock_guard<std::mutex> lock(index->first->lock);
+                        exited = index->first->exited;
+                    }
+                    if (exited) {
+                        finished.push_back(std::move(*index));
+                        index = m_reapers.erase(index);
+                    }
+                    else {
+                        index++;
+                    }
+                }
+            }
+
+            for (auto& reaper : finished) {
+                reaper.second.join();
+            }
+        }
+
+        /* Moves the whole process group of a running task between the normal and the throttled priority */
+        void MaintenanceManager::setTaskPriority(const MaintenanceTaskPtr& task, bool throttled)
+        {
+            std::lock_guard<std::mutex> lock(task->lock);
+
+            if (!task->started || task->exited || (task->throttled == throttled)) {
+                return;
+            }
+
+            const int niceValue = throttled ? m_activeNice : m_nice;
+            const int ioPrio = throttled ? m_activeIoPriority : m_ioPriority;
+
+            if (setpriority(PRIO_PGRP, task->pid, niceValue) < 0) {
+                LOGWARN("Failed to set nice %d for %s: %s", niceValue, task->command.c_str(), strerror(errno));
+            }
+            if ((ioPrio >= 0) && (syscall(SYS_ioprio_set, IOPRIO_WHO_PGRP, task->pid, ioPrio) < 0)) {
+                LOGWARN("Failed to set io priority for %s: %s", task->command.c_str(), strerror(errno));
+            }
+            task->throttled = throttled;
+        }
+
+        /* The device counts as in use while remote keys were pressed within the activity window */
+        bool MaintenanceManager::isUserActive() const
+        {
+            const int64_t last = m_lastUserActivity;
+
+            if ((0 == last) || (0 == m_activityWindow)) {
+                return false;
+            }
+
+            const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            return ((now - last) < m_activityWindow);
+        }
+
+        int MaintenanceManager::ioPriority(const string& ioClass)
+        {
+            if (ioClass == "besteffort") {
+                return IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 7);
+            }
+            else if (ioClass == "idle") {
+                return IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0);
+            }
+            else if (ioClass != "none") {
+                LOGWARN("Unknown io class '%s', leaving io priority unchanged", ioClass.c_str());
+            }
+            return -1;
+        }
+
         const string MaintenanceManager::checkActivatedStatus()
         {
             JsonObject joGetParams;
@@ -497,8 +739,19 @@ namespace WPEFramework {
             MaintenanceManager::_instance = nullptr;
         }
 
-        const string MaintenanceManager::Initialize(PluginHost::IShell*)
+        const string MaintenanceManager::Initialize(PluginHost::IShell* service)
         {
+            Config config;
+            config.FromString(service->ConfigLine());
+
+            m_nice = config.Nice.Value();
+            m_ioPriority = ioPriority(config.IOClass.Value());
+            m_activeNice = config.ActiveNice.Value();
+            m_activeIoPriority = ioPriority(config.ActiveIOClass.Value());
+            m_cgroupProcs = config.CGroup.Value().empty() ? string() : (config.CGroup.Value() + "/cgroup.procs");
+            m_activityWindow = config.ActivityWindow.Value();
+            m_maxDeferral = config.MaxDeferral.Value();
+
 #if defined(USE_IARMBUS) || defined(USE_IARM_BUS)
             InitializeIARM();
 #endif /* defined(USE_IARMBUS) || defined(USE_IARM_BUS) */
@@ -511,6 +764,8 @@ namespace WPEFramework {
 #if defined(USE_IARMBUS) || defined(USE_IARM_BUS)
             DeinitializeIARM();
 #endif /* defined(USE_IARMBUS) || defined(USE_IARM_BUS) */
+            /* the reapers run code of this library */
+            joinReapers(true);
         }
 
 #if defined(USE_IARMBUS) || defined(USE_IARM_BUS)
@@ -522,6 +777,8 @@ namespace WPEFramework {
                 IARM_CHECK(IARM_Bus_RegisterEventHandler(IARM_BUS_MAINTENANCE_MGR_NAME, IARM_BUS_MAINTENANCEMGR_EVENT_UPDATE, _MaintenanceMgrEventHandler));
                 //Register for setMaintenanceStartTime
                 IARM_CHECK(IARM_Bus_RegisterEventHandler(IARM_BUS_MAINTENANCE_MGR_NAME, IARM_BUS_DCM_NEW_START_TIME_EVENT,_MaintenanceMgrEventHandler));
+                //Register for key presses, to keep maintenance out of the user's way
+                IARM_CHECK(IARM_Bus_RegisterEventHandler(IARM_BUS_IRMGR_NAME, IARM_BUS_IRMGR_EVENT_IRKEY, _IrKeyEventHandler));
 
                 maintenanceManagerOnBootup();
             }
@@ -554,8 +811,11 @@ namespace WPEFramework {
             MaintenanceManager::g_is_critical_maintenance="false";
             MaintenanceManager::g_is_reboot_pending="false";
             MaintenanceManager::g_lastSuccessful_maint_time="";
-            MaintenanceManager::g_task_status=0;
-            MaintenanceManager::m_abort_flag=false;
+            {
+                std::lock_guard<std::mutex> guard(m_callMutex);
+                MaintenanceManager::g_task_status=0;
+                MaintenanceManager::m_abort_flag=false;
+            }
 
             /* we post just to tell that we are in idle at this moment */
             MaintenanceManager::_instance->onMaintenanceStatusChange(m_notify_status);
@@ -567,6 +827,7 @@ namespace WPEFramework {
                 exec_status = system("/lib/rdk/StartDCM_maintaince.sh &");
                 if ( E_OK == exec_status ){
                     LOGINFO("DBG:Succesfully executed StartDCM_maintaince.sh \n");
+                    std::lock_guard<std::mutex> guard(m_callMutex);
                     m_task_map["/lib/rdk/StartDCM_maintaince.sh"]=true;
                 }
                 else {
@@ -597,6 +858,14 @@ namespace WPEFramework {
                 LOGWARN("WARNING - cannot handle IARM events without MaintenanceManager plugin instance!");
         }
 
+        void MaintenanceManager::_IrKeyEventHandler(const char *owner, IARM_EventId_t eventId, void *data, size_t len)
+        {
+            if (MaintenanceManager::_instance && !strcmp(owner, IARM_BUS_IRMGR_NAME) && (IARM_BUS_IRMGR_EVENT_IRKEY == eventId)) {
+                MaintenanceManager::_instance->m_lastUserActivity =
+                    std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+        }
+
         void MaintenanceManager::iarmEventHandler(const char *owner, IARM_EventId_t eventId, void *data, size_t len)
         {
             Maint_notify_status_t notify_status=MAINTENANCE_STARTED;
@@ -604,6 +873,8 @@ namespace WPEFramework {
             IARM_Maint_module_status_t module_status;
             time_t successfulTime;
             string str_successfulTime="";
+            /* the task states are shared with the scheduler in task_execution_thread */
+            std::unique_lock<std::mutex> lck(m_callMutex);
             auto task_status_DCM=m_task_map.find("/lib/rdk/StartDCM_maintaince.sh");
             auto task_status_RFC=m_task_map.find(task_names_foreground[0].c_str());
             auto task_status_FWDLD=m_task_map.find(task_names_foreground[1].c_str());
@@ -671,6 +942,7 @@ namespace WPEFramework {
                             else {
                                 SET_STATUS(g_task_status,LOGUPLOAD_SUCCESS);
                                 SET_STATUS(g_task_status,LOGUPLOAD_COMPLETE);
+                                task_thread.notify_one();
                                 m_task_map[task_names_foreground[2].c_str()]=false;
                             }
 
@@ -721,6 +993,7 @@ namespace WPEFramework {
                             }
                             else {
                                 SET_STATUS(g_task_status,LOGUPLOAD_COMPLETE);
+                                task_thread.notify_one();
                                 LOGINFO("Error encountered in LOGUPLOAD script task \n");
                                 m_task_map[task_names_foreground[2].c_str()]=false;
                             }
@@ -797,6 +1070,7 @@ namespace WPEFramework {
                     }
 
                     LOGINFO("ENDING MAINTENANCE CYCLE");
+                    lck.unlock();
                     if(m_thread.joinable()){
                         m_thread.join();
                     }
@@ -818,9 +1092,14 @@ namespace WPEFramework {
                 IARM_Result_t res;
                 IARM_CHECK(IARM_Bus_UnRegisterEventHandler(IARM_BUS_MAINTENANCE_MGR_NAME, IARM_BUS_MAINTENANCEMGR_EVENT_UPDATE));
                 IARM_CHECK(IARM_Bus_UnRegisterEventHandler(IARM_BUS_MAINTENANCE_MGR_NAME, IARM_BUS_DCM_NEW_START_TIME_EVENT));
+                IARM_CHECK(IARM_Bus_RemoveEventHandler(IARM_BUS_IRMGR_NAME, IARM_BUS_IRMGR_EVENT_IRKEY, _IrKeyEventHandler));
                 MaintenanceManager::_instance = nullptr;
             }
 
+            /* the scheduler would otherwise wait for the running scripts to report back */
+            m_abort_flag = true;
+            task_thread.notify_one();
+
             if(m_thread.joinable()){
                 m_thread.join();
             }
@@ -974,6 +1253,64 @@ namespace WPEFramework {
             returnResponse(result);
         }
 
+        /*
+         * @brief This function returns the scheduling and resource usage of the tasks
+         * of the current or previous maintenance activity.
+         * @param1[in]: {"jsonrpc":"2.0","id":"3","method":"org.rdk.MaintenanceManager.1.getMaintenanceTaskStatistics","params":{}}''
+         * @param2[out]: {"jsonrpc":"2.0","id":3,"result":{"tasks":[{"name":"RFCbase.sh","state":"exited",...}],"success":true}}
+         * @return: Core::<StatusCode>
+         */
+        uint32_t MaintenanceManager::getMaintenanceTaskStatistics(const JsonObject& parameters,
+                JsonObject& response)
+        {
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            JsonArray tasks;
+
+            std::lock_guard<std::mutex> guard(m_taskMutex);
+            for (auto& task : m_tasks) {
+                std::lock_guard<std::mutex> lock(task->lock);
+                JsonObject item;
+
+                string name = task->command.substr(0, task->command.find(' '));
+                item["name"] = name.substr(name.find_last_of('/') + 1);
+
+                if (task->exited) {
+                    item["state"] = "exited";
+                } else if (task->started) {
+                    item["state"] = "running";
+                } else if (task->completed) {
+                    item["state"] = "skipped";
+                } else if (task->deferred) {
+                    item["state"] = "deferred";
+                } else {
+                    item["state"] = "waiting";
+                }
+
+                if (task->queued) {
+                    item["deferredMs"] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        (task->started ? task->startedAt : now) - task->queuedAt).count());
+                }
+                if (task->started) {
+                    item["throttled"] = task->throttled;
+                    item["durationMs"] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        (task->exited ? task->finishedAt : now) - task->startedAt).count());
+                }
+                if (task->exited) {
+                    item["exitCode"] = task->exitCode;
+                    item["userTimeMs"] = static_cast<uint64_t>(task->usage.ru_utime.tv_sec * 1000 + task->usage.ru_utime.tv_usec / 1000);
+                    item["systemTimeMs"] = static_cast<uint64_t>(task->usage.ru_stime.tv_sec * 1000 + task->usage.ru_stime.tv_usec / 1000);
+                    item["maxRssKB"] = static_cast<uint64_t>(task->usage.ru_maxrss);
+                    item["blocksRead"] = static_cast<uint64_t>(task->usage.ru_inblock);
+                    item["blocksWritten"] = static_cast<uint64_t>(task->usage.ru_oublock);
+                }
+
+                tasks.Add(item);
+            }
+
+            response["tasks"] = tasks;
+            returnResponse(true);
+        }
+
 
         /*
          * @brief This function returns the current status of the current
@@ -1078,6 +1415,7 @@ namespace WPEFramework {
                     /* Lock so that m_notify_status will not be updated  further */
                     m_statusMutex.lock();
                     if ( MAINTENANCE_STARTED != m_notify_status  ){
+                        std::unique_lock<std::mutex> lck(m_callMutex);
 
                         /*reset the status to 0*/
                         g_task_status=0;
@@ -1089,6 +1427,7 @@ namespace WPEFramework {
                          * we say DCM is success and complete */
                         SET_STATUS(g_task_status,DCM_SUCCESS);
                         SET_STATUS(g_task_status,DCM_COMPLETE);
+                        lck.unlock();
 
                         /* isRebootPending will be set to true
                          * irrespective of XConf configuration */
@@ -1148,10 +1487,13 @@ namespace WPEFramework {
                     auto task_status_FWDLD=m_task_map.find(task_names_foreground[1].c_str());
                     auto task_status_LOGUPLD=m_task_map.find(task_names_foreground[2].c_str());
 
-                    task_status[0] = task_status_DCM->second;
-                    task_status[1] = task_status_RFC->second;
-                    task_status[2] = task_status_FWDLD->second;
-                    task_status[3] = task_status_LOGUPLD->second;
+                    {
+                        std::lock_guard<std::mutex> guard(m_callMutex);
+                        task_status[0] = task_status_DCM->second;
+                        task_status[1] = task_status_RFC->second;
+                        task_status[2] = task_status_FWDLD->second;
+                        task_status[3] = task_status_LOGUPLD->second;
+                    }
 
                     for (i=0;i<4;i++)
                         LOGINFO("task status [%d]  = %s ScriptName %s",i,(task_status[i])? "true":"false",script_names[i].c_str());
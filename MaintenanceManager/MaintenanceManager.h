@@ -23,6 +23,10 @@
 #include <stdint.h>
 #include <thread>
 #include <map>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sys/resource.h>
 
 #include "Module.h"
 #include "tracing/Logging.h"
@@ -115,6 +119,43 @@ namespace WPEFramework {
 
         class MaintenanceManager : public AbstractPlugin {
             private:
+                class Config : public Core::JSON::Container {
+                    private:
+                        Config(const Config&) = delete;
+                        Config& operator=(const Config&) = delete;
+
+                    public:
+                        Config()
+                            : Nice(10)
+                            , IOClass(_T("besteffort"))
+                            , ActiveNice(19)
+                            , ActiveIOClass(_T("idle"))
+                            , CGroup()
+                            , ActivityWindow(300)
+                            , MaxDeferral(1800)
+                        {
+                            Add(_T("nice"), &Nice);
+                            Add(_T("ioclass"), &IOClass);
+                            Add(_T("activenice"), &ActiveNice);
+                            Add(_T("activeioclass"), &ActiveIOClass);
+                            Add(_T("cgroup"), &CGroup);
+                            Add(_T("activitywindow"), &ActivityWindow);
+                            Add(_T("maxdeferral"), &MaxDeferral);
+                        }
+                        ~Config()
+                        {
+                        }
+
+                    public:
+                        Core::JSON::DecSInt8 Nice;
+                        Core::JSON::String IOClass;
+                        Core::JSON::DecSInt8 ActiveNice;
+                        Core::JSON::String ActiveIOClass;
+                        Core::JSON::String CGroup;
+                        Core::JSON::DecUInt32 ActivityWindow;
+                        Core::JSON::DecUInt32 MaxDeferral;
+                };
+
                 typedef Core::JSON::String JString;
                 typedef Core::JSON::ArrayType<JString> JStringArray;
                 typedef Core::JSON::Boolean JBool;
@@ -158,18 +199,66 @@ namespace WPEFramework {
                 string getLastRebootReason();
                 void iarmEventHandler(const char *owner, IARM_EventId_t eventId, void *data, size_t len);
                 static void _MaintenanceMgrEventHandler(const char *owner,IARM_EventId_t eventId, void *data, size_t len);
+                static void _IrKeyEventHandler(const char *owner, IARM_EventId_t eventId, void *data, size_t len);
                 // We do not allow this plugin to be copied !!
                 MaintenanceManager(const MaintenanceManager&) = delete;
                 MaintenanceManager& operator=(const MaintenanceManager&) = delete;
 
             private:
-                class MaintenanceTask{
-                    private:
-                        std::string taskName;
-                        std::string taskScript;
+                // One maintenance script, run by the scheduler in task_execution_thread() as a child
+                // process in its own process group, so its priority can be changed while it runs.
+                // The script is done when its completion event arrives (completeBit), it may only start
+                // once all dependsOn bits are set in g_task_status.
+                class MaintenanceTask {
                     public:
-                        void startTask();
+                        MaintenanceTask(const string& command, uint8_t completeBit, uint16_t dependsOn)
+                            : command(command), completeBit(completeBit), dependsOn(dependsOn)
+                            , pid(-1), queued(false), deferred(false), started(false), completed(false)
+                            , throttled(false), exited(false), exitCode(-1)
+                        {
+                            memset(&usage, 0, sizeof(usage));
+                        }
+
+                        const string command;
+                        const uint8_t completeBit;
+                        const uint16_t dependsOn;
+
+                        // Shared with the thread reaping the child, guarded by lock
+                        std::mutex lock;
+                        pid_t pid;
+                        bool queued;
+                        bool deferred;
+                        bool started;
+                        bool completed;
+                        bool throttled;
+                        bool exited;
+                        int exitCode;
+                        struct rusage usage;
+                        std::chrono::steady_clock::time_point queuedAt;
+                        std::chrono::steady_clock::time_point startedAt;
+                        std::chrono::steady_clock::time_point finishedAt;
                 };
+                typedef std::shared_ptr<MaintenanceTask> MaintenanceTaskPtr;
+
+                bool launchTask(const MaintenanceTaskPtr& task, bool throttled);
+                void joinReapers(bool all);
+                void setTaskPriority(const MaintenanceTaskPtr& task, bool throttled);
+                bool isUserActive() const;
+                static int ioPriority(const string& ioClass);
+
+                int m_nice;
+                int m_ioPriority;
+                int m_activeNice;
+                int m_activeIoPriority;
+                string m_cgroupProcs;
+                uint32_t m_activityWindow;
+                uint32_t m_maxDeferral;
+                std::atomic<int64_t> m_lastUserActivity;
+
+                std::mutex m_taskMutex;
+                std::vector<MaintenanceTaskPtr> m_tasks;
+                // Threads collecting the exit status of the task processes, joined before the plugin goes
+                std::vector<std::pair<MaintenanceTaskPtr, std::thread>> m_reapers;
             public:
                 MaintenanceManager();
                 virtual ~MaintenanceManager();
@@ -201,6 +290,7 @@ namespace WPEFramework {
                 uint32_t startMaintenance(const JsonObject& parameters, JsonObject& response);
                 uint32_t stopMaintenance(const JsonObject& parameters, JsonObject& response);
                 uint32_t getMaintenanceMode(const JsonObject& parameters, JsonObject& response);
+                uint32_t getMaintenanceTaskStatistics(const JsonObject& parameters, JsonObject& response);
         }; /* end of MaintenanceManager service class */
     } /* end of plugin */
 } /* end of wpeframework */
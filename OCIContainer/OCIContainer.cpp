@@ -3,6 +3,8 @@
 #include <Dobby/DobbyProxy.h>
 #include <Dobby/IpcService/IpcFactory.h>
 
+#include <chrono>
+
 
 namespace WPEFramework
 {
@@ -17,6 +19,9 @@ SERVICE_REGISTRATION(OCIContainer, 1, 0);
 
 OCIContainer::OCIContainer()
     : PluginHost::JSONRPC()
+    , mEventListenerId(0)
+    , mWarmCount(0)
+    , mStopping(false)
 {
     Register("listContainers", &OCIContainer::listContainers, this);
     Register("getContainerState", &OCIContainer::getContainerState, this);
@@ -37,6 +42,15 @@ const string OCIContainer::Initialize(PluginHost::IShell *service)
 {
     mIpcService = AI_IPC::createIpcService("unix:path=/var/run/dbus/system_bus_socket", "com.sky.dobby.thunder");
 
+    {
+        // Left over from a previous Deinitialize
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = false;
+        mWarmCount = 0;
+        mWarmSpecs.clear();
+        mWarmQueue.clear();
+    }
+
     if (!mIpcService)
     {
         LOGERR("Failed to create IPC service");
@@ -55,11 +69,85 @@ const string OCIContainer::Initialize(PluginHost::IShell *service)
     // Register a state change event listener
     mEventListenerId = mDobbyProxy->registerListener(stateListener, static_cast<const void*>(this));
 
+    // Seed the container state cache, the listener keeps it up to date from here on
+    refreshContainers();
+
+    // Containers to keep started and paused, so starting them is only a resume
+    JsonObject config;
+    config.FromString(service->ConfigLine());
+    if (config.HasLabel("prewarm") && config.HasLabel("prewarmcontainers"))
+    {
+        mWarmCount = config["prewarm"].Number();
+
+        JsonArray containers = config["prewarmcontainers"].Array();
+        for (int i = 0; i < containers.Length(); i++)
+        {
+            JsonObject container = containers[i].Object();
+            std::string id = container["containerId"].String();
+
+            LaunchSpec spec;
+            if (container.HasLabel("dobbySpec"))
+            {
+                WPEFramework::Core::JSON::IElement::ToString(container["dobbySpec"].Object(), spec.dobbySpec);
+            }
+            else if (container.HasLabel("bundlePath"))
+            {
+                spec.bundlePath = container["bundlePath"].String();
+            }
+            if (container.HasLabel("command"))
+            {
+                spec.command = container["command"].String();
+            }
+            if (container.HasLabel("westerosSocket"))
+            {
+                spec.westerosSocket = container["westerosSocket"].String();
+            }
+
+            if (id.empty() || (spec.bundlePath.empty() && spec.dobbySpec.empty()))
+            {
+                LOGERR("Ignoring pre-warm entry %d, it needs a containerId and a bundlePath or dobbySpec", i);
+                continue;
+            }
+
+            mWarmSpecs[id] = spec;
+            mWarmQueue.push_back(id);
+        }
+
+        if ((mWarmCount > 0) && !mWarmSpecs.empty())
+        {
+            mWarmThread = std::thread(&OCIContainer::warmContainers, this);
+        }
+    }
+
     return string();
 }
 
 void OCIContainer::Deinitialize(PluginHost::IShell *service)
 {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+    }
+    mWarmChanged.notify_all();
+    if (mWarmThread.joinable())
+    {
+        mWarmThread.join();
+    }
+
+    // Pre-warmed containers nobody asked for are not left behind
+    std::map<std::string, WarmContainer> warm;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        warm.swap(mWarm);
+    }
+    for (const auto& container : warm)
+    {
+        if (container.second.descriptor > 0)
+        {
+            mDobbyProxy->stopContainer(container.second.descriptor, true);
+        }
+    }
+
     mDobbyProxy->unregisterListener(mEventListenerId);
     Unregister("listContainers");
     Unregister("getContainerState");
@@ -81,7 +169,9 @@ string OCIContainer::Information() const
 // Begin Thunder Methods
 
 /**
- * @brief Get all the currently running containers from Dobby
+ * @brief Get all the currently running containers Dobby knows about
+ *
+ * Answered from the state cache, pre-warmed containers are left out.
  *
  * @param[in]  parameters   No params processed.
  * @param[out] response     A list of running containers.
@@ -92,20 +182,20 @@ uint32_t OCIContainer::listContainers(const JsonObject &parameters, JsonObject &
 {
     LOGINFO("List containers");
 
-    // Get the running containers from Dobby
-    std::list<std::pair<int32_t, std::string>> runningContainers;
     JsonObject containerJson;
     JsonArray containerArray;
 
-    runningContainers = mDobbyProxy->listContainers();
-
-    // Build the response if containers were found
-    if (!runningContainers.empty())
     {
-        for (const std::pair<int32_t, std::string>& c : runningContainers)
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const auto& c : mContainers)
         {
+            if (c.second.warm)
+            {
+                continue;
+            }
+
             containerJson["Descriptor"] = c.first;
-            containerJson["Id"] = c.second;
+            containerJson["Id"] = c.second.id;
 
             containerArray.Add(containerJson);
         }
@@ -116,7 +206,7 @@ uint32_t OCIContainer::listContainers(const JsonObject &parameters, JsonObject &
 }
 
 /**
- * @brief Get the state of a known container
+ * @brief Get the state of a known container, from the state cache
  *
  * @param[in]  parameters   Must include 'containerId' of the container whose state is requested.
  * @param[out] response     Container ID and container state.
@@ -138,31 +228,18 @@ uint32_t OCIContainer::getContainerState(const JsonObject &parameters, JsonObjec
     }
 
     std::string containerState;
-
-    // We got a state back successfully, work out what that means in English
-    switch (static_cast<IDobbyProxyEvents::ContainerState>(mDobbyProxy->getContainerState(cd)))
     {
-    case IDobbyProxyEvents::ContainerState::Invalid:
-        containerState = "Invalid";
-        break;
-    case IDobbyProxyEvents::ContainerState::Starting:
-        containerState = "Starting";
-        break;
-    case IDobbyProxyEvents::ContainerState::Running:
-        containerState = "Running";
-        break;
-    case IDobbyProxyEvents::ContainerState::Stopping:
-        containerState = "Stopping";
-        break;
-    case IDobbyProxyEvents::ContainerState::Paused:
-        containerState = "Paused";
-        break;
-    case IDobbyProxyEvents::ContainerState::Stopped:
-        containerState = "Stopped";
-        break;
-    default:
-        containerState = "Unknown";
-        break;
+        std::lock_guard<std::mutex> lock(mLock);
+        auto container = mContainers.find(cd);
+        if (container == mContainers.end())
+        {
+            // Stopped in the meantime
+            containerState = stateName(IDobbyProxyEvents::ContainerState::Stopped);
+        }
+        else
+        {
+            containerState = stateName(container->second.state);
+        }
     }
 
     response["containerId"] = id;
@@ -230,39 +307,30 @@ uint32_t OCIContainer::startContainer(const JsonObject &parameters, JsonObject &
     returnIfStringParamNotFound(parameters, "bundlePath");
 
     std::string id = parameters["containerId"].String();
-    std::string bundlePath = parameters["bundlePath"].String();
     std::string command = parameters["command"].String();
     std::string westerosSocket = parameters["westerosSocket"].String();
 
-    // Can be used to pass file descriptors to container construction.
-    // Currently unsupported, see DobbyProxy::startContainerFromBundle().
-    std::list<int> emptyList;
+    // Dobby expects empty strings if values not set
+    LaunchSpec spec;
+    spec.bundlePath = parameters["bundlePath"].String();
+    spec.command = (command == "null") ? "" : command;
+    spec.westerosSocket = (westerosSocket == "null") ? "" : westerosSocket;
 
-    int descriptor;
-    // If no additional arguments, start the container
-    if ((command == "null" || command.empty()) && (westerosSocket == "null" || westerosSocket.empty()))
-    {
-        descriptor = mDobbyProxy->startContainerFromBundle(id, bundlePath, emptyList);
-    }
-    else
+    // A pre-warmed container only needs resuming
+    int descriptor = claimWarmContainer(id, spec);
+    if (descriptor <= 0)
     {
-        // Dobby expects empty strings if values not set
-        if (command == "null" || command.empty())
-        {
-            command = "";
-        }
-        if (westerosSocket == "null" || westerosSocket.empty())
+        descriptor = startFromSpec(id, spec);
+
+        // startContainer returns -1 on failure
+        if (descriptor <= 0)
         {
-            westerosSocket = "";
+            LOGERR("Failed to start container - internal Dobby error.");
+            returnResponse(false);
         }
-        descriptor = mDobbyProxy->startContainerFromBundle(id, bundlePath, emptyList, command, westerosSocket);
-    }
 
-    // startContainer returns -1 on failure
-    if (descriptor <= 0)
-    {
-        LOGERR("Failed to start container - internal Dobby error.");
-        returnResponse(false);
+        std::lock_guard<std::mutex> lock(mLock);
+        mContainers.insert(std::make_pair(descriptor, ContainerEntry{ id, IDobbyProxyEvents::ContainerState::Starting, false }));
     }
 
     response["descriptor"] = descriptor;
@@ -291,42 +359,32 @@ uint32_t OCIContainer::startContainerFromDobbySpec(const JsonObject &parameters,
     std::string command = parameters["command"].String();
     std::string westerosSocket = parameters["westerosSocket"].String();
 
-    std::string specString;
-    if (!WPEFramework::Core::JSON::IElement::ToString(dobbySpec, specString))
+    LaunchSpec spec;
+    if (!WPEFramework::Core::JSON::IElement::ToString(dobbySpec, spec.dobbySpec))
     {
         LOGERR("Failed to convert Dobby spec to string");
         returnResponse(false);
     }
 
-    // Can be used to pass file descriptors to container construction.
-    // Currently unsupported, see DobbyProxy::startContainerFromSpec().
-    std::list<int> emptyList;
+    // Dobby expects empty strings if values not set
+    spec.command = (command == "null") ? "" : command;
+    spec.westerosSocket = (westerosSocket == "null") ? "" : westerosSocket;
 
-    int descriptor;
-    // If no additional arguments, start the container
-    if ((command == "null" || command.empty()) && (westerosSocket == "null" || westerosSocket.empty()))
-    {
-        descriptor = mDobbyProxy->startContainerFromSpec(id, specString, emptyList);
-    }
-    else
+    // A pre-warmed container only needs resuming
+    int descriptor = claimWarmContainer(id, spec);
+    if (descriptor <= 0)
     {
-        // Dobby expects empty strings if values not set
-        if (command == "null" || command.empty())
-        {
-            command = "";
-        }
-        if (westerosSocket == "null" || westerosSocket.empty())
+        descriptor = startFromSpec(id, spec);
+
+        // startContainer returns -1 on failure
+        if (descriptor <= 0)
         {
-            westerosSocket = "";
+            LOGERR("Failed to start container - internal Dobby error.");
+            returnResponse(false);
         }
-        descriptor = mDobbyProxy->startContainerFromSpec(id, specString, emptyList, command, westerosSocket);
-    }
 
-    // startContainer returns -1 on failure
-    if (descriptor <= 0)
-    {
-        LOGERR("Failed to start container - internal Dobby error.");
-        returnResponse(false);
+        std::lock_guard<std::mutex> lock(mLock);
+        mContainers.insert(std::make_pair(descriptor, ContainerEntry{ id, IDobbyProxyEvents::ContainerState::Starting, false }));
     }
 
     response["descriptor"] = descriptor;
@@ -402,6 +460,16 @@ uint32_t OCIContainer::pauseContainer(const JsonObject &parameters, JsonObject &
         returnResponse(false);
     }
 
+    // Dobby sends no event for this
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto container = mContainers.find(cd);
+        if (container != mContainers.end())
+        {
+            container->second.state = IDobbyProxyEvents::ContainerState::Paused;
+        }
+    }
+
     returnResponse(true);
 }
 
@@ -435,6 +503,16 @@ uint32_t OCIContainer::resumeContainer(const JsonObject &parameters, JsonObject
         returnResponse(false);
     }
 
+    // Dobby sends no event for this
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto container = mContainers.find(cd);
+        if (container != mContainers.end())
+        {
+            container->second.state = IDobbyProxyEvents::ContainerState::Running;
+        }
+    }
+
     returnResponse(true);
 }
 
@@ -516,28 +594,292 @@ void OCIContainer::onContainerStopped(int32_t descriptor, const std::string& nam
  *
  * Will only return a value if Dobby knows about the running container
  * (e.g. the container was started by Dobby, not manually using the OCI runtime).
+ * Looked up in the state cache, which is only resynchronised with Dobby when the
+ * container is not found in it.
  *
  * @param containerId The container ID used by the OCI runtime - not the Dobby descriptor
  *
  * @return Descriptor value
  */
 const int OCIContainer::GetContainerDescriptorFromId(const std::string& containerId)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        if (attempt > 0)
+        {
+            refreshContainers();
+        }
+
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const auto& container : mContainers)
+        {
+            if (container.second.warm)
+            {
+                continue;
+            }
+
+            char strDescriptor[32];
+            sprintf(strDescriptor, "%d", container.first);
+
+            if ((containerId == strDescriptor) || (containerId == container.second.id))
+            {
+                return container.first;
+            }
+        }
+    }
+
+    LOGERR("Failed to find container %s", containerId.c_str());
+    return -1;
+}
+
+/**
+ * @brief Starts a container from an OCI bundle or a Dobby spec
+ *
+ * @param id    Container ID
+ * @param spec  What to start, empty command and westerosSocket are left out
+ *
+ * @return Descriptor of the container, -1 on failure
+ */
+int OCIContainer::startFromSpec(const std::string& id, const LaunchSpec& spec)
+{
+    // Can be used to pass file descriptors to container construction.
+    // Currently unsupported, see DobbyProxy::startContainerFromBundle().
+    std::list<int> emptyList;
+
+    // If no additional arguments, start the container
+    bool plain = spec.command.empty() && spec.westerosSocket.empty();
+
+    if (!spec.dobbySpec.empty())
+    {
+        return plain ? mDobbyProxy->startContainerFromSpec(id, spec.dobbySpec, emptyList)
+                     : mDobbyProxy->startContainerFromSpec(id, spec.dobbySpec, emptyList, spec.command, spec.westerosSocket);
+    }
+
+    return plain ? mDobbyProxy->startContainerFromBundle(id, spec.bundlePath, emptyList)
+                 : mDobbyProxy->startContainerFromBundle(id, spec.bundlePath, emptyList, spec.command, spec.westerosSocket);
+}
+
+/**
+ * @brief Hands out the pre-warmed container for an ID, if it was started the same way
+ *
+ * Waits for a container that is still being warmed. A pre-warmed container started
+ * differently is stopped, as it holds the ID the caller is about to start. Dobby stops
+ * it asynchronously, so this waits for its Stopped event before the ID is free again.
+ *
+ * @param id    Container ID
+ * @param spec  How the caller wants it started
+ *
+ * @return Descriptor of the resumed container, -1 if there was none
+ */
+int OCIContainer::claimWarmContainer(const std::string& id, const LaunchSpec& spec)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    if (mWarm.find(id) == mWarm.end())
+    {
+        return -1;
+    }
+
+    mWarmChanged.wait_for(lock, std::chrono::seconds(10), [this, &id]() {
+        auto warm = mWarm.find(id);
+        return (warm == mWarm.end()) || warm->second.ready;
+    });
+
+    auto warm = mWarm.find(id);
+    if ((warm == mWarm.end()) || !warm->second.ready)
+    {
+        return -1;
+    }
+
+    int32_t descriptor = warm->second.descriptor;
+    mWarm.erase(warm);
+    bool matches = (mWarmSpecs[id] == spec);
+    lock.unlock();
+
+    if (matches && mDobbyProxy->resumeContainer(descriptor))
+    {
+        LOGINFO("Handing out pre-warmed container %s", id.c_str());
+
+        lock.lock();
+        ContainerEntry& entry = mContainers[descriptor];
+        entry.id = id;
+        entry.state = IDobbyProxyEvents::ContainerState::Running;
+        entry.warm = false;
+
+        // The slot is free for another one
+        for (const auto& warmSpec : mWarmSpecs)
+        {
+            mWarmQueue.push_back(warmSpec.first);
+        }
+        lock.unlock();
+        mWarmChanged.notify_all();
+
+        // Its start was not announced while it was pre-warmed
+        onContainerStarted(descriptor, id);
+        return descriptor;
+    }
+
+    LOGINFO("Pre-warmed container %s does not match the request, replacing it", id.c_str());
+    if (mDobbyProxy->stopContainer(descriptor, true))
+    {
+        lock.lock();
+        bool stopped = mWarmChanged.wait_for(lock, std::chrono::seconds(10), [this, descriptor]() {
+            return (mContainers.find(descriptor) == mContainers.end());
+        });
+        lock.unlock();
+
+        if (!stopped)
+        {
+            LOGERR("Pre-warmed container %s did not stop in time", id.c_str());
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Reloads the state cache from Dobby
+ */
+void OCIContainer::refreshContainers()
 {
     const std::list<std::pair<int32_t, std::string>> containers = mDobbyProxy->listContainers();
 
+    std::map<int32_t, ContainerEntry> fresh;
     for (const std::pair<int32_t, std::string>& container : containers)
     {
-        char strDescriptor[32];
-        sprintf(strDescriptor, "%d", container.first);
+        auto state = static_cast<IDobbyProxyEvents::ContainerState>(mDobbyProxy->getContainerState(container.first));
+        fresh.insert(std::make_pair(container.first, ContainerEntry{ container.second, state, false }));
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto& entry : fresh)
+    {
+        auto known = mContainers.find(entry.first);
+        entry.second.warm = (known != mContainers.end()) ? known->second.warm : (mWarm.count(entry.second.id) > 0);
+    }
+    mContainers.swap(fresh);
+}
 
-        if ((containerId == strDescriptor) || (containerId == container.second))
+/**
+ * @brief Pre-warm thread, works through the queued container IDs until the plugin is deinitialised
+ */
+void OCIContainer::warmContainers()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true)
+    {
+        mWarmChanged.wait(lock, [this]() { return mStopping || !mWarmQueue.empty(); });
+        if (mStopping)
         {
-            return container.first;
+            break;
         }
+
+        std::string id = mWarmQueue.front();
+        mWarmQueue.pop_front();
+
+        lock.unlock();
+        warmContainer(id);
+        lock.lock();
     }
+}
 
-    LOGERR("Failed to find container %s", containerId.c_str());
-    return -1;
+/**
+ * @brief Starts and pauses the container for a pre-warm entry
+ *
+ * Nothing is done if it is warm already, the pool is full or the app itself runs under that ID.
+ *
+ * @param id    Container ID
+ */
+void OCIContainer::warmContainer(const std::string& id)
+{
+    LaunchSpec spec;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto warmSpec = mWarmSpecs.find(id);
+        if ((warmSpec == mWarmSpecs.end()) || (mWarm.count(id) > 0) || (mWarm.size() >= mWarmCount))
+        {
+            return;
+        }
+        for (const auto& container : mContainers)
+        {
+            if (container.second.id == id)
+            {
+                return;
+            }
+        }
+
+        spec = warmSpec->second;
+        mWarm[id] = WarmContainer{ -1, false };
+    }
+
+    int descriptor = startFromSpec(id, spec);
+    bool paused = (descriptor > 0) && mDobbyProxy->pauseContainer(descriptor);
+
+    std::unique_lock<std::mutex> lock(mLock);
+    auto warm = mWarm.find(id);
+    if (paused && (warm != mWarm.end()))
+    {
+        LOGINFO("Pre-warmed container %s", id.c_str());
+        warm->second.descriptor = descriptor;
+        warm->second.ready = true;
+
+        ContainerEntry& entry = mContainers[descriptor];
+        entry.id = id;
+        entry.state = IDobbyProxyEvents::ContainerState::Paused;
+        entry.warm = true;
+    }
+    else
+    {
+        LOGERR("Failed to pre-warm container %s", id.c_str());
+        if (warm != mWarm.end())
+        {
+            mWarm.erase(warm);
+        }
+    }
+    lock.unlock();
+    mWarmChanged.notify_all();
+
+    if (!paused && (descriptor > 0))
+    {
+        mDobbyProxy->stopContainer(descriptor, true);
+    }
+}
+
+/**
+ * @brief Name of a container state as reported to clients
+ */
+const char* OCIContainer::stateName(IDobbyProxyEvents::ContainerState state)
+{
+    switch (state)
+    {
+    case IDobbyProxyEvents::ContainerState::Invalid:
+        return "Invalid";
+    case IDobbyProxyEvents::ContainerState::Starting:
+        return "Starting";
+    case IDobbyProxyEvents::ContainerState::Running:
+        return "Running";
+    case IDobbyProxyEvents::ContainerState::Stopping:
+        return "Stopping";
+    case IDobbyProxyEvents::ContainerState::Paused:
+        return "Paused";
+    case IDobbyProxyEvents::ContainerState::Stopped:
+        return "Stopped";
+    default:
+        return "Unknown";
+    }
+}
+
+/**
+ * @brief Queues a pre-warm entry for the pre-warm thread
+ *
+ * @param id    Container ID
+ */
+void OCIContainer::queueWarm(const std::string& id)
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mWarmQueue.push_back(id);
+    }
+    mWarmChanged.notify_all();
 }
 
 /**
@@ -557,6 +899,59 @@ const void OCIContainer::stateListener(int32_t descriptor, const std::string& na
     // Cast const void* back to OCIContainer* type to get 'this'
     OCIContainer* __this = const_cast<OCIContainer*>(reinterpret_cast<const OCIContainer*>(_this));
 
+    // Keep the state cache up to date, and don't announce pre-warmed containers
+    bool warm = false;
+    bool rewarm = false;
+    {
+        std::lock_guard<std::mutex> lock(__this->mLock);
+        auto container = __this->mContainers.find(descriptor);
+        // The event can arrive before the start call returns
+        warm = (container != __this->mContainers.end()) ? container->second.warm : (__this->mWarm.count(name) > 0);
+
+        if (state == IDobbyProxyEvents::ContainerState::Stopped)
+        {
+            if (container != __this->mContainers.end())
+            {
+                __this->mContainers.erase(container);
+            }
+            // A start request may be waiting for a pre-warmed container to free its ID
+            __this->mWarmChanged.notify_all();
+
+            if (warm)
+            {
+                // A pre-warmed container that died can't be handed out
+                auto w = __this->mWarm.find(name);
+                if ((w != __this->mWarm.end()) && (w->second.descriptor == descriptor))
+                {
+                    __this->mWarm.erase(w);
+                }
+            }
+            else
+            {
+                // The app is gone, warm it up for the next start
+                rewarm = (__this->mWarmSpecs.count(name) > 0);
+            }
+        }
+        else if (container != __this->mContainers.end())
+        {
+            container->second.state = state;
+        }
+        else
+        {
+            __this->mContainers.insert(std::make_pair(descriptor, ContainerEntry{ name, state, warm }));
+        }
+    }
+
+    if (rewarm)
+    {
+        __this->queueWarm(name);
+    }
+
+    if (warm)
+    {
+        return;
+    }
+
     if (state == IDobbyProxyEvents::ContainerState::Running)
     {
         __this->onContainerStarted(descriptor, name);
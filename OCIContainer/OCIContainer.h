@@ -6,8 +6,12 @@
 #include <Dobby/DobbyProtocol.h>
 #include <Dobby/Public/Dobby/IDobbyProxy.h>
 
+#include <condition_variable>
+#include <deque>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <thread>
 
 namespace WPEFramework
 {
@@ -65,10 +69,56 @@ public:
     uint32_t getApiVersionNumber() const { return 1; };
 
 private:
+    // How a container is launched, a start request only gets a pre-warmed container if they match
+    struct LaunchSpec
+    {
+        std::string bundlePath; // Either a bundle path or a Dobby spec
+        std::string dobbySpec;
+        std::string command;
+        std::string westerosSocket;
+
+        bool operator==(const LaunchSpec& other) const
+        {
+            return (bundlePath == other.bundlePath) && (dobbySpec == other.dobbySpec) &&
+                   (command == other.command) && (westerosSocket == other.westerosSocket);
+        }
+    };
+
+    struct ContainerEntry
+    {
+        std::string id;
+        IDobbyProxyEvents::ContainerState state;
+        bool warm; // Pre-warmed and not handed out yet, hidden from clients
+    };
+
+    struct WarmContainer
+    {
+        int32_t descriptor; // -1 while it is being started
+        bool ready;         // Started and paused
+    };
+
     int mEventListenerId; // Dobby event listener ID
     std::shared_ptr<IDobbyProxy> mDobbyProxy; // DobbyProxy instance
     std::shared_ptr<AI_IPC::IIpcService> mIpcService; // Ipc Service instance
+
+    std::mutex mLock;
+    std::map<int32_t, ContainerEntry> mContainers; // Kept up to date from the Dobby state events
+    std::map<std::string, LaunchSpec> mWarmSpecs;  // Containers to keep pre-warmed, by ID
+    std::map<std::string, WarmContainer> mWarm;    // Pre-warmed (or warming) containers, by ID
+    uint32_t mWarmCount;                           // At most this many pre-warmed at once
+    std::deque<std::string> mWarmQueue;
+    std::condition_variable mWarmChanged;
+    std::thread mWarmThread;
+    bool mStopping;
+
     const int GetContainerDescriptorFromId(const std::string& containerId);
+    int startFromSpec(const std::string& id, const LaunchSpec& spec);
+    int claimWarmContainer(const std::string& id, const LaunchSpec& spec);
+    void refreshContainers();
+    void warmContainers();
+    void warmContainer(const std::string& id);
+    void queueWarm(const std::string& id);
+    static const char* stateName(IDobbyProxyEvents::ContainerState state);
     static const void stateListener(int32_t descriptor, const std::string& name, IDobbyProxyEvents::ContainerState state, const void* _this);
 };
 } // namespace Plugin
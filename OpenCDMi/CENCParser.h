@@ -22,6 +22,9 @@
 
 #include "Module.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -109,16 +112,18 @@ namespace Plugin {
             uint32_t _systems;
         };
 
-        typedef Core::IteratorType<const std::list<KeyId>, const KeyId&, std::list<KeyId>::const_iterator> Iterator;
+        typedef Core::IteratorType<const std::vector<KeyId>, const KeyId&, std::vector<KeyId>::const_iterator> Iterator;
 
     public:
         CommonEncryptionData(const uint8_t data[], const uint16_t length)
             : _keyIds()
+            , _slots()
         {
             Parse(data, length);
         }
         CommonEncryptionData(const CommonEncryptionData& copy)
             : _keyIds(copy._keyIds)
+            , _slots(copy._slots)
         {
         }
         ~CommonEncryptionData()
@@ -134,9 +139,9 @@ namespace Plugin {
         {
             ::OCDM::ISession::KeyStatus result(::OCDM::ISession::StatusPending);
             if (key.IsValid() == true) {
-                std::list<KeyId>::const_iterator index(std::find(_keyIds.begin(), _keyIds.end(), key));
-                if (index != _keyIds.end()) {
-                    result = index->Status();
+                const KeyId* entry = Find(key);
+                if (entry != nullptr) {
+                    result = entry->Status();
                 }
             }
             return (result);
@@ -147,33 +152,29 @@ namespace Plugin {
         }
         inline bool HasKeyId(const OCDM::KeyId& keyId) const
         {
-            return (std::find(_keyIds.begin(), _keyIds.end(), keyId) != _keyIds.end());
+            return (Find(keyId) != nullptr);
         }
         inline void AddKeyId(const KeyId& key)
         {
-            std::list<KeyId>::iterator index(std::find(_keyIds.begin(), _keyIds.end(), key));
+            KeyId* entry = Find(key);
 
-            if (index == _keyIds.end()) {
+            if (entry == nullptr) {
                 TRACE(Trace::Information, (_T("Added key: %s for system: %02X\n"), key.ToString().c_str(), key.Systems()));
-                _keyIds.emplace_back(key);
+                Insert(key);
             } else {
                 TRACE(Trace::Information, (_T("Updated key: %s for system: %02X\n"), key.ToString().c_str(), key.Systems()));
-                index->Flag(key.Systems());
+                entry->Flag(key.Systems());
             }
         }
+        // The returned entry is only valid until the next key is added.
         inline const KeyId* UpdateKeyStatus(::OCDM::ISession::KeyStatus status, const KeyId& key)
         {
-            KeyId* entry = nullptr;
-
             ASSERT(key.IsValid() == true);
 
-            std::list<KeyId>::iterator index(std::find(_keyIds.begin(), _keyIds.end(), key));
+            KeyId* entry = Find(key);
 
-            if (index == _keyIds.end()) {
-                _keyIds.emplace_back(key);
-                entry = &(_keyIds.back());
-            } else {
-                entry = &(*index);
+            if (entry == nullptr) {
+                entry = &Insert(key);
             }
             entry->Status(status);
 
@@ -183,17 +184,10 @@ namespace Plugin {
         {
 
             bool result = true;
-            std::list<KeyId>::const_iterator requested(keys._keyIds.begin());
+            std::vector<KeyId>::const_iterator requested(keys._keyIds.begin());
 
             while ((requested != keys._keyIds.end()) && (result == true)) {
-                std::list<KeyId>::const_iterator index(_keyIds.begin());
-
-                while ((index != _keyIds.end()) && (*index != *requested)) {
-                    index++;
-                }
-
-                result = (index != _keyIds.end());
-
+                result = (Find(*requested) != nullptr);
                 requested++;
             }
 
@@ -203,6 +197,88 @@ namespace Plugin {
             return _keyIds.empty();
         }
     private:
+        // The key ids are kept in insertion order in a flat array, indexed by an open addressing hash
+        // table holding (array index + 1), 0 marking a free slot. Only the last 8 bytes of a key id are
+        // hashed: OCDM::KeyId also considers ids equal whose first 8 bytes are in the other (PlayReady)
+        // byte order.
+        static uint32_t Hash(const OCDM::KeyId& key)
+        {
+            const uint8_t* id = key.Id();
+            uint32_t hash = 2166136261u;
+
+            for (uint8_t index = (KeyId::Length() / 2); index < KeyId::Length(); index++) {
+                hash = (hash ^ id[index]) * 16777619u;
+            }
+
+            return (hash);
+        }
+        inline uint16_t Index(const OCDM::KeyId& key) const
+        {
+            uint16_t result = 0;
+
+            if (_slots.empty() == false) {
+                const uint32_t mask = static_cast<uint32_t>(_slots.size() - 1);
+                uint32_t slot = Hash(key) & mask;
+
+                while ((result == 0) && (_slots[slot] != 0)) {
+                    if (_keyIds[_slots[slot] - 1] == key) {
+                        result = _slots[slot];
+                    } else {
+                        slot = (slot + 1) & mask;
+                    }
+                }
+            }
+
+            // Index + 1, 0 if not found
+            return (result);
+        }
+        inline const KeyId* Find(const OCDM::KeyId& key) const
+        {
+            const uint16_t index = Index(key);
+            return (index != 0 ? &(_keyIds[index - 1]) : nullptr);
+        }
+        inline KeyId* Find(const OCDM::KeyId& key)
+        {
+            const uint16_t index = Index(key);
+            return (index != 0 ? &(_keyIds[index - 1]) : nullptr);
+        }
+        KeyId& Insert(const KeyId& key)
+        {
+            ASSERT(_keyIds.size() < 0xFFFF);
+
+            _keyIds.emplace_back(key);
+
+            // Keep the table at most half full, so probe sequences stay short
+            if ((_keyIds.size() * 2) > _slots.size()) {
+                size_t size = 16;
+
+                while (size < (_keyIds.size() * 4)) {
+                    size <<= 1;
+                }
+
+                _slots.assign(size, 0);
+
+                for (uint16_t index = 0; index < _keyIds.size(); index++) {
+                    Place(index);
+                }
+            } else {
+                Place(static_cast<uint16_t>(_keyIds.size() - 1));
+            }
+
+            return (_keyIds.back());
+        }
+        void Place(const uint16_t index)
+        {
+            const uint32_t mask = static_cast<uint32_t>(_slots.size() - 1);
+            uint32_t slot = Hash(_keyIds[index]) & mask;
+
+            while (_slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+
+            _slots[slot] = index + 1;
+        }
+
         uint8_t Base64(const uint8_t value[], const uint8_t sourceLength, uint8_t object[], const uint8_t length)
         {
             uint8_t state = 0;
@@ -250,55 +326,72 @@ namespace Plugin {
             return (filler);
         }
 
+        static bool Contains(const uint8_t data[], const uint16_t length, const char text[], const uint16_t textLength)
+        {
+            const uint8_t* end = &(data[length]);
+            return (std::search(data, end, text, &(text[textLength])) != end);
+        }
+
         void Parse(const uint8_t data[], const uint16_t length)
         {
-            uint16_t offset = 0;
+            uint64_t offset = 0;
+
+            // Every box starts with a 32 bit size, anything shorter can not be parsed.
+            while ((offset + 4) <= length) {
+                const uint8_t* box = &(data[offset]);
+                const uint32_t remaining = static_cast<uint32_t>(length - offset);
 
-            do {
                 // Check if this is a PSSH box...
-                uint32_t size = (data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+                uint32_t size = (box[0] << 24) | (box[1] << 16) | (box[2] << 8) | box[3];
                 if (size == 0) {
                     TRACE(Trace::Information, (_T("While parsing CENC, found chunk of size 0, are you sure the data is valid? %d\n"), __LINE__));
                     break;
                 }
 
-                if ((size <= static_cast<uint32_t>(length - offset)) && (memcmp(&(data[offset + 4]), PSSHeader, 4) == 0)) {
-                    ParsePSSHBox(&(data[offset + 4 + 4]), size - 4 - 4);
+                if ((size <= remaining) && (size >= 8) && (memcmp(&(box[4]), PSSHeader, 4) == 0)) {
+                    ParsePSSHBox(&(box[4 + 4]), static_cast<uint16_t>(size - 4 - 4));
                 } else {
-                    uint32_t XMLSize = (data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | (data[offset + 3] << 24));
+                    uint32_t XMLSize = (box[0] | (box[1] << 8) | (box[2] << 16) | (box[3] << 24));
 
-                    if (XMLSize <= static_cast<uint32_t>(length - offset)) {
+                    if ((XMLSize <= remaining) && (XMLSize >= 10)) {
 
-                        uint16_t stringLength = (data[offset + 8] | (data[offset + 9] << 8));
+                        uint16_t stringLength = (box[8] | (box[9] << 8));
                         if (stringLength <= (XMLSize - 10)) {
 
                             // Seems like it is an XMLBlob, without PSSH header, we have seen that on PlayReady only..
-                            ParseXMLBox(&(data[offset + 10]), stringLength);
+                            ParseXMLBox(&(box[10]), stringLength);
                         }
 
                         offset += XMLSize;
 
-                    } else if ((offset == 0) && (data[0] == '<') && (data[2] == 'W') && (data[4] == 'R') && (data[6] == 'M')) {
-                        ParseXMLBox(data, size);
+                    } else if ((offset == 0) && (length > 6) && (data[0] == '<') && (data[2] == 'W') && (data[4] == 'R') && (data[6] == 'M')) {
+                        ParseXMLBox(data, length);
                         offset = length;
-                    } else if (std::string(reinterpret_cast<const char*>(data), length).find(JSONKeyIds) != std::string::npos) {
+                    } else if (Contains(data, length, JSONKeyIds, static_cast<uint16_t>(::strlen(JSONKeyIds))) == true) {
                         /* keyids initdata type */
                         TRACE(Trace::Information, (_T("Initdata contains clearkey's key ids")));
 
                         ParseJSONInitData(reinterpret_cast<const char*>(data), length);
+                        offset = length;
                     } else {
                         TRACE(Trace::Information, (_T("Have no clue what this is!!! %d\n"), __LINE__));
                     }
                 }
                 offset += size;
-
-            } while (offset < length);
+            }
         }
 
         void ParsePSSHBox(const uint8_t data[], const uint16_t length)
         {
+            // version/flags, system id and the first 32 bit field (key id count or data size)
+            if (length < (4 + KeyId::Length() + 4)) {
+                TRACE(Trace::Information, (_T("PSSH box too short: %d\n"), length));
+                return;
+            }
+
             systemType system(COMMON);
             const uint8_t* psshData(&(data[KeyId::Length() + 4 /* flags */]));
+            const uint8_t* end(&(data[length]));
             uint32_t count((psshData[0] << 24) | (psshData[1] << 16) | (psshData[2] << 8) | psshData[3]);
             uint16_t stringLength = (data[8] | (data[9] << 8));
 
@@ -307,7 +400,9 @@ namespace Plugin {
                 TRACE(Trace::Information, (_T("Common detected [%d]\n"), __LINE__));
             } else if (::memcmp(&(data[4]), PlayReady, KeyId::Length()) == 0) {
                 if (stringLength <= (length - 10)) {
-                    ParseXMLBox(&(psshData[10]), count);
+                    if ((psshData + 10) <= end) {
+                        ParseXMLBox(&(psshData[10]), static_cast<uint16_t>(std::min<uint32_t>(count, end - psshData - 10)));
+                    }
                     TRACE(Trace::Information, (_T("PlayReady XML detected [%d]\n"), __LINE__));
                     count = 0;
                 } else {
@@ -332,8 +427,17 @@ namespace Plugin {
                 count /= KeyId::Length();
             }
 
+            // Never read beyond the box, whatever the count claims
+            const uint32_t available = (psshData < end ? static_cast<uint32_t>(end - psshData) / KeyId::Length() : 0);
+            if (count > available) {
+                TRACE(Trace::Information, (_T("PSSH box claims %d keys, only %d present\n"), count, available));
+                count = available;
+            }
+
             TRACE(Trace::Information, (_T("Adding %d keys from PSSH box\n"), count));
 
+            _keyIds.reserve(_keyIds.size() + count);
+
             while (count-- != 0) {
                 AddKeyId(KeyId(system, psshData, KeyId::Length()));
                 psshData += KeyId::Length();
@@ -345,7 +449,7 @@ namespace Plugin {
             uint8_t index = 0;
             uint16_t result = 0;
 
-            while ((result <= length) && (index < keyLength)) {
+            while ((result < length) && (index < keyLength)) {
                 if (static_cast<uint8_t>(key[index]) == data[result]) {
                     index++;
                     result += 2;
@@ -477,7 +581,69 @@ namespace Plugin {
         }
 
     private:
-        std::list<KeyId> _keyIds;
+        std::vector<KeyId> _keyIds;
+        std::vector<uint16_t> _slots;
+    };
+
+    // The key ids of a session. Their status is updated from the CDM callback thread while the decrypt
+    // and RPC threads look them up, so unlike CommonEncryptionData this one takes a lock.
+    class SessionKeyIds {
+    private:
+        SessionKeyIds() = delete;
+        SessionKeyIds(const SessionKeyIds&) = delete;
+        SessionKeyIds& operator=(const SessionKeyIds&) = delete;
+
+    public:
+        SessionKeyIds(const CommonEncryptionData& keyIds)
+            : _lock()
+            , _keyIds(keyIds)
+        {
+        }
+        ~SessionKeyIds()
+        {
+        }
+
+    public:
+        inline ::OCDM::ISession::KeyStatus Status() const
+        {
+            _lock.Lock();
+            ::OCDM::ISession::KeyStatus result(_keyIds.Status());
+            _lock.Unlock();
+            return (result);
+        }
+        inline ::OCDM::ISession::KeyStatus Status(const CommonEncryptionData::KeyId& key) const
+        {
+            _lock.Lock();
+            ::OCDM::ISession::KeyStatus result(_keyIds.Status(key));
+            _lock.Unlock();
+            return (result);
+        }
+        inline bool HasKeyId(const OCDM::KeyId& keyId) const
+        {
+            _lock.Lock();
+            bool result(_keyIds.HasKeyId(keyId));
+            _lock.Unlock();
+            return (result);
+        }
+        inline bool IsSupported(const CommonEncryptionData& keys) const
+        {
+            _lock.Lock();
+            bool result(_keyIds.IsSupported(keys));
+            _lock.Unlock();
+            return (result);
+        }
+        // Returns a copy of the updated entry, the entry itself can move once the lock is released.
+        inline CommonEncryptionData::KeyId UpdateKeyStatus(::OCDM::ISession::KeyStatus status, const CommonEncryptionData::KeyId& key)
+        {
+            _lock.Lock();
+            CommonEncryptionData::KeyId result(*(_keyIds.UpdateKeyStatus(status, key)));
+            _lock.Unlock();
+            return (result);
+        }
+
+    private:
+        mutable Core::CriticalSection _lock;
+        CommonEncryptionData _keyIds;
     };
 }
 } // namespace WPEFramework::Plugin
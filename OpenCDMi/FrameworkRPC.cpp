@@ -17,12 +17,14 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <regex>
 #include <string>
 #include <vector>
 
 #include "Module.h"
 #include "CENCParser.h"
+#include "SampleBatch.h"
 
 // Get in the definitions required for access to the sepcific
 // DRM engines.
@@ -174,7 +176,7 @@ namespace Plugin {
 
                     _adminLock.Lock();
 
-                    while ((index < (sizeof(_occupation) * 8)) && ((_occupation & (1 << index)) != 0)) {
+                    while ((index < (sizeof(_occupation) * 8)) && ((_occupation & (1ULL << index)) != 0)) {
                         index++;
                     }
 
@@ -183,7 +185,7 @@ namespace Plugin {
                     ASSERT(index < (sizeof(_occupation) * 8));
 
                     if (index < (sizeof(_occupation) * 8)) {
-                        _occupation |= (1 << index);
+                        _occupation |= (1ULL << index);
                         locator = _basePath + BufferFileName + Core::NumberType<uint8_t>(index).Text();
                     }
 
@@ -204,11 +206,11 @@ namespace Plugin {
                             // Than the last part is the number..
                             uint8_t number(Core::NumberType<uint8_t>(&(actualFile.c_str()[baseLength]), static_cast<uint32_t>(actualFile.length() - baseLength)).Value());
 
-                            if (number <= (sizeof(_occupation) * 8)) {
+                            if (number < (sizeof(_occupation) * 8)) {
                                 _adminLock.Lock();
 
-                                if ((_occupation & (1 << number)) != 0) {
-                                    _occupation ^= (1 << number);
+                                if ((_occupation & (1ULL << number)) != 0) {
+                                    _occupation ^= (1ULL << number);
                                     released = true;
                                 } else {
                                     // Freeing a buffer that is already free sounds dangerous !!!
@@ -225,9 +227,11 @@ namespace Plugin {
             private:
                 Core::CriticalSection _adminLock;
                 string _basePath;
-                uint16_t _occupation;
+                uint64_t _occupation;
             };
 
+            typedef SampleBatch::Statistics Statistics;
+
             // IMediaKeys defines the MediaKeys interface.
             class SessionImplementation : public ::OCDM::ISession, public ::OCDM::ISessionExt {
             private:
@@ -235,20 +239,24 @@ namespace Plugin {
                 SessionImplementation(const SessionImplementation&) = delete;
                 SessionImplementation& operator=(const SessionImplementation&) = delete;
 
-                class DataExchange : public ::OCDM::DataExchange, public Core::Thread {
+                class DataExchange : public ::OCDM::DataExchange, public Core::Thread, public SampleBatch::Decryptor {
                 private:
                     DataExchange() = delete;
                     DataExchange(const DataExchange&) = delete;
                     DataExchange& operator=(const DataExchange&) = delete;
 
                 public:
-                    DataExchange(CDMi::IMediaKeySession* mediaKeys, const string& name, const uint32_t defaultSize)
+                    DataExchange(AccessorOCDM& accessor, CDMi::IMediaKeySession* mediaKeys, const string& name, const uint32_t defaultSize, const bool batched)
                         : ::OCDM::DataExchange(name, defaultSize)
                         , Core::Thread(Core::Thread::DefaultStackSize(), _T("DRMSessionThread"))
+                        , _accessor(accessor)
                         , _mediaKeys(mediaKeys)
                         , _mediaKeysExt(dynamic_cast<CDMi::IMediaKeySessionExt*>(mediaKeys))
                         , _sessionKey(nullptr)
                         , _sessionKeyLength(0)
+                        , _batched(batched)
+                        , _mapping()
+                        , _statistics()
                     {
                         Core::Thread::Run();
                         TRACE(Trace::Information, (_T("Constructing buffer server side: %p - %s"), this, name.c_str()));
@@ -263,6 +271,13 @@ namespace Plugin {
                         Produced();
 
                         Core::Thread::Wait(Core::Thread::STOPPED, Core::infinite);
+
+                        TRACE(Trace::Information, (_T("Buffer %s: %llu exchanges, %llu samples, %llu bytes, %llu failures, %llu us decrypting"),
+                            ::OCDM::DataExchange::Name().c_str(), static_cast<unsigned long long>(_statistics.Exchanges),
+                            static_cast<unsigned long long>(_statistics.Samples), static_cast<unsigned long long>(_statistics.Bytes),
+                            static_cast<unsigned long long>(_statistics.Failures), static_cast<unsigned long long>(_statistics.Ticks)));
+
+                        _accessor.Report(_statistics);
                     }
 
                 private:
@@ -271,41 +286,23 @@ namespace Plugin {
 
                         while (IsRunning() == true) {
 
-                            uint32_t clearContentSize = 0;
-                            uint8_t* clearContent = nullptr;
-
                             RequestConsume(Core::infinite);
 
                             if (IsRunning() == true) {
-                                uint8_t keyIdLength = 0;
-                                const uint8_t* keyIdData = KeyId(keyIdLength);
-
-                                int cr = _mediaKeys->Decrypt(
-                                    _sessionKey,
-                                    _sessionKeyLength,
-                                    nullptr, //subsamples
-                                    0, //number of subsamples
-                                    IVKey(),
-                                    IVKeyLength(),
-                                    Buffer(),
-                                    BytesWritten(),
-                                    &clearContentSize,
-                                    &clearContent,
-                                    keyIdLength,
-                                    keyIdData,
-                                    InitWithLast15());
-                                if ((cr == 0) && (clearContentSize != 0)) {
-                                    if (clearContentSize != BytesWritten()) {
-                                        TRACE(Trace::Information, (_T("Returned clear sample size (%d) differs from encrypted buffer size (%d)"), clearContentSize, BytesWritten()));
-                                        Size(clearContentSize);
-                                    }
+                                const uint64_t start = Core::Time::Now().Ticks();
+                                uint32_t cr;
 
-                                    // Adjust the buffer on our sied (this process) on what we will write back
-                                    SetBuffer(0, clearContentSize, clearContent);
+                                if ((_batched == true) && (SampleBatch::IsBatch(Buffer(), BytesWritten()) == true)) {
+                                    cr = DecryptBatch();
+                                } else {
+                                    cr = DecryptSample();
                                 }
 
+                                _statistics.Exchanges++;
+                                _statistics.Ticks += (Core::Time::Now().Ticks() - start);
+
                                 // Store the status we have for the other side.
-                                Status(static_cast<uint32_t>(cr));
+                                Status(cr);
 
                                 // Whatever the result, we are done with the buffer..
                                 Consumed();
@@ -315,11 +312,85 @@ namespace Plugin {
                         return (Core::infinite);
                     }
 
+                    uint32_t DecryptSample()
+                    {
+                        uint32_t clearContentSize = 0;
+                        uint8_t* clearContent = nullptr;
+                        uint8_t keyIdLength = 0;
+                        const uint8_t* keyIdData = KeyId(keyIdLength);
+
+                        _statistics.Samples++;
+                        _statistics.Bytes += BytesWritten();
+
+                        int cr = _mediaKeys->Decrypt(
+                            _sessionKey,
+                            _sessionKeyLength,
+                            nullptr, //subsamples
+                            0, //number of subsamples
+                            IVKey(),
+                            IVKeyLength(),
+                            Buffer(),
+                            BytesWritten(),
+                            &clearContentSize,
+                            &clearContent,
+                            keyIdLength,
+                            keyIdData,
+                            InitWithLast15());
+                        if ((cr == 0) && (clearContentSize != 0)) {
+                            if (clearContentSize != BytesWritten()) {
+                                TRACE(Trace::Information, (_T("Returned clear sample size (%d) differs from encrypted buffer size (%d)"), clearContentSize, BytesWritten()));
+                                Size(clearContentSize);
+                            }
+
+                            // Adjust the buffer on our sied (this process) on what we will write back
+                            SetBuffer(0, clearContentSize, clearContent);
+                        }
+
+                        if (cr != 0) {
+                            _statistics.Failures++;
+                        }
+
+                        return (static_cast<uint32_t>(cr));
+                    }
+
+                    // Decrypts all samples of a SampleBatch in one pass, see SampleBatch.h for the layout.
+                    uint32_t DecryptBatch()
+                    {
+                        return (SampleBatch::Decrypt(Buffer(), BytesWritten(), *this, CDMi::CDMi_S_FALSE, _mapping, _statistics));
+                    }
+
+                    uint32_t Decrypt(const SampleBatch::Sample& sample, const uint32_t mapping[], uint8_t data[], uint32_t& clearLength, uint8_t*& clearContent) override
+                    {
+                        return (static_cast<uint32_t>(_mediaKeys->Decrypt(
+                            _sessionKey,
+                            _sessionKeyLength,
+                            mapping,
+                            sample.Mappings,
+                            sample.IV,
+                            sample.IVLength,
+                            data,
+                            sample.Length,
+                            &clearLength,
+                            &clearContent,
+                            sample.KeyIdLength,
+                            sample.KeyId,
+                            (sample.InitWithLast15 != 0))));
+                    }
+
+                    void Failed(const uint16_t index, const char reason[]) override
+                    {
+                        TRACE(Trace::Error, (_T("Sample batch of %s, sample %d: %s"), ::OCDM::DataExchange::Name().c_str(), index, reason));
+                    }
+
                 private:
+                    AccessorOCDM& _accessor;
                     CDMi::IMediaKeySession* _mediaKeys;
                     CDMi::IMediaKeySessionExt* _mediaKeysExt;
                     uint8_t* _sessionKey;
                     uint32_t _sessionKeyLength;
+                    const bool _batched;
+                    std::vector<uint32_t> _mapping;
+                    Statistics _statistics;
                 };
 
                 // IMediaKeys defines the MediaKeys interface.
@@ -399,12 +470,10 @@ namespace Plugin {
                         else
                             key = ::OCDM::ISession::InternalError;
 
-                        const CommonEncryptionData::KeyId* updated = _parent._cencData.UpdateKeyStatus(key, keyId);
-
-                        ASSERT (updated != nullptr);
+                        const CommonEncryptionData::KeyId updated(_parent._cencData.UpdateKeyStatus(key, keyId));
 
                         if (_callback != nullptr) {
-                            _callback->OnKeyStatusUpdate(updated->Id(), updated->Length(), key);
+                            _callback->OnKeyStatusUpdate(updated.Id(), updated.Length(), key);
                         }
                     }
                     void Revoke(::OCDM::ISession::ICallback* callback)
@@ -538,7 +607,7 @@ namespace Plugin {
 
                         if (_parent._administrator.AquireBuffer(bufferID) == true)
                         {
-                            _buffer = new DataExchange(_mediaKeySession, bufferID, _parent.DefaultSize());
+                            _buffer = new DataExchange(_parent, _mediaKeySession, bufferID, _parent.DefaultSize(), _parent.Batched());
                             _adminLock.Unlock();
                             TRACE(Trace::Information, ("Server::Session::CreateSessionBuffer(%s,%s,%s) => %p", _keySystem.c_str(), _sessionId.c_str(), BufferId().c_str(), this));
                         } else {
@@ -663,21 +732,27 @@ namespace Plugin {
                 CDMi::IMediaKeySessionExt* _mediaKeySessionExt;
                 Core::Sink<Sink> _sink;
                 DataExchange* _buffer;
-                CommonEncryptionData _cencData;
+                SessionKeyIds _cencData;
             };
 
         public:
-            AccessorOCDM(OCDMImplementation* parent, const string& name, const uint32_t defaultSize)
+            AccessorOCDM(OCDMImplementation* parent, const string& name, const uint32_t defaultSize, const bool batched)
                 : _parent(*parent)
                 , _adminLock()
                 , _administrator(name)
                 , _defaultSize(defaultSize)
+                , _batched(batched)
                 , _sessionList()
+                , _statistics()
             {
                 ASSERT(parent != nullptr);
             }
             virtual ~AccessorOCDM()
             {
+                TRACE(Trace::Information, (_T("Decrypted %llu samples (%llu bytes) in %llu exchanges, %llu failures, %llu us decrypting"),
+                    static_cast<unsigned long long>(_statistics.Samples), static_cast<unsigned long long>(_statistics.Bytes),
+                    static_cast<unsigned long long>(_statistics.Exchanges), static_cast<unsigned long long>(_statistics.Failures),
+                    static_cast<unsigned long long>(_statistics.Ticks)));
                 TRACE(Trace::Information, (_T("Released the AccessorOCDM server side [%d]"), __LINE__));
             }
 
@@ -710,6 +785,17 @@ namespace Plugin {
                 return _defaultSize;
             }
 
+            bool Batched() const {
+                return _batched;
+            }
+
+            void Report(const Statistics& statistics)
+            {
+                _adminLock.Lock();
+                _statistics.Add(statistics);
+                _adminLock.Unlock();
+            }
+
             // Create a MediaKeySession using the supplied init data and CDM data.
             virtual OCDM::OCDM_RESULT CreateSession(
                 const std::string& keySystem,
@@ -999,7 +1085,9 @@ namespace Plugin {
             mutable Core::CriticalSection _adminLock;
             BufferAdministrator _administrator;
             uint32_t _defaultSize;
+            bool _batched;
             std::list<SessionImplementation*> _sessionList;
+            Statistics _statistics;
         };
 
         class Config : public Core::JSON::Container {
@@ -1053,12 +1141,16 @@ namespace Plugin {
                 , Connector(_T("/tmp/ocdm"))
                 , SharePath(_T("/tmp"))
                 , ShareSize(8 * 1024)
+                , BatchDecrypt(false)
+                , BatchShareSize(1024 * 1024)
                 , KeySystems()
             {
                 Add(_T("location"), &Location);
                 Add(_T("connector"), &Connector);
                 Add(_T("sharepath"), &SharePath);
                 Add(_T("sharesize"), &ShareSize);
+                Add(_T("batchdecrypt"), &BatchDecrypt);
+                Add(_T("batchsharesize"), &BatchShareSize);
                 Add(_T("systems"), &KeySystems);
             }
             ~Config()
@@ -1070,6 +1162,8 @@ namespace Plugin {
             Core::JSON::String Connector;
             Core::JSON::String SharePath;
             Core::JSON::DecUInt32 ShareSize;
+            Core::JSON::Boolean BatchDecrypt;
+            Core::JSON::DecUInt32 BatchShareSize;
             Core::JSON::ArrayType<Systems> KeySystems;
         };
 
@@ -1185,7 +1279,11 @@ namespace Plugin {
                 SYSLOG(Logging::Startup, (_T("No DRM factories specified. OCDM can not service any DRM requests.")));
             }
 
-            _entryPoint = Core::Service<AccessorOCDM>::Create<::OCDM::IAccessorOCDM>(this, config.SharePath.Value(), config.ShareSize.Value());
+            // Batches carry several samples per exchange, so they need a larger shared buffer
+            const bool batched = config.BatchDecrypt.Value();
+            const uint32_t shareSize = (batched == true ? std::max(config.ShareSize.Value(), config.BatchShareSize.Value()) : config.ShareSize.Value());
+
+            _entryPoint = Core::Service<AccessorOCDM>::Create<::OCDM::IAccessorOCDM>(this, config.SharePath.Value(), shareSize, batched);
             Core::ProxyType<RPC::InvokeServer> server = Core::ProxyType<RPC::InvokeServer>::Create(&Core::IWorkerPool::Instance());
             _service = new ExternalAccess(Core::NodeId(config.Connector.Value().c_str()), _entryPoint, server);
 
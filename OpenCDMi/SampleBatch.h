@@ -0,0 +1,365 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __OPENCDMI_SAMPLEBATCH_H
+#define __OPENCDMI_SAMPLEBATCH_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace SampleBatch {
+
+    // Layout of a session buffer carrying several samples for a single RequestConsume/Consumed
+    // handshake. It is only recognised when "batchdecrypt" is enabled in the plugin configuration,
+    // so the client side has to be built with the same definition.
+    //
+    //   | Header | Sample | uint32_t mapping[Sample::Mappings] | data[Sample::Length] | Sample | ...
+    //
+    // The mapping is handed to the CDM unchanged as the subsample mapping of the sample. After the
+    // handshake each Sample holds its own Status and ClearLength and the clear data has replaced the
+    // encrypted data in place. The overall status of the exchange is that of the first failing sample.
+
+    static const uint8_t Magic[8] = { 'O', 'C', 'D', 'M', 'B', 'A', 'T', '1' };
+
+    static constexpr uint8_t MaxIVLength = 16;
+    static constexpr uint8_t MaxKeyIdLength = 16;
+
+#pragma pack(push, 1)
+    struct Header {
+        uint8_t Magic[8];
+        uint16_t Samples;
+        uint16_t Reserved;
+        uint32_t Length; // Total size of the batch, including this header
+    };
+
+    struct Sample {
+        uint32_t Length; // Encrypted bytes following the mapping
+        uint32_t Mappings; // Number of uint32_t entries in the subsample mapping
+        uint8_t IVLength;
+        uint8_t KeyIdLength;
+        uint8_t InitWithLast15;
+        uint8_t Reserved;
+        uint8_t IV[MaxIVLength];
+        uint8_t KeyId[MaxKeyIdLength];
+        uint32_t Status; // Set by the decrypting side
+        uint32_t ClearLength; // Set by the decrypting side
+    };
+#pragma pack(pop)
+
+    inline bool IsBatch(const uint8_t buffer[], const uint32_t length)
+    {
+        return ((length >= sizeof(Header)) && (::memcmp(buffer, Magic, sizeof(Magic)) == 0));
+    }
+
+    // Client side: lays out the samples in the (shared) buffer before the handshake.
+    class Writer {
+    public:
+        Writer() = delete;
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        Writer(uint8_t buffer[], const uint32_t size)
+            : _buffer(buffer)
+            , _size(size)
+            , _header()
+        {
+            ::memcpy(_header.Magic, Magic, sizeof(Magic));
+            _header.Length = sizeof(_header);
+        }
+
+    public:
+        // Returns false, leaving the batch as it was, if the sample does not fit.
+        bool Add(const uint8_t data[], const uint32_t length, const uint32_t mapping[], const uint32_t mappings,
+            const uint8_t iv[], const uint8_t ivLength, const uint8_t keyId[], const uint8_t keyIdLength, const bool initWithLast15)
+        {
+            const uint64_t needed = static_cast<uint64_t>(sizeof(Sample)) + (static_cast<uint64_t>(mappings) * sizeof(uint32_t)) + length;
+
+            if ((ivLength > MaxIVLength) || (keyIdLength > MaxKeyIdLength) || (_header.Samples == UINT16_MAX) || ((_header.Length + needed) > _size)) {
+                return (false);
+            }
+
+            Sample sample;
+            ::memset(&sample, 0, sizeof(sample));
+            sample.Length = length;
+            sample.Mappings = mappings;
+            sample.IVLength = ivLength;
+            sample.KeyIdLength = keyIdLength;
+            sample.InitWithLast15 = (initWithLast15 ? 1 : 0);
+            if (ivLength != 0) {
+                ::memcpy(sample.IV, iv, ivLength);
+            }
+            if (keyIdLength != 0) {
+                ::memcpy(sample.KeyId, keyId, keyIdLength);
+            }
+
+            uint8_t* position = &_buffer[_header.Length];
+            ::memcpy(position, &sample, sizeof(sample));
+            position += sizeof(sample);
+            if (mappings != 0) {
+                ::memcpy(position, mapping, mappings * sizeof(uint32_t));
+                position += mappings * sizeof(uint32_t);
+            }
+            if (length != 0) {
+                ::memcpy(position, data, length);
+            }
+
+            _header.Samples++;
+            _header.Length += static_cast<uint32_t>(needed);
+            ::memcpy(_buffer, &_header, sizeof(_header));
+
+            return (true);
+        }
+        uint16_t Samples() const
+        {
+            return (_header.Samples);
+        }
+        // Bytes to hand over for the exchange
+        uint32_t Length() const
+        {
+            return (_header.Length);
+        }
+
+    private:
+        uint8_t* _buffer;
+        const uint32_t _size;
+        Header _header;
+    };
+
+    // Walks the samples of a batch, checking every length against the written size before use.
+    //
+    //   Reader reader(buffer, written);
+    //   while (reader.Next() == true) { ...; reader.Store(); }
+    //   if ((reader.IsValid() == false) || (reader.Malformed() == true)) { ... }
+    class Reader {
+    public:
+        Reader() = delete;
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        Reader(uint8_t buffer[], const uint32_t written)
+            : _buffer(buffer)
+            , _header()
+            , _valid(false)
+            , _malformed(false)
+            , _index(0)
+            , _offset(0)
+            , _next(sizeof(Header))
+            , _sample()
+        {
+            if (written >= sizeof(Header)) {
+                ::memcpy(&_header, buffer, sizeof(_header));
+                _valid = ((_header.Length >= sizeof(Header)) && (_header.Length <= written));
+            }
+        }
+
+    public:
+        // The header itself is consistent with the written size
+        bool IsValid() const
+        {
+            return (_valid);
+        }
+        // A sample did not fit the batch, the ones after it were not looked at
+        bool Malformed() const
+        {
+            return (_malformed);
+        }
+        const Header& Information() const
+        {
+            return (_header);
+        }
+        // Samples returned by Next() so far, so the index of the offending sample once Malformed()
+        uint16_t Index() const
+        {
+            return (_index);
+        }
+        bool Next()
+        {
+            if ((_valid == false) || (_malformed == true) || (_index >= _header.Samples)) {
+                return (false);
+            }
+
+            if ((_header.Length - _next) < sizeof(Sample)) {
+                _malformed = true;
+                return (false);
+            }
+
+            ::memcpy(&_sample, &_buffer[_next], sizeof(_sample));
+
+            const uint64_t end = _next + sizeof(Sample) + (static_cast<uint64_t>(_sample.Mappings) * sizeof(uint32_t)) + _sample.Length;
+
+            if ((end > _header.Length) || (_sample.IVLength > MaxIVLength) || (_sample.KeyIdLength > MaxKeyIdLength)) {
+                _malformed = true;
+                return (false);
+            }
+
+            _offset = _next;
+            _next = static_cast<uint32_t>(end);
+            _index++;
+
+            return (true);
+        }
+        Sample& Current()
+        {
+            return (_sample);
+        }
+        // Not necessarily aligned in the buffer, copy before use as uint32_t[]
+        const uint8_t* Mapping() const
+        {
+            return (&_buffer[_offset + sizeof(Sample)]);
+        }
+        uint8_t* Data()
+        {
+            return (&_buffer[_next - _sample.Length]);
+        }
+        // Writes Status and ClearLength of the current sample back
+        void Store()
+        {
+            ::memcpy(&_buffer[_offset], &_sample, sizeof(_sample));
+        }
+
+    private:
+        uint8_t* _buffer;
+        Header _header;
+        bool _valid;
+        bool _malformed;
+        uint16_t _index;
+        uint32_t _offset;
+        uint32_t _next;
+        Sample _sample;
+    };
+
+    // Decrypt throughput, accumulated per session buffer and, once a session buffer goes away,
+    // for the whole accessor. Exchanges counts the cross process handshakes, Samples the samples
+    // carried by them, so Samples / Exchanges is the average batch size.
+    struct Statistics {
+        Statistics()
+            : Exchanges(0)
+            , Samples(0)
+            , Bytes(0)
+            , Failures(0)
+            , Ticks(0)
+        {
+        }
+
+        void Add(const Statistics& other)
+        {
+            Exchanges += other.Exchanges;
+            Samples += other.Samples;
+            Bytes += other.Bytes;
+            Failures += other.Failures;
+            Ticks += other.Ticks;
+        }
+
+        uint64_t Exchanges;
+        uint64_t Samples;
+        uint64_t Bytes;
+        uint64_t Failures;
+        uint64_t Ticks; // Time spent decrypting, in microseconds
+    };
+
+    // The CDM side of Decrypt().
+    class Decryptor {
+    public:
+        virtual ~Decryptor() {}
+
+        // Decrypts one sample as CDMi::IMediaKeySession::Decrypt does, in place or into a buffer of
+        // its own returned through clearContent. Returns 0 on success.
+        virtual uint32_t Decrypt(const Sample& sample, const uint32_t mapping[], uint8_t data[], uint32_t& clearLength, uint8_t*& clearContent) = 0;
+        // The batch, or the sample at index, could not be handled
+        virtual void Failed(const uint16_t /* index */, const char /* reason */[]) {}
+    };
+
+    // Server side: decrypts all samples of the batch in place, storing the Status and ClearLength of
+    // each. Returns the status of the first failing sample, or failure if the batch itself is broken.
+    // The mapping vector is scratch space, kept by the caller so it is not allocated per batch.
+    inline uint32_t Decrypt(uint8_t buffer[], const uint32_t written, Decryptor& decryptor, const uint32_t failure,
+        std::vector<uint32_t>& mapping, Statistics& statistics)
+    {
+        Reader reader(buffer, written);
+        uint32_t result = 0;
+
+        if (reader.IsValid() == false) {
+            decryptor.Failed(0, "batch length does not fit the written buffer size");
+            statistics.Failures++;
+            return (failure);
+        }
+
+        while (reader.Next() == true) {
+            Sample& sample(reader.Current());
+
+            // The mapping is not necessarily aligned in the shared buffer
+            mapping.resize(sample.Mappings);
+            if (sample.Mappings != 0) {
+                ::memcpy(mapping.data(), reader.Mapping(), sample.Mappings * sizeof(uint32_t));
+            }
+
+            uint8_t* data = reader.Data();
+            uint32_t clearLength = 0;
+            uint8_t* clearContent = nullptr;
+
+            uint32_t cr = decryptor.Decrypt(sample, (sample.Mappings != 0 ? mapping.data() : nullptr), data, clearLength, clearContent);
+
+            sample.ClearLength = sample.Length;
+
+            if ((cr == 0) && (clearLength != 0)) {
+                if (clearLength > sample.Length) {
+                    // The clear data has to replace the encrypted data in place
+                    decryptor.Failed(reader.Index() - 1, "clear sample exceeds the encrypted size");
+                    cr = failure;
+                } else {
+                    if (clearContent != data) {
+                        ::memmove(data, clearContent, clearLength);
+                    }
+                    sample.ClearLength = clearLength;
+                }
+            }
+
+            sample.Status = cr;
+            reader.Store();
+
+            statistics.Samples++;
+            statistics.Bytes += sample.Length;
+
+            if (cr != 0) {
+                statistics.Failures++;
+
+                if (result == 0) {
+                    result = cr;
+                }
+            }
+        }
+
+        if (reader.Malformed() == true) {
+            decryptor.Failed(reader.Index(), "sample is malformed");
+            statistics.Failures++;
+            result = (result == 0 ? failure : result);
+        }
+
+        return (result);
+    }
+
+} // namespace SampleBatch
+} // namespace Plugin
+} // namespace WPEFramework
+
+#endif // __OPENCDMI_SAMPLEBATCH_H
@@ -19,17 +19,88 @@
  
 #include "PackagerImplementation.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
 #if defined (DO_NOT_USE_DEPRECATED_API)
 #include <opkg_cmd.h>
 #else
 #include <opkg.h>
 #endif
+#include <file_util.h>
 #include <opkg_download.h>
 #include <pkg.h>
+#include <pkg_hash.h>
+
+#include <curl/curl.h>
 
 namespace WPEFramework {
 namespace Plugin {
 
+    namespace {
+
+        const string* TransportOption(const std::map<string, string>& options, const string& name)
+        {
+            std::map<string, string>::const_iterator index(options.find(name));
+            return (index != options.end() ? &(index->second) : nullptr);
+        }
+
+        // The transport settings opkg's own (curl based) downloader takes from opkg.conf, so the prefetch
+        // reaches the feed the same way.
+        void ApplyTransportOptions(CURL* curl, const std::map<string, string>& options, const string& url)
+        {
+            static const struct {
+                const TCHAR* Name;
+                CURLoption Option;
+            } strings[] = {
+                { _T("no_proxy"), CURLOPT_NOPROXY },
+                { _T("proxy_user"), CURLOPT_PROXYUSERNAME },
+                { _T("proxy_passwd"), CURLOPT_PROXYPASSWORD },
+                { _T("http_auth"), CURLOPT_USERPWD },
+                { _T("ssl_engine"), CURLOPT_SSLENGINE },
+                { _T("ssl_cert"), CURLOPT_SSLCERT },
+                { _T("ssl_cert_type"), CURLOPT_SSLCERTTYPE },
+                { _T("ssl_key"), CURLOPT_SSLKEY },
+                { _T("ssl_key_type"), CURLOPT_SSLKEYTYPE },
+                { _T("ssl_key_passwd"), CURLOPT_KEYPASSWD },
+                { _T("ssl_ca_file"), CURLOPT_CAINFO },
+                { _T("ssl_ca_path"), CURLOPT_CAPATH }
+            };
+
+            const string scheme(url.substr(0, url.find(':')));
+            const string* proxy = TransportOption(options, scheme + _T("_proxy"));
+            if (proxy != nullptr) {
+                curl_easy_setopt(curl, CURLOPT_PROXY, proxy->c_str());
+            }
+
+            for (const auto& entry : strings) {
+                const string* value = TransportOption(options, entry.Name);
+                if (value != nullptr) {
+                    curl_easy_setopt(curl, entry.Option, value->c_str());
+                }
+            }
+
+            const string* verify = TransportOption(options, _T("ssl_dont_verify_peer"));
+            if ((verify != nullptr) && (*verify != _T("0"))) {
+                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+            }
+
+            const string* timeout = TransportOption(options, _T("connect_timeout_ms"));
+            if (timeout != nullptr) {
+                curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, std::strtol(timeout->c_str(), nullptr, 10));
+            }
+            timeout = TransportOption(options, _T("transfer_timeout_ms"));
+            if (timeout != nullptr) {
+                curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, std::strtol(timeout->c_str(), nullptr, 10));
+            }
+        }
+
+    }
+
     SERVICE_REGISTRATION(PackagerImplementation, 1, 0);
 
     void PackagerImplementation::UpdateConfig() const {
@@ -41,10 +112,6 @@ namespace Plugin {
         opkg_config->verbosity = _verbosity;
         opkg_config->nodeps = _noDeps;
 
-        if (_volatileCache == true) {
-            opkg_config->volatile_cache = 1;
-        }
-
         if (_skipSignatureChecking == true) {
             opkg_config->check_pkg_signature = 0;
         } else {
@@ -102,6 +169,9 @@ namespace Plugin {
              _volatileCache = config.MakeCacheVolatile.Value();
          }
 
+        _maxDownloads = std::max<uint8_t>(config.MaxDownloads.Value(), 1);
+        _downloadRate = config.DownloadRate.Value();
+
         if (Core::File(_configFile).Exists() == false) {
             result = Core::ERROR_GENERAL;
         } else if (Core::Directory(_tempPath.c_str()).CreatePath() == false) {
@@ -109,11 +179,15 @@ namespace Plugin {
         } else if (Core::Directory(_cachePath.c_str()).CreatePath() == false) {
             result = Core::ERROR_GENERAL;
         } else {
-            /* See Install() for explanation why it's not done here.
+            /* See ReinitOPKG() for explanation why it's not done here.
             if (InitOPKG() == false) {
                 result = Core::ERROR_GENERAL;
             }
             */
+            LoadTransportOptions();
+            curl_global_init(CURL_GLOBAL_ALL);
+            _downloads.Start(_maxDownloads);
+            _verifiers.Start(std::max<uint8_t>(config.VerifyThreads.Value(), 1));
         }
 
         return (result);
@@ -121,20 +195,78 @@ namespace Plugin {
 
     PackagerImplementation::~PackagerImplementation()
     {
+        _shuttingDown = true;
+        _downloads.Stop();
+        _verifiers.Stop();
+        _worker.Stop();
+        _worker.Wait(Core::Thread::STOPPED | Core::Thread::BLOCKED, Core::infinite);
+
+        _adminLock.Lock();
+        _tasks.clear();
+        _packages.clear();
+        _adminLock.Unlock();
+
         FreeOPKG();
+        curl_global_cleanup();
         _servicePI->Release();
         _servicePI = nullptr;
     }
 
+    void PackagerImplementation::JobPool::Start(uint8_t threads)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _stopping = false;
+        while (_threads.size() < threads) {
+            _threads.emplace_back([this]() {
+                std::unique_lock<std::mutex> lock(_lock);
+                while (true) {
+                    _signal.wait(lock, [this]() { return ((_stopping == true) || (_jobs.empty() == false)); });
+                    if (_stopping == true) {
+                        break;
+                    }
+                    std::function<void()> job(std::move(_jobs.front()));
+                    _jobs.pop_front();
+                    lock.unlock();
+                    job();
+                    lock.lock();
+                }
+            });
+        }
+    }
+
+    void PackagerImplementation::JobPool::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _stopping = true;
+        }
+        _signal.notify_all();
+        for (auto& thread : _threads) {
+            thread.join();
+        }
+        _threads.clear();
+
+        std::lock_guard<std::mutex> lock(_lock);
+        _jobs.clear();
+    }
+
+    void PackagerImplementation::JobPool::Post(std::function<void()>&& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _jobs.push_back(std::move(job));
+        }
+        _signal.notify_one();
+    }
+
     void PackagerImplementation::Register(Exchange::IPackager::INotification* notification)
     {
         ASSERT(notification);
         _adminLock.Lock();
         notification->AddRef();
         _notifications.push_back(notification);
-        if (_inProgress.Install != nullptr) {
-            ASSERT(_inProgress.Package != nullptr);
-            notification->StateChange(_inProgress.Package, _inProgress.Install);
+        for (auto& job : _packages) {
+            notification->StateChange(job->Package, job->Install);
         }
         _adminLock.Unlock();
     }
@@ -152,82 +284,301 @@ namespace Plugin {
 
     uint32_t PackagerImplementation::Install(const string& name, const string& version, const string& arch)
     {
-        return DoWork(&name, &version, &arch);
-    }
+        uint32_t result = Core::ERROR_NONE;
 
-    uint32_t PackagerImplementation::SynchronizeRepository()
-    {
-        return DoWork(nullptr, nullptr, nullptr);
+        _adminLock.Lock();
+        auto queued = std::find_if(_packages.begin(), _packages.end(),
+            [&name](const std::shared_ptr<InstallationData>& job) { return job->Package->Name() == name; });
+        if (queued != _packages.end()) {
+            result = Core::ERROR_INPROGRESS;
+        } else {
+            std::shared_ptr<InstallationData> job(new InstallationData());
+            job->Package = Core::Service<PackageInfo>::Create<PackageInfo>(name, version, arch);
+            job->Install = Core::Service<InstallInfo>::Create<InstallInfo>();
+            _packages.push_back(job);
+            QueueTask(Task::RESOLVE, job);
+            NotifyStateChange(*job);
+        }
+        _adminLock.Unlock();
+
+        return result;
     }
 
-    uint32_t PackagerImplementation::DoWork(const string* name, const string* version, const string* arch)
+    uint32_t PackagerImplementation::SynchronizeRepository()
     {
         uint32_t result = Core::ERROR_INPROGRESS;
 
         _adminLock.Lock();
-        if (_inProgress.Install == nullptr && _isSyncing == false) {
-            ASSERT(_inProgress.Package == nullptr);
+        if (_isSyncing == false) {
+            _isSyncing = true;
+            QueueTask(Task::SYNCHRONIZE, nullptr);
             result = Core::ERROR_NONE;
-            // OPKG bug: it marks it checked dependency for a package as cyclic dependency handling fix
-            // but since in our case it's not an process which dies when done, this info survives and makes the
-            // deps check to be skipped on subsequent calls. This is why hash_deinit() is called below
-            // and needs to be initialized here agian.
-            if (_opkgInitialized == true)  // it was initialized
-                FreeOPKG();
-            _opkgInitialized = InitOPKG();
-
-            if (_opkgInitialized) {
-                if (name && version && arch) {
-                    _inProgress.Package = Core::Service<PackageInfo>::Create<PackageInfo>(*name, *version, *arch);
-                    _inProgress.Install = Core::Service<InstallInfo>::Create<InstallInfo>();
+        }
+        _adminLock.Unlock();
+
+        return result;
+    }
+
+    void PackagerImplementation::QueueTask(Task type, const std::shared_ptr<InstallationData>& job)
+    {
+        _adminLock.Lock();
+        _tasks.push_back({ type, job });
+        _worker.Run();
+        _adminLock.Unlock();
+    }
+
+    void PackagerImplementation::RunTaskNoLock(const OPKGTask& task)
+    {
+        switch (task.Type) {
+            case Task::SYNCHRONIZE:
+                if (ReinitOPKG() == true) {
+                    BlockingSetupLocalRepoNoLock(RepoSyncMode::FORCED);
                 } else {
-                    _isSyncing = true;
+                    NotifyRepoSynced(Core::ERROR_GENERAL);
                 }
-                _worker.Run();
+                break;
+            case Task::RESOLVE:
+                // Package lists fetched by the setup are only loaded by a new opkg instance.
+                if (((_opkgInitialized == true) || (ReinitOPKG() == true)) &&
+                    ((BlockingSetupLocalRepoNoLock(RepoSyncMode::SETUP) == false) || (ReinitOPKG() == true))) {
+                    ResolveNoLock(task.Job);
+                } else {
+                    Fail(task.Job, Core::ERROR_GENERAL);
+                }
+                break;
+            case Task::INSTALL:
+                if (ReinitOPKG() == true) {
+                    _inProgress = task.Job;
+                    BlockingInstallUntilCompletionNoLock();
+                    _inProgress.reset();
+                    Finish(task.Job);
+                } else {
+                    Fail(task.Job, Core::ERROR_GENERAL);
+                }
+                break;
+        }
+    }
+
+    void PackagerImplementation::ResolveNoLock(const std::shared_ptr<InstallationData>& job)
+    {
+        const string name = job->Package->Name();
+        const string version = job->Package->Version();
+        pkg_t* pkg = (version.empty() == true ? pkg_hash_fetch_best_installation_candidate_by_name(name.c_str())
+                                              : pkg_hash_fetch_by_name_version(name.c_str(), version.c_str()));
+
+        // Packages given by URL or file path, or that are installed already, are left to opkg entirely.
+        if ((pkg != nullptr) && (pkg->state_status != SS_INSTALLED) && (pkg->src != nullptr) &&
+            (pkg->src->value != nullptr) && (pkg->filename != nullptr)) {
+            job->Url = string(pkg->src->value) + '/' + pkg->filename;
+            job->CacheFile = CacheLocation(job->Url);
+            if (pkg->md5sum != nullptr) {
+                job->MD5Sum = pkg->md5sum;
+            }
+        }
+
+        if (job->Url.empty() == true) {
+            QueueTask(Task::INSTALL, job);
+        } else if (Core::File(job->CacheFile).Exists() == true) {
+            _verifiers.Post([this, job]() { Verify(job); });
+        } else {
+            _downloads.Post([this, job]() { Download(job); });
+        }
+    }
+
+    void PackagerImplementation::Download(const std::shared_ptr<InstallationData>& job)
+    {
+        struct Progress {
+            PackagerImplementation* Parent;
+            InstallationData* Job;
+            uint8_t Reported;
+        } progress = { this, job.get(), 0 };
+
+        curl_xferinfo_callback onProgress = [](void* data, curl_off_t total, curl_off_t now, curl_off_t, curl_off_t) -> int {
+            Progress* progress = static_cast<Progress*>(data);
+            if (progress->Parent->_shuttingDown == true) {
+                return 1;
+            }
+            if (total > 0) {
+                uint8_t percentage = static_cast<uint8_t>((now * 100) / total);
+                // Steps of 10% are plenty for a progress bar and keep large packages from flooding the observers.
+                if ((percentage / 10) > (progress->Reported / 10)) {
+                    progress->Reported = percentage;
+                    progress->Job->Install->SetProgress(percentage);
+                    progress->Parent->NotifyStateChange(*progress->Job);
+                }
+            }
+            return 0;
+        };
+
+        job->Install->SetState(Exchange::IPackager::DOWNLOADING);
+        job->Install->SetProgress(0);
+        NotifyStateChange(*job);
+
+        uint32_t result = Core::ERROR_GENERAL;
+        const string partial = job->CacheFile + _T(".part");
+        FILE* file = fopen(partial.c_str(), "wb");
+        CURL* curl = (file != nullptr ? curl_easy_init() : nullptr);
+        if (curl != nullptr) {
+            curl_easy_setopt(curl, CURLOPT_URL, job->Url.c_str());
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, file);
+            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+            curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
+            curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+            curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, onProgress);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &progress);
+            ApplyTransportOptions(curl, _transportOptions, job->Url);
+            if (_downloadRate != 0) {
+                // Each of the concurrent downloads gets an equal share, so together they stay below the cap.
+                curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE,
+                    static_cast<curl_off_t>(_downloadRate) * 1024 / _maxDownloads);
+            }
+
+            CURLcode code = curl_easy_perform(curl);
+            if (code == CURLE_OK) {
+                result = Core::ERROR_NONE;
             } else {
-                result = Core::ERROR_GENERAL;
+                TRACE(Trace::Error, (_T("Downloading %s failed: %s"), job->Url.c_str(), curl_easy_strerror(code)));
+                result = (code == CURLE_ABORTED_BY_CALLBACK ? Core::ERROR_ASYNC_ABORTED : Core::ERROR_GENERAL);
+            }
+            curl_easy_cleanup(curl);
+        }
+
+        if ((file != nullptr) && (fclose(file) != 0) && (result == Core::ERROR_NONE)) {
+            result = Core::ERROR_WRITE_ERROR;
+        }
+        if ((result == Core::ERROR_NONE) && (rename(partial.c_str(), job->CacheFile.c_str()) != 0)) {
+            result = Core::ERROR_WRITE_ERROR;
+        }
+
+        if (result == Core::ERROR_NONE) {
+            job->Install->SetProgress(100);
+            job->Install->SetState(Exchange::IPackager::DOWNLOADED);
+            NotifyStateChange(*job);
+            _verifiers.Post([this, job]() { Verify(job); });
+        } else if ((result == Core::ERROR_ASYNC_ABORTED) || (_shuttingDown == true)) {
+            unlink(partial.c_str());
+            Fail(job, result);
+        } else {
+            // opkg downloads it itself while installing, with whatever the prefetch could not do.
+            unlink(partial.c_str());
+            TRACE(Trace::Information, (_T("Prefetching %s failed, leaving the download to opkg"), job->Url.c_str()));
+            QueueTask(Task::INSTALL, job);
+        }
+    }
+
+    void PackagerImplementation::Verify(const std::shared_ptr<InstallationData>& job)
+    {
+        job->Install->SetState(Exchange::IPackager::VERIFYING);
+        NotifyStateChange(*job);
+
+        // opkg checks the signature (and the checksum once more) while installing, this catches a broken
+        // download before it waits for its turn to be installed.
+        uint32_t result = Core::ERROR_NONE;
+        if (job->MD5Sum.empty() == false) {
+            char* sum = file_md5sum_alloc(job->CacheFile.c_str());
+            if (sum == nullptr) {
+                result = Core::ERROR_READ_ERROR;
+            } else if (job->MD5Sum != sum) {
+                TRACE(Trace::Error, (_T("Checksum of %s does not match the feed"), job->CacheFile.c_str()));
+                result = Core::ERROR_INCORRECT_HASH;
             }
+            free(sum);
         }
+
+        if (result == Core::ERROR_NONE) {
+            job->Install->SetState(Exchange::IPackager::VERIFIED);
+            NotifyStateChange(*job);
+            QueueTask(Task::INSTALL, job);
+        } else {
+            unlink(job->CacheFile.c_str());
+            Fail(job, result);
+        }
+    }
+
+    void PackagerImplementation::Finish(const std::shared_ptr<InstallationData>& job)
+    {
+        _adminLock.Lock();
+        _packages.remove(job);
         _adminLock.Unlock();
+    }
 
-        return result;
+    void PackagerImplementation::Fail(const std::shared_ptr<InstallationData>& job, uint32_t error)
+    {
+        job->Install->SetError(error);
+        NotifyStateChange(*job);
+        Finish(job);
+    }
+
+    // Named the way opkg (up to now) names the files in its download cache, so installing finds the package
+    // there instead of downloading it again. Nothing else depends on it, should opkg name them differently
+    // it downloads the package once more while installing.
+    string PackagerImplementation::CacheLocation(const string& url) const
+    {
+        string name(url);
+        std::replace(name.begin(), name.end(), '/', '_');
+        return Core::Directory::Normalize(_cachePath) + name;
+    }
 
+    // opkg.conf lines read "option <name> <value>", the value possibly quoted.
+    void PackagerImplementation::LoadTransportOptions()
+    {
+        std::ifstream file(_configFile);
+        string line;
+
+        _transportOptions.clear();
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            string keyword, name, value;
+
+            if ((fields >> keyword >> name) && (keyword == _T("option"))) {
+                std::getline(fields >> std::ws, value);
+                value.erase(value.find_last_not_of(_T(" \t\r")) + 1);
+                if ((value.length() >= 2) && ((value.front() == '"') || (value.front() == '\'')) && (value.back() == value.front())) {
+                    value = value.substr(1, value.length() - 2);
+                }
+                _transportOptions[name] = value;
+            }
+        }
     }
 
     void PackagerImplementation::BlockingInstallUntilCompletionNoLock() {
-        ASSERT(_inProgress.Install != nullptr && _inProgress.Package != nullptr);
+        ASSERT(_inProgress != nullptr);
 
 #if defined (DO_NOT_USE_DEPRECATED_API)
         opkg_cmd_t* command = opkg_cmd_find("install");
         if (command) {
-            _inProgress.Install->SetState(Exchange::IPackager::INSTALLING);
-            NotifyStateChange();
+            _inProgress->Install->SetState(Exchange::IPackager::INSTALLING);
+            NotifyStateChange(*_inProgress);
             opkg_config->pfm = command->pfm;
-            std::unique_ptr<char[]> targetCopy(new char [_inProgress.Package->Name().length() + 1]);
-            std::copy_n(_inProgress.Package->Name().begin(), _inProgress.Package->Name().length(), targetCopy.get());
-            (targetCopy.get())[_inProgress.Package->Name().length()] = 0;
+            std::unique_ptr<char[]> targetCopy(new char [_inProgress->Package->Name().length() + 1]);
+            std::copy_n(_inProgress->Package->Name().begin(), _inProgress->Package->Name().length(), targetCopy.get());
+            (targetCopy.get())[_inProgress->Package->Name().length()] = 0;
             const char* argv[1];
             argv[0] = targetCopy.get();
             if (opkg_cmd_exec(command, 1, argv) == 0) {
-                _inProgress.Install->SetProgress(100);
-                _inProgress.Install->SetState(Exchange::IPackager::INSTALLED);
+                _inProgress->Install->SetProgress(100);
+                _inProgress->Install->SetState(Exchange::IPackager::INSTALLED);
             } else {
-                _inProgress.Install->SetError(Core::ERROR_GENERAL);
+                _inProgress->Install->SetError(Core::ERROR_GENERAL);
             }
-            NotifyStateChange();
+            NotifyStateChange(*_inProgress);
         } else {
-            _inProgress.Install->SetError(Core::ERROR_GENERAL);
-            NotifyStateChange();
+            _inProgress->Install->SetError(Core::ERROR_GENERAL);
+            NotifyStateChange(*_inProgress);
         }
 #else
         _isUpgrade = false;
         opkg_package_callback_t checkUpgrade = [](pkg* pkg, void* user_data) {
             PackagerImplementation* self = static_cast<PackagerImplementation*>(user_data);
             if (self->_isUpgrade == false) {
-                self->_isUpgrade = self->_inProgress.Package->Name() == pkg->name;
-                if (self->_isUpgrade && self->_inProgress.Package->Version().empty() == false) {
+                self->_isUpgrade = self->_inProgress->Package->Name() == pkg->name;
+                if (self->_isUpgrade && self->_inProgress->Package->Version().empty() == false) {
                     self->_isUpgrade = opkg_compare_versions(pkg->version,
-                                                             self->_inProgress.Package->Version().c_str()) < 0;
+                                                             self->_inProgress->Package->Version().c_str()) < 0;
                 }
             }
         };
@@ -240,10 +591,10 @@ namespace Plugin {
         }
         _isUpgrade = false;
 
-        if (installFunction(_inProgress.Package->Name().c_str(), PackagerImplementation::InstallationProgessNoLock,
+        if (installFunction(_inProgress->Package->Name().c_str(), PackagerImplementation::InstallationProgessNoLock,
                             this) != 0) {
-            _inProgress.Install->SetError(Core::ERROR_GENERAL);
-            NotifyStateChange();
+            _inProgress->Install->SetError(Core::ERROR_GENERAL);
+            NotifyStateChange(*_inProgress);
         }
 #endif
     }
@@ -253,35 +604,35 @@ namespace Plugin {
                                                                         void* data)
     {
         PackagerImplementation* self = static_cast<PackagerImplementation*>(data);
-        self->_inProgress.Install->SetProgress(progress->percentage);
+        self->_inProgress->Install->SetProgress(progress->percentage);
         if (progress->action == OPKG_INSTALL &&
-            self->_inProgress.Install->State() == Exchange::IPackager::DOWNLOADING) {
-            self->_inProgress.Install->SetState(Exchange::IPackager::DOWNLOADED);
-            self->NotifyStateChange();
+            self->_inProgress->Install->State() == Exchange::IPackager::DOWNLOADING) {
+            self->_inProgress->Install->SetState(Exchange::IPackager::DOWNLOADED);
+            self->NotifyStateChange(*self->_inProgress);
         }
         bool stateChanged = false;
         switch (progress->action) {
             case OPKG_DOWNLOAD:
-                if (self->_inProgress.Install->State() != Exchange::IPackager::DOWNLOADING) {
-                    self->_inProgress.Install->SetState(Exchange::IPackager::DOWNLOADING);
+                if (self->_inProgress->Install->State() != Exchange::IPackager::DOWNLOADING) {
+                    self->_inProgress->Install->SetState(Exchange::IPackager::DOWNLOADING);
                     stateChanged = true;
                 }
                 break;
             case OPKG_INSTALL:
-                if (self->_inProgress.Install->State() != Exchange::IPackager::INSTALLING) {
-                    self->_inProgress.Install->SetState(Exchange::IPackager::INSTALLING);
+                if (self->_inProgress->Install->State() != Exchange::IPackager::INSTALLING) {
+                    self->_inProgress->Install->SetState(Exchange::IPackager::INSTALLING);
                     stateChanged = true;
                 }
                 break;
         }
 
         if (stateChanged == true)
-            self->NotifyStateChange();
+            self->NotifyStateChange(*self->_inProgress);
         if (progress->percentage == 100) {
-            self->_inProgress.Install->SetState(Exchange::IPackager::INSTALLED);
-            self->NotifyStateChange();
-            self->_inProgress.Install->SetAppName(progress->pkg->local_filename);
-            string mfilename = self->GetMetadataFile(self->_inProgress.Install->AppName());
+            self->_inProgress->Install->SetState(Exchange::IPackager::INSTALLED);
+            self->NotifyStateChange(*self->_inProgress);
+            self->_inProgress->Install->SetAppName(progress->pkg->local_filename);
+            string mfilename = self->GetMetadataFile(self->_inProgress->Install->AppName());
             string callsign = self->GetCallsign(mfilename);
             if(!callsign.empty()) {
                 self->DeactivatePlugin(callsign);
@@ -362,12 +713,12 @@ namespace Plugin {
         dlPlugin->Release();
     }
 
-    void PackagerImplementation::NotifyStateChange()
+    void PackagerImplementation::NotifyStateChange(const InstallationData& job)
     {
         _adminLock.Lock();
-        TRACE_L1("State for %s changed to %d (%d %%, %d)", _inProgress.Package->Name().c_str(), _inProgress.Install->State(), _inProgress.Install->Progress(), _inProgress.Install->ErrorCode());
+        TRACE_L1("State for %s changed to %d (%d %%, %d)", job.Package->Name().c_str(), job.Install->State(), job.Install->Progress(), job.Install->ErrorCode());
         for (auto* notification : _notifications) {
-            notification->StateChange(_inProgress.Package, _inProgress.Install);
+            notification->StateChange(job.Package, job.Install);
         }
         _adminLock.Unlock();
     }
@@ -382,6 +733,17 @@ namespace Plugin {
         _adminLock.Unlock();
     }
 
+    bool PackagerImplementation::ReinitOPKG()
+    {
+        // OPKG bug: it marks it checked dependency for a package as cyclic dependency handling fix
+        // but since in our case it's not an process which dies when done, this info survives and makes the
+        // deps check to be skipped on subsequent calls. This is why hash_deinit() is called below
+        // and needs to be initialized here agian.
+        FreeOPKG();
+        _opkgInitialized = InitOPKG();
+        return _opkgInitialized;
+    }
+
     bool PackagerImplementation::InitOPKG()
     {
         UpdateConfig();
@@ -395,13 +757,20 @@ namespace Plugin {
     void PackagerImplementation::FreeOPKG()
     {
         if (_opkgInitialized == true) {
+            // opkg wipes a volatile cache on deinit, which must wait until no queued package is kept in it.
+            _adminLock.Lock();
+            bool inUse = std::any_of(_packages.begin(), _packages.end(),
+                [](const std::shared_ptr<InstallationData>& job) { return job->CacheFile.empty() == false; });
+            _adminLock.Unlock();
+            opkg_config->volatile_cache = ((_volatileCache == true) && (inUse == false)) ? 1 : 0;
+
             opkg_download_cleanup();
             opkg_conf_deinit();
             _opkgInitialized = false;
         }
     }
 
-    void PackagerImplementation::BlockingSetupLocalRepoNoLock(RepoSyncMode mode)
+    bool PackagerImplementation::BlockingSetupLocalRepoNoLock(RepoSyncMode mode)
     {
         string dirPath = Core::ToString(opkg_config->lists_dir);
         Core::Directory dir(dirPath.c_str());
@@ -431,6 +800,8 @@ namespace Plugin {
             }
             NotifyRepoSynced(result);
         }
+
+        return (containFiles == false);
     }
 
 }  // namespace Plugin
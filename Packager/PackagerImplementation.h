@@ -22,8 +22,16 @@
 #include "Module.h"
 #include <interfaces/IPackager.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 // Forward declarations so we do not need to include the OPKG headers here.
 struct opkg_conf;
@@ -48,6 +56,9 @@ namespace Plugin {
                 , NoDeps()
                 , NoSignatureCheck()
                 , AlwaysUpdateFirst()
+                , MaxDownloads(2)               // Packages downloaded at the same time
+                , DownloadRate(0)               // KiB/s shared by all downloads, 0 is unlimited
+                , VerifyThreads(2)              // Threads checking downloaded packages
             {
                 Add(_T("config"), &ConfigFile);
                 Add(_T("temppath"), &TempDir);
@@ -57,6 +68,9 @@ namespace Plugin {
                 Add(_T("nodeps"), &NoDeps);
                 Add(_T("nosignaturecheck"), &NoSignatureCheck);
                 Add(_T("alwaysupdatefirst"), &AlwaysUpdateFirst);
+                Add(_T("maxdownloads"), &MaxDownloads);
+                Add(_T("downloadrate"), &DownloadRate);
+                Add(_T("verifythreads"), &VerifyThreads);
             }
 
             ~Config() override
@@ -74,6 +88,9 @@ namespace Plugin {
             Core::JSON::Boolean NoDeps;
             Core::JSON::Boolean NoSignatureCheck;
             Core::JSON::Boolean AlwaysUpdateFirst;
+            Core::JSON::DecUInt8 MaxDownloads;
+            Core::JSON::DecUInt32 DownloadRate;
+            Core::JSON::DecUInt8 VerifyThreads;
         };
 
         PackagerImplementation()
@@ -87,6 +104,10 @@ namespace Plugin {
             , _alwaysUpdateFirst(false)
             , _volatileCache(false)
             , _opkgInitialized(false)
+            , _maxDownloads(2)
+            , _downloadRate(0)
+            , _transportOptions()
+            , _shuttingDown(false)
             , _worker(this)
             , _isUpgrade(false)
             , _isSyncing(false)
@@ -239,6 +260,48 @@ namespace Plugin {
             }
             PackageInfo* Package = nullptr;
             InstallInfo* Install = nullptr;
+            string Url;         // Empty if opkg fetches the package itself during the install
+            string CacheFile;   // Where opkg looks for the package before downloading it itself
+            string MD5Sum;      // From the feed, empty if it has none
+        };
+
+        // A fixed number of threads running the jobs posted to them in order
+        class JobPool {
+        public:
+            JobPool(const JobPool&) = delete;
+            JobPool& operator=(const JobPool&) = delete;
+
+            JobPool()
+                : _stopping(false)
+            {
+            }
+            ~JobPool()
+            {
+                Stop();
+            }
+
+            void Start(uint8_t threads);
+            void Stop();
+            void Post(std::function<void()>&& job);
+
+        private:
+            std::mutex _lock;
+            std::condition_variable _signal;
+            std::list<std::function<void()>> _jobs;
+            std::vector<std::thread> _threads;
+            bool _stopping;
+        };
+
+        // Everything touching libopkg runs on this thread, one task at a time, as opkg is not reentrant.
+        enum class Task {
+            SYNCHRONIZE,    // Update the package lists
+            RESOLVE,        // Find the package in the feeds and hand it to the downloads
+            INSTALL         // Install the (downloaded and verified) package
+        };
+
+        struct OPKGTask {
+            Task Type;
+            std::shared_ptr<InstallationData> Job;
         };
 
         class InstallThread : public Core::Thread {
@@ -252,27 +315,18 @@ namespace Plugin {
 
             uint32_t Worker() override {
                 while(IsRunning() == true) {
-                    _parent->_adminLock.Lock(); // The parent may have lock when this starts so wait for it to release.
-                    bool isInstall = _parent->_inProgress.Install != nullptr;
-                    ASSERT(isInstall != true || _parent->_inProgress.Package != nullptr);
-                    _parent->_adminLock.Unlock();
-
-                    // After this point locking is not needed because API running on other threads only read if in
-                    // progress is filled in.
-                    _parent->BlockingSetupLocalRepoNoLock(isInstall == true ? RepoSyncMode::SETUP : RepoSyncMode::FORCED);
-                    if (isInstall)
-                        _parent->BlockingInstallUntilCompletionNoLock();
-
-                    if (isInstall) {
-                        _parent->_adminLock.Lock();
-                        _parent->_inProgress.Install->Release();
-                        _parent->_inProgress.Package->Release();
-                        _parent->_inProgress.Install = nullptr;
-                        _parent->_inProgress.Package = nullptr;
+                    _parent->_adminLock.Lock();
+                    if (_parent->_tasks.empty() == true) {
+                        // Tasks are only queued (and Run() called) with the lock taken, so none can be missed here.
+                        Block();
+                        _parent->_adminLock.Unlock();
+                    } else {
+                        OPKGTask task = _parent->_tasks.front();
+                        _parent->_tasks.pop_front();
                         _parent->_adminLock.Unlock();
-                    }
 
-                    Block();
+                        _parent->RunTaskNoLock(task);
+                    }
                 }
 
                 return Core::infinite;
@@ -287,7 +341,15 @@ namespace Plugin {
             SETUP
         };
 
-        uint32_t DoWork(const string* name, const string* version, const string* arch);
+        void QueueTask(Task type, const std::shared_ptr<InstallationData>& job);
+        void RunTaskNoLock(const OPKGTask& task);
+        void ResolveNoLock(const std::shared_ptr<InstallationData>& job);
+        void Download(const std::shared_ptr<InstallationData>& job);
+        void Verify(const std::shared_ptr<InstallationData>& job);
+        void Finish(const std::shared_ptr<InstallationData>& job);
+        void Fail(const std::shared_ptr<InstallationData>& job, uint32_t error);
+        string CacheLocation(const string& url) const;
+        void LoadTransportOptions();
         void UpdateConfig() const;
 #if !defined (DO_NOT_USE_DEPRECATED_API)
         static void InstallationProgessNoLock(const _opkg_progress_data_t* progress, void* data);
@@ -295,10 +357,11 @@ namespace Plugin {
         string GetMetadataFile(const string& appName);
         string GetCallsign(const string& mfilename);
         void DeactivatePlugin(const string& callsign);
-        void NotifyStateChange();
+        void NotifyStateChange(const InstallationData& job);
         void NotifyRepoSynced(uint32_t status);
         void BlockingInstallUntilCompletionNoLock();
-        void BlockingSetupLocalRepoNoLock(RepoSyncMode mode);
+        bool BlockingSetupLocalRepoNoLock(RepoSyncMode mode);
+        bool ReinitOPKG();
         bool InitOPKG();
         void FreeOPKG();
 
@@ -312,9 +375,17 @@ namespace Plugin {
         bool _alwaysUpdateFirst;
         bool _volatileCache;
         bool _opkgInitialized;
+        uint8_t _maxDownloads;
+        uint32_t _downloadRate;
+        std::map<string, string> _transportOptions; // "option" lines of opkg.conf, the prefetch uses them as opkg does
+        std::atomic<bool> _shuttingDown;
         PluginHost::IShell* _servicePI;
         std::vector<Exchange::IPackager::INotification*> _notifications;
-        InstallationData _inProgress;
+        std::list<std::shared_ptr<InstallationData>> _packages; // Queued or in progress, in request order
+        std::list<OPKGTask> _tasks;
+        std::shared_ptr<InstallationData> _inProgress; // Being installed, only used on the install thread
+        JobPool _downloads;
+        JobPool _verifiers;
         InstallThread _worker;
         bool _isUpgrade;
         bool _isSyncing;
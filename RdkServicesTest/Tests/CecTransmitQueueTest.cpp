@@ -0,0 +1,232 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "gtest/gtest.h"
+
+#include "CecTransmitQueue.h"
+
+#include <atomic>
+
+using namespace WPEFramework::Plugin;
+
+namespace RdkServicesTest {
+
+// Stands in for the ccec Connection: takes transmitDelay mS per frame and
+// does not ack the first nacks frames sent to nackDestination.
+class FakeConnection : public CecTransmitQueue::Transmitter {
+public:
+    FakeConnection(uint32_t transmitDelay)
+        : transmitDelay(transmitDelay)
+        , nackDestination(0xFF)
+        , nacks(0)
+    {
+    }
+
+    CecTransmitQueue::Result transmit(uint8_t destination, const std::vector<uint8_t>& frame, uint32_t timeout) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(transmitDelay));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        sent.push_back(frame.at(0));
+        timeouts.push_back(timeout);
+        if ((destination == nackDestination) && (nacks > 0)) {
+            nacks--;
+            return CecTransmitQueue::RESULT_NACKED;
+        }
+        return CecTransmitQueue::RESULT_ACKED;
+    }
+
+    std::vector<uint8_t> frames()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return sent;
+    }
+
+    std::vector<uint32_t> timeoutsUsed()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return timeouts;
+    }
+
+    uint32_t transmitDelay;
+    uint8_t nackDestination;
+    uint32_t nacks;
+
+private:
+    std::mutex mutex;
+    std::vector<uint8_t> sent;
+    std::vector<uint32_t> timeouts;
+};
+
+static void waitFor(std::atomic<int>& counter, int count)
+{
+    for (int i = 0; (i < 500) && (counter < count); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+TEST(CecTransmitQueueTest, ordering) {
+    FakeConnection connection(100);
+    CecTransmitQueue queue;
+
+    EXPECT_FALSE(queue.submit(0, { 0x01 }, CecTransmitQueue::PRIORITY_USER));
+
+    queue.start(connection);
+
+    std::atomic<int> completed(0);
+    CecTransmitQueue::Callback callback = [&completed](CecTransmitQueue::Result result) {
+        EXPECT_EQ(CecTransmitQueue::RESULT_ACKED, result);
+        completed++;
+    };
+
+    // submitting does not wait for the transmission
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(queue.submit(0x0F, { 0x84 }, CecTransmitQueue::PRIORITY_HOUSEKEEPING, callback));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(queue.submit(0x0F, { 0x87 }, CecTransmitQueue::PRIORITY_HOUSEKEEPING, callback));
+    EXPECT_TRUE(queue.submit(0x00, { 0x8F }, CecTransmitQueue::PRIORITY_RESPONSE, callback));
+    EXPECT_TRUE(queue.submit(0x0F, { 0x36 }, CecTransmitQueue::PRIORITY_USER, callback));
+    // same as the waiting one, it is sent once and both callbacks are called
+    EXPECT_TRUE(queue.submit(0x0F, { 0x87 }, CecTransmitQueue::PRIORITY_HOUSEKEEPING, callback));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(80));
+
+    waitFor(completed, 5);
+    EXPECT_EQ(5, completed);
+
+    // the frame on the bus is finished first, then by priority
+    EXPECT_EQ(std::vector<uint8_t>({ 0x84, 0x36, 0x8F, 0x87 }), connection.frames());
+
+    queue.stop();
+}
+
+TEST(CecTransmitQueueTest, retry) {
+    FakeConnection connection(0);
+    CecTransmitQueue queue;
+
+    connection.nackDestination = 0x04;
+    connection.nacks = 2;
+    queue.setRetryPolicy(0x04, 2, 50);
+    queue.start(connection);
+
+    std::atomic<int> completed(0);
+    CecTransmitQueue::Result result = CecTransmitQueue::RESULT_FAILED;
+
+    EXPECT_TRUE(queue.submit(0x04, { 0x46 }, CecTransmitQueue::PRIORITY_HOUSEKEEPING, [&](CecTransmitQueue::Result value) {
+        result = value;
+        completed++;
+    }));
+    // is not held up by the retries
+    EXPECT_TRUE(queue.submit(0x00, { 0x8F }, CecTransmitQueue::PRIORITY_HOUSEKEEPING, [&](CecTransmitQueue::Result) {
+        completed++;
+    }));
+
+    waitFor(completed, 2);
+    EXPECT_EQ(2, completed);
+    EXPECT_EQ(CecTransmitQueue::RESULT_ACKED, result);
+    EXPECT_EQ(std::vector<uint8_t>({ 0x46, 0x8F, 0x46, 0x46 }), connection.frames());
+
+    // without retries left the caller is told
+
+    connection.nacks = 1;
+    queue.setRetryPolicy(0x04, 0, 0);
+    EXPECT_TRUE(queue.submit(0x04, { 0x8C }, CecTransmitQueue::PRIORITY_HOUSEKEEPING, [&](CecTransmitQueue::Result value) {
+        result = value;
+        completed++;
+    }));
+
+    waitFor(completed, 3);
+    EXPECT_EQ(CecTransmitQueue::RESULT_NACKED, result);
+
+    queue.stop();
+}
+
+// One Touch Play: ActiveSource must not reach the bus before the TV acked ImageViewOn or that
+// was given up on.
+TEST(CecTransmitQueueTest, sequence) {
+    FakeConnection connection(0);
+    CecTransmitQueue queue;
+
+    connection.nackDestination = 0x00;
+    connection.nacks = 2;
+    queue.setRetryPolicy(0x00, 2, 50, 300);
+    queue.start(connection);
+
+    std::atomic<int> completed(0);
+    std::vector<CecTransmitQueue::Result> results;
+    std::mutex resultsLock;
+    CecTransmitQueue::Callback callback = [&](CecTransmitQueue::Result result) {
+        std::lock_guard<std::mutex> lock(resultsLock);
+        results.push_back(result);
+        completed++;
+    };
+
+    EXPECT_FALSE(queue.submit(std::vector<CecTransmitQueue::Message>(), CecTransmitQueue::PRIORITY_USER));
+    EXPECT_TRUE(queue.submit(std::vector<CecTransmitQueue::Message>({ { 0x00, { 0x04 }, callback }, { 0x0F, { 0x82 }, callback } }),
+        CecTransmitQueue::PRIORITY_USER));
+    // goes out while ImageViewOn waits for its retry, ActiveSource does not
+    EXPECT_TRUE(queue.submit(0x05, { 0x8F }, CecTransmitQueue::PRIORITY_USER, callback));
+
+    waitFor(completed, 3);
+    EXPECT_EQ(std::vector<uint8_t>({ 0x04, 0x8F, 0x04, 0x04, 0x82 }), connection.frames());
+    EXPECT_EQ(std::vector<uint32_t>({ 300, 1000, 300, 300, 1000 }), connection.timeoutsUsed());
+    {
+        std::lock_guard<std::mutex> lock(resultsLock);
+        EXPECT_EQ(std::vector<CecTransmitQueue::Result>({ CecTransmitQueue::RESULT_ACKED, CecTransmitQueue::RESULT_ACKED, CecTransmitQueue::RESULT_ACKED }), results);
+        results.clear();
+    }
+
+    // the TV does not answer at all, ActiveSource still goes out after the last retry
+
+    connection.nacks = 3;
+    EXPECT_TRUE(queue.submit(std::vector<CecTransmitQueue::Message>({ { 0x00, { 0x04 }, callback }, { 0x0F, { 0x82 }, callback } }),
+        CecTransmitQueue::PRIORITY_USER));
+
+    waitFor(completed, 5);
+    {
+        std::lock_guard<std::mutex> lock(resultsLock);
+        EXPECT_EQ(std::vector<CecTransmitQueue::Result>({ CecTransmitQueue::RESULT_NACKED, CecTransmitQueue::RESULT_ACKED }), results);
+    }
+
+    queue.stop();
+}
+
+TEST(CecTransmitQueueTest, stop) {
+    FakeConnection connection(100);
+    CecTransmitQueue queue;
+    queue.start(connection);
+
+    std::atomic<int> cancelled(0);
+    for (uint8_t opcode = 1; opcode <= 3; opcode++) {
+        queue.submit(0x00, { opcode }, CecTransmitQueue::PRIORITY_USER, [&cancelled](CecTransmitQueue::Result result) {
+            if (result == CecTransmitQueue::RESULT_CANCELLED)
+                cancelled++;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    queue.stop();
+
+    // the first one was on the bus already
+    EXPECT_EQ(2, cancelled);
+    EXPECT_EQ(0u, queue.pending());
+    EXPECT_FALSE(queue.submit(0x00, { 0x04 }, CecTransmitQueue::PRIORITY_USER));
+}
+
+} // namespace RdkServicesTest
@@ -76,8 +76,9 @@ TEST(LocationSyncTest, test) {
 
     WPEFramework::PluginHost::ISubSystem* subSystem = service->SubSystems();
 
+    // a location stored by an earlier run is served before the probe confirms internet connectivity
     WPEFramework::Core::Event wait(false, true);
-    for (int i = 0; ((subSystem->Get(WPEFramework::PluginHost::ISubSystem::LOCATION) == nullptr) && (i < 1000)); i++) {
+    for (int i = 0; ((subSystem->Get(WPEFramework::PluginHost::ISubSystem::INTERNET) == nullptr) && (i < 1000)); i++) {
         wait.Lock(10);
     }
 
@@ -98,4 +99,76 @@ TEST(LocationSyncTest, test) {
     _engine.Release();
 }
 
+TEST(LocationSyncTest, restore) {
+    // assign worker pool
+
+    auto _engine = WPEFramework::Core::ProxyType<WorkerPoolImplementation>::Create(2, WPEFramework::Core::Thread::DefaultStackSize(), 16);
+    WPEFramework::Core::IWorkerPool::Assign(&(*_engine));
+    _engine->Run();
+
+    // create plugin
+
+    auto locationSync = WPEFramework::Core::ProxyType <WPEFramework::Plugin::LocationSync>::Create();
+
+    WPEFramework::Core::JSONRPC::Handler& handler = *locationSync;
+
+    WPEFramework::Core::File serverConf(string("thunder/install/etc/WPEFramework/config.json"), false);
+    EXPECT_TRUE(serverConf.Open(true));
+
+    WPEFramework::Core::File pluginConf(string("thunder/install/etc/WPEFramework/plugins/LocationSync.json"), false);
+    EXPECT_TRUE(pluginConf.Open(true));
+
+    WPEFramework::Core::OptionalType<WPEFramework::Core::JSON::Error> error;
+
+    Config server(serverConf, error);
+    EXPECT_FALSE(error.IsSet());
+
+    WPEFramework::Plugin::Config plugin;
+    plugin.IElement::FromFile(pluginConf, error);
+    EXPECT_FALSE(error.IsSet());
+
+    // nothing answers on this port, the probe keeps on waiting for the rest of its 30 s round
+    plugin.Configuration = _T("{\"interval\":30,\"retries\":1,\"source\":\"http://jsonip.metrological.com:1/?maf=true\"}");
+
+    auto service = WPEFramework::Core::ProxyType <Service>::Create(server, plugin);
+
+    // store a location as an earlier run would have
+
+    WPEFramework::Core::Directory(service->PersistentPath().c_str()).CreatePath();
+
+    WPEFramework::Core::File stored(service->PersistentPath() + _T("location.json"), false);
+    EXPECT_TRUE(stored.Create());
+    string location(_T("{\"ip\":\"195.64.234.239\",\"timezone\":\"EET-2EEST,M3.5.0/3,M10.5.0/4\",\"region\":\"51\",\"country\":\"UA\",\"city\":\"Odessa\"}"));
+    stored.Write(reinterpret_cast<const uint8_t*>(location.c_str()), static_cast<uint32_t>(location.length()));
+    stored.Close();
+
+    // init plugin, the stored location is available right away
+
+    WPEFramework::PluginHost::ISubSystem* subSystem = service->SubSystems();
+
+    EXPECT_EQ(string(""), locationSync->Initialize(&(*service)));
+
+    EXPECT_TRUE(subSystem->Get(WPEFramework::PluginHost::ISubSystem::LOCATION) != nullptr);
+
+    WPEFramework::Core::JSONRPC::Connection connection(1, 0);
+
+    string response;
+    EXPECT_EQ(WPEFramework::Core::ERROR_NONE, handler.Invoke(connection, _T("location"), _T(""), response));
+    EXPECT_TRUE(response.empty() == false);
+
+    // the probe still runs in the background, the restored location does not mean internet connectivity
+
+    EXPECT_EQ(WPEFramework::Core::ERROR_INPROGRESS, handler.Invoke(connection, _T("sync"), _T("{}"), response));
+    EXPECT_TRUE(subSystem->Get(WPEFramework::PluginHost::ISubSystem::INTERNET) == nullptr);
+
+    // clean up
+
+    locationSync->Deinitialize(&(*service));
+    locationSync.Release();
+    service.Release();
+
+    WPEFramework::Core::IWorkerPool::Assign(nullptr);
+    _engine.Release();
+}
+
 } // namespace RdkServicesTest
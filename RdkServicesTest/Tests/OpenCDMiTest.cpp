@@ -0,0 +1,513 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "gtest/gtest.h"
+
+// OpenCDMi is not linked in, trace in the name of this module
+#ifndef MODULE_NAME
+#define MODULE_NAME RdkServicesTest
+#endif
+
+#include "CENCParser.h"
+#include "SampleBatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace WPEFramework::Plugin;
+
+namespace RdkServicesTest {
+
+static CommonEncryptionData::KeyId keyId(const uint16_t number)
+{
+    uint8_t id[16] = {};
+    id[14] = static_cast<uint8_t>(number >> 8);
+    id[15] = static_cast<uint8_t>(number);
+    return (CommonEncryptionData::KeyId(CommonEncryptionData::COMMON, id, sizeof(id)));
+}
+
+TEST(OpenCDMiTest, keyIds) {
+    CommonEncryptionData initData(nullptr, 0);
+    SessionKeyIds keys(initData);
+
+    EXPECT_EQ(::OCDM::ISession::StatusPending, keys.Status());
+    EXPECT_FALSE(keys.HasKeyId(keyId(1)));
+
+    CommonEncryptionData::KeyId updated(keys.UpdateKeyStatus(::OCDM::ISession::Usable, keyId(1)));
+    EXPECT_TRUE(updated == keyId(1));
+    EXPECT_TRUE(keys.HasKeyId(keyId(1)));
+    EXPECT_EQ(::OCDM::ISession::Usable, keys.Status(keyId(1)));
+    EXPECT_EQ(::OCDM::ISession::StatusPending, keys.Status(keyId(2)));
+
+    keys.UpdateKeyStatus(::OCDM::ISession::Expired, keyId(1));
+    EXPECT_EQ(::OCDM::ISession::Expired, keys.Status(keyId(1)));
+}
+
+// The CDM reports key statuses from its own thread while decrypt and RPC threads look keys up,
+// adding keys grows the table underneath the readers.
+TEST(OpenCDMiTest, concurrentKeyStatusUpdates) {
+    const uint16_t count = 2000;
+
+    CommonEncryptionData initData(nullptr, 0);
+    SessionKeyIds keys(initData);
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> lookups(0);
+
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 3; reader++) {
+        readers.emplace_back([&keys, &done, &lookups, count]() {
+            uint16_t number = 0;
+            while (done == false) {
+                const CommonEncryptionData::KeyId key(keyId(number));
+                if (keys.HasKeyId(key) == true) {
+                    EXPECT_EQ(::OCDM::ISession::Usable, keys.Status(key));
+                }
+                keys.Status();
+                number = (number + 1) % count;
+                lookups++;
+            }
+        });
+    }
+
+    for (uint16_t number = 0; number < count; number++) {
+        keys.UpdateKeyStatus(::OCDM::ISession::Usable, keyId(number));
+    }
+
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_GT(lookups, 0u);
+    for (uint16_t number = 0; number < count; number++) {
+        EXPECT_TRUE(keys.HasKeyId(keyId(number)));
+    }
+}
+
+// Init data corpus: PSSH boxes as found in MP4 'moov' and 'moof' boxes, PlayReady objects and
+// ClearKey JSON, built from their parts so the length fields can be broken on purpose.
+
+static const uint8_t CommonSystem[16] = { 0x10, 0x77, 0xef, 0xec, 0xc0, 0xb2, 0x4d, 0x02, 0xac, 0xe3, 0x3c, 0x1e, 0x52, 0xe2, 0xfb, 0x4b };
+static const uint8_t WidevineSystem[16] = { 0xed, 0xef, 0x8b, 0xa9, 0x79, 0xd6, 0x4a, 0xce, 0xa3, 0xc8, 0x27, 0xdc, 0xd5, 0x1d, 0x21, 0xed };
+static const uint8_t ClearKeySystem[16] = { 0x58, 0x14, 0x7e, 0xc8, 0x04, 0x23, 0x46, 0x59, 0x92, 0xe6, 0xf5, 0x2c, 0x5c, 0xe8, 0xc3, 0xcc };
+
+static std::vector<uint8_t> kid(const uint8_t number)
+{
+    std::vector<uint8_t> result(16, 0);
+    result[0] = 0x10;
+    result[15] = number;
+    return (result);
+}
+
+static void append32(std::vector<uint8_t>& data, const uint32_t value)
+{
+    data.push_back(static_cast<uint8_t>(value >> 24));
+    data.push_back(static_cast<uint8_t>(value >> 16));
+    data.push_back(static_cast<uint8_t>(value >> 8));
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+// Version 1 boxes list their key ids in the box itself, version 0 boxes only carry system specific data
+static std::vector<uint8_t> pssh(const uint8_t version, const uint8_t system[16], const std::vector<std::vector<uint8_t>>& kids,
+    const std::vector<uint8_t>& payload, const uint32_t kidCount = ~0u)
+{
+    std::vector<uint8_t> body;
+    append32(body, static_cast<uint32_t>(version) << 24);
+    body.insert(body.end(), system, system + 16);
+    if (version == 1) {
+        append32(body, (kidCount != ~0u ? kidCount : static_cast<uint32_t>(kids.size())));
+        for (const std::vector<uint8_t>& id : kids) {
+            body.insert(body.end(), id.begin(), id.end());
+        }
+    }
+    append32(body, static_cast<uint32_t>(payload.size()));
+    body.insert(body.end(), payload.begin(), payload.end());
+
+    std::vector<uint8_t> box;
+    append32(box, static_cast<uint32_t>(body.size() + 8));
+    box.insert(box.end(), { 'p', 's', 's', 'h' });
+    box.insert(box.end(), body.begin(), body.end());
+    return (box);
+}
+
+// Widevine keeps the key id in a protobuf: field 1 (algorithm) and field 2 (key id)
+static std::vector<uint8_t> widevineData(const std::vector<uint8_t>& id)
+{
+    std::vector<uint8_t> result({ 0x08, 0x01, 0x12, 0x10 });
+    result.insert(result.end(), id.begin(), id.end());
+    return (result);
+}
+
+static std::vector<uint16_t> keyNumbers(const CommonEncryptionData& data, const uint32_t system = 0)
+{
+    std::vector<uint16_t> result;
+    CommonEncryptionData::Iterator index(data.Keys());
+    while (index.Next() == true) {
+        if ((system == 0) || ((index.Current().Systems() & system) != 0)) {
+            result.push_back(index.Current().Id()[15]);
+        }
+    }
+    return (result);
+}
+
+static CommonEncryptionData parse(const std::vector<uint8_t>& data)
+{
+    return (CommonEncryptionData(data.data(), static_cast<uint16_t>(data.size())));
+}
+
+TEST(OpenCDMiTest, psshBoxes) {
+    // version 1 with several key ids
+    CommonEncryptionData common(parse(pssh(1, CommonSystem, { kid(1), kid(2), kid(3) }, {})));
+    EXPECT_EQ(std::vector<uint16_t>({ 1, 2, 3 }), keyNumbers(common));
+    EXPECT_EQ(std::vector<uint16_t>({ 1, 2, 3 }), keyNumbers(common, CommonEncryptionData::COMMON));
+
+    // version 0, the key id is in the system specific data
+    CommonEncryptionData widevine(parse(pssh(0, WidevineSystem, {}, widevineData(kid(4)))));
+    EXPECT_EQ(std::vector<uint16_t>({ 4 }), keyNumbers(widevine, CommonEncryptionData::WIDEVINE));
+
+    std::vector<uint8_t> raw(kid(5));
+    std::vector<uint8_t> more(kid(6));
+    raw.insert(raw.end(), more.begin(), more.end());
+    CommonEncryptionData clearKey(parse(pssh(0, ClearKeySystem, {}, raw)));
+    EXPECT_EQ(std::vector<uint16_t>({ 5, 6 }), keyNumbers(clearKey, CommonEncryptionData::CLEARKEY));
+
+    // several boxes, a key id in more than one of them is listed once for all its systems
+    std::vector<uint8_t> boxes(pssh(1, CommonSystem, { kid(1), kid(4) }, {}));
+    std::vector<uint8_t> second(pssh(0, WidevineSystem, {}, widevineData(kid(4))));
+    std::vector<uint8_t> third(pssh(1, CommonSystem, { kid(7) }, {}));
+    boxes.insert(boxes.end(), second.begin(), second.end());
+    boxes.insert(boxes.end(), third.begin(), third.end());
+    CommonEncryptionData all(parse(boxes));
+    EXPECT_EQ(std::vector<uint16_t>({ 1, 4, 7 }), keyNumbers(all));
+    EXPECT_EQ(std::vector<uint16_t>({ 4 }), keyNumbers(all, CommonEncryptionData::WIDEVINE));
+    EXPECT_FALSE(all.IsSupported(common));
+    EXPECT_TRUE(all.IsSupported(widevine));
+
+    // unknown systems are skipped
+    const uint8_t unknown[16] = { 0x01 };
+    EXPECT_TRUE(parse(pssh(1, unknown, { kid(1) }, {})).IsEmpty());
+}
+
+TEST(OpenCDMiTest, brokenPsshBoxes) {
+    std::vector<uint8_t> valid(pssh(1, CommonSystem, { kid(1), kid(2) }, {}));
+
+    // too short to hold a box size, or of size 0
+    EXPECT_TRUE(parse(std::vector<uint8_t>(valid.begin(), valid.begin() + 3)).IsEmpty());
+    EXPECT_TRUE(parse(std::vector<uint8_t>(8, 0)).IsEmpty());
+
+    // the size field points past the end of the data: the box is not looked into
+    EXPECT_TRUE(parse(std::vector<uint8_t>(valid.begin(), valid.end() - 1)).IsEmpty());
+    std::vector<uint8_t> oversized(valid);
+    oversized[0] = 0x7F;
+    EXPECT_TRUE(parse(oversized).IsEmpty());
+
+    // a box too short for its own header, followed by a valid one
+    std::vector<uint8_t> truncated({ 0x00, 0x00, 0x00, 0x0C, 'p', 's', 's', 'h', 0x01, 0x00, 0x00, 0x00 });
+    truncated.insert(truncated.end(), valid.begin(), valid.end());
+    EXPECT_EQ(std::vector<uint16_t>({ 1, 2 }), keyNumbers(parse(truncated)));
+
+    // the key id count, or the data size of a version 0 box, claims more than there is
+    EXPECT_EQ(std::vector<uint16_t>({ 1, 2 }), keyNumbers(parse(pssh(1, CommonSystem, { kid(1), kid(2) }, {}, 1000))));
+    EXPECT_EQ(std::vector<uint16_t>({ 1, 2 }), keyNumbers(parse(pssh(1, CommonSystem, { kid(1), kid(2) }, {}, 0x80000000))));
+    std::vector<uint8_t> raw(pssh(0, ClearKeySystem, {}, kid(5)));
+    raw[8 + 20] = 0xFF;
+    EXPECT_EQ(std::vector<uint16_t>({ 5 }), keyNumbers(parse(raw)));
+
+    // the box ends in the middle of a key id
+    std::vector<uint8_t> cut(pssh(1, CommonSystem, { kid(1), kid(2) }, {}));
+    cut.resize(cut.size() - 4 - 8);
+    cut[3] = static_cast<uint8_t>(cut.size());
+    EXPECT_EQ(std::vector<uint16_t>({ 1 }), keyNumbers(parse(cut)));
+}
+
+// PlayReady objects hold a UTF-16 WRM header, ClearKey init data is JSON
+TEST(OpenCDMiTest, xmlAndJsonInitData) {
+    const std::string xml("<WRMHEADER version=\"4.0.0.0\"><DATA><KID>EAAAAAAAAAAAAAAAAAAACQ==</KID></DATA></WRMHEADER>");
+    std::vector<uint8_t> record;
+    for (const char character : xml) {
+        record.push_back(static_cast<uint8_t>(character));
+        record.push_back(0);
+    }
+
+    // object size and record count, then record type and size, all little endian
+    std::vector<uint8_t> object;
+    const uint32_t size = static_cast<uint32_t>(record.size() + 10);
+    object.insert(object.end(), { static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8), 0x00, 0x00, 0x01, 0x00, 0x01, 0x00 });
+    object.push_back(static_cast<uint8_t>(record.size()));
+    object.push_back(static_cast<uint8_t>(record.size() >> 8));
+    object.insert(object.end(), record.begin(), record.end());
+
+    CommonEncryptionData playReady(parse(object));
+    ASSERT_EQ(1u, keyNumbers(playReady, CommonEncryptionData::PLAYREADY).size());
+    EXPECT_TRUE(playReady.HasKeyId(CommonEncryptionData::KeyId(CommonEncryptionData::COMMON, kid(9).data(), 16)));
+
+    // the record claims more than the object holds
+    object[8] = 0xFF;
+    object[9] = 0xFF;
+    EXPECT_TRUE(parse(object).IsEmpty());
+
+    const std::string json("{\"kids\":[\"EAAAAAAAAAAAAAAAAAAACw==\"]}");
+    CommonEncryptionData clearKey(parse(std::vector<uint8_t>(json.begin(), json.end())));
+    EXPECT_EQ(std::vector<uint16_t>({ 11 }), keyNumbers(clearKey, CommonEncryptionData::CLEARKEY));
+}
+
+TEST(OpenCDMiTest, sampleBatch) {
+    uint8_t buffer[512];
+    const uint8_t first[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    const uint8_t second[] = { 9, 10, 11 };
+    const uint32_t mapping[] = { 4, 4 };
+    const uint8_t iv[8] = { 0xAA };
+
+    SampleBatch::Writer writer(buffer, sizeof(buffer));
+    EXPECT_TRUE(writer.Add(first, sizeof(first), mapping, 2, iv, sizeof(iv), nullptr, 0, false));
+    EXPECT_TRUE(writer.Add(second, sizeof(second), nullptr, 0, nullptr, 0, nullptr, 0, true));
+    EXPECT_FALSE(writer.Add(buffer, sizeof(buffer), nullptr, 0, nullptr, 0, nullptr, 0, false));
+    EXPECT_EQ(2, writer.Samples());
+    EXPECT_TRUE(SampleBatch::IsBatch(buffer, writer.Length()));
+
+    SampleBatch::Reader reader(buffer, writer.Length());
+    EXPECT_TRUE(reader.IsValid());
+
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(sizeof(first), reader.Current().Length);
+    EXPECT_EQ(sizeof(iv), reader.Current().IVLength);
+    EXPECT_EQ(0, ::memcmp(reader.Data(), first, sizeof(first)));
+    uint32_t copied[2];
+    ::memcpy(copied, reader.Mapping(), sizeof(copied));
+    EXPECT_EQ(4u, copied[1]);
+    reader.Current().Status = 7;
+    reader.Store();
+
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(1, reader.Current().InitWithLast15);
+    EXPECT_EQ(0, ::memcmp(reader.Data(), second, sizeof(second)));
+
+    EXPECT_FALSE(reader.Next());
+    EXPECT_FALSE(reader.Malformed());
+
+    SampleBatch::Reader again(buffer, writer.Length());
+    ASSERT_TRUE(again.Next());
+    EXPECT_EQ(7u, again.Current().Status);
+}
+
+// A batch length shorter than the header, beyond the written data or samples running past
+// the batch are refused before anything is read from outside the batch.
+TEST(OpenCDMiTest, malformedSampleBatch) {
+    uint8_t buffer[256];
+    const uint8_t data[16] = {};
+
+    SampleBatch::Writer writer(buffer, sizeof(buffer));
+    EXPECT_TRUE(writer.Add(data, sizeof(data), nullptr, 0, nullptr, 0, nullptr, 0, false));
+    EXPECT_TRUE(writer.Add(data, sizeof(data), nullptr, 0, nullptr, 0, nullptr, 0, false));
+    const uint32_t length = writer.Length();
+
+    SampleBatch::Header header;
+    ::memcpy(&header, buffer, sizeof(header));
+
+    header.Length = 4;
+    ::memcpy(buffer, &header, sizeof(header));
+    SampleBatch::Reader shortHeader(buffer, length);
+    EXPECT_FALSE(shortHeader.IsValid());
+    EXPECT_FALSE(shortHeader.Next());
+
+    SampleBatch::Reader notWritten(buffer, sizeof(header) - 1);
+    EXPECT_FALSE(notWritten.IsValid());
+
+    header.Length = length + 1;
+    ::memcpy(buffer, &header, sizeof(header));
+    SampleBatch::Reader beyondWritten(buffer, length);
+    EXPECT_FALSE(beyondWritten.IsValid());
+
+    // the second sample is cut off
+    header.Length = length - 1;
+    ::memcpy(buffer, &header, sizeof(header));
+    SampleBatch::Reader cutOff(buffer, length);
+    EXPECT_TRUE(cutOff.IsValid());
+    EXPECT_TRUE(cutOff.Next());
+    EXPECT_FALSE(cutOff.Next());
+    EXPECT_TRUE(cutOff.Malformed());
+    EXPECT_EQ(1, cutOff.Index());
+
+    // more samples announced than there are
+    header.Length = length;
+    header.Samples = 3;
+    ::memcpy(buffer, &header, sizeof(header));
+    SampleBatch::Reader tooMany(buffer, length);
+    EXPECT_TRUE(tooMany.Next());
+    EXPECT_TRUE(tooMany.Next());
+    EXPECT_FALSE(tooMany.Next());
+    EXPECT_TRUE(tooMany.Malformed());
+}
+
+// Stands in for a ClearKey-like CDM: XORs the encrypted bytes of each subsample with the first IV byte,
+// in place, and refuses samples for key ids it does not have. 'grow' makes it return more clear data
+// than there was encrypted data.
+class XorDecryptor : public SampleBatch::Decryptor {
+public:
+    XorDecryptor()
+        : grow(false)
+        , failures()
+    {
+    }
+
+    uint32_t Decrypt(const SampleBatch::Sample& sample, const uint32_t mapping[], uint8_t data[], uint32_t& clearLength, uint8_t*& clearContent) override
+    {
+        if ((sample.KeyIdLength != 0) && (sample.KeyId[0] == 0xFF)) {
+            return (1);
+        }
+
+        // pairs of clear and encrypted byte counts, all of it encrypted without a mapping
+        uint32_t offset = 0;
+        for (uint32_t index = 0; index < std::max(sample.Mappings / 2, 1u); index++) {
+            uint32_t clear = (sample.Mappings != 0 ? mapping[index * 2] : 0);
+            uint32_t encrypted = (sample.Mappings != 0 ? mapping[(index * 2) + 1] : sample.Length);
+            offset += clear;
+            for (uint32_t end = std::min(offset + encrypted, sample.Length); offset < end; offset++) {
+                data[offset] ^= sample.IV[0];
+            }
+        }
+
+        clearLength = sample.Length + (grow ? 1 : 0);
+        clearContent = data;
+        return (0);
+    }
+
+    void Failed(const uint16_t index, const char[]) override
+    {
+        failures.push_back(index);
+    }
+
+    bool grow;
+    std::vector<uint16_t> failures;
+};
+
+// Runs batches through the decrypt loop of the session buffer with a stand-in CDM.
+TEST(OpenCDMiTest, decryptBatch) {
+    uint8_t buffer[512];
+    const uint8_t clear[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t encrypted[sizeof(clear)];
+    const uint8_t iv[1] = { 0x5A };
+    const uint8_t goodKey[1] = { 0x01 };
+    const uint8_t badKey[1] = { 0xFF };
+    // 2 clear bytes, 4 encrypted ones, 2 clear bytes without an encrypted part
+    const uint32_t mapping[] = { 2, 4, 2, 0 };
+
+    for (uint32_t index = 0; index < sizeof(clear); index++) {
+        encrypted[index] = clear[index] ^ iv[0];
+    }
+    uint8_t partial[sizeof(clear)];
+    ::memcpy(partial, clear, sizeof(clear));
+    for (uint32_t index = 2; index < 6; index++) {
+        partial[index] ^= iv[0];
+    }
+
+    SampleBatch::Writer writer(buffer, sizeof(buffer));
+    EXPECT_TRUE(writer.Add(encrypted, sizeof(encrypted), nullptr, 0, iv, sizeof(iv), goodKey, sizeof(goodKey), false));
+    EXPECT_TRUE(writer.Add(encrypted, sizeof(encrypted), nullptr, 0, iv, sizeof(iv), badKey, sizeof(badKey), false));
+    EXPECT_TRUE(writer.Add(partial, sizeof(partial), mapping, 4, iv, sizeof(iv), goodKey, sizeof(goodKey), false));
+
+    XorDecryptor cdm;
+    SampleBatch::Statistics statistics;
+    std::vector<uint32_t> scratch;
+
+    // the overall status is that of the first failing sample, the others are decrypted regardless
+    EXPECT_EQ(1u, SampleBatch::Decrypt(buffer, writer.Length(), cdm, 99, scratch, statistics));
+    EXPECT_EQ(3u, statistics.Samples);
+    EXPECT_EQ(3u * sizeof(clear), statistics.Bytes);
+    EXPECT_EQ(1u, statistics.Failures);
+    EXPECT_TRUE(cdm.failures.empty());
+
+    SampleBatch::Reader reader(buffer, writer.Length());
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(0u, reader.Current().Status);
+    EXPECT_EQ(sizeof(clear), reader.Current().ClearLength);
+    EXPECT_EQ(0, ::memcmp(reader.Data(), clear, sizeof(clear)));
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(1u, reader.Current().Status);
+    EXPECT_EQ(0, ::memcmp(reader.Data(), encrypted, sizeof(encrypted)));
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(0u, reader.Current().Status);
+    EXPECT_EQ(0, ::memcmp(reader.Data(), clear, sizeof(clear)));
+    EXPECT_FALSE(reader.Next());
+
+    // clear data that does not fit in place is refused
+
+    SampleBatch::Writer again(buffer, sizeof(buffer));
+    EXPECT_TRUE(again.Add(encrypted, sizeof(encrypted), nullptr, 0, iv, sizeof(iv), goodKey, sizeof(goodKey), false));
+    cdm.grow = true;
+    statistics = SampleBatch::Statistics();
+    EXPECT_EQ(99u, SampleBatch::Decrypt(buffer, again.Length(), cdm, 99, scratch, statistics));
+    EXPECT_EQ(1u, statistics.Failures);
+    EXPECT_EQ(std::vector<uint16_t>({ 0 }), cdm.failures);
+
+    // a broken batch reaches the CDM only up to the broken sample
+
+    cdm.grow = false;
+    cdm.failures.clear();
+    statistics = SampleBatch::Statistics();
+    EXPECT_EQ(99u, SampleBatch::Decrypt(buffer, sizeof(SampleBatch::Header) - 1, cdm, 99, scratch, statistics));
+    EXPECT_EQ(0u, statistics.Samples);
+    EXPECT_EQ(1u, statistics.Failures);
+
+    SampleBatch::Header header;
+    ::memcpy(&header, buffer, sizeof(header));
+    header.Samples = 2;
+    ::memcpy(buffer, &header, sizeof(header));
+    statistics = SampleBatch::Statistics();
+    EXPECT_EQ(99u, SampleBatch::Decrypt(buffer, again.Length(), cdm, 99, scratch, statistics));
+    EXPECT_EQ(1u, statistics.Samples);
+    EXPECT_EQ(1u, statistics.Failures);
+    EXPECT_EQ(std::vector<uint16_t>({ 0, 1 }), cdm.failures);
+}
+
+// Offline throughput of the batched decrypt loop with the stand-in CDM, recorded as test properties.
+// The cross process handshake is not part of it, a batch saves all but one of those per batch.
+TEST(OpenCDMiTest, decryptBatchThroughput) {
+    const uint32_t sampleSize = 4096;
+    const uint16_t batchSize = 32;
+    const uint32_t batches = 2000;
+
+    std::vector<uint8_t> buffer(batchSize * (sampleSize + sizeof(SampleBatch::Sample)) + sizeof(SampleBatch::Header));
+    std::vector<uint8_t> data(sampleSize, 0xA5);
+    const uint8_t iv[1] = { 0x5A };
+
+    SampleBatch::Writer writer(buffer.data(), static_cast<uint32_t>(buffer.size()));
+    for (uint16_t index = 0; index < batchSize; index++) {
+        EXPECT_TRUE(writer.Add(data.data(), sampleSize, nullptr, 0, iv, sizeof(iv), nullptr, 0, false));
+    }
+
+    XorDecryptor cdm;
+    SampleBatch::Statistics statistics;
+    std::vector<uint32_t> scratch;
+    uint64_t start = WPEFramework::Core::Time::Now().Ticks();
+
+    for (uint32_t index = 0; index < batches; index++) {
+        EXPECT_EQ(0u, SampleBatch::Decrypt(buffer.data(), writer.Length(), cdm, 1, scratch, statistics));
+    }
+
+    uint64_t ticks = std::max<uint64_t>(WPEFramework::Core::Time::Now().Ticks() - start, 1);
+
+    EXPECT_EQ(static_cast<uint64_t>(batches) * batchSize, statistics.Samples);
+    EXPECT_EQ(0u, statistics.Failures);
+    RecordProperty("BatchDecryptSamplesPerSecond", static_cast<int>((statistics.Samples * 1000000) / ticks));
+    RecordProperty("BatchDecryptMBPerSecond", static_cast<int>(statistics.Bytes / ticks));
+}
+
+} // namespace RdkServicesTest
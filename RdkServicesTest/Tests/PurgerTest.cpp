@@ -0,0 +1,187 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "gtest/gtest.h"
+
+#include "Purger.h"
+
+#include <fstream>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace WPEFramework::Plugin;
+
+namespace RdkServicesTest {
+
+// A data directory to reset and one next to it that must survive
+class PurgerTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        char path[] = "/tmp/PurgerTestXXXXXX";
+        ASSERT_TRUE(mkdtemp(path) != nullptr);
+        root = path;
+
+        ASSERT_EQ(0, mkdir((root + "/data").c_str(), 0755));
+        ASSERT_EQ(0, mkdir((root + "/data/sub").c_str(), 0755));
+        ASSERT_EQ(0, mkdir((root + "/keep").c_str(), 0755));
+        create("data/file");
+        create("data/sub/file");
+        create("keep/file");
+    }
+
+    void TearDown() override
+    {
+        ASSERT_EQ(0, system(("rm -rf " + root).c_str()));
+    }
+
+    void create(const std::string& name)
+    {
+        std::ofstream file(root + '/' + name);
+        file << "data";
+    }
+
+    bool exists(const std::string& name)
+    {
+        struct stat st;
+        return (lstat((root + '/' + name).c_str(), &st) == 0);
+    }
+
+    std::string root;
+};
+
+TEST_F(PurgerTest, resolve) {
+    std::string path;
+
+    unsetenv("PURGER_TEST_DIR");
+    EXPECT_FALSE(Purger::resolve("PURGER_TEST_DIR/*", path));
+    EXPECT_TRUE(Purger::resolve("PURGER_TEST_DIR/*", path, { { "PURGER_TEST_DIR", "/tmp/test" } }));
+    EXPECT_EQ("/tmp/test/*", path);
+
+    // empty does not mean the root directory
+    setenv("PURGER_TEST_DIR", "", 1);
+    EXPECT_FALSE(Purger::resolve("PURGER_TEST_DIR/*", path));
+
+    setenv("PURGER_TEST_DIR", "/", 1);
+    EXPECT_FALSE(Purger::resolve("PURGER_TEST_DIR", path));
+    EXPECT_FALSE(Purger::resolve("PURGER_TEST_DIR/*", path));
+    EXPECT_FALSE(Purger::resolve("PURGER_TEST_DIR//", path));
+
+    setenv("PURGER_TEST_DIR", "/opt/data", 1);
+    EXPECT_TRUE(Purger::resolve("PURGER_TEST_DIR/*", path, { { "PURGER_TEST_DIR", "/tmp/test" } }));
+    EXPECT_EQ("/opt/data/*", path);
+    unsetenv("PURGER_TEST_DIR");
+
+    EXPECT_FALSE(Purger::resolve("/", path));
+    EXPECT_FALSE(Purger::resolve("/*", path));
+    EXPECT_FALSE(Purger::resolve("relative/*", path));
+    EXPECT_FALSE(Purger::resolve("", path));
+    EXPECT_TRUE(Purger::resolve("/opt/logs/*", path));
+    EXPECT_EQ("/opt/logs/*", path);
+}
+
+TEST_F(PurgerTest, purge) {
+    Purger dryRun(true, 2);
+    dryRun.add(root + "/data/*");
+    EXPECT_EQ(2u, dryRun.paths().size());
+    Purger::Result result = dryRun.run();
+    EXPECT_EQ(3u, result.files);
+    EXPECT_EQ(0u, result.failures);
+    EXPECT_TRUE(exists("data/sub/file"));
+
+    uint32_t reports = 0;
+    Purger purger(false, 2);
+    purger.add(root + "/data/*");
+    purger.add(root + "/missing/*");
+    result = purger.run([&reports](uint32_t completed, uint32_t count, const Purger::Result&) {
+        EXPECT_LE(completed, count);
+        reports++;
+    });
+    EXPECT_EQ(3u, result.files);
+    EXPECT_EQ(0u, result.failures);
+    EXPECT_GE(reports, 1u);
+    EXPECT_TRUE(exists("data"));
+    EXPECT_FALSE(exists("data/sub"));
+    EXPECT_TRUE(exists("keep/file"));
+}
+
+// Paths naming the root directory, "." or ".." are refused, even when they reach the purger
+TEST_F(PurgerTest, refused) {
+    Purger purger(true);
+    purger.add("/");
+    purger.add("///");
+    purger.add(root + "/data/sub/..");
+    purger.add(root + "/data/.");
+    ASSERT_EQ(4u, purger.paths().size());
+
+    Purger::Result result = purger.run();
+    EXPECT_EQ(0u, result.files);
+    EXPECT_EQ(4u, result.failures);
+    EXPECT_EQ(0u, result.denied);
+    EXPECT_TRUE(exists("data/sub/file"));
+}
+
+// Failures for lack of permission are told apart, the Warehouse leaves these to a privileged script
+TEST_F(PurgerTest, denied) {
+    if (0 == geteuid()) {
+        GTEST_SKIP() << "root may remove anything";
+    }
+    ASSERT_EQ(0, chmod((root + "/data/sub").c_str(), 0555));
+
+    Purger purger(false);
+    purger.add(root + "/data");
+    Purger::Result result = purger.run();
+    EXPECT_EQ(0, chmod((root + "/data/sub").c_str(), 0755));
+
+    // the file in data/sub is denied, data/sub and data then are not empty
+    EXPECT_EQ(3u, result.failures);
+    EXPECT_EQ(1u, result.denied);
+    EXPECT_EQ(1u, result.files);
+    EXPECT_TRUE(exists("data/sub/file"));
+    EXPECT_FALSE(exists("data/file"));
+}
+
+// Symbolic links are removed, what they point to is left alone
+TEST_F(PurgerTest, symlinks) {
+    ASSERT_EQ(0, symlink((root + "/keep").c_str(), (root + "/data/dir").c_str()));
+    ASSERT_EQ(0, symlink((root + "/keep/file").c_str(), (root + "/data/sub/link").c_str()));
+
+    Purger purger(false);
+    purger.add(root + "/data/dir");
+    purger.add(root + "/data/sub");
+    Purger::Result result = purger.run();
+    EXPECT_EQ(4u, result.files);
+    EXPECT_EQ(0u, result.failures);
+    EXPECT_FALSE(exists("data/dir"));
+    EXPECT_FALSE(exists("data/sub"));
+    EXPECT_TRUE(exists("keep/file"));
+
+    // a trailing slash does not make it follow the link
+    ASSERT_EQ(0, symlink((root + "/keep").c_str(), (root + "/data/dir").c_str()));
+    Purger again(false);
+    again.add(root + "/data/dir/");
+    result = again.run();
+    EXPECT_EQ(1u, result.files);
+    EXPECT_FALSE(exists("data/dir"));
+    EXPECT_TRUE(exists("keep/file"));
+}
+
+} // namespace RdkServicesTest
@@ -20,6 +20,7 @@
 #include "gtest/gtest.h"
 
 #include "SecurityAgent.h"
+#include "AccessControlList.h"
 
 #include "Source/WorkerPoolImplementation.h"
 #include "Source/Config.h"
@@ -109,4 +110,94 @@ TEST(SecurityAgentTest, test) {
     _engine.Release();
 }
 
+TEST(SecurityAgentTest, accessControlList) {
+    WPEFramework::Plugin::AccessControlList acl;
+
+    WPEFramework::Core::File aclFile(string("../SecurityAgent/example_acl.json"), false);
+    EXPECT_TRUE(aclFile.Open(true));
+    EXPECT_EQ(WPEFramework::Core::ERROR_NONE, acl.Load(aclFile));
+
+    // url to role
+
+    const WPEFramework::Plugin::AccessControlList::Filter* local = acl.FilterMapFromURL(_T("http://localhost:9998/index.html"));
+    const WPEFramework::Plugin::AccessControlList::Filter* comcast = acl.FilterMapFromURL(_T("https://apps.comcast.com/?x=1"));
+    const WPEFramework::Plugin::AccessControlList::Filter* metrological = acl.FilterMapFromURL(_T("https://metrological.com#top"));
+
+    ASSERT_TRUE(local != nullptr);
+    ASSERT_TRUE(comcast != nullptr);
+    ASSERT_TRUE(metrological != nullptr);
+    EXPECT_TRUE(acl.FilterMapFromURL(_T("file:///tmp/index.html")) == nullptr);
+    EXPECT_TRUE(acl.FilterMapFromURL(_T("https://comcast.com.evil.org")) == nullptr);
+
+    // role to decision
+
+    EXPECT_TRUE(local->Allowed(_T("org.rdk.System"), _T("reboot")));
+    EXPECT_TRUE(comcast->Allowed(_T("Compositor"), _T("putontop")));
+    EXPECT_FALSE(comcast->Allowed(_T("DeviceInfo"), _T("systeminfo")));
+    EXPECT_FALSE(metrological->Allowed(_T("DeviceInfo"), _T("register")));
+    EXPECT_TRUE(metrological->Allowed(_T("DeviceInfo"), _T("systeminfo")));
+    EXPECT_TRUE(metrological->Allowed(_T("JSONRPCPlugin"), _T("time")));
+    EXPECT_FALSE(metrological->Allowed(_T("JSONRPCPlugin"), _T("echo")));
+    // callsigns match anywhere in the name, as shipped ACLs expect, so "DeviceInfo" covers this one too
+    EXPECT_TRUE(metrological->Allowed(_T("MyDeviceInfo"), _T("systeminfo")));
+    EXPECT_FALSE(metrological->Allowed(_T("MyDeviceInfo"), _T("unregister")));
+    EXPECT_FALSE(metrological->Allowed(_T("Monitor"), _T("status")));
+
+    // cached decisions have to be stable
+
+    const uint32_t iterations = 100000;
+    uint32_t allowed = 0;
+    uint64_t start = WPEFramework::Core::Time::Now().Ticks();
+
+    for (uint32_t index = 0; index < iterations; index++) {
+        const WPEFramework::Plugin::AccessControlList::Filter* filter = acl.FilterMapFromURL(_T("https://metrological.com"));
+        if ((filter != nullptr) && (filter->Allowed(_T("DeviceInfo"), _T("systeminfo")) == true) && (filter->Allowed(_T("JSONRPCPlugin"), _T("status")) == true)) {
+            allowed++;
+        }
+    }
+
+    RecordProperty("ACLCheckNanoseconds", static_cast<int>(((WPEFramework::Core::Time::Now().Ticks() - start) * 1000) / iterations));
+    EXPECT_EQ(iterations, allowed);
+}
+
+TEST(SecurityAgentTest, aclPatterns) {
+    typedef WPEFramework::Plugin::AccessControlList::Pattern Pattern;
+
+    // names match anywhere, regex anchors work as they always did
+
+    EXPECT_TRUE(Pattern::Name(_T("register")).IsLiteral());
+    EXPECT_TRUE(Pattern::Name(_T("register")).Matches(_T("register")));
+    EXPECT_TRUE(Pattern::Name(_T("register")).Matches(_T("unregister")));
+    EXPECT_FALSE(Pattern::Name(_T("org.rdk")).Matches(_T("orgXrdk")));
+
+    EXPECT_FALSE(Pattern::Name(_T("^register$")).IsLiteral());
+    EXPECT_TRUE(Pattern::Name(_T("^register$")).Matches(_T("register")));
+    EXPECT_FALSE(Pattern::Name(_T("^register$")).Matches(_T("unregister")));
+    EXPECT_TRUE(Pattern::Name(_T("^reg")).Matches(_T("register")));
+    EXPECT_FALSE(Pattern::Name(_T("^reg")).Matches(_T("unregister")));
+    EXPECT_FALSE(Pattern::Name(_T("ister$")).Matches(_T("registered")));
+
+    // '*' stands for a whole name, so only a lone wildcard matches anything
+
+    EXPECT_TRUE(Pattern::Name(_T("*")).Matches(_T("org.rdk.System")));
+    EXPECT_FALSE(Pattern::Name(_T("*")).Matches(_T("org_rdk")));
+    EXPECT_FALSE(Pattern::Name(_T("org.rdk.*")).Matches(_T("org.rdk.System")));
+    EXPECT_FALSE(Pattern::Name(_T("*Info")).Matches(_T("DeviceInfo")));
+    EXPECT_FALSE(Pattern::Name(_T("a*b")).Matches(_T("axb")));
+
+    // an invalid expression matches nothing
+
+    EXPECT_FALSE(Pattern::Name(_T("(")).Matches(_T("(")));
+
+    // origins always match as a whole
+
+    EXPECT_TRUE(Pattern::URL(_T("*://localhost:*")).Matches(_T("http://localhost:9998")));
+    EXPECT_FALSE(Pattern::URL(_T("*://localhost:*")).Matches(_T("http://localhost")));
+    EXPECT_TRUE(Pattern::URL(_T("*://*.comcast.com")).Matches(_T("https://apps.comcast.com")));
+    EXPECT_FALSE(Pattern::URL(_T("*://*.comcast.com")).Matches(_T("https://apps.comcast.com.evil.org")));
+    EXPECT_TRUE(Pattern::URL(_T("*://[::1]:*")).Matches(_T("http://[::1]:80")));
+    EXPECT_TRUE(Pattern::URL(_T("http://a.com")).IsLiteral());
+    EXPECT_FALSE(Pattern::URL(_T("http://a.com")).Matches(_T("http://a.com.evil.org")));
+}
+
 } // namespace RdkServicesTest
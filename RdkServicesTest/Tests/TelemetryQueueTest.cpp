@@ -0,0 +1,110 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "gtest/gtest.h"
+
+#include "TelemetryQueue.h"
+
+#include <fstream>
+
+namespace RdkServicesTest {
+
+static std::vector<std::string> readLines(const std::string& name)
+{
+    std::ifstream file(name);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+TEST(TelemetryQueueTest, test) {
+    const std::string sink("TelemetryQueueTest.txt");
+    remove(sink.c_str());
+
+    // long window, everything is sent by flush
+
+    Utils::TelemetryQueue& queue = Utils::TelemetryQueue::instance();
+    queue.configure(sink, 60000, 3);
+
+    EXPECT_TRUE(queue.isEnabled());
+
+    // identical errors are counted
+
+    for (int i = 0; i < 1000; i++) {
+        queue.post("source1", "THUNDER_ERROR", "same error");
+    }
+
+    // a source can add a limited number of different errors
+
+    for (int i = 0; i < 10; i++) {
+        queue.post("source2", "THUNDER_ERROR", "error " + std::to_string(i));
+    }
+
+    // events are neither merged nor limited
+
+    for (int i = 0; i < 5; i++) {
+        queue.postEvent("APP_EVENT", "42");
+    }
+    queue.postEvent("THUNDER_MESSAGE", "message");
+
+    queue.flush();
+
+    std::vector<std::string> lines(readLines(sink));
+
+    ASSERT_EQ(12u, lines.size());
+    EXPECT_EQ("THUNDER_ERROR\tsame error", lines[0]);
+    EXPECT_EQ("THUNDER_ERROR_COUNT\t1000", lines[1]);
+    EXPECT_EQ("THUNDER_ERROR\terror 0", lines[2]);
+    EXPECT_EQ("THUNDER_ERROR\terror 1", lines[3]);
+    EXPECT_EQ("THUNDER_ERROR\terror 2", lines[4]);
+    for (size_t i = 5; i < 10; i++) {
+        EXPECT_EQ("APP_EVENT\t42", lines[i]);
+    }
+    EXPECT_EQ("THUNDER_MESSAGE\tmessage", lines[10]);
+    EXPECT_EQ("THUNDER_TELEMETRY_DROPPED\t7", lines[11]);
+
+    // clean up
+
+    queue.configure(std::string(), 0, Utils::TelemetryQueue::defaultSourceLimit);
+    remove(sink.c_str());
+}
+
+// The worker ends after an empty window and is started again by the next marker
+TEST(TelemetryQueueTest, idleWorker) {
+    const std::string sink("TelemetryQueueIdleTest.txt");
+    remove(sink.c_str());
+
+    Utils::TelemetryQueue& queue = Utils::TelemetryQueue::instance();
+    queue.configure(sink, 20, Utils::TelemetryQueue::defaultSourceLimit);
+
+    queue.postEvent("APP_EVENT", "1");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    queue.postEvent("APP_EVENT", "2");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    EXPECT_EQ(std::vector<std::string>({ "APP_EVENT\t1", "APP_EVENT\t2" }), readLines(sink));
+
+    queue.configure(std::string(), 0, Utils::TelemetryQueue::defaultSourceLimit);
+    remove(sink.c_str());
+}
+
+} // namespace RdkServicesTest
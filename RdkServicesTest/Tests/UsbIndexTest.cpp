@@ -0,0 +1,165 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "gtest/gtest.h"
+
+#include "UsbIndex.h"
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace WPEFramework::Plugin;
+
+namespace RdkServicesTest {
+
+// A volume with a few files and folders below a temporary directory
+class UsbIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        char path[] = "/tmp/UsbIndexTestXXXXXX";
+        ASSERT_TRUE(mkdtemp(path) != nullptr);
+        root = path;
+
+        ASSERT_EQ(0, mkdir((root + "/pages").c_str(), 0755));
+        ASSERT_EQ(0, mkdir((root + "/pages/deep").c_str(), 0755));
+        create("logs.txt", 3);
+        create("image.BIN", 10);
+        create("pages/index.html", 5);
+        create("pages/deep/image2.bin", 7);
+    }
+
+    void TearDown() override
+    {
+        ASSERT_EQ(0, system(("rm -rf " + root).c_str()));
+    }
+
+    void create(const std::string& name, size_t size)
+    {
+        std::ofstream file(root + '/' + name);
+        file << std::string(size, 'x');
+    }
+
+    static std::vector<std::string> names(const std::vector<UsbIndex::Entry>& entries)
+    {
+        std::vector<std::string> result;
+        for (const UsbIndex::Entry& entry : entries) {
+            result.push_back(entry.name + ':' + entry.type);
+        }
+        return result;
+    }
+
+    // Changes come in from the indexer thread
+    static bool waitFor(const UsbIndex& index, const std::string& path, const UsbIndex::Filter& filter, size_t count)
+    {
+        for (int i = 0; i < 500; i++) {
+            std::vector<UsbIndex::Entry> entries;
+            uint32_t total = 0;
+            if (index.ready() && index.query(path, filter, 0, 0, entries, total) && (entries.size() == count)) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    std::string root;
+};
+
+TEST_F(UsbIndexTest, scan) {
+    UsbIndex::Filter filter;
+    std::vector<UsbIndex::Entry> entries;
+    uint32_t total = 0;
+
+    // "." and ".." are listed as folders, like readdir() does
+    EXPECT_TRUE(UsbIndex::scan(root, filter, 0, 0, entries, total));
+    EXPECT_EQ(std::vector<std::string>({ ".:d", "..:d", "image.BIN:f", "logs.txt:f", "pages:d" }), names(entries));
+    EXPECT_EQ(5u, total);
+    EXPECT_EQ(10u, entries[2].size);
+
+    EXPECT_TRUE(UsbIndex::scan(root, filter, 2, 2, entries, total));
+    EXPECT_EQ(std::vector<std::string>({ "image.BIN:f", "logs.txt:f" }), names(entries));
+    EXPECT_EQ(5u, total);
+
+    // only the scanned directory has "." and ".."
+    filter.recursive = true;
+    EXPECT_TRUE(UsbIndex::scan(root, filter, 0, 0, entries, total));
+    EXPECT_EQ(std::vector<std::string>({ ".:d", "..:d", "image.BIN:f", "logs.txt:f", "pages:d",
+        "pages/deep:d", "pages/index.html:f", "pages/deep/image2.bin:f" }), names(entries));
+
+    filter.includeFolders = false;
+    filter.extensions = { "bin" };
+    EXPECT_TRUE(UsbIndex::scan(root, filter, 0, 0, entries, total));
+    EXPECT_EQ(std::vector<std::string>({ "image.BIN:f", "pages/deep/image2.bin:f" }), names(entries));
+
+    filter.extensions.clear();
+    filter.setRegex(".*\\.html");
+    EXPECT_TRUE(UsbIndex::scan(root, filter, 0, 0, entries, total));
+    EXPECT_EQ(std::vector<std::string>({ "pages/index.html:f" }), names(entries));
+
+    EXPECT_FALSE(UsbIndex::scan(root + "/missing", filter, 0, 0, entries, total));
+}
+
+TEST_F(UsbIndexTest, index) {
+    UsbIndex index(root + '/');
+    UsbIndex::Filter filter;
+    std::vector<UsbIndex::Entry> entries;
+    uint32_t total = 0;
+
+    EXPECT_FALSE(index.ready());
+    index.start();
+    ASSERT_TRUE(waitFor(index, "", filter, 5));
+
+    EXPECT_TRUE(index.query("pages/", filter, 0, 0, entries, total));
+    EXPECT_EQ(std::vector<std::string>({ ".:d", "..:d", "deep:d", "index.html:f" }), names(entries));
+
+    // paths leaving the volume are refused
+    EXPECT_FALSE(index.query("..", filter, 0, 0, entries, total));
+    EXPECT_FALSE(index.query("pages/../..", filter, 0, 0, entries, total));
+    EXPECT_FALSE(index.query("missing", filter, 0, 0, entries, total));
+
+    // changes are picked up, also in a folder created after the index was built
+
+    create("new.bin", 1);
+    ASSERT_EQ(0, mkdir((root + "/added").c_str(), 0755));
+    EXPECT_TRUE(waitFor(index, "", filter, 7));
+    create("added/inside.bin", 2);
+    EXPECT_TRUE(waitFor(index, "added", filter, 3));
+
+    ASSERT_EQ(0, unlink((root + "/logs.txt").c_str()));
+    ASSERT_EQ(0, rename((root + "/pages").c_str(), (root + "/moved").c_str()));
+    EXPECT_TRUE(waitFor(index, "moved/deep", filter, 3));
+    EXPECT_FALSE(index.query("pages", filter, 0, 0, entries, total));
+
+    filter.recursive = true;
+    filter.includeFolders = false;
+    EXPECT_TRUE(index.query("", filter, 0, 0, entries, total));
+    EXPECT_EQ(std::vector<std::string>({ "image.BIN:f", "new.bin:f", "added/inside.bin:f",
+        "moved/index.html:f", "moved/deep/image2.bin:f" }), names(entries));
+
+    index.stop();
+    EXPECT_FALSE(index.ready());
+}
+
+} // namespace RdkServicesTest
@@ -22,6 +22,7 @@
 #include "Module.h"
 
 #include <regex>
+#include <unordered_map>
 
 // helper functions
 namespace {
@@ -265,6 +266,93 @@ namespace Plugin {
         };
 
     public:
+        // Patterns from the ACL are compiled once, at load time, with the same regular expressions
+        // that used to be built on every check:
+        //   callsigns/methods: '.' is literal, '*' -> ^[a-zA-Z0-9.]+$, searched for anywhere in the name
+        //   urls:              '*:' -> [a-z]+, ':*' -> [0-9]+, any other '*' -> [a-zA-Z0-9.-]+, whole origin
+        // Anything else regex syntax, like '^' and '$', keeps its regex meaning. Entries without any
+        // of it skip the regex: a literal callsign or method is found as a substring, so "register"
+        // also allows "unregister", a literal origin is compared as a whole.
+        class Pattern {
+        public:
+            Pattern(const Pattern&) = default;
+            Pattern& operator=(const Pattern&) = default;
+            ~Pattern()
+            {
+            }
+
+            static Pattern Name(const string& input)
+            {
+                Pattern result(input, false);
+
+                if (result._literal == false) {
+                    result.Compile(CreateRegex(input));
+                }
+
+                return (result);
+            }
+            static Pattern URL(const string& input)
+            {
+                Pattern result(input, true);
+
+                if (result._literal == false) {
+                    result.Compile(CreateUrlRegex(input));
+                }
+
+                return (result);
+            }
+
+        public:
+            inline bool IsLiteral() const
+            {
+                return (_literal);
+            }
+            inline const string& Text() const
+            {
+                return (_text);
+            }
+            inline bool Matches(const string& input) const
+            {
+                bool result;
+
+                if (_literal == false) {
+                    result = std::regex_search(input, _expression);
+                } else if (_whole == true) {
+                    result = (input == _text);
+                } else {
+                    result = (input.find(_text) != string::npos);
+                }
+
+                return (result);
+            }
+
+        private:
+            Pattern(const string& input, const bool whole)
+                : _text(input)
+                , _whole(whole)
+                , _literal(input.find_first_of(_T("\\^$|?*+()[]{}")) == string::npos)
+                , _expression()
+            {
+            }
+
+            void Compile(const string& expression)
+            {
+                try {
+                    _expression = std::regex(expression);
+                } catch (const std::regex_error&) {
+                    // Matches nothing, as the entry never could
+                    SYSLOG(Logging::ParsingError, (_T("Invalid ACL entry %s"), _text.c_str()));
+                    _expression = std::regex(_T("[^\\s\\S]"));
+                }
+            }
+
+        private:
+            string _text;
+            bool _whole;
+            bool _literal;
+            std::regex _expression;
+        };
+
         class Filter {
         private:
             class Plugin {
@@ -278,8 +366,7 @@ namespace Plugin {
                     , _methods() {
                     Core::JSON::ArrayType<Core::JSON::String>::ConstIterator index(rules.Methods.Elements());
                     while (index.Next() == true) {
-                        string str = index.Current().Value();
-                        _methods.emplace_back(CreateRegex(str));
+                        _methods.push_back(Pattern::Name(index.Current().Value()));
                     }
                 }
                 ~Plugin() {
@@ -290,24 +377,31 @@ namespace Plugin {
                 {
                     bool found = false;
 
-                    std::list<string>::const_iterator index(_methods.begin());
+                    std::list<Pattern>::const_iterator index(_methods.begin());
 
                     while ((index != _methods.end()) && (found == false)) { 
-                        std::regex expression(index->c_str());
-                        std::smatch matchList;
-                        found = std::regex_search(method, matchList, expression);
-                        if (found == false) {
-                            index++;
-                        }
+                        found = index->Matches(method);
+                        index++;
                     }
                     return !(_defaultBlocked ^ found);
                 }
 
             private:
                 bool _defaultBlocked;
-                std::list<string> _methods;
+                std::list<Pattern> _methods;
             };
 
+            struct DecisionHash {
+                size_t operator()(const std::pair<string, string>& key) const
+                {
+                    return (std::hash<string>()(key.first) ^ (std::hash<string>()(key.second) * 31));
+                }
+            };
+
+            // Decisions are cached per callsign/method pair. Once the cache is full it is simply
+            // dropped, the set of callsign/method pairs used on a box is small.
+            static constexpr uint16_t MaxDecisions = 256;
+
         public:
             Filter() = delete;
             Filter(const Filter&) = delete;
@@ -316,13 +410,17 @@ namespace Plugin {
             Filter(const JSONACL::Plugins& plugins)
                 : _defaultBlocked(plugins.Default.Value() == mode::BLOCKED)
                 , _plugins()
+                , _adminLock()
+                , _decisions()
             {
                 JSONACL::Plugins::Iterator index(plugins.Elements());
           
+                // Sorted by callsign entry, as they come from the JSON map, the first entry that
+                // matches decides
                 while (index.Next() == true) {
-                    _plugins.emplace(std::piecewise_construct,
-                            std::forward_as_tuple(CreateRegex(index.Key())),
-                            std::forward_as_tuple(index.Current()));
+                    _plugins.emplace_back(std::piecewise_construct,
+                        std::forward_as_tuple(Pattern::Name(index.Key())),
+                        std::forward_as_tuple(index.Current()));
                 }
             }
             ~Filter()
@@ -330,29 +428,58 @@ namespace Plugin {
             }
 
         public:
-            bool Allowed(const string callsign, const string& method) const
+            bool Allowed(const string& callsign, const string& method) const
+            {
+                bool result;
+                std::pair<string, string> key(callsign, method);
+
+                _adminLock.Lock();
+
+                DecisionMap::const_iterator cached(_decisions.find(key));
+
+                if (cached != _decisions.end()) {
+                    result = cached->second;
+                } else {
+                    result = Evaluate(callsign, method);
+
+                    if (_decisions.size() >= MaxDecisions) {
+                        _decisions.clear();
+                    }
+                    _decisions.emplace(std::move(key), result);
+                }
+
+                _adminLock.Unlock();
+
+                return (result);
+            }
+
+        private:
+            using DecisionMap = std::unordered_map<std::pair<string, string>, bool, DecisionHash>;
+
+            bool Evaluate(const string& callsign, const string& method) const
             {
-                bool pluginFound = false;
-
-                std::map<string, Plugin>::const_iterator index(_plugins.begin());
-                while ((index != _plugins.end()) && (pluginFound == false)) {
-                    std::regex expression(index->first.c_str());
-                    std::smatch matchList;
-                    pluginFound = std::regex_search(callsign, matchList, expression);
-                    if (pluginFound == false) {
+                const Plugin* plugin = nullptr;
+
+                std::list<std::pair<Pattern, Plugin>>::const_iterator index(_plugins.begin());
+                while ((index != _plugins.end()) && (plugin == nullptr)) {
+                    if (index->first.Matches(callsign) == true) {
+                        plugin = &(index->second);
+                    } else {
                         index++;
                     }
                 }
 
-                return (pluginFound == false ? !_defaultBlocked : index->second.Allowed(method));
+                return (plugin == nullptr ? !_defaultBlocked : plugin->Allowed(method));
             }
 
         private:
             bool _defaultBlocked;
-            std::map<string, Plugin> _plugins;
+            std::list<std::pair<Pattern, Plugin>> _plugins;
+            mutable Core::CriticalSection _adminLock;
+            mutable DecisionMap _decisions;
         };
 
-        using URLList = std::list<std::pair<string, Filter&>>;
+        using URLList = std::list<std::pair<Pattern, Filter&>>;
         using Iterator = Core::IteratorType<const std::list<string>, const string&, std::list<string>::const_iterator>;
 
     public:
@@ -391,16 +518,10 @@ namespace Plugin {
             auto origin = GetUrlOrigin(URL);
 
             const Filter* result = nullptr;
-            std::smatch matchList;
             URLList::const_iterator index = _urlMap.begin();
 
             while ((index != _urlMap.end()) && (result == nullptr)) {
-                // regex_search() for searching the regex pattern
-                // 'r' in the string 's'. 'm' is flag for determining
-                // matching behavior.
-                std::regex expression(index->first.c_str());
-
-                if (std::regex_search(origin, matchList, expression) == true) {
+                if (index->first.Matches(origin) == true) {
                     result = &(index->second);
                 }
                 else {
@@ -450,11 +571,8 @@ namespace Plugin {
                 } else {
                     Filter& entry(selectedFilter->second);
                     
-                    // create regex for url
-                    string url_regex = CreateUrlRegex(index.Current().URL.Value());
-                    
-                    _urlMap.emplace_back(std::pair<string, Filter&>(
-                        url_regex, entry));
+                    _urlMap.emplace_back(std::pair<Pattern, Filter&>(
+                        Pattern::URL(index.Current().URL.Value()), entry));
 
                     std::list<string>::iterator found = std::find(_unusedRoles.begin(), _unusedRoles.end(), role);
 
@@ -60,6 +60,7 @@ namespace Plugin {
 
     SecurityAgent::SecurityAgent()
         : _acl()
+        , _contexts()
         , _dispatcher(nullptr)
         , _engine()
     {
@@ -78,6 +79,7 @@ namespace Plugin {
         string version = service->Version();
 
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
+        _contexts.Configure(config.TokenCache.Value(), config.TokenLifetime.Value());
         Core::File aclFile(service->PersistentPath() + config.ACL.Value(), true);
 
         PluginHost::ISubSystem* subSystem = service->SubSystems();
@@ -148,13 +150,14 @@ namespace Plugin {
         _dispatcher.reset();
         _engine.Release();
 
+        // Cached contexts refer to the filters of the ACL, drop them first.
+        _contexts.Clear();
         _acl.Clear();
     }
 
     /* virtual */ string SecurityAgent::Information() const
     {
-        // No additional info to report.
-        return (string());
+        return (_contexts.Statistics());
     }
 
     /* virtual */ uint32_t SecurityAgent::CreateToken(const uint16_t length, const uint8_t buffer[], string& token)
@@ -167,21 +170,25 @@ namespace Plugin {
 
     /* virtual */ PluginHost::ISecurity* SecurityAgent::Officer(const string& token)
     {
-        PluginHost::ISecurity* result = nullptr;
+        // Tokens that were validated before hand out the same context, without decoding again.
+        PluginHost::ISecurity* result = _contexts.Find(token);
 
-        auto webToken = JWTFactory::Instance().Element();
-        uint16_t load = webToken->PayloadLength(token);
+        if (result == nullptr) {
+            auto webToken = JWTFactory::Instance().Element();
+            uint16_t load = webToken->PayloadLength(token);
 
-        // Validate the token
-        if (load != static_cast<uint16_t>(~0)) {
-            // It is potentially a valid token, extract the payload.
-            uint8_t* payload = reinterpret_cast<uint8_t*>(ALLOCA(load));
+            // Validate the token
+            if (load != static_cast<uint16_t>(~0)) {
+                // It is potentially a valid token, extract the payload.
+                uint8_t* payload = reinterpret_cast<uint8_t*>(ALLOCA(load));
 
-            load = webToken->Decode(token, load, payload);
+                load = webToken->Decode(token, load, payload);
 
-            if (load != static_cast<uint16_t>(~0)) {
-                // Seems like we extracted a valid payload, time to create an security context
-                result = Core::Service<SecurityContext>::Create<SecurityContext>(&_acl, load, payload);
+                if (load != static_cast<uint16_t>(~0)) {
+                    // Seems like we extracted a valid payload, time to create an security context
+                    result = Core::Service<SecurityContext>::Create<SecurityContext>(&_acl, load, payload);
+                    _contexts.Insert(token, result);
+                }
             }
         }
         return (result);
@@ -231,28 +238,18 @@ namespace Plugin {
                 result->Message = _T("Missing token");
 
                 if (request.WebToken.IsSet()) {
-                    auto webToken = JWTFactory::Instance().Element();
-                    const string& token = request.WebToken.Value().Token();
-                    uint16_t load = webToken->PayloadLength(token);
-
-                    // Validate the token
-                    if (load != static_cast<uint16_t>(~0)) {
-                        // It is potentially a valid token, extract the payload.
-                        uint8_t* payload = reinterpret_cast<uint8_t*>(ALLOCA(load));
-
-                        load = webToken->Decode(token, load, payload);
-
-                        if (load == static_cast<uint16_t>(~0)) {
-                            result->ErrorCode = Web::STATUS_FORBIDDEN;
-                            result->Message = _T("Invalid token");
-                        } else {
-                            result->ErrorCode = Web::STATUS_OK;
-                            result->Message = _T("Valid token");
-                            TRACE(Trace::Information, (_T("Token contents: %s"), reinterpret_cast<const TCHAR*>(payload)));
-                        }
+                    PluginHost::ISecurity* context = Officer(request.WebToken.Value().Token());
+
+                    if (context == nullptr) {
+                        result->ErrorCode = Web::STATUS_FORBIDDEN;
+                        result->Message = _T("Invalid token");
+                    } else {
+                        result->ErrorCode = Web::STATUS_OK;
+                        result->Message = _T("Valid token");
+                        TRACE(Trace::Information, (_T("Token contents: %s"), context->Token().c_str()));
+                        context->Release();
                     }
-                
-				}
+                }
             }
         }
 		return (result);
@@ -21,6 +21,7 @@
 
 #include "Module.h"
 #include "AccessControlList.h"
+#include "cryptalgo/Hash.h"
 
 #include <interfaces/json/JsonData_SecurityAgent.h>
 
@@ -92,9 +93,13 @@ namespace Plugin {
                 : Core::JSON::Container()
                 , ACL(_T("acl.json"))
                 , Connector()
+                , TokenCache(32)
+                , TokenLifetime(3600)
             {
                 Add(_T("acl"), &ACL);
                 Add(_T("connector"), &Connector);
+                Add(_T("tokencache"), &TokenCache);
+                Add(_T("tokenlifetime"), &TokenLifetime);
             }
             ~Config()
             {
@@ -103,6 +108,181 @@ namespace Plugin {
         public:
             Core::JSON::String ACL;
             Core::JSON::String Connector;
+            Core::JSON::DecUInt16 TokenCache;
+            Core::JSON::DecUInt32 TokenLifetime;
+        };
+
+        // Holds the security contexts of recently validated tokens, so a token that is presented again
+        // does not have to be decoded and verified again. A context is immutable once created and is
+        // shared by everyone presenting the same token, until it expires or is evicted.
+        // Entries are keyed by the SHA-256 digest of the token, the tokens themselves are not kept.
+        class ContextCache {
+        private:
+            struct Entry {
+                Entry(const string& key, PluginHost::ISecurity* context, const uint64_t expiry)
+                    : Key(key)
+                    , Context(context)
+                    , Expiry(expiry)
+                {
+                }
+
+                string Key;
+                PluginHost::ISecurity* Context;
+                uint64_t Expiry;
+            };
+
+            using EntryList = std::list<Entry>;
+
+        public:
+            ContextCache(const ContextCache&) = delete;
+            ContextCache& operator=(const ContextCache&) = delete;
+
+            ContextCache()
+                : _adminLock()
+                , _entries()
+                , _index()
+                , _capacity(0)
+                , _lifetime(0)
+                , _hits(0)
+                , _misses(0)
+                , _evictions(0)
+            {
+            }
+            ~ContextCache()
+            {
+                Clear();
+            }
+
+        public:
+            void Configure(const uint16_t capacity, const uint32_t lifetime)
+            {
+                _adminLock.Lock();
+                _capacity = capacity;
+                _lifetime = static_cast<uint64_t>(lifetime) * 1000 * Core::Time::TicksPerMillisecond;
+                _hits = 0;
+                _misses = 0;
+                _evictions = 0;
+                _adminLock.Unlock();
+
+                Clear();
+            }
+            // Returns an AddRef'ed context if the token was validated before, nullptr otherwise.
+            PluginHost::ISecurity* Find(const string& token)
+            {
+                PluginHost::ISecurity* result = nullptr;
+                string key;
+
+                if (Digest(token, key) == false) {
+                    return (nullptr);
+                }
+
+                _adminLock.Lock();
+
+                IndexMap::iterator index(_index.find(key));
+
+                if (index != _index.end()) {
+                    if (index->second->Expiry > Core::Time::Now().Ticks()) {
+                        // Most recently used entries are kept at the front.
+                        _entries.splice(_entries.begin(), _entries, index->second);
+                        result = index->second->Context;
+                        result->AddRef();
+                        _hits++;
+                    } else {
+                        Remove(index);
+                        _misses++;
+                    }
+                } else {
+                    _misses++;
+                }
+
+                _adminLock.Unlock();
+
+                return (result);
+            }
+            void Insert(const string& token, PluginHost::ISecurity* context)
+            {
+                ASSERT(context != nullptr);
+
+                string key;
+
+                if (Digest(token, key) == false) {
+                    return;
+                }
+
+                _adminLock.Lock();
+
+                if ((_capacity > 0) && (_index.find(key) == _index.end())) {
+                    while (_entries.size() >= _capacity) {
+                        Remove(_index.find(_entries.back().Key));
+                        _evictions++;
+                    }
+
+                    context->AddRef();
+                    _entries.emplace_front(key, context, Core::Time::Now().Ticks() + _lifetime);
+                    _index.emplace(key, _entries.begin());
+                }
+
+                _adminLock.Unlock();
+            }
+            void Clear()
+            {
+                _adminLock.Lock();
+
+                for (Entry& entry : _entries) {
+                    entry.Context->Release();
+                }
+                _entries.clear();
+                _index.clear();
+
+                _adminLock.Unlock();
+            }
+            string Statistics() const
+            {
+                _adminLock.Lock();
+
+                uint32_t requests = _hits + _misses;
+                uint32_t hitRate = (requests == 0 ? 0 : static_cast<uint32_t>((static_cast<uint64_t>(_hits) * 100) / requests));
+
+                string result = _T("Token cache: ") + std::to_string(_entries.size()) + '/' + std::to_string(_capacity) + _T(" entries, ")
+                    + std::to_string(_hits) + _T(" hits, ") + std::to_string(_misses) + _T(" misses (") + std::to_string(hitRate) + _T("% hit rate), ")
+                    + std::to_string(_evictions) + _T(" evictions");
+
+                _adminLock.Unlock();
+
+                return (result);
+            }
+
+        private:
+            using IndexMap = std::unordered_map<string, EntryList::iterator>;
+
+            // Tokens too long to digest in one go are not cached
+            static bool Digest(const string& token, string& key)
+            {
+                if (token.length() > 0xFFFF) {
+                    return (false);
+                }
+
+                Crypto::SHA256 digest(reinterpret_cast<const uint8_t*>(token.c_str()), static_cast<uint16_t>(token.length()));
+                key.assign(reinterpret_cast<const char*>(digest.Result()), digest.Length);
+                return (true);
+            }
+
+            void Remove(IndexMap::iterator index)
+            {
+                index->second->Context->Release();
+                _entries.erase(index->second);
+                _index.erase(index);
+            }
+
+        private:
+            mutable Core::CriticalSection _adminLock;
+            EntryList _entries;
+            IndexMap _index;
+            uint16_t _capacity;
+            uint64_t _lifetime;
+            uint32_t _hits;
+            uint32_t _misses;
+            uint32_t _evictions;
         };
 
     public:
@@ -161,6 +341,7 @@ namespace Plugin {
 
     private:
         AccessControlList _acl;
+        ContextCache _contexts;
         uint8_t _skipURL;
         std::unique_ptr<TokenDispatcher> _dispatcher; 
         Core::ProxyType<RPC::InvokeServer> _engine;
@@ -28,10 +28,12 @@
   */
 
 #include <stdio.h>
+#include <string.h>
 #include <list>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <unordered_map>
 
 #include "StateObserver.h"
 #include "libIARM.h"
@@ -60,10 +62,111 @@ namespace WPEFramework {
 
 		std::vector<string> registeredPropertyNames;
 
+		namespace {
+
+			enum ErrorFormat {
+				ERROR_NONE,     // Always "none"
+				ERROR_CODE,     // The RDK error code if error is 1, "none" otherwise
+				ERROR_NUMERIC   // The SysMgr error as is
+			};
+
+			// The properties getValues knows about, how to find them in the SysMgr states and how to
+			// report them
+			struct PropertyInfo {
+				const string& name;
+				IARM_Bus_SYSMgr_SystemState_t stateId;
+				state_info_t IARM_Bus_SYSMgr_GetSystemStates_Param_t::* field;
+				ErrorFormat errorFormat;
+				const char* errorCode;
+				bool payloadValue; // The value is the payload string rather than the state
+			};
+
+			const PropertyInfo properties[] = {
+				{ SYSTEM_CHANNEL_MAP, IARM_BUS_SYSMGR_SYSSTATE_CHANNELMAP, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::channel_map, ERROR_CODE, "RDK-03005", false },
+				{ SYSTEM_CARD_DISCONNECTED, IARM_BUS_SYSMGR_SYSSTATE_DISCONNECTMGR, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::disconnect_mgr_state, ERROR_CODE, "RDK-03007", false },
+				{ SYSTEM_TUNE_READY, IARM_BUS_SYSMGR_SYSSTATE_TUNEREADY, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::TuneReadyStatus, ERROR_NONE, nullptr, false },
+				{ SYSTEM_EXIT_OK, IARM_BUS_SYSMGR_SYSSTATE_EXIT_OK, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::exit_ok_key_sequence, ERROR_NONE, nullptr, false },
+				{ SYSTEM_CMAC, IARM_BUS_SYSMGR_SYSSTATE_CMAC, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::cmac, ERROR_CODE, "RDK-03002", false },
+				{ SYSTEM_MOTO_ENTITLEMENT, IARM_BUS_SYSMGR_SYSSTATE_MOTO_ENTITLEMENT, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::card_moto_entitlements, ERROR_NONE, nullptr, false },
+				{ SYSTEM_DAC_INIT_TIMESTAMP, IARM_BUS_SYSMGR_SYSSTATE_DAC_INIT_TIMESTAMP, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::dac_init_timestamp, ERROR_NONE, nullptr, true },
+				{ SYSTEM_CARD_SERIAL_NO, IARM_BUS_SYSMGR_SYSSTATE_CABLE_CARD_SERIAL_NO, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::card_serial_no, ERROR_NONE, nullptr, true },
+				{ SYSTEM_STB_SERIAL_NO, IARM_BUS_SYSMGR_SYSSTATE_STB_SERIAL_NO, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::stb_serial_no, ERROR_NONE, nullptr, true },
+				{ SYSTEM_ECM_MAC, IARM_BUS_SYSMGR_SYSSTATE_ECM_MAC, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::ecm_mac, ERROR_NONE, nullptr, true },
+				{ SYSTEM_MOTO_HRV_RX, IARM_BUS_SYSMGR_SYSSTATE_MOTO_HRV_RX, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::card_moto_hrv_rx, ERROR_NONE, nullptr, false },
+				{ SYSTEM_CARD_CISCO_STATUS, IARM_BUS_SYSMGR_SYSSTATE_CARD_CISCO_STATUS, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::card_cisco_status, ERROR_NONE, nullptr, false },
+				{ SYSTEM_VIDEO_PRESENTING, IARM_BUS_SYSMGR_SYSSTATE_VIDEO_PRESENTING, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::video_presenting, ERROR_NONE, nullptr, false },
+				{ SYSTEM_HDMI_OUT, IARM_BUS_SYSMGR_SYSSTATE_HDMI_OUT, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::hdmi_out, ERROR_NONE, nullptr, false },
+				{ SYSTEM_HDCP_ENABLED, IARM_BUS_SYSMGR_SYSSTATE_HDCP_ENABLED, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::hdcp_enabled, ERROR_NONE, nullptr, false },
+				{ SYSTEM_HDMI_EDID_READ, IARM_BUS_SYSMGR_SYSSTATE_HDMI_EDID_READ, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::hdmi_edid_read, ERROR_NONE, nullptr, false },
+				{ SYSTEM_FIRMWARE_DWNLD, IARM_BUS_SYSMGR_SYSSTATE_FIRMWARE_DWNLD, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::firmware_download, ERROR_NONE, nullptr, false },
+				{ SYSTEM_TIME_SOURCE, IARM_BUS_SYSMGR_SYSSTATE_TIME_SOURCE, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::time_source, ERROR_CODE, "RDK-03006", false },
+				{ SYSTEM_TIME_ZONE, IARM_BUS_SYSMGR_SYSSTATE_TIME_ZONE, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::time_zone_available, ERROR_NONE, nullptr, false },
+				{ SYSTEM_CA_SYSTEM, IARM_BUS_SYSMGR_SYSSTATE_CA_SYSTEM, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::ca_system, ERROR_NONE, nullptr, false },
+				{ SYSTEM_ESTB_IP, IARM_BUS_SYSMGR_SYSSTATE_ESTB_IP, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::estb_ip, ERROR_CODE, "RDK-03009", false },
+				{ SYSTEM_ECM_IP, IARM_BUS_SYSMGR_SYSSTATE_ECM_IP, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::ecm_ip, ERROR_CODE, "RDK-03004", false },
+				{ SYSTEM_LAN_IP, IARM_BUS_SYSMGR_SYSSTATE_LAN_IP, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::lan_ip, ERROR_NONE, nullptr, false },
+				{ SYSTEM_DOCSIS, IARM_BUS_SYSMGR_SYSSTATE_DOCSIS, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::docsis, ERROR_NONE, nullptr, false },
+				{ SYSTEM_DSG_CA_TUNNEL, IARM_BUS_SYSMGR_SYSSTATE_DSG_CA_TUNNEL, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::dsg_ca_tunnel, ERROR_CODE, "RDK-03003", false },
+				{ SYSTEM_CABLE_CARD, IARM_BUS_SYSMGR_SYSSTATE_CABLE_CARD, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::cable_card, ERROR_CODE, "RDK-03001", false },
+				{ SYSTEM_VOD_AD, IARM_BUS_SYSMGR_SYSSTATE_VOD_AD, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::vod_ad, ERROR_NONE, nullptr, false },
+				{ SYSTEM_IP_MODE, IARM_BUS_SYSMGR_SYSSTATE_IP_MODE, &IARM_Bus_SYSMgr_GetSystemStates_Param_t::ip_mode, ERROR_NUMERIC, nullptr, false },
+			};
+
+			const size_t propertyCount = sizeof(properties) / sizeof(properties[0]);
+
+			// Index into the property table by property name, -1 if unknown
+			int propertyIndex(const string& name)
+			{
+				static const std::unordered_map<string, int> byName = []() {
+					std::unordered_map<string, int> map;
+					for (size_t i = 0; i < propertyCount; i++)
+						map.emplace(properties[i].name, i);
+					return map;
+				}();
+				auto it = byName.find(name);
+				return (it != byName.end()) ? it->second : -1;
+			}
+
+			// Index into the property table by SysMgr state, -1 if not reported
+			int stateIndex(int stateId)
+			{
+				static const std::unordered_map<int, int> byState = []() {
+					std::unordered_map<int, int> map;
+					for (size_t i = 0; i < propertyCount; i++)
+						map.emplace(properties[i].stateId, i);
+					return map;
+				}();
+				auto it = byState.find(stateId);
+				return (it != byState.end()) ? it->second : -1;
+			}
+
+			bool isStandAloneMode()
+			{
+				static const bool standAlone = []() {
+					char *env_var= getenv("SERVICE_MANAGER_STANDALONE_MODE");
+					if ( env_var )
+					{
+						int v= atoi(env_var);
+						LOGWARN("standalone mode value %d", v);
+						if (v == 1)
+						{
+							LOGWARN("standalone mode enabled");
+							return true;
+						}
+					}
+					return false;
+				}();
+				return standAlone;
+			}
+		}
+
 
 		StateObserver::StateObserver()
 		: AbstractPlugin()
 		, m_apiVersionNumber((uint32_t)-1)
+		, m_snapshot(propertyCount)
+		, m_snapshotVersion(0)
+		, m_snapshotSeeded(false)
 		{
 			StateObserver::_instance = this;
 			Register("getValues", &StateObserver::getValues, this);
@@ -72,6 +175,7 @@ namespace WPEFramework {
 			Register("setApiVersionNumber", &StateObserver::setApiVersionNumberWrapper, this);
 			Register("getApiVersionNumber", &StateObserver::getApiVersionNumberWrapper, this);
 			Register("getRegisteredPropertyNames", &StateObserver::getRegisteredPropertyNames, this);
+			Register("getChangesSince", &StateObserver::getChangesSince, this);
 			Register("getName", &StateObserver::getNameWrapper, this);
 			setApiVersionNumber(1);
 		}
@@ -101,6 +205,10 @@ namespace WPEFramework {
             {
                 IARM_Result_t res;
 			    IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_SYSMGR_NAME, IARM_BUS_SYSMGR_EVENT_SYSTEMSTATE, onReportStateObserverEvents) );
+
+                // After registering, so no change can get lost in between
+                std::lock_guard<std::mutex> lock(m_snapshotMutex);
+                seedSnapshot();
             }
 		}
 
@@ -271,309 +379,79 @@ namespace WPEFramework {
 
 		void StateObserver::getVal(std::vector<string> pname,JsonObject& response)
 		{
-			static bool checkForStandalone = true;
-			static bool stbStandAloneMode = false;
-			if (checkForStandalone)
+			std::lock_guard<std::mutex> lock(m_snapshotMutex);
+			if (!m_snapshotSeeded)
 			{
-				char *env_var= getenv("SERVICE_MANAGER_STANDALONE_MODE");
-				if ( env_var )
-				{
-					int v= atoi(env_var);
-					LOGWARN("standalone mode value %d", v);
-					if (v == 1)
-					{
-						stbStandAloneMode = true;
-						LOGWARN("standalone mode enabled");
-					}
-				}
-				checkForStandalone = false;
+				// SysMgr was not available yet when the plugin started
+				seedSnapshot();
 			}
-			IARM_Bus_SYSMgr_GetSystemStates_Param_t param;
-			IARM_Bus_Call(IARM_BUS_SYSMGR_NAME, IARM_BUS_SYSMGR_API_GetSystemStates, &param, sizeof(param));
+
+			fillValues(pname, response);
+		}
+
+		/**
+		 * @brief This function adds the given properties and the snapshot version they are taken
+		 * from to the response. Called with m_snapshotMutex held, so both belong together.
+		 */
+		void StateObserver::fillValues(const std::vector<string>& pname, JsonObject& response)
+		{
+			const bool stbStandAloneMode = isStandAloneMode();
+
 			JsonArray response_arr;
-			for( std::vector<string>::iterator it = pname.begin(); it!= pname.end(); ++it )
+			for( std::vector<string>::const_iterator it = pname.begin(); it!= pname.end(); ++it )
 			{
-				string err_str="none";
 				JsonObject devProp;
-				if(*it == SYSTEM_CHANNEL_MAP)
+				int index = propertyIndex(*it);
+				if (index < 0)
 				{
-					int channelMapState = param.channel_map.state;
-					int channelMapError = param.channel_map.error;
-					if (stbStandAloneMode)
-					{
-						LOGINFO("stand alone mode true\n");
-						channelMapState = 2;
-						channelMapError = 0;
-					}
-					devProp["propertyName"]=SYSTEM_CHANNEL_MAP;
-					devProp["value"]=channelMapState;
-					if(channelMapError == 1)
-					{
-						err_str="RDK-03005";
-					}
-					devProp["error"]=err_str;
+					LOGINFO("Invalid property Name\n");
+					string res="Invalid property Name";
+ 					devProp["propertyName"] = *it;
+					devProp["error"]=res;
 					response_arr.Add(devProp);
+					continue;
 				}
 
-				else if(*it == SYSTEM_CARD_DISCONNECTED)
+				const PropertyInfo& info = properties[index];
+				const PropertyState& prop = m_snapshot[index];
+				int state = prop.state;
+				int error = prop.error;
+				if (stbStandAloneMode)
 				{
-					int systemCardState = param.disconnect_mgr_state.state;
-					int systemCardError = param.disconnect_mgr_state.error;
-					if (stbStandAloneMode)
+					if (info.stateId == IARM_BUS_SYSMGR_SYSSTATE_CHANNELMAP)
 					{
-						systemCardState = 0;
-						systemCardError = 0;
+						state = 2;
+						error = 0;
 					}
-					devProp["propertyName"]=SYSTEM_CARD_DISCONNECTED;
-					devProp["value"]=systemCardState;
-					if(systemCardError==1)
+					else if (info.stateId == IARM_BUS_SYSMGR_SYSSTATE_DISCONNECTMGR)
 					{
-						err_str = "RDK-03007";
+						state = 0;
+						error = 0;
 					}
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it  == SYSTEM_TUNE_READY)
-				{
-					int tuneReadyState = param.TuneReadyStatus.state;
-					if (stbStandAloneMode)
+					else if (info.stateId == IARM_BUS_SYSMGR_SYSSTATE_TUNEREADY)
 					{
-						tuneReadyState = 1;
+						state = 1;
 					}
-					devProp["propertyName"]=SYSTEM_TUNE_READY;
-					devProp["value"]=tuneReadyState;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
 				}
-				else if(*it  == SYSTEM_EXIT_OK)
-				{
-					devProp["propertyName"]=SYSTEM_EXIT_OK;
-					devProp["value"]=param.exit_ok_key_sequence.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it ==SYSTEM_CMAC )
-				{
-					devProp["propertyName"]=SYSTEM_CMAC ;
-					devProp["value"]=param.cmac.state;
-					if(param.cmac.error == 1)
-					{
-						err_str  = "RDK-03002";
-					}
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it ==SYSTEM_MOTO_ENTITLEMENT )
-				{
-					devProp["propertyName"]=SYSTEM_MOTO_ENTITLEMENT;
-					devProp["value"]=param.card_moto_entitlements.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_DAC_INIT_TIMESTAMP)
-				{
-					devProp["propertyName"]=SYSTEM_DAC_INIT_TIMESTAMP;
-					string dac_init_str(param.dac_init_timestamp.payload);
-					devProp["value"]=dac_init_str;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_CARD_SERIAL_NO )
-				{
-					string card_serial_str(param.card_serial_no.payload);
-					devProp["propertyName"]=SYSTEM_CARD_SERIAL_NO;
-					devProp["value"]=card_serial_str;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_STB_SERIAL_NO )
-				{
-					string stb_string(param.stb_serial_no.payload);
-					devProp["propertyName"]=SYSTEM_STB_SERIAL_NO;
-					devProp["value"]=stb_string;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it ==SYSTEM_ECM_MAC )
-				{
-					string ecm_mac_str(param.ecm_mac.payload);
-					devProp["propertyName"]=SYSTEM_ECM_MAC;
-					devProp["value"]=ecm_mac_str;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_MOTO_HRV_RX)
-				{
-					devProp["propertyName"]=SYSTEM_MOTO_HRV_RX;
-					devProp["value"]=param.card_moto_hrv_rx.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_CARD_CISCO_STATUS )
-				{
-					LOGINFO("property SYSTEM_CARD_CISCO_STATUS \n");
-					devProp["propertyName"]=SYSTEM_CARD_CISCO_STATUS;
-					devProp["value"]=param.card_cisco_status.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_VIDEO_PRESENTING)
-				{
-					devProp["propertyName"]=SYSTEM_VIDEO_PRESENTING;
-					devProp["value"]=param.video_presenting.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_HDMI_OUT )
-				{
-					devProp["propertyName"]=SYSTEM_HDMI_OUT;
-					devProp["value"]=param.hdmi_out.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_HDCP_ENABLED )
-				{
-					devProp["propertyName"]=SYSTEM_HDCP_ENABLED;
-					devProp["value"]=param.hdcp_enabled.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_HDMI_EDID_READ )
-				{
-					devProp["propertyName"]=SYSTEM_HDMI_EDID_READ;
-					devProp["value"]=param.hdmi_edid_read.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_FIRMWARE_DWNLD )
-				{
-					devProp["propertyName"]=SYSTEM_FIRMWARE_DWNLD;
-					devProp["value"]=param.firmware_download.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_TIME_SOURCE)
-				{
-					LOGWARN("%s PropertyName: %s Time source state: %d, time source error: %d",
-						__FUNCTION__,
-						SYSTEM_TIME_SOURCE.c_str(),
-						param.time_source.state,
-						param.time_source.error);
-
-					devProp["propertyName"]=SYSTEM_TIME_SOURCE;
-					devProp["value"]=param.time_source.state;
-					if(param.time_source.error == 1)
-					{
-						err_str  = "RDK-03006";
-					}
-					devProp["error"]=err_str;
 
-					std::string json;
-					devProp.ToString(json);
-					LOGWARN("%s devProp=%s", __FUNCTION__, json.c_str());
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_TIME_ZONE)
-				{
-					devProp["propertyName"]=SYSTEM_TIME_ZONE;
-					devProp["value"]=param.time_zone_available.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_CA_SYSTEM)
-				{
-					devProp["propertyName"]=SYSTEM_CA_SYSTEM;
-					devProp["value"]=param.ca_system.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_ESTB_IP)
-				{
-					devProp["propertyName"]=SYSTEM_ESTB_IP;
-					devProp["value"]=param.estb_ip.state;
-					if(param.estb_ip.error == 1)
-					{
-						err_str  = "RDK-03009";
-					}
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_ECM_IP)
-				{
-					devProp["propertyName"]=SYSTEM_ECM_IP;
-					devProp["value"]=param.ecm_ip.state;
-					if(param.ecm_ip.error == 1)
-					{
-						err_str  = "RDK-03004";
-					}
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_LAN_IP)
-				{
-					devProp["propertyName"]=SYSTEM_LAN_IP;
-					devProp["value"]=param.lan_ip.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_DOCSIS)
-				{
-					devProp["propertyName"]=SYSTEM_DOCSIS;
-					devProp["value"]=param.docsis.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_DSG_CA_TUNNEL)
-				{
-					devProp["propertyName"]=SYSTEM_DSG_CA_TUNNEL;
-					devProp["value"]=param.dsg_ca_tunnel.state;
-					if(param.dsg_ca_tunnel.error == 1)
-					{
-						err_str  = "RDK-03003";
-					}
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_CABLE_CARD )
-				{
-					devProp["propertyName"]=SYSTEM_CABLE_CARD;
-					devProp["value"]=param.cable_card.state;
-					if(param.cable_card.error == 1)
-					{
-						err_str  = "RDK-03001";
-					}
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_VOD_AD)
-				{
-					devProp["propertyName"]=SYSTEM_VOD_AD;
-					devProp["value"]=param.vod_ad.state;
-					devProp["error"]=err_str;
-					response_arr.Add(devProp);
-				}
-				else if(*it == SYSTEM_IP_MODE)
-				{
-					int ipState=param.ip_mode.state;
-					int ipError=param.ip_mode.error;
-					devProp["propertyName"]=SYSTEM_IP_MODE;
-					devProp["value"]=ipState;
-					devProp["error"]=ipError;
-					response_arr.Add(devProp);
-				}
+				devProp["propertyName"]=info.name;
+				if (info.payloadValue)
+					devProp["value"]=prop.payload;
+				else
+					devProp["value"]=state;
 
+				if (info.errorFormat == ERROR_NUMERIC)
+					devProp["error"]=error;
+				else if ((info.errorFormat == ERROR_CODE) && (error == 1))
+					devProp["error"]=string(info.errorCode);
 				else
-				{
-					LOGINFO("Invalid property Name\n");
-					string res="Invalid property Name";
- 					devProp["propertyName"] = *it;
-					devProp["error"]=res;
-					response_arr.Add(devProp);
-				}
+					devProp["error"]=string("none");
 
+				response_arr.Add(devProp);
 			}
 
 			response["properties"]=response_arr;
+			response["version"]=m_snapshotVersion;
 			#if(DEBUG_INFO)
 				string json_str;
 				response.ToString(json_str);
@@ -581,6 +459,103 @@ namespace WPEFramework {
 			#endif
 		}
 
+		/**
+		 * @brief This function fills the snapshot with all system states from SysMgr. States
+		 * already received in an event are newer and are kept. Called with m_snapshotMutex held.
+		 */
+		void StateObserver::seedSnapshot()
+		{
+			IARM_Bus_SYSMgr_GetSystemStates_Param_t param;
+			memset(&param, 0, sizeof(param));
+			IARM_Result_t res = IARM_Bus_Call(IARM_BUS_SYSMGR_NAME, IARM_BUS_SYSMGR_API_GetSystemStates, &param, sizeof(param));
+			if (res != IARM_RESULT_SUCCESS)
+			{
+				LOGWARN("failed to get the system states: %d", res);
+				return;
+			}
+
+			m_snapshotVersion++;
+			for (size_t i = 0; i < propertyCount; i++)
+			{
+				PropertyState& prop = m_snapshot[i];
+				if (prop.version != 0)
+					continue;
+
+				const state_info_t& source = param.*(properties[i].field);
+				prop.state = source.state;
+				prop.error = source.error;
+				prop.payload = string(source.payload, strnlen(source.payload, sizeof(source.payload)));
+				prop.version = m_snapshotVersion;
+			}
+			m_snapshotSeeded = true;
+		}
+
+		/**
+		 * @brief This function applies a system state event to the snapshot, the snapshot version
+		 * only moves when the state actually changed.
+		 */
+		void StateObserver::updateSnapshot(int stateId, int state, int error, const string& payload)
+		{
+			int index = stateIndex(stateId);
+			if (index < 0)
+				return;
+
+			std::lock_guard<std::mutex> lock(m_snapshotMutex);
+			PropertyState& prop = m_snapshot[index];
+			if ((prop.version != 0) && (prop.state == state) && (prop.error == error) && (prop.payload == payload))
+				return;
+
+			prop.state = state;
+			prop.error = error;
+			prop.payload = payload;
+			prop.version = ++m_snapshotVersion;
+		}
+
+		/**
+		 * @brief This function returns the properties that changed after a given snapshot version.
+		 *
+		 * param[in] version The snapshot version the caller has seen last, as returned by getValues
+		 * or a previous getChangesSince. 0, or a version newer than the current one (the plugin was
+		 * restarted), returns all properties.
+		 *
+		 * param[out] The current snapshot version and the changed properties with their state and
+		 * error values.
+		 *
+		 * @return Core::ERROR_NONE
+		 *Request example: curl -d '{"jsonrpc":"2.0","id":"3","method": "StateObserver.1.getChangesSince" ,"params":{"version":12}}' http://127.0.0.1:9998/jsonrpc
+		 *Response success:{"jsonrpc":"2.0","id":3,"result":{"properties":[{"propertyName":"com.comcast.channel_map","value":2,"error":"none"}],"version":14,"success":true}}
+		 */
+		uint32_t StateObserver::getChangesSince(const JsonObject& parameters, JsonObject& response)
+		{
+			LOGINFOMETHOD();
+			uint32_t version = 0;
+			getDefaultNumberParameter("version", version, 0);
+
+			// One hold of the lock, a change that comes in meanwhile is either in this answer or
+			// gets a version newer than the one returned
+			{
+				std::lock_guard<std::mutex> lock(m_snapshotMutex);
+				if (!m_snapshotSeeded)
+				{
+					seedSnapshot();
+				}
+				if (version > m_snapshotVersion)
+					version = 0;
+
+				std::vector<string> pname;
+				for (size_t i = 0; i < propertyCount; i++)
+				{
+					if (m_snapshot[i].version > version)
+						pname.push_back(properties[i].name);
+				}
+
+				fillValues(pname, response);
+			}
+
+			LOGTRACEMETHODFIN();
+			returnResponse(true);
+		}
+
 
 		 /**
 		 * @brief This function registers Listeners to properties.It adds the properties to a registered properties list.
@@ -711,7 +686,6 @@ namespace WPEFramework {
 		 */
 		void StateObserver::onReportStateObserverEvents(const char *owner, IARM_EventId_t eventId, void *data, size_t len)
 		{
-			IARM_Bus_SYSMgr_GetSystemStates_Param_t systemStates;
 			JsonObject params;
 			int state=0;
 			int error=0;
@@ -733,22 +707,18 @@ namespace WPEFramework {
 					LOGINFO("stateId is %d state is %d error is %d \n",stateId,state,error);
 					LOGINFO("payload is %s\n",payload);
 				#endif
+				if(StateObserver::_instance)
+					StateObserver::_instance->updateSnapshot(stateId,state,error,string(payload,strnlen(payload,sizeof(sysEventData->data.systemStates.payload))));
 				switch(stateId)
 				{
 
 					case IARM_BUS_SYSMGR_SYSSTATE_TUNEREADY:
-						systemStates.TuneReadyStatus.state = state;
-						systemStates.TuneReadyStatus.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_TUNE_READY,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_CHANNELMAP:
 						{
-						systemStates.channel_map.state = state;
-						systemStates.channel_map.error = error;
-						memcpy( systemStates.channel_map.payload, payload, sizeof( systemStates.channel_map.payload ) );
-						systemStates.channel_map.payload[ sizeof( systemStates.channel_map.payload ) - 1] = 0;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_CHANNEL_MAP,state,error);
 						string payload_str(payload);
@@ -757,47 +727,33 @@ namespace WPEFramework {
 						}
 
 					case IARM_BUS_SYSMGR_SYSSTATE_DISCONNECTMGR:
-						systemStates.disconnect_mgr_state.state = state;
-						systemStates.disconnect_mgr_state.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_CARD_DISCONNECTED,state,error);
 						break;
 
 
 					case IARM_BUS_SYSMGR_SYSSTATE_EXIT_OK :
-						systemStates.exit_ok_key_sequence.state = state;
-						systemStates.exit_ok_key_sequence.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_EXIT_OK,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_CMAC :
-						systemStates.cmac.state = state;
-						systemStates.cmac.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_CMAC,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_MOTO_ENTITLEMENT :
-						systemStates.card_moto_entitlements.state = state;
-						systemStates.card_moto_entitlements.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_MOTO_ENTITLEMENT,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_MOTO_HRV_RX :
-						systemStates.card_moto_hrv_rx.state = state;
-						systemStates.card_moto_hrv_rx.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_MOTO_HRV_RX,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_DAC_INIT_TIMESTAMP :
 						{
-						systemStates.dac_init_timestamp.state = state;
-						systemStates.dac_init_timestamp.error = error;
-						strncpy(systemStates.dac_init_timestamp.payload,payload,strlen(payload));
-						systemStates.dac_init_timestamp.payload[strlen(payload)]='\0';
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_DAC_INIT_TIMESTAMP,state,error);
 						string payload_str(payload);
@@ -807,9 +763,6 @@ namespace WPEFramework {
 
 					case IARM_BUS_SYSMGR_SYSSTATE_CABLE_CARD_SERIAL_NO:
 						{
-						systemStates.card_serial_no.error =error;
-						strncpy(systemStates.card_serial_no.payload,payload,strlen(payload));
-						systemStates.card_serial_no.payload[strlen(payload)]='\0';
 						params["propertyName"]=SYSTEM_CARD_SERIAL_NO;
 						params["error"]=error;
 						string payload_str(payload);
@@ -819,9 +772,6 @@ namespace WPEFramework {
 
 					 case IARM_BUS_SYSMGR_SYSSTATE_STB_SERIAL_NO:
 						{
-						systemStates.stb_serial_no.error =error;
-						strncpy(systemStates.stb_serial_no.payload,payload,strlen(payload));
-						systemStates.stb_serial_no.payload[strlen(payload)]='\0';
 						params["propertyName"]=SYSTEM_STB_SERIAL_NO;
 						params["error"]=error;
 						string payload_str(payload);
@@ -830,60 +780,42 @@ namespace WPEFramework {
 						}
 
 					case IARM_BUS_SYSMGR_SYSSTATE_CARD_CISCO_STATUS :
-						systemStates.card_cisco_status.state = state;
-						systemStates.card_cisco_status.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_CARD_CISCO_STATUS,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_VIDEO_PRESENTING :
-						systemStates.video_presenting.state = state;
-						systemStates.video_presenting.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_VIDEO_PRESENTING,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_HDMI_OUT :
-						systemStates.hdmi_out.state = state;
-						systemStates.hdmi_out.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_HDMI_OUT,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_HDCP_ENABLED :
-						systemStates.hdcp_enabled.state = state;
-						systemStates.hdcp_enabled.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_HDCP_ENABLED,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_HDMI_EDID_READ :
-						systemStates.hdmi_edid_read.state = state;
-						systemStates.hdmi_edid_read.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_HDMI_EDID_READ,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_FIRMWARE_DWNLD :
-						systemStates.firmware_download.state = state;
-						systemStates.firmware_download.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_FIRMWARE_DWNLD,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_TIME_SOURCE :
-						systemStates.time_source.state = state;
-						systemStates.time_source.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_TIME_SOURCE,state,error);
 						break;
 
 					case IARM_BUS_SYSMGR_SYSSTATE_TIME_ZONE :
 						{
-						systemStates.time_zone_available.state = state;
-						systemStates.time_zone_available.error = error;
-						memcpy( systemStates.time_zone_available.payload, payload, sizeof( systemStates.time_zone_available.payload ) );
-						systemStates.time_zone_available.payload[ sizeof( systemStates.time_zone_available.payload ) - 1] = 0;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_TIME_ZONE,state,error);
 						string payload_str(payload);
@@ -892,60 +824,42 @@ namespace WPEFramework {
 						}
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_CA_SYSTEM :
-						systemStates.ca_system.state = state;
-						systemStates.ca_system.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_CA_SYSTEM,state,error);
 						break;
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_ESTB_IP :
-						systemStates.estb_ip.state = state;
-						systemStates.estb_ip.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_ESTB_IP,state,error);
 						break;
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_ECM_IP :
-						systemStates.ecm_ip.state = state;
-						systemStates.ecm_ip.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_ECM_IP,state,error);
 						break;
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_LAN_IP :
-						systemStates.lan_ip.state = state;
-						systemStates.lan_ip.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_LAN_IP,state,error);
 						break;
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_DOCSIS :
-						systemStates.docsis.state = state;
-						systemStates.docsis.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_DOCSIS,state,error);
 						break;
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_DSG_CA_TUNNEL :
-						systemStates.dsg_ca_tunnel.state = state;
-						systemStates.dsg_ca_tunnel.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_DSG_CA_TUNNEL,state,error);
 						break;
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_CABLE_CARD :
-						systemStates.cable_card.state = state;
-						systemStates.cable_card.error = error;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_CABLE_CARD,state,error);
 						break;
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_VOD_AD :
 						{
-						systemStates.vod_ad.state = state;
-						systemStates.vod_ad.error = error;
-						memcpy( systemStates.vod_ad.payload, payload, sizeof( systemStates.vod_ad.payload ) );
-						systemStates.vod_ad.payload[ sizeof( systemStates.vod_ad.payload ) -1 ] =0;
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_VOD_AD,state,error);
 						string payload_str(payload);
@@ -955,9 +869,6 @@ namespace WPEFramework {
 
 					case IARM_BUS_SYSMGR_SYSSTATE_ECM_MAC:
 						{
-						systemStates.ecm_mac.error =error;
-						strncpy(systemStates.ecm_mac.payload,payload,strlen(payload));
-						systemStates.ecm_mac.payload[strlen(payload)]='\0';
 						params["propertyName"]=SYSTEM_ECM_MAC;
 						params["error"]=error;
 						string payload_str(payload);
@@ -967,10 +878,6 @@ namespace WPEFramework {
 
 					case   IARM_BUS_SYSMGR_SYSSTATE_IP_MODE:
 						{
-						systemStates.ip_mode.state=state;
-						systemStates.ip_mode.error =error;
-						strncpy(systemStates.ip_mode.payload,payload,strlen(payload));
-						systemStates.ip_mode.payload[strlen(payload)]='\0';
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_IP_MODE,state,error);
 						string payload_str(payload);
@@ -32,6 +32,9 @@
 #define STATEOBSERVER_H
 #include <cjson/cJSON.h>
 
+#include <mutex>
+#include <vector>
+
 #include "Module.h"
 #include "libIBus.h"
 #include "utils.h"
@@ -119,8 +122,12 @@ namespace WPEFramework {
 			uint32_t setApiVersionNumberWrapper(const JsonObject& parameters, JsonObject& response);
 			uint32_t getApiVersionNumberWrapper(const JsonObject& parameters, JsonObject& response);
             uint32_t getRegisteredPropertyNames(const JsonObject &parameters, JsonObject &response);
+			uint32_t getChangesSince(const JsonObject& parameters, JsonObject& response);
 			uint32_t getNameWrapper(const JsonObject& parameters, JsonObject& response);
 			void getVal(std::vector<string> pname,JsonObject& response);
+			void fillValues(const std::vector<string>& pname, JsonObject& response);
+			void seedSnapshot();
+			void updateSnapshot(int stateId, int state, int error, const string& payload);
 			void InitializeIARM();
 			void DeinitializeIARM();
 			//End methods
@@ -146,6 +153,23 @@ namespace WPEFramework {
 			static StateObserver* _instance;
 		private:
 			uint32_t m_apiVersionNumber;
+
+			// Last known state of a property as reported by SysMgr
+			struct PropertyState {
+				PropertyState() : state(0), error(0), version(0) {}
+				int state;
+				int error;
+				string payload;
+				uint32_t version; // Snapshot version of the last change, 0 if never known
+			};
+
+			// Local copy of the SysMgr system states, indexed like the property table in
+			// StateObserver.cpp. It is fetched once and then kept up to date from the
+			// IARM_BUS_SYSMGR_EVENT_SYSTEMSTATE events, so reading values is not an IARM call.
+			std::mutex m_snapshotMutex;
+			std::vector<PropertyState> m_snapshot;
+			uint32_t m_snapshotVersion;
+			bool m_snapshotSeeded;
 		};
 
 	} // namespace Plugin
@@ -39,7 +39,8 @@
 #define TIMER_EVT_TIMER_EXPIRED           "timerExpired"
 #define TIMER_EVT_TIMER_EXPIRY_REMINDER   "timerExpiryReminder"
 
-#define TIMER_ACCURACY 0.001 // 10 milliseconds
+#define TIMER_ACCURACY 0.001 // 1 millisecond
+#define TIMER_COALESCE_WINDOW 0.005 // Timers due within 5 milliseconds are handled in the same callback
 
 static const char* stateStrings[] = {
     "",
@@ -89,157 +90,139 @@ namespace WPEFramework
             Timer::_instance = nullptr;
         }
 
-        void Timer::checkTimers()
+        static std::chrono::system_clock::duration toDuration(double seconds)
         {
-            double minTimeout = 100000;
-            for (auto it = m_runningItems.cbegin(); it != m_runningItems.cend(); ++it)
-            {
-                unsigned int timerId = *it;
-                if (timerId < 0 || timerId >= m_timerItems.size())
-                {
-                    LOGERR("Internal error: wrong timerId");
-                    continue;
-                }
-                if (m_timerItems[timerId].state != RUNNING)
-                {
-                    LOGERR("Internal error: timer %d has wrong state", timerId);
-                    continue;
-                }
+            return std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(seconds));
+        }
 
-                std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - m_timerItems[timerId].lastExpired;
-                double timeout =  m_timerItems[timerId].interval - elapsed.count();
+        // The next event of a running timer is its expiry reminder if one is still due, otherwise its expiry.
+        // A deadline that already passed is picked up by the next callback.
+        void Timer::scheduleTimer(int timerId)
+        {
+            TimerItem& item = m_timerItems[timerId];
+
+            item.deadline = item.lastExpired + toDuration(item.interval);
+            if (!item.reminderSent && item.remindBefore > TIMER_ACCURACY)
+                item.deadline -= toDuration(item.remindBefore);
 
-                if (!m_timerItems[timerId].reminderSent && m_timerItems[timerId].remindBefore > TIMER_ACCURACY)
+            m_schedule.emplace(item.deadline, timerId);
+        }
+
+        bool Timer::unscheduleTimer(int timerId)
+        {
+            return m_schedule.erase(std::make_pair(m_timerItems[timerId].deadline, timerId)) != 0;
+        }
+
+        // Arms the OS timer for the first deadline in the schedule, unless it is armed for it already
+        void Timer::armTimer(bool force)
+        {
+            if (m_schedule.empty())
+            {
+                if (m_armedDeadline != std::chrono::system_clock::time_point())
                 {
-                    if (timeout > m_timerItems[timerId].remindBefore)
-                    {
-                        timeout -= m_timerItems[timerId].remindBefore;
-                    }
-                    else
-                    {
-                        sendTimerExpiryReminder(timerId);
-                        m_timerItems[timerId].reminderSent = true;
-                    }
+                    m_timer.stop();
+                    m_armedDeadline = std::chrono::system_clock::time_point();
                 }
-
-                if (timeout < minTimeout)
-                    minTimeout = timeout;
+                return;
             }
 
+            std::chrono::system_clock::time_point deadline = m_schedule.cbegin()->first;
+            if (!force && deadline == m_armedDeadline)
+                return;
+
+            std::chrono::duration<double> timeout = deadline - std::chrono::system_clock::now();
+            double minTimeout = timeout.count();
             if (minTimeout < TIMER_ACCURACY)
                 minTimeout = TIMER_ACCURACY;
 
-            if (minTimeout < 100000)
-                m_timer.start(int(minTimeout * 1000));
-            else
-                m_timer.stop();
+            m_timer.start(int(minTimeout * 1000));
+            m_armedDeadline = deadline;
         }
 
         void Timer::startTimer(int timerId)
         {
-            m_runningItems.push_back(timerId);
             m_timerItems[timerId].state = RUNNING;
 
             m_timerItems[timerId].lastExpired = std::chrono::system_clock::now();
             m_timerItems[timerId].lastExpiryReminder = std::chrono::system_clock::now();
             m_timerItems[timerId].reminderSent = false;
 
-            checkTimers();
+            scheduleTimer(timerId);
+            armTimer();
         }
 
         bool Timer::cancelTimer(int timerId)
         {
+            bool wasRunning = (RUNNING == m_timerItems[timerId].state) && unscheduleTimer(timerId);
+
             m_timerItems[timerId].state = CANCELED;
 
-            auto it = std::find(m_runningItems.begin(), m_runningItems.end(), timerId);
-            if (m_runningItems.end() != it)
-            {
-                m_runningItems.erase(it);
-                m_timer.stop();
-                checkTimers();
-                return true;
-            }
+            if (wasRunning)
+                armTimer();
 
-            return false;
+            return wasRunning;
         }
 
         bool Timer::suspendTimer(int timerId)
         {
+            bool wasRunning = (RUNNING == m_timerItems[timerId].state) && unscheduleTimer(timerId);
+
             m_timerItems[timerId].state = SUSPENDED;
 
-            auto it = std::find(m_runningItems.begin(), m_runningItems.end(), timerId);
-            if (m_runningItems.end() != it)
-            {
-                m_runningItems.erase(it);
-                m_timer.stop();
-                checkTimers();
-                return true;
-            }
+            if (wasRunning)
+                armTimer();
 
-            return false;
+            return wasRunning;
         }
 
         void Timer::onTimerCallback()
         {
             std::lock_guard<std::mutex> guard(m_callMutex);
 
-            std::list <int> itemsToDelete;
+            // Take out everything that is due, or nearly due, before handling any of it, so a timer that is
+            // rescheduled into the window is left for the next callback
+            std::chrono::system_clock::time_point limit = std::chrono::system_clock::now() + toDuration(TIMER_COALESCE_WINDOW);
+            std::vector <int> dueItems;
 
-            for (auto it = m_runningItems.cbegin(); it != m_runningItems.cend(); ++it)
+            while (!m_schedule.empty() && m_schedule.cbegin()->first <= limit)
             {
-                unsigned int timerId = *it;
-                if (timerId < 0 || timerId >= m_timerItems.size())
-                {
-                    LOGERR("Internal error: wrong timerId");
-                    continue;
-                }
-                if (m_timerItems[timerId].state != RUNNING)
-                {
-                    LOGERR("Internal error: timer %d has wrong state", timerId);
-                    continue;
-                }
+                dueItems.push_back(m_schedule.cbegin()->second);
+                m_schedule.erase(m_schedule.cbegin());
+            }
 
-                std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - m_timerItems[timerId].lastExpired;
-                double timeout =  m_timerItems[timerId].interval - elapsed.count();
+            for (int timerId : dueItems)
+            {
+                TimerItem& item = m_timerItems[timerId];
 
-                if (!m_timerItems[timerId].reminderSent && m_timerItems[timerId].remindBefore > TIMER_ACCURACY)
+                if (!item.reminderSent && item.remindBefore > TIMER_ACCURACY)
                 {
-                    if (timeout < m_timerItems[timerId].remindBefore + TIMER_ACCURACY)
-                    {
-                        sendTimerExpiryReminder(timerId);
-                        m_timerItems[timerId].reminderSent = true;
-                    }
+                    sendTimerExpiryReminder(timerId);
+                    item.lastExpiryReminder = std::chrono::system_clock::now();
+                    item.reminderSent = true;
                 }
-
-                if (timeout <= TIMER_ACCURACY)
+                else
                 {
                     sendTimerExpired(timerId);
 
-                    m_timerItems[timerId].lastExpired = std::chrono::system_clock::now();
+                    item.lastExpired = std::chrono::system_clock::now();
+                    item.reminderSent = false;
 
-                    if (m_timerItems[timerId].repeatInterval > 0)
+                    if (item.repeatInterval > 0)
                     {
-                        m_timerItems[timerId].interval = m_timerItems[timerId].repeatInterval;
+                        item.interval = item.repeatInterval;
                     }
                     else
                     {
-                        m_timerItems[timerId].state = EXPIRED;
-                        itemsToDelete.push_back(timerId);
+                        item.state = EXPIRED;
+                        continue;
                     }
-
-                    m_timerItems[timerId].reminderSent = false;
                 }
-            }
-
-            for (auto delIt = itemsToDelete.cbegin(); delIt != itemsToDelete.cend(); ++delIt)
-            {
-                auto it = std::find(m_runningItems.begin(), m_runningItems.end(), *delIt);
-                if (m_runningItems.end() != it)
-                    m_runningItems.erase(it);
 
+                scheduleTimer(timerId);
             }
 
-            checkTimers();
+            // TpTimer rearms itself with the last interval after this returns, so always set it here
+            armTimer(true);
         }
 
         void Timer::getTimerStatus(int timerId, JsonObject& output, bool writeTimerId)
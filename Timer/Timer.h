@@ -20,6 +20,7 @@
 #pragma once
 
 #include <mutex>
+#include <set>
 
 #include "Module.h"
 #include "utils.h"
@@ -55,6 +56,7 @@ namespace WPEFramework {
             std::chrono::system_clock::time_point lastExpired;
             std::chrono::system_clock::time_point lastExpiryReminder;
             bool reminderSent;
+            std::chrono::system_clock::time_point deadline; // Key in the schedule while RUNNING
         };
 
 		// This is a server for a JSONRPC communication channel.
@@ -90,7 +92,9 @@ namespace WPEFramework {
             void sendTimerExpiryReminder(int timerId);
             //End events
 
-            void checkTimers();
+            void scheduleTimer(int timerId);
+            bool unscheduleTimer(int timerId);
+            void armTimer(bool force = false);
 
             void startTimer(int timerId);
             bool cancelTimer(int timerId);
@@ -109,7 +113,9 @@ namespace WPEFramework {
         private:
             TpTimer m_timer;
             std::vector <TimerItem> m_timerItems;
-            std::list <int> m_runningItems;
+            // Running timers ordered by their next reminder or expiry, the OS timer is armed for the first one
+            std::set <std::pair<std::chrono::system_clock::time_point, int>> m_schedule;
+            std::chrono::system_clock::time_point m_armedDeadline;
             std::mutex m_callMutex;
         };
 	} // namespace Plugin
@@ -101,14 +101,6 @@ namespace Plugin {
             });
             return result;
         }
-
-        time_t fileModTime(const char* filename) {
-            struct stat st;
-            time_t mod_time;
-            if (stat(filename, &st) == 0)
-                mod_time = st.st_mtime;
-            return mod_time;
-        }
     }
 
     SERVICE_REGISTRATION(UsbAccess, UsbAccess::API_VERSION_NUMBER_MAJOR, UsbAccess::API_VERSION_NUMBER_MINOR);
@@ -140,12 +132,26 @@ namespace Plugin {
     const string UsbAccess::Initialize(PluginHost::IShell * /* service */)
     {
         InitializeIARM();
+
+        std::list<string> paths;
+        getMounted(paths);
+        for (auto const& path : paths)
+            startIndex(path);
+
         return "";
     }
 
     void UsbAccess::Deinitialize(PluginHost::IShell * /* service */)
     {
         DeinitializeIARM();
+
+        std::map<string, std::shared_ptr<UsbIndex>> indexes;
+        {
+            std::lock_guard<std::mutex> lock(m_indexMutex);
+            indexes.swap(m_indexes);
+        }
+        for (auto const& it : indexes)
+            it.second->stop();
     }
 
     string UsbAccess::Information() const
@@ -164,25 +170,70 @@ namespace Plugin {
         if (parameters.HasLabel("path"))
             pathParam = parameters["path"].String();
 
+        UsbIndex::Filter filter;
+        uint32_t offset = 0;
+        uint32_t limit = 0;
+        getDefaultNumberParameter("offset", offset, 0);
+        getDefaultNumberParameter("limit", limit, 0);
+        getDefaultBoolParameter("recursive", filter.recursive, false);
+        getDefaultBoolParameter("includeFolders", filter.includeFolders, true);
+        getDefaultStringParameter("prefix", filter.prefix, "");
+
+        // The media file pattern applies unless the caller asks for something else
+        string regex = REGEX_FILE;
+        if (parameters.HasLabel("extensions"))
+        {
+            JsonArray extensions = parameters["extensions"].Array();
+            for (int i = 0; i < extensions.Length(); i++)
+            {
+                string extension = extensions[i].String();
+                extension.erase(0, extension.find_first_not_of('.'));
+                std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+                if (!extension.empty())
+                    filter.extensions.push_back(extension);
+            }
+            regex.clear();
+        }
+        if (parameters.HasLabel("regex"))
+            regex = parameters["regex"].String();
+
+        try
+        {
+            filter.setRegex(regex);
+        }
+        catch (const std::regex_error& e)
+        {
+            LOGERR("invalid regex '%s': %s", regex.c_str(), e.what());
+            response["error"] = "invalid regex";
+            returnResponse(false);
+        }
+
         FileList files;
+        uint32_t total = 0;
         std::list<string> paths;
         getMounted(paths);
         if (!paths.empty())
-            result = getFileList(joinPaths(*paths.begin(), pathParam), files, REGEX_FILE, true);
+            result = getFileList(joinPaths(*paths.begin(), pathParam), files, filter, offset, limit, total);
 
         if (!result)
             response["error"] = "not found";
         else
         {
             JsonArray arr;
-            for_each(files.begin(), files.end(), [&arr](const FileEnt& it)
+            for_each(files.begin(), files.end(), [&arr](const UsbIndex::Entry& it)
             {
                 JsonObject ent;
-                ent["name"] = it.filename;
-                ent["t"] = string(1, it.fileType);
+                ent["name"] = it.name;
+                ent["t"] = string(1, it.type);
+                if (it.type == 'f')
+                {
+                    ent["size"] = it.size;
+                    ent["mtime"] = it.mtime;
+                }
                 arr.Add(ent);
             });
             response["contents"] = arr;
+            response["total"] = total;
         }
 
         returnResponse(result);
@@ -233,24 +284,29 @@ namespace Plugin {
             for (auto jt = ADDITIONAL_FW_PATHS.begin(); jt != ADDITIONAL_FW_PATHS.end(); ++jt)
                 paths.insert(it, joinPaths(*it, *jt));
 
+        UsbIndex::Filter filter;
+        filter.includeFolders = false;
+        filter.setRegex(deviceSpecificRegexBin());
+
         JsonArray arr;
-        std::list<string> allFiles;
-        for_each(paths.begin(), paths.end(), [&allFiles](const string& it)
+        std::vector<std::pair<string, int64_t>> allFiles;
+        for_each(paths.begin(), paths.end(), [this, &filter, &allFiles](const string& it)
         {
             FileList files;
-            getFileList(it, files, deviceSpecificRegexBin(), false);
-            for_each(files.begin(), files.end(), [&allFiles, &it](const FileEnt& jt) {
-                allFiles.emplace_back(joinPaths(it, jt.filename));
+            uint32_t total = 0;
+            getFileList(it, files, filter, 0, 0, total);
+            for_each(files.begin(), files.end(), [&allFiles, &it](const UsbIndex::Entry& jt) {
+                allFiles.emplace_back(joinPaths(it, jt.name), jt.mtime);
             });
         });
         // sort list in ascending order based on time, with newest image being the last in the list.
-        allFiles.sort([](const string &a, const string &b)
+        std::stable_sort(allFiles.begin(), allFiles.end(), [](const std::pair<string, int64_t>& a, const std::pair<string, int64_t>& b)
         {
-            return std::difftime(fileModTime(a.c_str()), fileModTime(b.c_str())) < 0;
+            return a.second < b.second;
         });
-        for_each(allFiles.begin(), allFiles.end(), [&arr](const string& it)
+        for_each(allFiles.begin(), allFiles.end(), [&arr](const std::pair<string, int64_t>& it)
         {
-            arr.Add(it);
+            arr.Add(it.first);
         });
         response["availableFirmwareFiles"] = arr;
 
@@ -411,6 +467,11 @@ namespace Plugin {
 
     void UsbAccess::onUSBMountChanged(bool mounted, const string& device)
     {
+        if (mounted)
+            startIndex(device);
+        else
+            stopIndex(device);
+
         JsonObject params;
         params["mounted"] = mounted;
         params["device"] = device;
@@ -418,36 +479,71 @@ namespace Plugin {
     }
 
     // internal methods
-    bool UsbAccess::getFileList(const string& path, FileList& files, const string& fileRegex, bool includeFolders)
+    // Served from the index of the volume once it is complete, otherwise read from the device
+    bool UsbAccess::getFileList(const string& path, FileList& files, const UsbIndex::Filter& filter,
+                                uint32_t offset, uint32_t limit, uint32_t& total)
     {
-        bool result = false;
+        if (path.empty())
+            return false;
 
-        if (!path.empty())
+        std::shared_ptr<UsbIndex> index;
+        string relative;
         {
-            DIR *dirp = opendir(path.c_str());
-            if (dirp != nullptr)
+            std::lock_guard<std::mutex> lock(m_indexMutex);
+            for (auto const& it : m_indexes)
             {
-                files.clear();
-
-                struct dirent *dp;
-                while ((dp = readdir(dirp)) != nullptr)
+                const string& root = it.first;
+                if ((path.compare(0, root.size(), root) == 0) && ((path.size() == root.size()) || (path[root.size()] == '/')))
                 {
-                    if (((dp->d_type == DT_DIR) && includeFolders) ||
-                        ((dp->d_type != DT_DIR) && (fileRegex.empty() ||
-                            std::regex_match(dp->d_name, std::regex(fileRegex, std::regex_constants::icase)) == true)))
-                        files.push_back(
-                                {
-                                    dp->d_type == DT_DIR ? 'd' : 'f',
-                                    dp->d_name
-                                });
+                    index = it.second;
+                    relative = path.substr(root.size());
+                    break;
                 }
-                closedir(dirp);
+            }
+        }
 
-                result = true;
+        if (index && index->ready() && index->query(relative, filter, offset, limit, files, total))
+            return true;
+
+        return UsbIndex::scan(path, filter, offset, limit, files, total);
+    }
+
+    void UsbAccess::startIndex(const string& mountPath)
+    {
+        if (mountPath.empty())
+            return;
+
+        std::shared_ptr<UsbIndex> index = std::make_shared<UsbIndex>(mountPath);
+
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        if (m_indexes.find(index->root()) == m_indexes.end())
+        {
+            LOGINFO("indexing '%s'", index->root().c_str());
+            index->start();
+            m_indexes.emplace(index->root(), index);
+        }
+    }
+
+    void UsbAccess::stopIndex(const string& mountPath)
+    {
+        string root = mountPath;
+        while (root.size() > 1 && *root.rbegin() == '/')
+            root.erase(root.size() - 1);
+
+        std::shared_ptr<UsbIndex> index;
+        {
+            std::lock_guard<std::mutex> lock(m_indexMutex);
+            auto it = m_indexes.find(root);
+            if (it != m_indexes.end())
+            {
+                index = it->second;
+                m_indexes.erase(it);
             }
         }
 
-        return result;
+        // Outside of the lock, the walk may take a moment to wind down
+        if (index)
+            index->stop();
     }
 
     bool UsbAccess::getMounted(std::list <std::string>& paths)
@@ -3,7 +3,10 @@
 #include "Module.h"
 #include "utils.h"
 #include "AbstractPlugin.h"
+#include "UsbIndex.h"
 
+#include <memory>
+#include <mutex>
 #include <thread>
 
 namespace WPEFramework {
@@ -76,16 +79,18 @@ namespace Plugin {
         UsbAccess(const UsbAccess&) = delete;
         UsbAccess& operator=(const UsbAccess&) = delete;
 
-        struct FileEnt
-        {
-            char fileType; // 'f' or 'd'
-            string filename;
-        };
-        typedef std::list<FileEnt> FileList;
+        typedef std::vector<UsbIndex::Entry> FileList;
 
-        static bool getFileList(const string& path, FileList& files, const string& fileRegex, bool includeFolders);
+        bool getFileList(const string& path, FileList& files, const UsbIndex::Filter& filter,
+                         uint32_t offset, uint32_t limit, uint32_t& total);
         static bool getMounted(std::list<string>& paths);
 
+        void startIndex(const string& mountPath);
+        void stopIndex(const string& mountPath);
+
+        std::mutex m_indexMutex;
+        std::map<string, std::shared_ptr<UsbIndex>> m_indexes; // By mount path
+
         void archiveLogsInternal();
         void onArchiveLogs(ArchiveLogsError error);
         std::thread archiveLogsThread;
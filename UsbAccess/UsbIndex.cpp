@@ -0,0 +1,556 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "UsbIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+// Threads walking the volume when the index is (re)built
+#define USB_INDEX_WORKERS 4
+// Directory trees deeper than this are not indexed
+#define USB_INDEX_MAX_DEPTH 64
+#define USB_INDEX_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | \
+                              IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+namespace WPEFramework
+{
+    namespace Plugin
+    {
+        namespace {
+            std::string joinPath(const std::string& dir, const std::string& name)
+            {
+                return (dir.empty() ? name : (dir + '/' + name));
+            }
+
+            bool isDotEntry(const std::string& name)
+            {
+                return (name == "." || name == "..");
+            }
+
+            // Turns a path relative to the index root into the form used as key, refusing "." and ".."
+            bool relativePath(const std::string& path, std::string& result)
+            {
+                result.clear();
+
+                size_t start = 0;
+                while (start < path.size())
+                {
+                    size_t end = path.find('/', start);
+                    if (std::string::npos == end)
+                        end = path.size();
+
+                    if (end > start)
+                    {
+                        std::string component = path.substr(start, end - start);
+                        if (isDotEntry(component))
+                            return false;
+                        result = joinPath(result, component);
+                    }
+                    start = end + 1;
+                }
+
+                return true;
+            }
+
+            bool byName(const UsbIndex::Entry& entry, const std::string& name)
+            {
+                return (entry.name < name);
+            }
+        }
+
+        void UsbIndex::Filter::setRegex(const std::string& regex)
+        {
+            m_hasRegex = !regex.empty();
+            if (m_hasRegex)
+                m_regex = std::regex(regex, std::regex_constants::icase);
+        }
+
+        bool UsbIndex::Filter::matches(const std::string& name, char type) const
+        {
+            if (!prefix.empty() && (0 != strncasecmp(name.c_str(), prefix.c_str(), prefix.size())))
+                return false;
+
+            if ('d' == type)
+                return includeFolders;
+
+            if (!extensions.empty())
+            {
+                size_t dot = name.find_last_of('.');
+                if (std::string::npos == dot)
+                    return false;
+
+                std::string extension = name.substr(dot + 1);
+                std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+                if (std::find(extensions.begin(), extensions.end(), extension) == extensions.end())
+                    return false;
+            }
+
+            return (!m_hasRegex || std::regex_match(name, m_regex));
+        }
+
+        UsbIndex::UsbIndex(const std::string& root)
+        : m_root(root)
+        , m_watch(false)
+        , m_ready(false)
+        , m_stopping(false)
+        , m_inotifyFd(-1)
+        , m_stopFd(-1)
+        , m_complete(true)
+        {
+            while (m_root.size() > 1 && '/' == *m_root.rbegin())
+                m_root.erase(m_root.size() - 1);
+        }
+
+        UsbIndex::~UsbIndex()
+        {
+            stop();
+        }
+
+        void UsbIndex::start()
+        {
+            if (m_thread.joinable())
+                return;
+
+            m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            m_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (m_inotifyFd < 0 || m_stopFd < 0)
+            {
+                // Without change notifications the index would go stale, listings keep scanning
+                LOGERR("cannot watch '%s': %s", m_root.c_str(), strerror(errno));
+                if (m_inotifyFd >= 0)
+                    close(m_inotifyFd);
+                if (m_stopFd >= 0)
+                    close(m_stopFd);
+                m_inotifyFd = m_stopFd = -1;
+                return;
+            }
+
+            m_watch = true;
+            m_stopping = false;
+            m_thread = std::thread(&UsbIndex::run, this);
+        }
+
+        void UsbIndex::stop()
+        {
+            if (!m_thread.joinable())
+                return;
+
+            m_stopping = true;
+            uint64_t one = 1;
+            if (write(m_stopFd, &one, sizeof(one)) < 0)
+                LOGERR("failed to stop indexing '%s': %s", m_root.c_str(), strerror(errno));
+            m_thread.join();
+
+            m_ready = false;
+            close(m_inotifyFd);
+            close(m_stopFd);
+            m_inotifyFd = m_stopFd = -1;
+        }
+
+        bool UsbIndex::query(const std::string& path, const Filter& filter, uint32_t offset, uint32_t limit,
+                             std::vector<Entry>& entries, uint32_t& total) const
+        {
+            std::string base;
+            if (!relativePath(path, base))
+                return false;
+
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            auto it = m_dirs.find(base);
+            if (it == m_dirs.end())
+                return false;
+
+            entries.clear();
+            total = 0;
+
+            auto visit = [&](const std::string& key, const Directory& dir) {
+                const bool nested = (key.size() > base.size());
+                const std::string prefix = nested ? (key.substr(base.empty() ? 0 : (base.size() + 1)) + '/') : std::string();
+
+                for (const Entry& entry : dir)
+                {
+                    // "." and ".." are only listed for the queried directory itself
+                    if (nested && isDotEntry(entry.name))
+                        continue;
+
+                    if (!filter.matches(entry.name, entry.type))
+                        continue;
+
+                    if ((total >= offset) && ((0 == limit) || (entries.size() < limit)))
+                        entries.push_back({ prefix + entry.name, entry.type, entry.size, entry.mtime });
+                    total++;
+                }
+            };
+
+            visit(it->first, it->second);
+
+            if (filter.recursive)
+            {
+                // Keys of the subdirectories all start with "<base>/", so they follow each other in the map
+                const std::string sub = base.empty() ? base : (base + '/');
+                for (auto jt = m_dirs.lower_bound(sub); jt != m_dirs.end() && 0 == jt->first.compare(0, sub.size(), sub); ++jt)
+                {
+                    if (jt->first != base)
+                        visit(jt->first, jt->second);
+                }
+            }
+
+            return true;
+        }
+
+        bool UsbIndex::scan(const std::string& path, const Filter& filter, uint32_t offset, uint32_t limit,
+                            std::vector<Entry>& entries, uint32_t& total)
+        {
+            UsbIndex index(path);
+            index.walk(std::string(), filter.recursive ? USB_INDEX_WORKERS : 1, filter.recursive);
+            return index.query(std::string(), filter, offset, limit, entries, total);
+        }
+
+        void UsbIndex::run()
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            walk(std::string(), USB_INDEX_WORKERS, true);
+            if (m_stopping)
+                return;
+
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+
+                size_t count = 0;
+                for (const auto& dir : m_dirs)
+                    count += dir.second.size();
+
+                LOGINFO("indexed '%s': %zu directories, %zu entries in %lld ms%s", m_root.c_str(), m_dirs.size(), count,
+                    static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()),
+                    m_complete ? "" : ", not all directories are watched");
+
+                m_ready = m_complete;
+            }
+
+            struct pollfd fds[2] = { { m_inotifyFd, POLLIN, 0 }, { m_stopFd, POLLIN, 0 } };
+            char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+            while (!m_stopping)
+            {
+                if (poll(fds, 2, -1) < 0)
+                {
+                    if (EINTR == errno)
+                        continue;
+                    LOGERR("failed to wait for changes of '%s': %s", m_root.c_str(), strerror(errno));
+                    break;
+                }
+
+                if (0 != fds[1].revents)
+                    break;
+
+                ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+                if (length <= 0)
+                    continue;
+
+                const struct inotify_event* event;
+                for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len)
+                {
+                    event = reinterpret_cast<const struct inotify_event*>(ptr);
+                    handleEvent(event);
+                }
+            }
+
+            m_ready = false;
+        }
+
+        // Reads the tree below 'path' with 'workers' threads taking directories from a shared queue
+        void UsbIndex::walk(const std::string& path, unsigned int workers, bool recursive)
+        {
+            std::mutex queueLock;
+            std::condition_variable queueChanged;
+            std::deque<std::string> queue(1, path);
+            unsigned int busy = 0;
+
+            auto worker = [&]() {
+                std::unique_lock<std::mutex> lock(queueLock);
+                while (true)
+                {
+                    if (m_stopping)
+                        queue.clear();
+
+                    if (queue.empty())
+                    {
+                        if (0 == busy)
+                            break;
+                        queueChanged.wait(lock);
+                        continue;
+                    }
+
+                    std::string dir = queue.front();
+                    queue.pop_front();
+                    busy++;
+                    lock.unlock();
+
+                    Directory entries;
+                    std::vector<std::string> subdirs;
+                    if (readDirectory(dir, entries, subdirs))
+                    {
+                        std::lock_guard<std::mutex> guard(m_lock);
+                        m_dirs[dir].swap(entries);
+                    }
+
+                    lock.lock();
+                    if (recursive && (std::count(dir.begin(), dir.end(), '/') < USB_INDEX_MAX_DEPTH))
+                        queue.insert(queue.end(), subdirs.begin(), subdirs.end());
+                    busy--;
+                    queueChanged.notify_all();
+                }
+                queueChanged.notify_all();
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned int n = 1; n < workers; n++)
+                threads.emplace_back(worker);
+
+            worker();
+
+            for (auto& thread : threads)
+                thread.join();
+        }
+
+        bool UsbIndex::readDirectory(const std::string& path, Directory& entries, std::vector<std::string>& subdirs)
+        {
+            const std::string fullPath = path.empty() ? m_root : (m_root + '/' + path);
+
+            // Watch before reading, so nothing created in between is missed
+            if (m_watch)
+            {
+                int wd = inotify_add_watch(m_inotifyFd, fullPath.c_str(), USB_INDEX_WATCH_MASK);
+
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (wd >= 0)
+                    m_watches[wd] = path;
+                else
+                {
+                    if (m_complete)
+                        LOGWARN("cannot watch '%s': %s", fullPath.c_str(), strerror(errno));
+                    m_complete = false;
+                }
+            }
+
+            int fd = open(fullPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            DIR* dir = (fd >= 0) ? fdopendir(fd) : nullptr;
+            if (nullptr == dir)
+            {
+                if (ENOENT != errno)
+                    LOGERR("failed to open '%s': %s", fullPath.c_str(), strerror(errno));
+                if (fd >= 0)
+                    close(fd);
+                return false;
+            }
+
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != nullptr)
+            {
+                // Listed as folders, as they always were, but never walked into
+                if (isDotEntry(entry->d_name))
+                {
+                    struct stat st;
+                    entries.push_back({ entry->d_name, 'd', 0, (fstatat(fd, entry->d_name, &st, 0) == 0) ? static_cast<int64_t>(st.st_mtime) : 0 });
+                    continue;
+                }
+
+                // Links are listed as what they point to, but not followed into
+                struct stat st;
+                bool link = false;
+                if (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                    continue;
+                if (S_ISLNK(st.st_mode))
+                {
+                    link = true;
+                    if (fstatat(fd, entry->d_name, &st, 0) != 0)
+                        continue;
+                }
+
+                const bool isDir = S_ISDIR(st.st_mode);
+                entries.push_back({ entry->d_name, isDir ? 'd' : 'f', isDir ? 0 : static_cast<uint64_t>(st.st_size),
+                    static_cast<int64_t>(st.st_mtime) });
+
+                if (isDir && !link)
+                    subdirs.push_back(joinPath(path, entry->d_name));
+            }
+
+            closedir(dir);
+
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return (a.name < b.name); });
+
+            return true;
+        }
+
+        void UsbIndex::handleEvent(const struct inotify_event* event)
+        {
+            if (0 != (event->mask & IN_Q_OVERFLOW))
+            {
+                LOGWARN("missed changes of '%s', indexing again", m_root.c_str());
+                m_ready = false;
+                clear();
+                walk(std::string(), USB_INDEX_WORKERS, true);
+
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_ready = m_complete;
+                return;
+            }
+
+            if (0 != (event->mask & IN_UNMOUNT))
+            {
+                m_ready = false;
+                return;
+            }
+
+            std::string dir;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+
+                auto it = m_watches.find(event->wd);
+                if (it == m_watches.end())
+                    return;
+
+                if (0 != (event->mask & IN_IGNORED))
+                {
+                    m_watches.erase(it);
+                    return;
+                }
+
+                dir = it->second;
+            }
+
+            if (0 == event->len)
+                return;
+
+            const std::string name(event->name);
+
+            if (0 != (event->mask & (IN_DELETE | IN_MOVED_FROM)))
+            {
+                removeEntry(dir, name);
+                if (0 != (event->mask & IN_ISDIR))
+                    removeTree(joinPath(dir, name));
+            }
+            else
+            {
+                updateEntry(dir, name);
+                if ((0 != (event->mask & IN_ISDIR)) && (0 != (event->mask & (IN_CREATE | IN_MOVED_TO))))
+                {
+                    // Listings of the new tree would be incomplete until it has been read
+                    m_ready = false;
+                    walk(joinPath(dir, name), 1, true);
+
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    m_ready = m_complete;
+                }
+            }
+        }
+
+        void UsbIndex::updateEntry(const std::string& dir, const std::string& name)
+        {
+            const std::string fullPath = m_root + '/' + joinPath(dir, name);
+
+            struct stat st;
+            if ((lstat(fullPath.c_str(), &st) != 0) || (S_ISLNK(st.st_mode) && (stat(fullPath.c_str(), &st) != 0)))
+            {
+                removeEntry(dir, name);
+                return;
+            }
+
+            const bool isDir = S_ISDIR(st.st_mode);
+            Entry entry = { name, isDir ? 'd' : 'f', isDir ? 0 : static_cast<uint64_t>(st.st_size), static_cast<int64_t>(st.st_mtime) };
+
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            auto it = m_dirs.find(dir);
+            if (it == m_dirs.end())
+                return;
+
+            Directory& entries = it->second;
+            auto position = std::lower_bound(entries.begin(), entries.end(), name, byName);
+            if (position != entries.end() && position->name == name)
+                *position = entry;
+            else
+                entries.insert(position, entry);
+        }
+
+        void UsbIndex::removeEntry(const std::string& dir, const std::string& name)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            auto it = m_dirs.find(dir);
+            if (it == m_dirs.end())
+                return;
+
+            Directory& entries = it->second;
+            auto position = std::lower_bound(entries.begin(), entries.end(), name, byName);
+            if (position != entries.end() && position->name == name)
+                entries.erase(position);
+        }
+
+        void UsbIndex::removeTree(const std::string& path)
+        {
+            const std::string sub = path + '/';
+
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            m_dirs.erase(path);
+            auto it = m_dirs.lower_bound(sub);
+            while (it != m_dirs.end() && 0 == it->first.compare(0, sub.size(), sub))
+                it = m_dirs.erase(it);
+
+            // A moved directory is still watched under its old name, it is indexed again if it shows up
+            for (auto jt = m_watches.begin(); jt != m_watches.end(); )
+            {
+                if (jt->second == path || 0 == jt->second.compare(0, sub.size(), sub))
+                {
+                    inotify_rm_watch(m_inotifyFd, jt->first);
+                    jt = m_watches.erase(jt);
+                }
+                else
+                    ++jt;
+            }
+        }
+
+        void UsbIndex::clear()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            m_dirs.clear();
+            m_complete = true;
+        }
+
+    } // namespace Plugin
+} // namespace WPEFramework
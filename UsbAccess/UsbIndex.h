@@ -0,0 +1,122 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+struct inotify_event;
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Name, size and modification time of everything below a mounted USB volume, so listings
+        // don't have to go back to the (slow) device. The volume is walked once by a few threads in
+        // parallel when the index is started, after that inotify keeps it up to date. Until the
+        // walk has finished, or if the volume could not be watched completely, ready() is false and
+        // callers are expected to fall back to scan().
+        class UsbIndex {
+        public:
+            struct Entry {
+                std::string name;   // Relative to the queried directory
+                char type;          // 'f' or 'd'
+                uint64_t size;
+                int64_t mtime;
+            };
+
+            class Filter {
+            public:
+                Filter() : includeFolders(true), recursive(false), m_hasRegex(false) {}
+
+                // Throws std::regex_error for an invalid expression
+                void setRegex(const std::string& regex);
+
+                // Folders are only filtered by prefix, files by all criteria
+                bool matches(const std::string& name, char type) const;
+
+                std::vector<std::string> extensions; // Lower case, without the dot
+                std::string prefix;
+                bool includeFolders;
+                bool recursive;
+
+            private:
+                bool m_hasRegex;
+                std::regex m_regex;
+            };
+
+            explicit UsbIndex(const std::string& root);
+            ~UsbIndex();
+
+            const std::string& root() const { return m_root; }
+            bool ready() const { return m_ready; }
+
+            void start();
+            void stop();
+
+            // Fills in the matching entries of the directory at 'path' (relative to the root) from
+            // 'offset' on, at most 'limit' of them unless that is 0, and sets 'total' to the number
+            // of matches. Returns false if the directory is not in the index.
+            bool query(const std::string& path, const Filter& filter, uint32_t offset, uint32_t limit,
+                       std::vector<Entry>& entries, uint32_t& total) const;
+
+            // The same without an index, reading the directory (tree) at 'path' right away
+            static bool scan(const std::string& path, const Filter& filter, uint32_t offset, uint32_t limit,
+                             std::vector<Entry>& entries, uint32_t& total);
+
+        private:
+            UsbIndex(const UsbIndex&) = delete;
+            UsbIndex& operator=(const UsbIndex&) = delete;
+
+            typedef std::vector<Entry> Directory; // Sorted by name
+
+            void run();
+            void walk(const std::string& path, unsigned int workers, bool recursive);
+            bool readDirectory(const std::string& path, Directory& entries, std::vector<std::string>& subdirs);
+            void handleEvent(const struct inotify_event* event);
+            void updateEntry(const std::string& dir, const std::string& name);
+            void removeEntry(const std::string& dir, const std::string& name);
+            void removeTree(const std::string& path);
+            void clear();
+
+            std::string m_root;
+            bool m_watch;
+            std::atomic<bool> m_ready;
+            std::atomic<bool> m_stopping;
+            int m_inotifyFd;
+            int m_stopFd;
+            std::thread m_thread;
+
+            mutable std::mutex m_lock;
+            std::map<std::string, Directory> m_dirs; // By path relative to the root, "" is the root
+            std::unordered_map<int, std::string> m_watches;
+            bool m_complete;
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
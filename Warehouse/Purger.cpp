@@ -0,0 +1,275 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "Purger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+// Directory trees deeper than this are left alone rather than running out of descriptors
+#define PURGE_MAX_DEPTH 64
+
+namespace WPEFramework
+{
+    namespace Plugin
+    {
+        static void countFailure(Purger::Result& result, int error)
+        {
+            result.failures++;
+            if (EACCES == error || EPERM == error)
+                result.denied++;
+        }
+
+        Purger::Purger(bool dryRun, unsigned int workers)
+        : m_dryRun(dryRun)
+        , m_workers(workers > 0 ? workers : 1)
+        {
+        }
+
+        bool Purger::resolve(const std::string& entry, std::string& path, const std::map<std::string, std::string>& defaults)
+        {
+            path = entry;
+
+            if (!entry.empty() && (isupper(entry[0]) || '_' == entry[0]))
+            {
+                size_t end = entry.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_");
+                std::string var = entry.substr(0, end);
+                const char *envVar = getenv(var.c_str());
+
+                std::string value = (envVar != nullptr) ? envVar : "";
+                if (value.empty())
+                {
+                    auto it = defaults.find(var);
+                    if (it != defaults.end())
+                        value = it->second;
+                }
+
+                if (value.empty())
+                {
+                    LOGINFO("skipping '%s', %s is not set", entry.c_str(), var.c_str());
+                    return false;
+                }
+
+                path = value + ((std::string::npos != end) ? entry.substr(end) : std::string());
+            }
+
+            size_t nr = path.find_first_not_of('/');
+            if (path.empty() || '/' != path[0] || std::string::npos == nr || '*' == path[nr])
+            {
+                LOGWARN("skipping '%s', resolved to '%s'", entry.c_str(), path.c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+        void Purger::add(const std::string& pattern)
+        {
+            glob_t matches;
+            memset(&matches, 0, sizeof(matches));
+
+            int rc = glob(pattern.c_str(), GLOB_NOSORT, nullptr, &matches);
+            if (0 == rc)
+            {
+                for (size_t i = 0; i < matches.gl_pathc; i++)
+                    m_paths.emplace_back(matches.gl_pathv[i]);
+            }
+            else if (GLOB_NOMATCH != rc)
+            {
+                LOGWARN("failed to expand '%s': %d", pattern.c_str(), rc);
+            }
+
+            globfree(&matches);
+        }
+
+        Purger::Result Purger::run(const ProgressCallback& progress)
+        {
+            Result total;
+            const uint32_t count = m_paths.size();
+            if (0 == count)
+            {
+                if (progress)
+                    progress(0, 0, total);
+                return total;
+            }
+
+            std::atomic<uint32_t> next(0);
+            std::mutex totalMutex;
+            uint32_t completed = 0;
+            std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+
+            auto worker = [&]() {
+                uint32_t index;
+                while ((index = next++) < count)
+                {
+                    Result result;
+                    purgePath(m_paths[index], result);
+
+                    std::lock_guard<std::mutex> lock(totalMutex);
+                    total.files += result.files;
+                    total.bytes += result.bytes;
+                    total.failures += result.failures;
+                    total.denied += result.denied;
+                    completed++;
+
+                    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                    if (progress && ((completed == count) ||
+                        (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastReport).count() >= ProgressInterval)))
+                    {
+                        lastReport = now;
+                        progress(completed, count, total);
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            const unsigned int workers = std::min<unsigned int>(m_workers, count);
+            for (unsigned int n = 1; n < workers; n++)
+                threads.emplace_back(worker);
+
+            worker();
+
+            for (auto& thread : threads)
+                thread.join();
+
+            return total;
+        }
+
+        void Purger::purgePath(const std::string& path, Result& result) const
+        {
+            // Split into the parent directory and the name to remove from it, ignoring trailing slashes
+            size_t end = path.find_last_not_of('/');
+            if (std::string::npos == end)
+            {
+                LOGERR("refusing to remove '%s'", path.c_str());
+                result.failures++;
+                return;
+            }
+
+            std::string name = path.substr(0, end + 1);
+            std::string parent = ".";
+            size_t slash = name.find_last_of('/');
+            if (std::string::npos != slash)
+            {
+                parent = (0 == slash) ? std::string("/") : name.substr(0, slash);
+                name = name.substr(slash + 1);
+            }
+
+            if (name == "." || name == "..")
+            {
+                LOGERR("refusing to remove '%s'", path.c_str());
+                result.failures++;
+                return;
+            }
+
+            int dirFd = open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dirFd < 0)
+            {
+                int error = errno;
+                if (ENOENT != error)
+                {
+                    LOGERR("failed to open '%s': %s", parent.c_str(), strerror(error));
+                    countFailure(result, error);
+                }
+                return;
+            }
+
+            purgeAt(dirFd, name.c_str(), result, 0);
+            close(dirFd);
+        }
+
+        void Purger::purgeAt(int dirFd, const char* name, Result& result, unsigned int depth) const
+        {
+            struct stat st;
+            if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                int error = errno;
+                if (ENOENT != error)
+                {
+                    LOGERR("failed to stat '%s': %s", name, strerror(error));
+                    countFailure(result, error);
+                }
+                return;
+            }
+
+            if (S_ISDIR(st.st_mode))
+            {
+                if (depth >= PURGE_MAX_DEPTH)
+                {
+                    LOGERR("'%s' is nested too deep", name);
+                    result.failures++;
+                    return;
+                }
+
+                int fd = openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                DIR* dir = (fd >= 0) ? fdopendir(fd) : nullptr;
+                if (nullptr == dir)
+                {
+                    int error = errno;
+                    LOGERR("failed to open '%s': %s", name, strerror(error));
+                    if (fd >= 0)
+                        close(fd);
+                    countFailure(result, error);
+                    return;
+                }
+
+                struct dirent* entry;
+                while ((entry = readdir(dir)) != nullptr)
+                {
+                    if (0 == strcmp(entry->d_name, ".") || 0 == strcmp(entry->d_name, ".."))
+                        continue;
+                    purgeAt(fd, entry->d_name, result, depth + 1);
+                }
+
+                closedir(dir);
+            }
+
+            if (!m_dryRun && unlinkat(dirFd, name, S_ISDIR(st.st_mode) ? AT_REMOVEDIR : 0) != 0)
+            {
+                int error = errno;
+                if (ENOENT != error)
+                {
+                    LOGERR("failed to remove '%s': %s", name, strerror(error));
+                    countFailure(result, error);
+                }
+                return;
+            }
+
+            result.files++;
+            if (!S_ISDIR(st.st_mode) && st.st_nlink <= 1)
+                result.bytes += static_cast<uint64_t>(st.st_blocks) * 512;
+        }
+
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,79 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Removes files and directory trees in-process, the equivalent of "rm -rf <patterns>".
+        // Patterns are expanded with glob(3), so like in the shell a '*' does not match names starting
+        // with a dot. The expanded paths are shared between a few worker threads, each removing its
+        // trees with openat()/unlinkat() relative to the parent directory, so nothing is resolved by
+        // full path twice and symbolic links are removed rather than followed.
+        // Only one worker walks each expanded path, so a single large tree is not removed any faster.
+        // In dry run mode the trees are only walked and counted.
+        class Purger {
+        public:
+            struct Result {
+                Result() : files(0), bytes(0), failures(0), denied(0) {}
+                uint32_t files;     // Objects removed, directories included
+                uint64_t bytes;     // Disk space released, hard linked files are not counted
+                uint32_t failures;  // Objects that could not be removed
+                uint32_t denied;    // Of these, the ones failing with EACCES or EPERM
+            };
+
+            // Called from the worker threads with the totals so far, at most every ProgressInterval
+            // milliseconds and once when all paths are done
+            typedef std::function<void(uint32_t completed, uint32_t count, const Result& total)> ProgressCallback;
+
+            static const uint32_t ProgressInterval = 250;
+
+            Purger(bool dryRun, unsigned int workers = 4);
+
+            // Replaces a leading environment variable name in a path ("HOME/.cache") with its value, or
+            // with the one in 'defaults' if it is not set. Returns false for paths that must be skipped:
+            // the variable is empty, or the path would be relative or match the root directory.
+            static bool resolve(const std::string& entry, std::string& path,
+                                const std::map<std::string, std::string>& defaults = std::map<std::string, std::string>());
+
+            void add(const std::string& pattern);
+            const std::vector<std::string>& paths() const { return m_paths; }
+
+            Result run(const ProgressCallback& progress = ProgressCallback());
+
+        private:
+            void purgePath(const std::string& path, Result& result) const;
+            void purgeAt(int dirFd, const char* name, Result& result, unsigned int depth) const;
+
+            bool m_dryRun;
+            unsigned int m_workers;
+            std::vector<std::string> m_paths;
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -18,12 +18,11 @@
 **/
 
 #include "Warehouse.h"
+#include "Purger.h"
 
 #include <algorithm>
 #include <fstream>
 
-#include <regex.h>
-
 #if defined(USE_IARMBUS) || defined(USE_IARM_BUS)
 #include "libIBus.h"
 #include "sysMgr.h"
@@ -55,6 +54,7 @@
 
 #define WAREHOUSE_EVT_DEVICE_INFO_RETRIEVED "deviceInfoRetrieved"
 #define WAREHOUSE_EVT_RESET_DONE "resetDone"
+#define WAREHOUSE_EVT_RESET_PROGRESS "resetProgress"
 
 #define HOSTS_FILE "/etc/warehouseHosts.conf"
 #define DEFAULT_CNAME_TAIL ".warehouse.ccp.xcal.tv"
@@ -66,8 +66,30 @@
 #define VERSION_FILE_NAME "/version.txt"
 #define CUSTOM_DATA_FILE "/lib/rdk/wh_api_5.conf"
 
-#define LIGHT_RESET_SCRIPT "rm -rf /opt/netflix/* SD_CARD_MOUNT_PATH/netflix/* XDG_DATA_HOME/* XDG_CACHE_HOME/* XDG_CACHE_HOME/../.sparkStorage/ /opt/QT/home/data/* /opt/hn_service_settings.conf /opt/apps/common/proxies.conf /opt/lib/bluetooth /opt/persistent/rdkservicestore"
-#define INTERNAL_RESET_SCRIPT "rm -rf /opt/drm /opt/www/whitebox /opt/www/authService && /rebootNow.sh -s WarehouseService &"
+#define INTERNAL_RESET_SCRIPT "/rebootNow.sh -s WarehouseService &"
+#define SD_CARD_DEVICE "mmcblk0p1"
+#define PURGE_WORKERS 4
+
+// Paths removed by lightReset and internalReset. A leading upper case name is replaced with the value
+// of that environment variable, paths with an empty variable are skipped.
+static const char* lightResetPaths[] = {
+    "/opt/netflix/*",
+    "SD_CARD_MOUNT_PATH/netflix/*",
+    "XDG_DATA_HOME/*",
+    "XDG_CACHE_HOME/*",
+    "XDG_CACHE_HOME/../.sparkStorage/",
+    "/opt/QT/home/data/*",
+    "/opt/hn_service_settings.conf",
+    "/opt/apps/common/proxies.conf",
+    "/opt/lib/bluetooth",
+    "/opt/persistent/rdkservicestore"
+};
+
+static const char* internalResetPaths[] = {
+    "/opt/drm",
+    "/opt/www/whitebox",
+    "/opt/www/authService"
+};
 
 #define FRONT_PANEL_NONE -1
 #define FRONT_PANEL_INPROGRESS 1
@@ -469,7 +491,7 @@ namespace WPEFramework
 #endif
         }
 
-        void Warehouse::internalReset(JsonObject& response)
+        void Warehouse::internalReset(bool dryRun, JsonObject& response)
         {
             bool isProd = false;
 
@@ -499,11 +521,15 @@ namespace WPEFramework
             else
             {
 #if defined(USE_IARMBUS) || defined(USE_IARM_BUS)
-                std::string error;
-                bool ok = RunScriptIARM(INTERNAL_RESET_SCRIPT, error);
-                response[PARAM_SUCCESS] = ok;
-                if (!ok)
-                    response[PARAM_ERROR] = error;
+                bool ok = purge("internalReset", internalResetPaths, sizeof(internalResetPaths) / sizeof(internalResetPaths[0]), dryRun, response);
+                if (ok && !dryRun)
+                {
+                    std::string error;
+                    ok = RunScriptIARM(INTERNAL_RESET_SCRIPT, error);
+                    response[PARAM_SUCCESS] = ok;
+                    if (!ok)
+                        response[PARAM_ERROR] = error;
+                }
 #else
                 response[PARAM_SUCCESS] = false;
                 response[PARAM_ERROR] = "No IARMBUS";
@@ -511,87 +537,88 @@ namespace WPEFramework
             }
         }
 
-        void Warehouse::lightReset(JsonObject& response)
+        // Returns the mount point of the SD card, as "grep mmcblk0p1 /proc/mounts | awk '{print $2}'" would
+        static std::string getSDCardMountPath()
         {
-#if defined(USE_IARMBUS) || defined(USE_IARM_BUS)
+            std::ifstream mounts("/proc/mounts");
+            std::string device, mountPoint, rest;
 
-            std::string script(LIGHT_RESET_SCRIPT);
-            regex_t rx;
-            regcomp(&rx, "(\\s+)([A-Z_][0-9A-Z_]*)(\\S*)", REG_EXTENDED);
-            regmatch_t rm[4];
-
-            int pos = 0;
-            while (regexec(&rx, script.c_str() + pos, 4, rm, 0) == REG_NOERROR)
+            while (mounts >> device >> mountPoint && std::getline(mounts, rest))
             {
-                std::string var = script.substr(pos + rm[2].rm_so, rm[2].rm_eo - rm[2].rm_so);
-                std::string replace;
-                const char *envVar = getenv(var.c_str());
-
-                std::string scmp;
-                if ("SD_CARD_MOUNT_PATH" == var && (!envVar || 0 == *envVar))
-                {
-
-                    FILE *p = popen("cat  /proc/mounts | grep mmcblk0p1 | awk '{print $2}' ", "r");
-
-                    if(!p)
-                    {
-                        LOGWARN("failed to run script to get SD_CARD_MOUNT_PATH");
-                    }
-                    else
-                    {
-                        char buf[256];
-                        while(fgets(buf, sizeof(buf), p) != NULL)
-                            scmp += buf;
+                if (device.find(SD_CARD_DEVICE) != std::string::npos)
+                    return mountPoint;
+            }
 
-                        scmp.erase(0, scmp.find_first_not_of(" \n\r\t"));
-                        scmp.erase(scmp.find_last_not_of(" \n\r\t") + 1);
+            return std::string();
+        }
 
-                        envVar = scmp.c_str();
-                        pclose(p);
-                    }
-                }
+        bool Warehouse::purge(const char* operation, const char* const entries[], size_t count, bool dryRun, JsonObject& response)
+        {
+            Purger purger(dryRun, PURGE_WORKERS);
+            const std::map<std::string, std::string> defaults { { "SD_CARD_MOUNT_PATH", getSDCardMountPath() } };
+            std::string script = "rm -rf";
 
-                if (envVar && *envVar)
+            for (size_t i = 0; i < count; i++)
+            {
+                std::string path;
+                if (Purger::resolve(entries[i], path, defaults))
                 {
-                    replace += envVar;
-                    replace += script.substr(pos + rm[3].rm_so, rm[3].rm_eo - rm[3].rm_so);
-                    if (replace.size() > 0)
-                    {
-                        if ('/' == replace[0])
-                        {
-                            size_t nr = replace.find_first_not_of('/');
-                            if (string::npos != nr && '*' != replace[nr]) // Check if that is not root dir
-                                replace = script.substr(pos + rm[1].rm_so, rm[1].rm_eo - rm[1].rm_so) + replace;
-                            else 
-                                replace = "";
-                        }
-                        else
-                            replace = script.substr(pos + rm[1].rm_so, rm[1].rm_eo - rm[1].rm_so) + replace;
-                    }
+                    purger.add(path);
+                    script += " " + path;
                 }
-                script.replace(pos + rm[0].rm_so, rm[0].rm_eo - rm[0].rm_so, replace);
-                pos += rm[0].rm_so + replace.size();
             }
 
-            LOGWARN("lightReset: %s", script.c_str());
+            LOGWARN("%s: %s %d paths", operation, dryRun ? "checking" : "removing", (int)purger.paths().size());
+
+            Purger::Result result = purger.run([this, operation, dryRun](uint32_t completed, uint32_t total, const Purger::Result& progress) {
+                JsonObject params;
+                params["operation"] = operation;
+                params["dryRun"] = dryRun;
+                params["completed"] = completed;
+                params["total"] = total;
+                params["filesRemoved"] = progress.files;
+                params["bytesFreed"] = progress.bytes;
+                sendNotify(WAREHOUSE_EVT_RESET_PROGRESS, params);
+            });
+
+            LOGWARN("%s: %s %u objects, %llu bytes, %u failures", operation, dryRun ? "found" : "removed",
+                    result.files, (unsigned long long)result.bytes, result.failures);
+
+#if defined(USE_IARMBUS) || defined(USE_IARM_BUS)
+            // This data used to be removed by a script run as root by sysMgr. What the plugin's own user
+            // may not remove is left to that script, the objects it removes are not counted.
+            if (!dryRun && result.denied > 0)
+            {
+                std::string error;
+                LOGWARN("%s: %u objects not permitted, running '%s'", operation, result.denied, script.c_str());
+                if (RunScriptIARM(script, error))
+                    result.failures -= result.denied;
+                else
+                    LOGERR("%s: %s", operation, error.c_str());
+            }
+#endif
 
-            std::string error;
-            bool ok = RunScriptIARM(script, error);
+            bool ok = (0 == result.failures);
             response[PARAM_SUCCESS] = ok;
+            response["filesRemoved"] = result.files;
+            response["bytesFreed"] = result.bytes;
+            if (!ok)
+                response[PARAM_ERROR] = "failed to remove " + std::to_string(result.failures) + " objects";
+
+            return ok;
+        }
+
+        void Warehouse::lightReset(bool dryRun, JsonObject& response)
+        {
+            bool ok = purge("lightReset", lightResetPaths, sizeof(lightResetPaths) / sizeof(lightResetPaths[0]), dryRun, response);
             if (ok)
             {
                 LOGWARN("lightReset succeeded");
             }
             else
             {
-                LOGERR("lightReset failed. %s", error.c_str());
-                response[PARAM_ERROR] = error;
+                LOGERR("lightReset failed");
             }
-#else
-            LOGERR("lightReset failed: No IARMBUS");
-            response[PARAM_SUCCESS] = false;
-            response[PARAM_ERROR] = "No IARMBUS";
-#endif
         }
 
         void Warehouse::isClean(int age, JsonObject& response)
@@ -853,7 +880,10 @@ namespace WPEFramework
 
             if (parameters.HasLabel("passPhrase") && parameters["passPhrase"].String() == "FOR TEST PURPOSES ONLY")
             {
-                internalReset(response);
+                bool dryRun = false;
+                getDefaultBoolParameter("dryRun", dryRun, false);
+
+                internalReset(dryRun, response);
                 return (Core::ERROR_NONE); 
             }
             else
@@ -868,7 +898,10 @@ namespace WPEFramework
         {
             LOGINFOMETHOD();
 
-            lightReset(response);
+            bool dryRun = false;
+            getDefaultBoolParameter("dryRun", dryRun, false);
+
+            lightReset(dryRun, response);
             return Core::ERROR_NONE;
         }
 
@@ -84,8 +84,9 @@ namespace WPEFramework {
             void resetDevice(bool suppressReboot, const string& resetType = string());
             std::vector<std::string>  getAllowedCNameTails();
             void setFrontPanelState(int state, JsonObject& response);
-            void internalReset(JsonObject& response);
-            void lightReset(JsonObject& response);
+            void internalReset(bool dryRun, JsonObject& response);
+            void lightReset(bool dryRun, JsonObject& response);
+            bool purge(const char* operation, const char* const entries[], size_t count, bool dryRun, JsonObject& response);
             void isClean(int age, JsonObject& response);
             bool executeHardwareTest() const;
             bool getHardwareTestResults(string& testResults) const;
@@ -21,6 +21,8 @@
 #include "BridgeObject.h"
 #include "../Tags.h"
 
+#include <algorithm>
+
 namespace WPEFramework {
 namespace JavaScript {
 namespace BridgeObject {
@@ -45,60 +47,179 @@ const char kBadgerReplySrc[] = R"jssrc(
 )jssrc";
 
 const char kBadgerEventSrc[] = R"jssrc(
-(function(payload) {
-  var obj = JSON.parse(payload)
-  window.$badger.event(obj.handlerId, obj.json)
+(function() {
+  for (var i = 0; i < arguments.length; i++) {
+    try {
+      var obj = JSON.parse(arguments[i])
+      window.$badger.event(obj.handlerId, obj.json)
+    } catch (e) {
+      console.error('$badger event failed: ' + e)
+    }
+  }
 })
 )jssrc";
 
-static void CallBridge(WebKitWebPage* page, const char* scriptSrc, WebKitUserMessage* message)
+// Upper bound on the arguments of a single batched event call
+static constexpr guint kMaxEventsPerCall = 64;
+
+static const char kBridgeStateKey[] = "wpeframework-badger-bridge";
+
+static bool _batchEvents = false;
+
+// Per page: the dispatcher functions, compiled once for the JS context of the current document,
+// and the events waiting for the next main loop iteration when batching is enabled.
+struct BridgeState {
+    BridgeState()
+        : context(nullptr)
+        , reply(nullptr)
+        , event(nullptr)
+        , pending(g_ptr_array_new_with_free_func(reinterpret_cast<GDestroyNotify>(g_bytes_unref)))
+        , flushSource(0)
+    {
+    }
+    ~BridgeState()
+    {
+        if (flushSource != 0) {
+            g_source_remove(flushSource);
+        }
+        g_ptr_array_unref(pending);
+        Reset();
+    }
+
+    void Reset()
+    {
+        g_clear_object(&reply);
+        g_clear_object(&event);
+        g_clear_object(&context);
+    }
+
+    JSCContext* context;
+    JSCValue* reply;
+    JSCValue* event;
+    GPtrArray* pending;
+    guint flushSource;
+};
+
+static BridgeState& State(WebKitWebPage* page)
+{
+    BridgeState* state = static_cast<BridgeState*>(g_object_get_data(G_OBJECT(page), kBridgeStateKey));
+    if (state == nullptr) {
+        state = new BridgeState();
+        g_object_set_data_full(G_OBJECT(page), kBridgeStateKey, state,
+            [](gpointer data) { delete static_cast<BridgeState*>(data); });
+    }
+    return *state;
+}
+
+// Returns the context of the main frame with the dispatchers compiled for it, (re)compiling them
+// only if the document, and with it the context, changed since the last message.
+static JSCContext* Dispatchers(WebKitWebPage* page, BridgeState& state)
+{
+    JSCContext* jsContext = webkit_frame_get_js_context(webkit_web_page_get_main_frame(page));
+
+    if (jsContext != state.context) {
+        state.Reset();
+        state.context = jsContext;
+        state.reply = jsc_context_evaluate(jsContext, kBadgerReplySrc, -1);
+        state.event = jsc_context_evaluate(jsContext, kBadgerEventSrc, -1);
+    } else {
+        g_object_unref(jsContext);
+    }
+
+    return state.context;
+}
+
+static void CallDispatcher(JSCValue* dispatcher, JSCValue** arguments, guint count)
+{
+    JSCValue* ignore = jsc_value_function_callv(dispatcher, count, arguments);
+    if (ignore != nullptr) {
+        g_object_unref(ignore);
+    }
+}
+
+static void FlushEvents(WebKitWebPage* page, BridgeState& state)
 {
-    GVariant* payload;
-    const char* payloadPtr;
+    if (state.flushSource != 0) {
+        g_source_remove(state.flushSource);
+        state.flushSource = 0;
+    }
+    if (state.pending->len == 0) {
+        return;
+    }
+
+    JSCContext* jsContext = Dispatchers(page, state);
 
-    payload = webkit_user_message_get_parameters(message);
-    if (!payload) {
+    JSCValue* arguments[kMaxEventsPerCall];
+    guint index = 0;
+    while (index < state.pending->len) {
+        guint count = std::min(state.pending->len - index, kMaxEventsPerCall);
+        for (guint i = 0; i < count; ++i) {
+            arguments[i] = jsc_value_new_string_from_bytes(jsContext, static_cast<GBytes*>(g_ptr_array_index(state.pending, index + i)));
+        }
+        CallDispatcher(state.event, arguments, count);
+        for (guint i = 0; i < count; ++i) {
+            g_object_unref(arguments[i]);
+        }
+        index += count;
+    }
+
+    g_ptr_array_set_size(state.pending, 0);
+}
+
+// Payloads arrive as the raw UTF-8 bytes of the JSON message, already validated by the browser.
+static GBytes* Payload(WebKitUserMessage* message)
+{
+    GVariant* payload = webkit_user_message_get_parameters(message);
+    if (!payload || !g_variant_is_of_type(payload, G_VARIANT_TYPE_BYTESTRING)) {
+        TRACE_GLOBAL(Trace::Error, (_T("Unexpected $badger message payload!")));
+        return nullptr;
+    }
+    return g_variant_get_data_as_bytes(payload);
+}
+
+static void CallBridge(WebKitWebPage* page, bool isEvent, WebKitUserMessage* message)
+{
+    GBytes* payload = Payload(message);
+    if (payload == nullptr) {
         return;
     }
-    g_variant_get(payload, "&s", &payloadPtr);
-
-    gsize decodedLen = 0;
-    gchar *decoded = reinterpret_cast<gchar*>(g_base64_decode(payloadPtr, &decodedLen));
-    if (g_utf8_validate(decoded, decodedLen, nullptr) == FALSE) {
-        TRACE_GLOBAL(Trace::Error, (_T("Decoded message is not a valid UTF8 string!")));
-        gchar *tmp = decoded;
-#if GLIB_CHECK_VERSION(2, 52, 0)
-        decoded = g_utf8_make_valid(tmp, decodedLen);
-#else
-        decoded = g_strdup("[Invalid UTF-8]");
-#endif
-        g_free(tmp);
-        decodedLen = strlen(decoded);
+
+    BridgeState& state = State(page);
+
+    if (isEvent && _batchEvents) {
+        g_ptr_array_add(state.pending, payload);
+        if (state.flushSource == 0) {
+            state.flushSource = g_idle_add_full(G_PRIORITY_DEFAULT,
+                [](gpointer userData) -> gboolean {
+                    WebKitWebPage* page = static_cast<WebKitWebPage*>(userData);
+                    BridgeState& state = State(page);
+                    state.flushSource = 0;
+                    FlushEvents(page, state);
+                    return G_SOURCE_REMOVE;
+                },
+                page, nullptr);
+        }
+        return;
     }
 
-    WebKitFrame* frame = webkit_web_page_get_main_frame(page);
-    JSCContext* jsContext = webkit_frame_get_js_context(frame);
+    // Keep the order in which the messages were sent
+    FlushEvents(page, state);
 
-    GBytes *payloadBytes = g_bytes_new_take(decoded, decodedLen);
-    JSCValue *payloadVal = jsc_value_new_string_from_bytes(jsContext, payloadBytes);
-    g_bytes_unref(payloadBytes);
+    JSCContext* jsContext = Dispatchers(page, state);
+    JSCValue* payloadVal = jsc_value_new_string_from_bytes(jsContext, payload);
+    g_bytes_unref(payload);
 
-    JSCValue* script = jsc_context_evaluate(jsContext, scriptSrc, -1);
-    JSCValue* ignore = jsc_value_function_call(script, JSC_TYPE_VALUE, payloadVal, G_TYPE_NONE);
+    CallDispatcher(isEvent ? state.event : state.reply, &payloadVal, 1);
 
-    g_object_unref(ignore);
-    g_object_unref(script);
     g_object_unref(payloadVal);
-    g_object_unref(jsContext);
 }
 
 static void OnBridgeQuery(const char* arg, gpointer userData)
 {
     WebKitWebPage* page = reinterpret_cast<WebKitWebPage*>(userData);
-    gchar *b64string = g_base64_encode(reinterpret_cast<const guchar*>(arg), strlen(arg));
     webkit_web_page_send_message_to_view(page,
             webkit_user_message_new(Tags::BridgeObjectQuery,
-                    g_variant_new_take_string(b64string)), nullptr, nullptr, nullptr);
+                    g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, arg, strlen(arg), sizeof(gchar))), nullptr, nullptr, nullptr);
 }
 
 static JSCValue* OnCreateBridgeObject(gpointer userData)
@@ -132,17 +253,27 @@ void InjectJS(WebKitScriptWorld* world, WebKitWebPage* page, WebKitFrame* frame)
     g_object_unref(jsFunction);
     g_object_unref(jsObject);
 
+    // A new document, compile the dispatchers for its context up front
+    BridgeState& state = State(page);
+    state.Reset();
+    Dispatchers(page, state);
+
     g_object_unref(jsContext);
 }
 
+void SetEventBatching(bool enabled)
+{
+    _batchEvents = enabled;
+}
+
 bool HandleMessageToPage(WebKitWebPage* page, const char* messageName, WebKitUserMessage* message)
 {
     if (g_strcmp0(messageName, Tags::BridgeObjectReply) == 0) {
-        CallBridge(page, kBadgerReplySrc, message);
+        CallBridge(page, false, message);
         return true;
     }
     else if (g_strcmp0(messageName, Tags::BridgeObjectEvent) == 0) {
-        CallBridge(page, kBadgerEventSrc, message);
+        CallBridge(page, true, message);
         return true;
     }
     return false;
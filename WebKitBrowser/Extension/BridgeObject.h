@@ -25,6 +25,10 @@ namespace WPEFramework {
 namespace JavaScript {
 namespace BridgeObject {
 
+// When enabled, events arriving within the same main loop iteration are handed to $badger in a
+// single call instead of one call per message.
+void SetEventBatching(bool enabled);
+
 bool HandleMessageToPage(WebKitWebPage*, const char*, WebKitUserMessage*);
 void InjectJS(WebKitScriptWorld*, WebKitWebPage*, WebKitFrame*);
 
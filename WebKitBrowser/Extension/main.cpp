@@ -95,8 +95,13 @@ public:
 
         const char *uid;
         const char *whitelist;
+        gboolean batchBridgeEvents = FALSE;
 
-        g_variant_get((GVariant*) userData, "(&sm&sb)", &uid, &whitelist, &_logToSystemConsoleEnabled);
+        g_variant_get((GVariant*) userData, "(&sm&sbb)", &uid, &whitelist, &_logToSystemConsoleEnabled, &batchBridgeEvents);
+
+#if defined(ENABLE_BADGER_BRIDGE)
+        JavaScript::BridgeObject::SetEventBatching(batchBridgeEvents);
+#endif
 
         g_signal_connect(
           webkit_script_world_get_default(),
@@ -19,12 +19,48 @@
 
 #include "WebKitBrowser.h"
 
+#include <fstream>
+#include <limits>
+
 namespace WPEFramework {
 
 namespace Plugin {
 
     SERVICE_REGISTRATION(WebKitBrowser, 1, 0);
 
+    namespace {
+
+        // A level is only left once the footprint dropped this far below its threshold, so the
+        // governor does not flap around it.
+        constexpr uint8_t HysteresisPercentage = 10;
+
+        // MemAvailable of the system in bytes, 0 if unknown
+        uint64_t AvailableMemory()
+        {
+            uint64_t result = 0;
+            std::ifstream meminfo("/proc/meminfo");
+            string label;
+
+            while ((meminfo >> label) && (label != _T("MemAvailable:"))) {
+                meminfo.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+            if (label == _T("MemAvailable:")) {
+                uint64_t kilobytes = 0;
+                if (meminfo >> kilobytes) {
+                    result = kilobytes * 1024;
+                }
+            }
+
+            return (result);
+        }
+
+        const TCHAR* LevelName(const uint8_t level)
+        {
+            static const TCHAR* names[] = { _T("normal"), _T("moderate"), _T("critical") };
+            return (names[level]);
+        }
+    }
+
     /* virtual */ const string WebKitBrowser::Initialize(PluginHost::IShell* service)
     {
         string message;
@@ -96,6 +132,20 @@ namespace Plugin {
         } else {
             RegisterAll();
             Exchange::JWebBrowser::Register(*this, _browser);
+
+            Config config;
+            config.FromString(_service->ConfigLine());
+
+            _moderateThreshold = static_cast<uint64_t>(config.MemoryGovernor.Moderate.Value()) * 1024 * 1024;
+            _criticalThreshold = static_cast<uint64_t>(config.MemoryGovernor.Critical.Value()) * 1024 * 1024;
+            _availableThreshold = static_cast<uint64_t>(config.MemoryGovernor.MinAvailable.Value()) * 1024 * 1024;
+            _suspendHidden = config.MemoryGovernor.SuspendHidden.Value();
+            _memoryLevel = MemoryLevel::NORMAL;
+
+            if ((_memory != nullptr) && (config.MemoryGovernor.Interval.Value() != 0)
+                && ((_moderateThreshold != 0) || (_criticalThreshold != 0) || (_availableThreshold != 0))) {
+                _governor.Start(config.MemoryGovernor.Interval.Value());
+            }
         }
 
         return message;
@@ -111,6 +161,8 @@ namespace Plugin {
         if (_browser == nullptr)
             return;
 
+        _governor.Stop();
+
         // Make sure we get no longer get any notifications, we are deactivating..
         _service->Unregister(&_notification);
         _browser->Unregister(&_notification);
@@ -245,6 +297,73 @@ namespace Plugin {
         return result;
     }
 
+    void WebKitBrowser::GovernMemory()
+    {
+        ASSERT(_memory != nullptr);
+        ASSERT(_browser != nullptr);
+
+        const uint64_t resident = _memory->Resident();
+        const uint64_t available = (_availableThreshold != 0 ? AvailableMemory() : 0);
+
+        // A threshold counts as crossed when the sample is above it, and as still crossed when we
+        // are at that level or higher and the sample did not drop below the hysteresis band.
+        auto above = [this](const uint64_t sample, const uint64_t threshold, const MemoryLevel level) -> bool {
+            if (threshold == 0) {
+                return (false);
+            }
+            return (_memoryLevel >= level ? (sample > (threshold - ((threshold * HysteresisPercentage) / 100))) : (sample > threshold));
+        };
+        auto below = [this](const uint64_t sample, const uint64_t threshold, const MemoryLevel level) -> bool {
+            if ((threshold == 0) || (sample == 0)) {
+                return (false);
+            }
+            return (_memoryLevel >= level ? (sample < (threshold + ((threshold * HysteresisPercentage) / 100))) : (sample < threshold));
+        };
+
+        MemoryLevel level = MemoryLevel::NORMAL;
+        if ((above(resident, _criticalThreshold, MemoryLevel::CRITICAL) == true) || (below(available, _availableThreshold, MemoryLevel::CRITICAL) == true)) {
+            level = MemoryLevel::CRITICAL;
+        } else if (above(resident, _moderateThreshold, MemoryLevel::MODERATE) == true) {
+            level = MemoryLevel::MODERATE;
+        }
+
+        std::list<string> actions;
+
+        if (level > _memoryLevel) {
+            // Drops the JavaScript heap and the in-memory resource caches of the page
+            _browser->CollectGarbage();
+            actions.push_back(_T("collectgarbage"));
+        }
+
+        // Keep checking while critical, the page might only be sent to the background later
+        if ((level == MemoryLevel::CRITICAL) && (_suspendHidden == true)) {
+            PluginHost::IStateControl* stateControl(_browser->QueryInterface<PluginHost::IStateControl>());
+
+            if (stateControl != nullptr) {
+                bool visible = true;
+                static_cast<const Exchange::IApplication*>(_application)->Visible(visible);
+
+                if ((visible == false) && (stateControl->State() == PluginHost::IStateControl::RESUMED)) {
+                    if (stateControl->Request(PluginHost::IStateControl::SUSPEND) == Core::ERROR_NONE) {
+                        actions.push_back(_T("suspend"));
+                    }
+                }
+                stateControl->Release();
+            }
+        }
+
+        if ((level != _memoryLevel) || (actions.empty() == false)) {
+            const TCHAR* name = LevelName(static_cast<uint8_t>(level));
+
+            SYSLOG(Logging::Notification, (_T("Memory pressure %s: resident %llu kB, available %llu kB, %u action(s)"),
+                name, static_cast<unsigned long long>(resident / 1024), static_cast<unsigned long long>(available / 1024),
+                static_cast<uint32_t>(actions.size())));
+
+            _memoryLevel = level;
+            event_memorypressure(name, resident, available, actions);
+        }
+    }
+
     void WebKitBrowser::LoadFinished(const string& URL, int32_t code)
     {
         string message(string("{ \"url\": \"") + URL + string("\", \"loaded\":true, \"httpstatus\":") + Core::NumberType<int32_t>(code).Text() + string(" }"));
@@ -141,6 +141,147 @@ namespace Plugin {
             Core::JSON::String Path;
         };
 
+    public:
+        class Config : public Core::JSON::Container {
+        private:
+            Config(const Config&) = delete;
+            Config& operator=(const Config&) = delete;
+
+        public:
+            class MemoryGovernorConfig : public Core::JSON::Container {
+            private:
+                MemoryGovernorConfig(const MemoryGovernorConfig&) = delete;
+                MemoryGovernorConfig& operator=(const MemoryGovernorConfig&) = delete;
+
+            public:
+                MemoryGovernorConfig()
+                    : Core::JSON::Container()
+                    , Interval(5)
+                    , Moderate(0)
+                    , Critical(0)
+                    , MinAvailable(0)
+                    , SuspendHidden(true)
+                {
+                    Add(_T("interval"), &Interval);
+                    Add(_T("moderate"), &Moderate);
+                    Add(_T("critical"), &Critical);
+                    Add(_T("minavailable"), &MinAvailable);
+                    Add(_T("suspendhidden"), &SuspendHidden);
+                }
+                ~MemoryGovernorConfig()
+                {
+                }
+
+            public:
+                Core::JSON::DecUInt16 Interval; // Seconds between samples
+                Core::JSON::DecUInt32 Moderate; // Footprint in MB, 0 disables the level
+                Core::JSON::DecUInt32 Critical; // Footprint in MB, 0 disables the level
+                Core::JSON::DecUInt32 MinAvailable; // System MemAvailable in MB below which the level is critical
+                Core::JSON::Boolean SuspendHidden;
+            };
+
+        public:
+            Config()
+                : Core::JSON::Container()
+                , MemoryGovernor()
+            {
+                Add(_T("memorygovernor"), &MemoryGovernor);
+            }
+            ~Config()
+            {
+            }
+
+        public:
+            MemoryGovernorConfig MemoryGovernor;
+        };
+
+        class MemoryPressureData : public Core::JSON::Container {
+        private:
+            MemoryPressureData(const MemoryPressureData&) = delete;
+            MemoryPressureData& operator=(const MemoryPressureData&) = delete;
+
+        public:
+            MemoryPressureData()
+                : Core::JSON::Container()
+                , Level()
+                , Resident(0)
+                , Available(0)
+                , Actions()
+            {
+                Add(_T("level"), &Level);
+                Add(_T("resident"), &Resident);
+                Add(_T("available"), &Available);
+                Add(_T("actions"), &Actions);
+            }
+            ~MemoryPressureData()
+            {
+            }
+
+        public:
+            Core::JSON::String Level;
+            Core::JSON::DecUInt64 Resident;
+            Core::JSON::DecUInt64 Available;
+            Core::JSON::ArrayType<Core::JSON::String> Actions;
+        };
+
+    private:
+        enum class MemoryLevel : uint8_t {
+            NORMAL,
+            MODERATE,
+            CRITICAL
+        };
+
+        // Samples the footprint of the browser processes (WPE process, WebProcess and NetworkProcess)
+        // through the MemoryObserver and the free memory of the system, and makes the plugin release
+        // memory as thresholds are crossed. WebKit's own pressure handler (see "memorypressure") only
+        // looks at each process in isolation, this one also reacts when other residents eat the memory.
+        class MemoryGovernor {
+        private:
+            MemoryGovernor() = delete;
+            MemoryGovernor(const MemoryGovernor&) = delete;
+            MemoryGovernor& operator=(const MemoryGovernor&) = delete;
+
+        public:
+            explicit MemoryGovernor(WebKitBrowser& parent)
+                : _parent(parent)
+                , _job(*this)
+                , _interval(0)
+            {
+            }
+            ~MemoryGovernor()
+            {
+                Stop();
+            }
+
+        public:
+            void Start(const uint16_t interval)
+            {
+                _interval = interval;
+                _job.Schedule(Core::Time::Now().Add(_interval * 1000));
+            }
+            void Stop()
+            {
+                if (_interval != 0) {
+                    _job.Revoke();
+                    _interval = 0;
+                }
+            }
+
+        private:
+            friend Core::ThreadPool::JobType<MemoryGovernor&>;
+
+            void Dispatch()
+            {
+                _parent.GovernMemory();
+                _job.Schedule(Core::Time::Now().Add(_interval * 1000));
+            }
+
+        private:
+            WebKitBrowser& _parent;
+            Core::WorkerPool::JobType<MemoryGovernor&> _job;
+            uint16_t _interval;
+        };
+
     public:
         WebKitBrowser()
             : _skipURL(0)
@@ -150,6 +291,12 @@ namespace Plugin {
             , _application(nullptr)
             , _notification(this)
             , _jsonBodyDataFactory(2)
+            , _governor(*this)
+            , _memoryLevel(MemoryLevel::NORMAL)
+            , _moderateThreshold(0)
+            , _criticalThreshold(0)
+            , _availableThreshold(0)
+            , _suspendHidden(true)
         {
         }
 
@@ -218,6 +365,7 @@ namespace Plugin {
         void BridgeQuery(const string& message);
         void StateChange(const PluginHost::IStateControl::state state);
         uint32_t DeleteDir(const string& path);
+        void GovernMemory();
 
         // JsonRpc
         void RegisterAll();
@@ -231,6 +379,7 @@ namespace Plugin {
         uint32_t set_headers(const Core::JSON::ArrayType<JsonData::WebKitBrowser::HeadersData>& param);
         void event_bridgequery(const string& message);
         void event_statechange(const bool& suspended); // StateControl
+        void event_memorypressure(const string& level, const uint64_t resident, const uint64_t available, const std::list<string>& actions);
 
     private:
         uint8_t _skipURL;
@@ -242,6 +391,12 @@ namespace Plugin {
         Core::Sink<Notification> _notification;
         Core::ProxyPoolType<Web::JSONBodyType<WebKitBrowser::Data>> _jsonBodyDataFactory;
         string _persistentStoragePath;
+        MemoryGovernor _governor;
+        MemoryLevel _memoryLevel;
+        uint64_t _moderateThreshold; // In bytes
+        uint64_t _criticalThreshold;
+        uint64_t _availableThreshold;
+        bool _suspendHidden;
     };
 }
 }
@@ -178,6 +178,20 @@ namespace Plugin {
         Notify(_T("statechange"), params);
     }
 
+    // Event: memorypressure - Signals a change of the memory pressure level or the actions taken to release memory
+    void WebKitBrowser::event_memorypressure(const string& level, const uint64_t resident, const uint64_t available, const std::list<string>& actions)
+    {
+        MemoryPressureData params;
+        params.Level = level;
+        params.Resident = resident;
+        params.Available = available;
+        for (const string& action : actions) {
+            params.Actions.Add() = action;
+        }
+
+        Notify(_T("memorypressure"), params);
+    }
+
     // Event: bridgequery - A message from legacy $badger bridge
     void WebKitBrowser::event_bridgequery(const string& message)
     {
@@ -39,6 +39,7 @@
 #include <WPE/WebKit/WKNotificationManager.h>
 #include <WPE/WebKit/WKNotificationPermissionRequest.h>
 #include <WPE/WebKit/WKNotificationProvider.h>
+#include <WPE/WebKit/WKResourceCacheManager.h>
 #include <WPE/WebKit/WKSoupSession.h>
 #include <WPE/WebKit/WKUserMediaPermissionRequest.h>
 #include <WPE/WebKit/WKErrorRef.h>
@@ -489,6 +490,7 @@ static GSourceFuncs _handlerIntervention =
                 , WatchDogCheckTimeoutInSeconds(0)
                 , WatchDogHangThresholdInSeconds(0)
                 , LoadBlankPageOnSuspendEnabled(false)
+                , BatchBridgeEvents(false)
             {
                 Add(_T("useragent"), &UserAgent);
                 Add(_T("url"), &URL);
@@ -541,6 +543,7 @@ static GSourceFuncs _handlerIntervention =
                 Add(_T("watchdogchecktimeoutinseconds"), &WatchDogCheckTimeoutInSeconds);
                 Add(_T("watchdoghangthresholdtinseconds"), &WatchDogHangThresholdInSeconds);
                 Add(_T("loadblankpageonsuspendenabled"), &LoadBlankPageOnSuspendEnabled);
+                Add(_T("batchbridgeevents"), &BatchBridgeEvents);
             }
             ~Config()
             {
@@ -598,6 +601,7 @@ static GSourceFuncs _handlerIntervention =
             Core::JSON::DecUInt16 WatchDogCheckTimeoutInSeconds;   // How often to check main event loop for responsiveness
             Core::JSON::DecUInt16 WatchDogHangThresholdInSeconds;  // The amount of time to give a process to recover before declaring a hang state
             Core::JSON::Boolean LoadBlankPageOnSuspendEnabled;
+            Core::JSON::Boolean BatchBridgeEvents;
         };
 
         class HangDetector
@@ -1030,13 +1034,40 @@ static GSourceFuncs _handlerIntervention =
             return Core::ERROR_NONE;
         }
 
+#ifdef WEBKIT_GLIB_API
+        // Bridge payloads are base64 encoded on the JSON-RPC interface only. Decode them on the calling
+        // thread so neither the main loop nor the page has to, the extension gets the raw UTF-8 bytes.
+        static GBytes* DecodeBridgePayload(const string& payload)
+        {
+            gsize decodedLen = 0;
+            gchar* decoded = reinterpret_cast<gchar*>(g_base64_decode(payload.c_str(), &decodedLen));
+            if (g_utf8_validate(decoded, decodedLen, nullptr) == FALSE) {
+                TRACE_GLOBAL(Trace::Error, (_T("Decoded message is not a valid UTF8 string!")));
+                gchar* tmp = decoded;
+#if GLIB_CHECK_VERSION(2, 52, 0)
+                decoded = g_utf8_make_valid(tmp, decodedLen);
+#else
+                decoded = g_strdup("[Invalid UTF-8]");
+#endif
+                g_free(tmp);
+                decodedLen = strlen(decoded);
+            }
+            return g_bytes_new_take(decoded, decodedLen);
+        }
+#endif
+
         void SendToBridge(const string& name, const string& payload)
         {
             if (_context == nullptr)
                 return;
 
+#ifdef WEBKIT_GLIB_API
+            using BridgeMessageData = std::tuple<WebKitImplementation*, string, GBytes*>;
+            auto* data = new BridgeMessageData(this, name, DecodeBridgePayload(payload));
+#else
             using BridgeMessageData = std::tuple<WebKitImplementation*, string, string>;
             auto* data = new BridgeMessageData(this, name, payload);
+#endif
 
             g_main_context_invoke_full(
                 _context,
@@ -1047,10 +1078,10 @@ static GSourceFuncs _handlerIntervention =
 
 #ifdef WEBKIT_GLIB_API
                     auto messageName = std::get<1>(data).c_str();
-                    auto messageBody = std::get<2>(data).c_str();
+                    auto messageBody = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, std::get<2>(data), TRUE);
 
                     webkit_web_view_send_message_to_page(object->_view,
-                            webkit_user_message_new(messageName, g_variant_new("s", messageBody)),
+                            webkit_user_message_new(messageName, messageBody),
                             nullptr, nullptr, nullptr);
 #else
                     auto messageName = WKStringCreateWithUTF8CString(std::get<1>(data).c_str());
@@ -1065,6 +1096,9 @@ static GSourceFuncs _handlerIntervention =
                 },
                 data,
                 [](gpointer customdata) {
+#ifdef WEBKIT_GLIB_API
+                    g_bytes_unref(std::get<2>(*static_cast<BridgeMessageData*>(customdata)));
+#endif
                     delete static_cast<BridgeMessageData*>(customdata);
                 });
         }
@@ -1076,12 +1110,16 @@ static GSourceFuncs _handlerIntervention =
                 G_PRIORITY_DEFAULT,
                 [](gpointer customdata) -> gboolean {
                 WebKitImplementation* object = static_cast<WebKitImplementation*>(customdata);
+                // Also drop the in-memory resource caches, the disk cache is left alone
 #ifdef WEBKIT_GLIB_API
                 WebKitWebContext* context = webkit_web_view_get_context(object->_view);
                 webkit_web_context_garbage_collect_javascript_objects(context);
+                webkit_website_data_manager_clear(webkit_web_context_get_website_data_manager(context),
+                    WEBKIT_WEBSITE_DATA_MEMORY_CACHE, 0, nullptr, nullptr, nullptr);
 #else
                 auto context = WKPageGetContext(object->_page);
                 WKContextGarbageCollectJavaScriptObjects(context);
+                WKResourceCacheManagerClearCacheForAllOrigins(WKContextGetResourceCacheManager(context), WKResourceCachesToClearInMemoryOnly);
 #endif
                 return G_SOURCE_REMOVE;
             },
@@ -1997,7 +2035,7 @@ static GSourceFuncs _handlerIntervention =
         {
             webkit_web_context_set_web_extensions_directory(context, browser->_dataPath.c_str());
             // FIX it
-            GVariant* data = g_variant_new("(smsb)", std::to_string(browser->_guid).c_str(), !browser->_config.Whitelist.Value().empty() ? browser->_config.Whitelist.Value().c_str() : nullptr, browser->_config.LogToSystemConsoleEnabled.Value());
+            GVariant* data = g_variant_new("(smsbb)", std::to_string(browser->_guid).c_str(), !browser->_config.Whitelist.Value().empty() ? browser->_config.Whitelist.Value().c_str() : nullptr, browser->_config.LogToSystemConsoleEnabled.Value(), browser->_config.BatchBridgeEvents.Value());
             webkit_web_context_set_web_extensions_initialization_user_data(context, data);
         }
         static void wpeNotifyWPEFrameworkMessageReceivedCallback(WebKitUserContentManager*, WebKitJavascriptResult* message, WebKitImplementation* browser)
@@ -2084,14 +2122,15 @@ static GSourceFuncs _handlerIntervention =
             const char* name = webkit_user_message_get_name(message);
             if (g_strcmp0(name, Tags::BridgeObjectQuery) == 0) {
                 GVariant* payload;
-                const char* payloadPtr;
 
                 payload = webkit_user_message_get_parameters(message);
-                if (!payload) {
+                if (!payload || !g_variant_is_of_type(payload, G_VARIANT_TYPE_BYTESTRING)) {
                     return false;
                 }
-                g_variant_get(payload, "&s", &payloadPtr);
-                string payloadStr(payloadPtr);
+                // The extension sends the raw query, JSON-RPC clients expect it base64 encoded
+                gchar* b64string = g_base64_encode(static_cast<const guchar*>(g_variant_get_data(payload)), g_variant_get_size(payload));
+                string payloadStr(b64string);
+                g_free(b64string);
                 browser->OnBridgeQuery(payloadStr);
             }
             return true;
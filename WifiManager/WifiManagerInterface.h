@@ -33,6 +33,7 @@ namespace WPEFramework {
             virtual uint32_t getCurrentState(const JsonObject& parameters, JsonObject& response) const = 0;
             virtual uint32_t startScan(const JsonObject& parameters, JsonObject& response) const = 0;
             virtual uint32_t stopScan(const JsonObject& parameters, JsonObject& response) = 0;
+            virtual uint32_t getAvailableSSIDs(const JsonObject& parameters, JsonObject& response) const = 0;
             virtual uint32_t getConnectedSSID(const JsonObject& parameters, JsonObject& response) const = 0;
             virtual uint32_t setEnabled(const JsonObject& parameters, JsonObject& response) = 0;
             virtual uint32_t connect(const JsonObject& parameters, JsonObject& response) = 0;
@@ -56,6 +57,7 @@ namespace WPEFramework {
             virtual void onSSIDsChanged() = 0;
             virtual void onWifiSignalThresholdChanged(float signalStrength, const std::string &strength) = 0;
             virtual void onAvailableSSIDs(JsonObject const& ssids) = 0;
+            virtual void onAvailableSSIDsChanged(JsonObject const& changes) = 0;
             //End events
         };
 
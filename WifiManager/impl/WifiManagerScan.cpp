@@ -33,6 +33,7 @@
 // std
 #include <sstream>
 #include <regex>
+#include <cmath>
 
 using namespace WPEFramework;
 using namespace WPEFramework::Plugin;
@@ -53,9 +54,30 @@ namespace
     char const* const g_ssids = "ssids";
     char const* const g_SSID_name = "SSID_name";
     char const* const g_timeout = "timeout";
+    char const* const g_bssid = "bssid";
+    char const* const g_security = "security";
+    char const* const g_signalStrength = "signalStrength";
+    char const* const g_deltasOnly = "deltasOnly";
+    char const* const g_added = "added";
+    char const* const g_changed = "changed";
+    char const* const g_removed = "removed";
+
+    // Access points not seen for this long are no longer reported by 'getAvailableSSIDs'
+    const uint64_t g_bssMaxAgeMs = 5 * 60 * 1000;
+    // A signal change smaller than this (in dBm) is not reported as a change
+    const double g_signalChangeThreshold = 5.0;
+
+    uint64_t nowMs()
+    {
+        return WPEC::Time::Now().Ticks() / WPEC::Time::TicksPerMillisecond;
+    }
 }
 
 WifiManagerScan::Filter WifiManagerScan::filter = {};
+bool WifiManagerScan::deltasOnly = false;
+std::map<std::string, WifiManagerScan::Bss> WifiManagerScan::bssTable;
+uint32_t WifiManagerScan::scanRound = 0;
+std::mutex WifiManagerScan::scanMutex;
 
 /**
  * \brief Register event handlers.
@@ -85,6 +107,9 @@ void WifiManagerScan::Deinitialize(PluginHost::IShell* service)
     IARM_Result_t res;
     IARM_CHECK(IARM_Bus_UnRegisterEventHandler(IARM_BUS_NM_SRV_MGR_NAME, IARM_BUS_WIFI_MGR_EVENT_onAvailableSSIDs));
     IARM_CHECK(IARM_Bus_UnRegisterEventHandler(IARM_BUS_NM_SRV_MGR_NAME, IARM_BUS_WIFI_MGR_EVENT_onAvailableSSIDsIncr));
+
+    std::lock_guard<std::mutex> lock(scanMutex);
+    bssTable.clear();
 }
 
 /**
@@ -92,7 +117,7 @@ void WifiManagerScan::Deinitialize(PluginHost::IShell* service)
  *
  * The results are published on via the "onAvailableSSIDs" event.
  *
- * \param parameters        Must include 'incremental'. Optionally includes 'ssid' and/or 'frequency'.
+ * \param parameters        Must include 'incremental'. Optionally includes 'ssid', 'frequency' and/or 'deltasOnly'.
  * \param[out] response     Always includes 'success' if successful.
  * \return                  A code indicating success.
  *
@@ -104,23 +129,10 @@ uint32_t WifiManagerScan::startScan(const JsonObject &parameters, JsonObject &re
     returnIfBooleanParamNotFound(parameters, g_incremental);
     const bool incremental = parameters[g_incremental].Boolean();
 
-    filter = {};
-
-    if (parameters.HasLabel(g_ssid)) {
-        std::string ssid;
-        getStringParameter(g_ssid, ssid);
-        if (ssid.length()) {
-            filter.onSsid = true;
-            filter.ssid = ssid;
-        }
-    }
-    if (parameters.HasLabel(g_frequency)) {
-        std::string frequency;
-        getStringParameter(g_frequency, frequency);
-        if (frequency.length()) {
-            filter.onFrequency = true;
-            filter.frequency = frequency;
-        }
+    {
+        std::lock_guard<std::mutex> lock(scanMutex);
+        parseFilter(parameters, filter);
+        deltasOnly = parameters.HasLabel(g_deltasOnly) && parameters[g_deltasOnly].Boolean();
     }
 
     if (incremental)
@@ -206,6 +218,41 @@ uint32_t WifiManagerScan::getAvailableSSIDsAsyncIncr(const JsonObject &parameter
     }
 }
 
+/**
+ * \brief Get the access points found by the most recent scans.
+ *
+ * The result is served from the table maintained from the scan events, no scan is started.
+ *
+ * \param parameters    Optionally includes 'ssid' and/or 'frequency', as for 'startScan'.
+ * \param[out] response Will contain 'ssids' and 'success'.
+ * \return              A status code.
+ *
+ */
+uint32_t WifiManagerScan::getAvailableSSIDs(const JsonObject& parameters, JsonObject& response) const
+{
+    LOGINFOMETHOD();
+
+    Filter query;
+    if (!parseFilter(parameters, query)) {
+        response[g_error] = "Invalid ssid regular expression";
+        returnResponse(false);
+    }
+
+    JsonArray ssids;
+    uint64_t const oldest = nowMs() - g_bssMaxAgeMs;
+
+    {
+        std::lock_guard<std::mutex> lock(scanMutex);
+        for (auto const& entry : bssTable) {
+            if ((entry.second.lastSeen >= oldest) && matchesFilter(entry.second.info, query))
+                ssids.Add(entry.second.info);
+        }
+    }
+
+    response[g_ssids] = ssids;
+    returnResponse(true);
+}
+
 /**
  * \brief Cancel a current incremental asynchronous scan started by 'getAvailableSSIDsAsyncIncr'.
  *
@@ -250,7 +297,7 @@ void WifiManagerScan::iarmEventHandler(char const* owner, IARM_EventId_t eventId
     if ((eventId == IARM_BUS_WIFI_MGR_EVENT_onAvailableSSIDs) || (eventId == IARM_BUS_WIFI_MGR_EVENT_onAvailableSSIDsIncr)) {
         IARM_BUS_WiFiSrvMgr_EventData_t const* eventData = reinterpret_cast<IARM_BUS_WiFiSrvMgr_EventData_t*>(data);
 
-        LOGINFO("Event IARM_BUS_WIFI_MGR_EVENT_onAvailableSSIDs[Incr] received. '%s'", eventData->data.wifiSSIDList.ssid_list);
+        LOGINFO("Event IARM_BUS_WIFI_MGR_EVENT_onAvailableSSIDs[Incr] received (%zu bytes).", strlen(eventData->data.wifiSSIDList.ssid_list));
 
         // The returned SSIDs are in a JSON document
         std::string const serialized(eventData->data.wifiSSIDList.ssid_list);
@@ -265,48 +312,154 @@ void WifiManagerScan::iarmEventHandler(char const* owner, IARM_EventId_t eventId
             return;
         }
 
-        JsonArray ssids = eventDocument[g_getAvailableSSIDs].Array();
-        applyFilter(ssids, filter);
-
-        JsonObject params;
-        params[g_ssids] = ssids;
-        params[g_moreData] = eventData->data.wifiSSIDList.more_data;
-        WifiManager::getInstance().onAvailableSSIDs(params);
-    }
-}
+        bool const moreData = eventData->data.wifiSSIDList.more_data;
+        JsonArray const ssids = eventDocument[g_getAvailableSSIDs].Array();
+        JsonArray filtered, added, changed, removed;
+        bool sendFull;
 
-void WifiManagerScan::applyFilter(JsonArray &ssids, const WifiManagerScan::Filter &filter) {
-    JsonArray result;
-    std::regex re;
-    std::smatch m;
-    if(filter.onSsid)
-    {
-        try
         {
-            re = std::regex(filter.ssid);
+            std::lock_guard<std::mutex> lock(scanMutex);
+
+            updateBssTable(ssids, moreData, added, changed, removed);
+
+            sendFull = !deltasOnly;
+            if (sendFull) {
+                for (int i = 0; i < ssids.Length(); i++) {
+                    if (matchesFilter(ssids[i].Object(), filter))
+                        filtered.Add(ssids[i].Object());
+                }
+            }
         }
-        catch(const std::regex_error &e)
-        {
-           LOGERR("Incorrect regex: %s", e.what());
+
+        if (sendFull) {
+            JsonObject params;
+            params[g_ssids] = filtered;
+            params[g_moreData] = moreData;
+            WifiManager::getInstance().onAvailableSSIDs(params);
+        }
+
+        if (added.Length() || changed.Length() || removed.Length()) {
+            JsonObject params;
+            params[g_added] = added;
+            params[g_changed] = changed;
+            params[g_removed] = removed;
+            params[g_moreData] = moreData;
+            WifiManager::getInstance().onAvailableSSIDsChanged(params);
         }
     }
+}
+
+/**
+ * \brief Read the 'ssid' and 'frequency' filter parameters.
+ *
+ * \return False if 'ssid' is not a valid regular expression, in which case nothing is filtered on SSID.
+ *
+ */
+bool WifiManagerScan::parseFilter(const JsonObject& parameters, WifiManagerScan::Filter& filter)
+{
+    bool valid = true;
 
-    for(int i=0; i<ssids.Length(); i++) {
-        JsonObject object = ssids[i].Object();
-        if(filter.onSsid) {
-            std::string str = object[g_ssid].String();
+    filter = {};
 
-            if(!std::regex_match(str, m, re)){
-                LOGINFO("SSID filter out %s ~= %s", str.c_str(), filter.ssid.c_str());
-                continue;
+    if (parameters.HasLabel(g_ssid)) {
+        std::string ssid;
+        getStringParameter(g_ssid, ssid);
+        if (ssid.length()) {
+            try
+            {
+                filter.ssidRegex = std::regex(ssid);
+                filter.onSsid = true;
+                filter.ssid = ssid;
+            }
+            catch(const std::regex_error &e)
+            {
+                LOGERR("Incorrect regex: %s", e.what());
+                valid = false;
             }
         }
-        if(filter.onFrequency && object[g_frequency].String() != filter.frequency) {
-            LOGINFO("Frequency filter out %s != %s", object[g_frequency].String().c_str(), filter.frequency.c_str());
-            continue;
+    }
+    if (parameters.HasLabel(g_frequency)) {
+        std::string frequency;
+        getStringParameter(g_frequency, frequency);
+        if (frequency.length()) {
+            filter.onFrequency = true;
+            filter.frequency = frequency;
+        }
+    }
+
+    return valid;
+}
+
+bool WifiManagerScan::matchesFilter(const JsonObject& object, const WifiManagerScan::Filter& filter)
+{
+    if (filter.onSsid) {
+        std::string const str = object[g_ssid].String();
+        if (!std::regex_match(str, filter.ssidRegex))
+            return false;
+    }
+    if (filter.onFrequency && object[g_frequency].String() != filter.frequency)
+        return false;
+
+    return true;
+}
+
+std::string WifiManagerScan::bssKey(const JsonObject& object)
+{
+    if (object.HasLabel(g_bssid))
+        return object[g_bssid].String();
+
+    return object[g_ssid].String() + '\n' + object[g_frequency].String() + '\n' + object[g_security].String();
+}
+
+/**
+ * \brief Merge the access points of a scan event into the BSS table.
+ *
+ * A scan round ends with the event that has 'moreData' false. Entries that were not reported during
+ * the round are removed at that point.
+ *
+ * \param ssids        The access points from the event.
+ * \param moreData     Whether more events follow for this scan round.
+ * \param[out] added   Access points that were not in the table.
+ * \param[out] changed Access points of which the security changed or the signal moved noticeably.
+ * \param[out] removed Access points that disappeared, only at the end of a round.
+ *
+ * Must be called with 'scanMutex' held.
+ */
+void WifiManagerScan::updateBssTable(const JsonArray& ssids, bool moreData, JsonArray& added, JsonArray& changed, JsonArray& removed)
+{
+    uint64_t const now = nowMs();
+
+    for (int i = 0; i < ssids.Length(); i++) {
+        JsonObject const object = ssids[i].Object();
+        double const signalStrength = atof(object[g_signalStrength].String().c_str());
+
+        auto result = bssTable.emplace(bssKey(object), Bss());
+        Bss& bss = result.first->second;
+
+        if (result.second) {
+            added.Add(object);
+            bss.signalStrength = signalStrength;
+        } else if ((std::abs(bss.signalStrength - signalStrength) >= g_signalChangeThreshold) ||
+                   (bss.info[g_security].String() != object[g_security].String())) {
+            changed.Add(object);
+            // Only move the reference signal when a change is reported, so slow drifts still add up
+            bss.signalStrength = signalStrength;
         }
 
-        result.Add(object);
+        bss.info = object;
+        bss.scanRound = scanRound;
+        bss.lastSeen = now;
+    }
+
+    if (!moreData) {
+        for (auto entry = bssTable.begin(); entry != bssTable.end();) {
+            if (entry->second.scanRound != scanRound) {
+                removed.Add(entry->second.info);
+                entry = bssTable.erase(entry);
+            } else {
+                ++entry;
+            }
+        }
+        scanRound++;
     }
-    ssids = result;
 }
@@ -22,6 +22,9 @@
 #include "../Module.h"
 
 #include <string>
+#include <map>
+#include <mutex>
+#include <regex>
 
 // Forward declaration
 typedef int IARM_EventId_t;
@@ -44,6 +47,7 @@ namespace WPEFramework {
 
             uint32_t startScan(const JsonObject& parameters, JsonObject& response) const;
             uint32_t stopScan(const JsonObject& parameters, JsonObject& response);
+            uint32_t getAvailableSSIDs(const JsonObject& parameters, JsonObject& response) const;
 
         private:
             uint32_t getAvailableSSIDsAsync(const JsonObject& parameters, JsonObject& response) const;
@@ -54,12 +58,32 @@ namespace WPEFramework {
             struct Filter {
                 bool onSsid = false;
                 std::string ssid;
+                std::regex ssidRegex;
                 bool onFrequency = false;
                 std::string frequency;
             };
 
-            static void applyFilter(JsonArray &object, const WifiManagerScan::Filter &filter);
+            /**
+             * An access point as last reported by the service manager. Entries are keyed by BSSID, or by
+             * SSID/frequency/security when the service manager does not report BSSIDs.
+             */
+            struct Bss {
+                JsonObject info;
+                double signalStrength = 0;
+                uint32_t scanRound = 0;
+                uint64_t lastSeen = 0;
+            };
+
+            static bool parseFilter(const JsonObject& parameters, Filter& filter);
+            static bool matchesFilter(const JsonObject& object, const Filter& filter);
+            static std::string bssKey(const JsonObject& object);
+            static void updateBssTable(const JsonArray& ssids, bool moreData, JsonArray& added, JsonArray& changed, JsonArray& removed);
+
             static Filter filter;
+            static bool deltasOnly;
+            static std::map<std::string, Bss> bssTable;
+            static uint32_t scanRound;
+            static std::mutex scanMutex;
         };
     } // namespace Plugin
 } // namespace WPEFramework
@@ -21,6 +21,7 @@
 
 #include "utils.h"
 
+#include <algorithm>
 #include <chrono>
 
 using namespace WPEFramework::Plugin;
@@ -30,30 +31,41 @@ namespace {
     const float signalStrengthThresholdGood = -60.0f;
     const float signalStrengthThresholdFair = -67.0f;
 
-    void getSignalData(WifiManagerInterface &wifiManager, float &signalStrengthOut, std::string &strengthOut) {
+    // A new strength is only reported once the signal is this far (in dBm) outside the range of the
+    // previously reported one, so a signal hovering around a threshold does not flood with events.
+    const float signalStrengthHysteresis = 2.0f;
+
+    // While the strength stays the same the polling interval doubles, up to this many times the
+    // interval requested by the client.
+    const int maxIntervalFactor = 8;
+
+    float getSignalStrength(WifiManagerInterface &wifiManager) {
         JsonObject response;
         wifiManager.getConnectedSSID(JsonObject(), response);
 
-        signalStrengthOut = 0.0f;
+        float signalStrength = 0.0f;
         if (response.HasLabel("signalStrength")) {
-            signalStrengthOut = std::stof(response["signalStrength"].String());
+            signalStrength = std::stof(response["signalStrength"].String());
         }
+        return signalStrength;
+    }
 
-        if (signalStrengthOut >= signalStrengthThresholdExcellent && signalStrengthOut < 0)
+    std::string getStrength(float signalStrength) {
+        if (signalStrength >= signalStrengthThresholdExcellent && signalStrength < 0)
         {
-            strengthOut = "Excellent";
+            return "Excellent";
         }
-        else if (signalStrengthOut >= signalStrengthThresholdGood && signalStrengthOut < signalStrengthThresholdExcellent)
+        else if (signalStrength >= signalStrengthThresholdGood && signalStrength < signalStrengthThresholdExcellent)
         {
-            strengthOut = "Good";
+            return "Good";
         }
-        else if (signalStrengthOut >= signalStrengthThresholdFair && signalStrengthOut < signalStrengthThresholdGood)
+        else if (signalStrength >= signalStrengthThresholdFair && signalStrength < signalStrengthThresholdGood)
         {
-            strengthOut = "Fair";
+            return "Fair";
         }
         else
         {
-            strengthOut = "Weak";
+            return "Weak";
         };
     }
 }
@@ -145,30 +157,54 @@ void WifiManagerSignalThreshold::loop(int interval)
 {
     std::unique_lock<std::mutex> lk(cv_mutex);
     std::string lastStrength = "";
+    int pollInterval = interval;
 
     while(changeEnabled)
     {
-        float signalStrength;
-        std::string strength;
-        if (running)
+        if (!running)
         {
-            getSignalData(wifiManager, signalStrength, strength);
+            // Nothing to measure while not connected, sleep until connected again or disabled
+            cv.wait(lk, [this](){ return changeEnabled == false || running; });
+            pollInterval = interval;
+            continue;
+        }
+
+        lk.unlock();
+        float signalStrength = getSignalStrength(wifiManager);
+        lk.lock();
 
+        std::string strength = getStrength(signalStrength);
+        bool nearThreshold = (getStrength(signalStrength - signalStrengthHysteresis) != getStrength(signalStrength + signalStrengthHysteresis));
 
-            if (strength != lastStrength)
-            {
-                LOGINFO("Triggering onWifiSignalThresholdChanged notification");
-                wifiManager.onWifiSignalThresholdChanged(signalStrength, strength);
-                lastStrength = strength;
-            }
+        if ((strength != lastStrength) &&
+            (lastStrength.empty() ||
+             ((getStrength(signalStrength - signalStrengthHysteresis) != lastStrength) && (getStrength(signalStrength + signalStrengthHysteresis) != lastStrength))))
+        {
+            LOGINFO("Triggering onWifiSignalThresholdChanged notification");
+            wifiManager.onWifiSignalThresholdChanged(signalStrength, strength);
+            lastStrength = strength;
+            pollInterval = interval;
+        }
+        else if (nearThreshold)
+        {
+            pollInterval = interval;
         }
-        cv.wait_for(lk, std::chrono::milliseconds(interval), [this](){ return changeEnabled == false; });
+        else
+        {
+            pollInterval = std::min(pollInterval * 2, interval * maxIntervalFactor);
+        }
+
+        cv.wait_for(lk, std::chrono::milliseconds(pollInterval), [this](){ return changeEnabled == false || running == false; });
     }
 }
 
 void WifiManagerSignalThreshold::stopThread()
 {
-    changeEnabled = false;
+    {
+        // Under the lock, so the thread can not miss the wake up while it has no timeout
+        std::lock_guard<std::mutex> lk(cv_mutex);
+        changeEnabled = false;
+    }
     cv.notify_one();
     if(thread.joinable()) {
         thread.join();
@@ -180,7 +216,11 @@ void WifiManagerSignalThreshold::stopThread()
 void WifiManagerSignalThreshold::setSignalThresholdChangeEnabled(bool enable)
 {
     LOGINFO("setSignalThresholdChangeEnabled: enable %s", enable ? "true":"false");
-    running = enable;
+    {
+        std::lock_guard<std::mutex> lk(cv_mutex);
+        running = enable;
+    }
+    cv.notify_one();
 }
 
 void WifiManagerSignalThreshold::startThread(int interval)
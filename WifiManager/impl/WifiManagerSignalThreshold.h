@@ -39,7 +39,8 @@ namespace WPEFramework {
             // From WifiManager module.
             //
             // As the onWifiSignalTresholdChanged event is signalled periodically,
-            // it has to be handled with an additional thread.
+            // it has to be handled with an additional thread. The thread sleeps while
+            // not connected and polls less often while the strength does not change.
         public:
             WifiManagerSignalThreshold(WifiManagerInterface &wifiManager);
             virtual ~WifiManagerSignalThreshold();
@@ -0,0 +1,331 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef ENABLE_TELEMETRY_LOGGING
+#include <telemetry_busmessage_sender.h>
+#endif
+
+namespace Utils
+{
+    // Telemetry markers are not sent from the caller's thread, they go out once per window.
+    //
+    // Errors (post) are limited: identical ones (same marker and value) posted within a window are
+    // sent once, followed by "<marker>_COUNT" with the number of them if there were more. Every
+    // source (the LOGERR format string) can add at most a limited number of different errors per
+    // window, the rest is dropped and only counted in THUNDER_TELEMETRY_DROPPED.
+    //
+    // Events (postEvent, e.g. logApplicationEvent) carry a value the receiver acts on, they are
+    // sent one for one and as they were posted, never merged or dropped.
+    //
+    // Markers go to T2 if built with ENABLE_TELEMETRY_LOGGING and, one "marker<TAB>value" line each,
+    // to a file if one is configured.
+    //
+    // Header only, as most plugins include utils.h without building utils.cpp. Plugins are loaded
+    // on their own, so every plugin that sends telemetry has a queue and a worker thread of its own.
+    // The thread is started by the first marker and ends after a window without any.
+    //
+    // Environment: RDKSERVICES_TELEMETRY_FILE (file sink), RDKSERVICES_TELEMETRY_WINDOW (mS,
+    // default 1000) and RDKSERVICES_TELEMETRY_SOURCE_LIMIT (default 10, 0 is unlimited).
+    class TelemetryQueue
+    {
+    public:
+        static constexpr uint32_t defaultWindow = 1000;
+        static constexpr uint32_t defaultSourceLimit = 10;
+
+        // Send right away when this many different markers are waiting
+        static constexpr uint32_t maxBatch = 256;
+
+        static TelemetryQueue& instance()
+        {
+            static TelemetryQueue queue;
+            return queue;
+        }
+
+        // Nothing is done with posted markers if there is no sink, so callers can skip building them
+        bool isEnabled() const
+        {
+            return m_enabled;
+        }
+
+        void configure(const std::string& file, uint32_t window, uint32_t sourceLimit)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            m_file = file;
+            m_window = defaultWindow;
+            if (window != 0)
+                m_window = window;
+            m_sourceLimit = sourceLimit;
+            m_enabled = (m_t2 || (m_file.empty() == false));
+            m_configuration++;
+
+            m_signal.notify_one();
+        }
+
+        void post(const std::string& source, const std::string& marker, const std::string& value)
+        {
+            if (m_enabled == false)
+                return;
+
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (m_stopping == true)
+                return;
+
+            std::string key(marker);
+            key += '\0';
+            key += value;
+
+            std::map<std::string, size_t>::iterator index = m_index.find(key);
+            if (index != m_index.end())
+            {
+                // Repeats are always counted, only new markers are limited
+                m_pending[index->second].count++;
+                return;
+            }
+
+            uint32_t& posted = m_sources[source];
+            if ((m_sourceLimit != 0) && (posted >= m_sourceLimit))
+            {
+                m_dropped++;
+                return;
+            }
+            posted++;
+
+            m_index.emplace(key, m_pending.size());
+            m_pending.push_back(Entry { marker, value, 1 });
+
+            queued();
+        }
+
+        void postEvent(const std::string& marker, const std::string& value)
+        {
+            if (m_enabled == false)
+                return;
+
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (m_stopping == true)
+                return;
+
+            m_pending.push_back(Entry { marker, value, 1 });
+
+            queued();
+        }
+
+        // Sends what is waiting now instead of at the end of the window
+        void flush()
+        {
+            std::vector<Entry> entries;
+            uint32_t dropped = 0;
+
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                take(entries, dropped);
+            }
+
+            send(entries, dropped);
+        }
+
+    private:
+        struct Entry
+        {
+            std::string marker;
+            std::string value;
+            uint32_t count;
+        };
+
+        TelemetryQueue()
+            : m_enabled(false)
+            , m_stopping(false)
+            , m_running(false)
+            , m_t2(false)
+            , m_window(defaultWindow)
+            , m_sourceLimit(defaultSourceLimit)
+            , m_dropped(0)
+            , m_configuration(0)
+        {
+#ifdef ENABLE_TELEMETRY_LOGGING
+            m_t2 = true;
+#endif
+            const char* value = getenv("RDKSERVICES_TELEMETRY_FILE");
+            if (value != nullptr)
+                m_file = value;
+
+            value = getenv("RDKSERVICES_TELEMETRY_WINDOW");
+            if ((value != nullptr) && (atoi(value) > 0))
+                m_window = atoi(value);
+
+            value = getenv("RDKSERVICES_TELEMETRY_SOURCE_LIMIT");
+            if ((value != nullptr) && (atoi(value) >= 0))
+                m_sourceLimit = atoi(value);
+
+            m_enabled = (m_t2 || (m_file.empty() == false));
+        }
+
+        ~TelemetryQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_stopping = true;
+                m_signal.notify_one();
+            }
+
+            if (m_worker.joinable() == true)
+                m_worker.join();
+
+            flush();
+
+            m_enabled = false;
+        }
+
+        TelemetryQueue(const TelemetryQueue&) = delete;
+        TelemetryQueue& operator=(const TelemetryQueue&) = delete;
+
+        // Called with the lock taken
+        void queued()
+        {
+            if (m_running == false)
+            {
+                // Done with its last window, it does not need the lock anymore
+                if (m_worker.joinable() == true)
+                    m_worker.join();
+
+                m_running = true;
+                m_worker = std::thread(&TelemetryQueue::run, this);
+            }
+            else if (m_pending.size() >= maxBatch)
+            {
+                m_signal.notify_one();
+            }
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+
+            while (m_stopping == false)
+            {
+                // A new configuration ends the window, the next one is as configured
+                const uint32_t configuration = m_configuration;
+                m_signal.wait_for(lock, std::chrono::milliseconds(m_window), [this, configuration]() {
+                    return (m_stopping == true) || (m_pending.size() >= maxBatch) || (m_configuration != configuration);
+                });
+
+                std::vector<Entry> entries;
+                uint32_t dropped = 0;
+                take(entries, dropped);
+
+                if ((entries.empty() == true) && (dropped == 0))
+                    break;
+
+                lock.unlock();
+                send(entries, dropped);
+                lock.lock();
+            }
+
+            m_running = false;
+        }
+
+        // Starts a new window, called with the lock taken
+        void take(std::vector<Entry>& entries, uint32_t& dropped)
+        {
+            entries.swap(m_pending);
+            m_index.clear();
+            m_sources.clear();
+            dropped = m_dropped;
+            m_dropped = 0;
+        }
+
+        void send(std::vector<Entry>& entries, uint32_t dropped)
+        {
+            if (dropped != 0)
+                entries.push_back(Entry { "THUNDER_TELEMETRY_DROPPED", std::to_string(dropped), 1 });
+
+            if (entries.empty() == true)
+                return;
+
+            std::lock_guard<std::mutex> lock(m_sendLock);
+
+            std::string file;
+            {
+                std::lock_guard<std::mutex> configLock(m_lock);
+                file = m_file;
+            }
+
+            FILE* sink = (file.empty() == false ? fopen(file.c_str(), "a") : nullptr);
+
+            for (Entry& entry : entries)
+            {
+                emit(sink, entry.marker, entry.value);
+
+                if (entry.count > 1)
+                    emit(sink, entry.marker + "_COUNT", std::to_string(entry.count));
+            }
+
+            if (sink != nullptr)
+                fclose(sink);
+        }
+
+        static void emit(FILE* sink, std::string marker, std::string value)
+        {
+#ifdef ENABLE_TELEMETRY_LOGGING
+            // t2_event_s does not take const, but leaves the strings alone
+            t2_event_s(&marker[0], &value[0]);
+#endif
+            if (sink != nullptr)
+                fprintf(sink, "%s\t%s\n", marker.c_str(), value.c_str());
+        }
+
+    private:
+        std::atomic<bool> m_enabled;
+        bool m_stopping;
+        bool m_running; // m_worker has not left run() yet
+        bool m_t2;
+        std::string m_file;
+        uint32_t m_window;
+        uint32_t m_sourceLimit;
+
+        std::mutex m_lock;
+        std::condition_variable m_signal;
+        std::thread m_worker;
+        std::vector<Entry> m_pending;
+        std::map<std::string, size_t> m_index; // marker '\0' value -> m_pending
+        std::map<std::string, uint32_t> m_sources; // Different markers posted in this window
+        uint32_t m_dropped;
+        uint32_t m_configuration; // Changed by every configure()
+
+        std::mutex m_sendLock;
+    };
+} // namespace Utils
@@ -32,6 +32,7 @@
 #ifdef ENABLE_TELEMETRY_LOGGING
 #include <telemetry_busmessage_sender.h>
 #endif
+#include "TelemetryQueue.h"
 
 // IARM
 #include "rdk/iarmbus/libIARM.h"
@@ -405,35 +406,31 @@ namespace Utils
 
         static void sendMessage(char* message)
         {
-#ifdef ENABLE_TELEMETRY_LOGGING
-            t2_event_s("THUNDER_MESSAGE", message);
-#endif
+            if (message != nullptr)
+                TelemetryQueue::instance().postEvent("THUNDER_MESSAGE", message);
         };
 
         static void sendMessage(char *marker, char* message)
         {
-#ifdef ENABLE_TELEMETRY_LOGGING
-            t2_event_s(marker, message);
-#endif
+            if ((marker != nullptr) && (message != nullptr))
+                TelemetryQueue::instance().postEvent(marker, message);
         };
 
         static void sendError(const char* format, ...)
         {
-#ifdef ENABLE_TELEMETRY_LOGGING
-            va_list parameters;
-            va_start(parameters, format);
-            std::string message;
-            WPEFramework::Trace::Format(message, format, parameters);
-            va_end(parameters);
-
-            // get rid of const for t2_event_s
-            char* error = strdup(message.c_str());
-            t2_event_s("THUNDER_ERROR", error);
-            if (error)
+            TelemetryQueue& queue = TelemetryQueue::instance();
+
+            if (queue.isEnabled() == true)
             {
-                free(error);
+                va_list parameters;
+                va_start(parameters, format);
+                std::string message;
+                WPEFramework::Trace::Format(message, format, parameters);
+                va_end(parameters);
+
+                // The LOGERR call site is the source, one noisy error can not crowd out the others
+                queue.post(format, "THUNDER_ERROR", message);
             }
-#endif
         };
     };
 } // namespace Utils